@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Memento.hpp"
+#include "Node2.hpp"
 #include <core/common.h>
+#include <deque>
 
 namespace kpi {
 
@@ -32,20 +34,32 @@ struct SelectionManager {
   std::vector<std::pair<void*, std::function<void(void)>>> mUndoRedoCbs;
 };
 
+// Each commit records only what changed since the last one; unchanged nodes
+// share the previous records.
 class History {
 public:
   void commit(const auto& doc, SelectionManager* sel = nullptr,
               bool select_reset = false) {
-    if (history_cursor >= 0)
+    if (history_cursor >= 0) {
       root_history.erase(root_history.begin() + history_cursor + 1,
                          root_history.end());
+      needs_select_reset.erase(needs_select_reset.begin() + history_cursor + 1,
+                               needs_select_reset.end());
+      record_bytes.erase(record_bytes.begin() + history_cursor + 1,
+                         record_bytes.end());
+    }
+    RecordContext ctx{.trust_dirty = dirty_tracking};
+    tRecordContext = &ctx;
     root_history.push_back(setNext(
         doc, root_history.empty() ? nullptr : root_history.back().get()));
+    tRecordContext = nullptr;
+    record_bytes.push_back(ctx.bytes);
     needs_select_reset.push_back(select_reset);
     if (select_reset && sel != nullptr) {
       sel->onUndoRedo_ResetSelection();
     }
     ++history_cursor;
+    evict();
   }
   void undo(auto& doc, SelectionManager& sel) {
     if (history_cursor <= 0)
@@ -67,18 +81,57 @@ public:
   std::size_t cursor() const { return history_cursor; }
   std::size_t size() const { return root_history.size(); }
 
+  // When set, commit() re-records only nodes marked dirty (IObject::markDirty)
+  // rather than comparing every node to its last record. Every edit must then
+  // mark what it touched.
+  void setDirtyTracking(bool b) { dirty_tracking = b; }
+  bool dirtyTracking() const { return dirty_tracking; }
+
+  // Drop the oldest undo steps once the history is estimated to exceed
+  // |bytes|. 0 (the default) keeps everything.
+  void setMemoryCap(std::size_t bytes) {
+    memory_cap = bytes;
+    evict();
+  }
+  // Estimated bytes held by the history: a full document for the oldest step,
+  // plus the records each later step added.
+  std::size_t memoryUsage() const {
+    std::size_t total = 0;
+    for (auto b : record_bytes) {
+      total += b;
+    }
+    return total;
+  }
+
 private:
   // At the roots, we don't need persistence
   // We don't ever expose history to anyone -- only the current document
-  std::vector<std::shared_ptr<const IMemento>> root_history;
+  std::deque<std::shared_ptr<const IMemento>> root_history;
   // Adding an additional item could mean selected.mActive points to a now-stale
   // object.
-  std::vector<bool> needs_select_reset;
+  std::deque<bool> needs_select_reset;
+  // Bytes of the records new to each step
+  std::deque<std::size_t> record_bytes;
   signed history_cursor = -1;
+  bool dirty_tracking = false;
+  std::size_t memory_cap = 0;
 
   void rollbackTo(auto& doc, unsigned position) {
     rollback(doc, *root_history[position].get());
   }
+  // The current step is never dropped
+  void evict() {
+    while (memory_cap != 0 && history_cursor > 0 &&
+           memoryUsage() > memory_cap) {
+      // The next step becomes the oldest, and now holds a whole document
+      // (mostly records shared with the step being dropped).
+      record_bytes[1] = record_bytes[0];
+      root_history.pop_front();
+      needs_select_reset.pop_front();
+      record_bytes.pop_front();
+      --history_cursor;
+    }
+  }
 };
 
 } // namespace kpi
@@ -25,6 +25,20 @@ struct IObject {
   ICollection* collectionOf = nullptr;
   // The owner of the collection
   IObject* childOf = nullptr;
+
+  // Flags this object, and everything that owns it, as possibly differing from
+  // its last history record. See History::setDirtyTracking.
+  void markDirty() const {
+    for (const IObject* it = this; it != nullptr; it = it->childOf) {
+      it->dirty = true;
+    }
+  }
+  bool isDirty() const { return dirty; }
+  void clearDirty() const { dirty = false; }
+
+private:
+  // New objects have never been recorded
+  mutable bool dirty = true;
 };
 
 struct INamed {
@@ -172,6 +186,9 @@ public:
   const T* at(std::size_t i) const {
     return low == nullptr ? nullptr : reinterpret_cast<const T*>(low->at(i));
   }
+  const IObject* objectAt(std::size_t i) const {
+    return low == nullptr ? nullptr : low->atObject(i);
+  }
   ConstCollectionRange() : low(nullptr) {}
   ConstCollectionRange(const ICollection* src) : low(src) {}
   ConstCollectionRange(const ConstCollectionRange& src) : low(src.low) {
@@ -332,8 +349,12 @@ template <typename T> struct CollectionImpl final : public ICollection {
     auto& last = data.emplace_back(std::make_unique<element_type>());
     last->collectionOf = this;
     last->childOf = parent;
+    last->markDirty();
   }
   void resize(std::size_t size) override {
+    if (parent != nullptr && size != data.size()) {
+      parent->markDirty();
+    }
     auto old_size = data.size();
     data.resize(size);
 
@@ -350,6 +371,9 @@ template <typename T> struct CollectionImpl final : public ICollection {
   }
   void swap(std::size_t a, std::size_t b) override {
     std::swap(data[a], data[b]);
+    // Records are matched to objects by index
+    data[a]->markDirty();
+    data[b]->markDirty();
   }
   CollectionImpl(INode* _parent) : parent(_parent) {}
   CollectionImpl(const CollectionImpl& rhs) : parent(rhs.parent) {
@@ -395,6 +419,18 @@ template <typename T> using MementoIfy = typename _MementoIfy<T>::_type;
 template <typename T>
 using ConstPersistentVec = std::vector<std::shared_ptr<const MementoIfy<T>>>;
 
+// State of the commit being recorded on this thread
+struct RecordContext {
+  // Reuse the last record of any object not marked dirty, unseen
+  bool trust_dirty = false;
+  // Estimated bytes of new records
+  std::size_t bytes = 0;
+};
+inline thread_local RecordContext* tRecordContext = nullptr;
+
+// Estimated size of a record. Overload for records owning large buffers.
+template <typename T> std::size_t recordSize(const T&) { return sizeof(T); }
+
 template <typename T, typename U> bool should_set(const T* out, const U* in) {
   assert(in);
   if (out == nullptr)
@@ -417,24 +453,32 @@ std::shared_ptr<R> set_m(const T* last, const U& in) {
   }
 }
 
-// Create a composite memento
+// Create a composite memento. Unchanged elements share their last record.
 template <typename InT, typename OutT, typename OldT>
 void nextFolder(OutT& out, const InT& in, const OldT* old) {
   using record_t = MementoIfy<typename OutT::value_type::element_type>;
-  if (old != nullptr) {
-    auto& last = *old;
-    out.resize(in.size());
-    for (size_t i = 0; i < in.size(); ++i) {
-      if (i < last.size() && should_set(last[i].get(), &in[i])) {
-        out[i] = set_m<record_t>(last[i].get(), in[i]);
+  const bool trust_dirty =
+      tRecordContext != nullptr && tRecordContext->trust_dirty;
+  out.resize(in.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    const IObject* obj = in.objectAt(i);
+    const auto* last =
+        old != nullptr && i < old->size() ? (*old)[i].get() : nullptr;
+    if (last != nullptr && ((trust_dirty && obj != nullptr && !obj->isDirty()) ||
+                            !should_set(last, &in[i]))) {
+      out[i] = (*old)[i];
+    } else {
+      if (last != nullptr) {
+        out[i] = set_m<record_t>(last, in[i]);
       } else {
         out[i] = std::make_shared<const record_t>(in[i]);
       }
+      if (tRecordContext != nullptr) {
+        tRecordContext->bytes += recordSize(*out[i]);
+      }
     }
-  } else {
-    out.resize(in.size());
-    for (size_t i = 0; i < in.size(); ++i) {
-      out[i] = std::make_shared<const record_t>(in[i]);
+    if (obj != nullptr) {
+      obj->clearDirty();
     }
   }
 }
@@ -477,5 +521,9 @@ void fromFolder(OutT&& out /*rvalue range*/, const InT& in) {
       // Rationale: New objects likely do not have observers.
     }
   }
+  // Everything now matches the record being restored
+  for (size_t i = 0; i < out.size(); ++i) {
+    out.low->atObject(i)->clearDirty();
+  }
 }
 } // namespace kpi
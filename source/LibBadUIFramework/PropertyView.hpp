@@ -32,6 +32,7 @@ public:
     for (T* it : mAffected) {
       if (!(get(*it) == after)) {
         set(*it, after);
+        markDirty(it);
       }
     }
 
@@ -43,7 +44,14 @@ public:
       mCommit("Property Update");
     }
   }
-  void commit(const char* s) { mCommit(s); }
+  // For edits made directly on the active/affected objects
+  void commit(const char* s) {
+    markDirty(&mActive);
+    for (T* it : mAffected) {
+      markDirty(it);
+    }
+    mCommit(s);
+  }
 
   template <typename TGet, typename TSet, typename TVal>
   void propertyAbstract(TGet get, TSet set, const TVal& after) {
@@ -79,6 +87,16 @@ public:
   KPI_PROPERTY(delegate, delegate.getActive().before, after, before)
 
 private:
+  static void markDirty(const T* x) {
+    if constexpr (std::is_base_of_v<IObject, T>) {
+      x->markDirty();
+    } else if constexpr (std::is_polymorphic_v<T>) {
+      if (const auto* obj = dynamic_cast<const IObject*>(x)) {
+        obj->markDirty();
+      }
+    }
+  }
+
   T& mActive;
 
 public:
@@ -18,6 +18,7 @@
 // --cull_invalid
 // --recompute_normals off
 // --fuse_vertices on
+// --optimize
 //
 using bool32 = uint32_t;
 
@@ -56,6 +57,10 @@ enum {
 
   TYPE_BRRES2JSON,
   TYPE_JSON2BRRES,
+
+  // SZS, over a folder
+  TYPE_COMPRESS_BATCH,
+  TYPE_DECOMPRESS_BATCH,
 };
 
 template <size_t L> struct CFixedString {
@@ -90,6 +95,11 @@ struct CliOptions {
   uint32_t szs_algo = 0;
   uint32_t texture_format = 0xE;
   bool32 yay0 = false;
+  uint32_t threads = 1;
+  bool32 force = false;
+  uint32_t palette_format = 2; // RGB5A3
+  uint32_t quality = 1;
+  bool32 optimize = false;
 };
 
 std::optional<CliOptions> parse(int argc, const char** argv);
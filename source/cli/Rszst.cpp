@@ -1,7 +1,9 @@
 #include "Cli.hpp"
+#include <atomic>
 #include <core/util/oishii.hpp>
 #include <core/util/timestamp.hpp>
 #include <fmt/color.h>
+#include <fstream>
 #include <iostream>
 #include <librii/assimp/LRAssimp.hpp>
 #include <librii/assimp2rhst/Assimp.hpp>
@@ -10,6 +12,7 @@
 #include <librii/crate/j3d_crate.hpp>
 #include <librii/g3d/io/JSON.hpp>
 #include <librii/g3d/io/TextureIO.hpp>
+#include <librii/image/Palette.hpp>
 #include <librii/j3d/PreciseBMDDump.hpp>
 #include <librii/kcol/Model.hpp>
 #include <librii/kmp/io/KMP.hpp>
@@ -27,6 +30,7 @@
 #include <rsl/Filesystem.hpp>
 #include <rsl/Stb.hpp>
 #include <rsl/StringManip.hpp>
+#include <rsl/ThreadPool.hpp>
 #include <rsl/Timer.hpp>
 #include <rsl/WriteFile.hpp>
 #include <sstream>
@@ -88,6 +92,21 @@ static auto GetMips(const CliOptions& opt)
   };
 }
 
+// Only BRRES buffers have fixed-point formats to choose from
+static void OptimizeVertexBuffers(riistudio::g3d::Collection& scene) {
+  riistudio::rhst::QuantizeReport total;
+  for (auto& mdl : scene.getModels()) {
+    const auto report = riistudio::rhst::OptimizeVertexQuantization(mdl);
+    total.buffers += report.buffers;
+    total.bytes_before += report.bytes_before;
+    total.bytes_after += report.bytes_after;
+  }
+  fmt::print(stdout,
+             "Requantized {} vertex buffers: {} -> {} bytes ({} saved)\n",
+             total.buffers, total.bytes_before, total.bytes_after,
+             total.bytes_before - total.bytes_after);
+}
+
 #define FS_TRY(expr)                                                           \
   TRY(expr.transform_error([](const std::error_code& ec) -> std::string {      \
     return std::format("Filesystem Error: {} ({}:{})", ec.message(), __FILE__, \
@@ -150,6 +169,9 @@ public:
     if (!ok) {
       return std::unexpected("Failed to parse RHST");
     }
+    if (m_opt.optimize) {
+      OptimizeVertexBuffers(*m_result);
+    }
     std::unordered_map<std::string, librii::crate::CrateAnimation> presets;
     if (FS_TRY(rsl::filesystem::exists(m_presets)) &&
         FS_TRY(rsl::filesystem::is_directory(m_presets))) {
@@ -271,6 +293,9 @@ public:
     if (!pok) {
       return std::unexpected("Failed to parse args: " + pok.error());
     }
+    if (m_opt.optimize) {
+      return std::unexpected("--optimize only applies to .brres output");
+    }
     if (!librii::assimp2rhst::IsExtensionSupported(m_from.string())) {
       return std::unexpected("File format is unsupported");
     }
@@ -439,27 +464,65 @@ public:
     if (!pok) {
       return std::unexpected("Error: failed to parse args: " + pok.error());
     }
+    if (FS_TRY(rsl::filesystem::exists(m_to)) &&
+        FS_TRY(rsl::filesystem::is_directory(m_to))) {
+      return std::unexpected("Failed to extract: |to| is a folder, not a file");
+    }
+    std::ifstream in(m_from, std::ios::binary);
+    std::array<u8, 16> header{};
+    if (!in.read(reinterpret_cast<char*>(header.data()), header.size())) {
+      return std::unexpected("Error: Failed to read file");
+    }
+    in.seekg(0);
+    if (librii::szs::isDataYaz0Compressed(header)) {
+      fmt::print(stderr, "Decompressing SZS: {} => {}\n", m_from.string(),
+                 m_to.string());
+      return decompressStream(in);
+    }
     auto file = ReadFile(m_opt.from.view());
     if (!file.has_value()) {
       return std::unexpected("Error: Failed to read file");
     }
     // Max 4GB
     u32 size = TRY(librii::szs::getExpandedSize(*file));
-    std::string fmt = librii::szs::isDataYaz0Compressed(*file) ? "SZS" : "SZP";
-    fmt::print(stderr, "Decompressing {}: {} => {}\n", fmt, m_from.string(),
+    fmt::print(stderr, "Decompressing SZP: {} => {}\n", m_from.string(),
                m_to.string());
     std::vector<u8> buf(size);
-    TRY(librii::szs::decode(buf, *file,
-                            !librii::szs::isDataYaz0Compressed(*file)));
-    if (FS_TRY(rsl::filesystem::exists(m_to)) &&
-        FS_TRY(rsl::filesystem::is_directory(m_to))) {
-      return std::unexpected("Failed to extract: |to| is a folder, not a file");
-    }
+    TRY(librii::szs::decode(buf, *file, true));
     TRY(rsl::WriteFile(buf, m_to.string()));
     return {};
   }
 
 private:
+  // YAZ0 is decoded file-to-file in chunks, so memory use does not depend on
+  // the size of the archive.
+  Result<void> decompressStream(std::ifstream& in) {
+    std::ofstream out(m_to, std::ios::binary);
+    if (!out) {
+      return std::unexpected("Error: Failed to open output file");
+    }
+    librii::szs::StreamDecoder decoder;
+    std::vector<u8> src(64 * 1024);
+    std::vector<u8> dst(64 * 1024);
+    while (!decoder.done()) {
+      in.read(reinterpret_cast<char*>(src.data()), src.size());
+      std::span<const u8> pending(src.data(), in.gcount());
+      if (pending.empty()) {
+        return std::unexpected("Error: Truncated SZS file");
+      }
+      while (!pending.empty() && !decoder.done()) {
+        auto progress = TRY(decoder.decode(pending, dst));
+        out.write(reinterpret_cast<const char*>(dst.data()),
+                  progress.dst_used);
+        pending = pending.subspan(progress.src_used);
+      }
+    }
+    if (!out) {
+      return std::unexpected("Error: Failed to write output file");
+    }
+    return {};
+  }
+
   Result<void> parseArgs() {
     m_from = std::string{m_opt.from.view()};
     m_to = std::string{m_opt.to.view()};
@@ -511,7 +574,8 @@ public:
     fmt::print(stderr, "Compressing {}: {} => {} ({} strategy)\n",
                m_opt.yay0 ? "SZP (YAY0)" : "SZS (YAZ0)", m_from.string(),
                m_to.string(), fmt::styled(sname, fmt::fg(fmt::color::gold)));
-    auto buf = TRY(librii::szs::encodeAlgo(*file, strat, m_opt.yay0));
+    auto buf =
+        TRY(librii::szs::encodeAlgo(*file, strat, m_opt.yay0, m_opt.threads));
     float elapsed = static_cast<float>(timer.elapsed()) * 0.001f;
     float rate =
         static_cast<float>(buf.size()) / static_cast<float>(file->size());
@@ -553,6 +617,151 @@ private:
   std::filesystem::path m_to;
 };
 
+// Compresses (.arc => .szs) or decompresses (.szs => .arc) every matching file
+// under a folder, on a pool of worker threads. Avoids paying process startup
+// per file when converting a whole game or mod.
+class BatchSZS {
+public:
+  BatchSZS(const CliOptions& opt, bool compress)
+      : m_opt(opt), m_compress(compress) {}
+
+  Result<void> execute() {
+    if (m_opt.verbose) {
+      rsl::logging::init();
+    }
+    m_from = m_opt.from.view();
+    m_to = m_opt.to.view();
+    if (m_to.empty()) {
+      m_to = m_from;
+    }
+    if (!FS_TRY(rsl::filesystem::is_directory(m_from))) {
+      return std::unexpected(
+          std::format("Error: {} is not a folder", m_from.string()));
+    }
+    m_algo = TRY(rsl::enum_cast<librii::szs::Algo>(m_opt.szs_algo));
+
+    std::vector<std::filesystem::path> inputs;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(m_from, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+      if (it->is_regular_file(ec) && isInput(it->path())) {
+        inputs.push_back(it->path());
+      }
+    }
+    if (ec) {
+      return std::unexpected(std::format("Error: Failed to search {}: {}",
+                                         m_from.string(), ec.message()));
+    }
+    fmt::print(stderr, "{} {} files in {}\n",
+               m_compress ? "Compressing" : "Decompressing", inputs.size(),
+               m_from.string());
+
+    rsl::Timer timer;
+    timer.reset();
+    {
+      rsl::ThreadPool pool(m_opt.threads);
+      for (auto& path : inputs) {
+        pool.submit([this, path] {
+          auto ok = processFile(path);
+          if (!ok) {
+            ++m_failed;
+            std::unique_lock g(s_progressLock);
+            fmt::print(stderr, "{}: {}\n", path.string(), ok.error());
+          }
+        });
+      }
+      pool.wait();
+    }
+    float elapsed = static_cast<float>(timer.elapsed()) * 0.001f;
+
+    // Throughput is measured on the uncompressed side
+    const u64 raw = m_compress ? m_bytesIn : m_bytesOut;
+    const u64 packed = m_compress ? m_bytesOut : m_bytesIn;
+    fmt::print("{} files processed, {} up to date, {} failed.\n",
+               m_processed.load(), m_skipped.load(), m_failed.load());
+    fmt::print("Elapsed time: {:.2f} seconds. Throughput: {:.2f} MB/s. "
+               "Compression rate: {:.2f}% (lower is better)\n",
+               fmt::styled(elapsed, fmt::fg(fmt::color::light_green)),
+               fmt::styled(static_cast<float>(raw) / (1024.0f * 1024.0f) /
+                               std::max(elapsed, 0.001f),
+                           fmt::fg(fmt::color::light_green)),
+               fmt::styled(raw ? 100.0f * static_cast<float>(packed) /
+                                     static_cast<float>(raw)
+                               : 0.0f,
+                           fmt::fg(fmt::color::light_green)));
+    if (m_failed) {
+      return std::unexpected(
+          std::format("Error: {} files failed", m_failed.load()));
+    }
+    return {};
+  }
+
+private:
+  bool isInput(const std::filesystem::path& path) const {
+    auto ext = rsl::to_lower(path.extension().string());
+    if (m_compress) {
+      return ext == ".arc";
+    }
+    return ext == ".szs" || ext == ".szp";
+  }
+
+  Result<std::filesystem::path>
+  outputPath(const std::filesystem::path& input) const {
+    auto rel = FS_TRY(rsl::filesystem::relative(input, m_from));
+    auto out = m_to / rel;
+    if (m_compress) {
+      out.replace_extension(m_opt.yay0 ? ".szp" : ".szs");
+    } else {
+      out.replace_extension(".arc");
+    }
+    return out;
+  }
+
+  Result<void> processFile(const std::filesystem::path& input) {
+    auto output = TRY(outputPath(input));
+    if (!m_opt.force && FS_TRY(rsl::filesystem::exists(output)) &&
+        FS_TRY(rsl::filesystem::last_write_time(output)) >=
+            FS_TRY(rsl::filesystem::last_write_time(input))) {
+      ++m_skipped;
+      return {};
+    }
+    auto file = TRY(ReadFile(input.string()));
+    std::vector<u8> buf;
+    if (m_compress) {
+      buf = TRY(librii::szs::encodeAlgo(file, m_algo, m_opt.yay0));
+      buf.resize(roundUp(buf.size(), 32));
+    } else {
+      u32 size = TRY(librii::szs::getExpandedSize(file));
+      buf.resize(size);
+      TRY(librii::szs::decode(buf, file,
+                              !librii::szs::isDataYaz0Compressed(file)));
+    }
+    FS_TRY(rsl::filesystem::create_directories(output.parent_path()));
+    TRY(rsl::WriteFileAtomic(buf, output.string()));
+    m_bytesIn += file.size();
+    m_bytesOut += buf.size();
+    ++m_processed;
+    if (m_opt.verbose) {
+      std::unique_lock g(s_progressLock);
+      fmt::print(stderr, "{} => {}\n", input.string(), output.string());
+    }
+    return {};
+  }
+
+  CliOptions m_opt;
+  bool m_compress;
+  librii::szs::Algo m_algo{};
+  std::filesystem::path m_from;
+  std::filesystem::path m_to;
+
+  std::atomic<u32> m_processed = 0;
+  std::atomic<u32> m_skipped = 0;
+  std::atomic<u32> m_failed = 0;
+  std::atomic<u64> m_bytesIn = 0;
+  std::atomic<u64> m_bytesOut = 0;
+};
+
 [[nodiscard]] Result<void> WriteIt(riistudio::g3d::Collection& c,
                                    oishii::Writer& w) {
   return riistudio::g3d::WriteBRRES(c, w);
@@ -604,6 +813,11 @@ public:
     if (!ok) {
       return std::unexpected("Failed to compile RHST");
     }
+    if constexpr (std::is_same_v<T, riistudio::g3d::Collection>) {
+      if (m_opt.optimize) {
+        OptimizeVertexBuffers(*m_result);
+      }
+    }
     oishii::Writer result(std::endian::big);
     TRY(WriteIt(*m_result, result));
     result.saveToDisk(m_to.string());
@@ -812,10 +1026,9 @@ static Result<void> kmp2json(const CliOptions& m_opt) {
   }
   auto kmp = TRY(librii::kmp::readKMP(*file));
 
-  auto result = DumpJSON(kmp);
-  fmt::print("{}\n", result);
   std::ofstream stream(m_to);
-  stream << result;
+  librii::kmp::WriteJSON(stream, kmp);
+  EXPECT(stream.good());
 
   return {};
 }
@@ -840,12 +1053,11 @@ static Result<void> json2kmp(const CliOptions& m_opt) {
                "Warning: File {} will be overwritten by this operation.\n",
                m_to.string());
   }
-  auto file = ReadFile(m_opt.from.view());
-  if (!file.has_value()) {
+  std::ifstream stream(m_from);
+  if (!stream) {
     return std::unexpected("Error: Failed to read file");
   }
-  auto kmp = librii::kmp::LoadJSON(
-      std::string_view{(char*)file->data(), file->size()});
+  auto kmp = TRY(librii::kmp::ReadJSON(stream));
 
   oishii::Writer writer(std::endian::big);
   librii::kmp::writeKMP(kmp, writer);
@@ -878,17 +1090,44 @@ static Result<void> kcl2json(const CliOptions& m_opt) {
   if (!file.has_value()) {
     return std::unexpected("Error: Failed to read file");
   }
-  auto kmp = TRY(librii::kcol::ReadKCollisionData(*file, file->size()));
+  auto kcl = TRY(librii::kcol::ReadKCollisionData(*file, file->size()));
 
-  auto result = DumpJSON(kmp);
-  fmt::print("{}\n", result);
   std::ofstream stream(m_to);
-  stream << result;
+  librii::kcol::WriteJSON(stream, kcl);
+  EXPECT(stream.good());
 
   return {};
 }
 static Result<void> json2kcl(const CliOptions& m_opt) {
-  return std::unexpected("unimplemented!");
+  if (m_opt.verbose) {
+    rsl::logging::init();
+  }
+  std::filesystem::path m_from = m_opt.from.view();
+  std::filesystem::path m_to = m_opt.to.view();
+
+  if (m_to.empty()) {
+    std::filesystem::path p = m_from;
+    p.replace_extension(".kcl");
+    m_to = p;
+  }
+  if (!FS_TRY(rsl::filesystem::exists(m_from))) {
+    fmt::print(stderr, "Error: File {} does not exist.\n", m_from.string());
+    return std::unexpected("FolderNotExist");
+  }
+  if (FS_TRY(rsl::filesystem::exists(m_to))) {
+    fmt::print(stderr,
+               "Warning: File {} will be overwritten by this operation.\n",
+               m_to.string());
+  }
+  std::ifstream stream(m_from);
+  if (!stream) {
+    return std::unexpected("Error: Failed to read file");
+  }
+  auto kcl = TRY(librii::kcol::ReadJSON(stream));
+
+  auto buf = TRY(librii::kcol::WriteKCollisionData(kcl));
+  TRY(rsl::WriteFile(buf, m_to.string()));
+  return {};
 }
 static Result<void> brres2json(const CliOptions& m_opt) {
   if (m_opt.verbose) {
@@ -919,11 +1158,11 @@ static Result<void> brres2json(const CliOptions& m_opt) {
       librii::g3d::Archive::fromMemory(*file, std::string(m_opt.from.view())));
 
   EXPECT(brres.models.size() == 1);
-  auto mdl = brres.models[0];
+  const auto& mdl = brres.models[0];
 
-  auto result = ModelToJSON(mdl);
   std::ofstream stream(m_to);
-  stream << result;
+  librii::g3d::WriteModelJSON(stream, mdl);
+  EXPECT(stream.good());
 
   return {};
 }
@@ -1242,11 +1481,14 @@ static Result<void> import_tex0(const CliOptions& m_opt) {
                     "recognize it or didn't exist.",
                     path));
   }
-  std::vector<u8> scratch;
+  auto quality =
+      TRY(rsl::enum_cast<librii::image::EncodeQuality>(m_opt.quality));
+  // Import losslessly, then encode with the requested quality (and palette)
   riistudio::g3d::Texture tex;
   const auto ok = riistudio::rhst::importTexture(
-      tex, image->data, scratch, m_opt.mipmaps, m_opt.min_mip, m_opt.max_mips,
-      image->width, image->height, image->channels, format);
+      tex, image->data, m_opt.mipmaps, m_opt.min_mip, m_opt.max_mips,
+      image->width, image->height, image->channels,
+      librii::gx::TextureFormat::RGBA8);
   if (!ok) {
     return std::unexpected(
         std::format("Failed to import texture {}: {}", path, ok.error()));
@@ -1254,6 +1496,23 @@ static Result<void> import_tex0(const CliOptions& m_opt) {
   std::filesystem::path fsp(m_opt.from.view());
   tex.setName(fsp.stem().string());
 
+  const std::vector<u8> rgba8 = tex.data;
+  tex.format = format;
+  tex.data.resize(librii::g3d::ComputeImageSize(tex));
+  auto tlut_format =
+      TRY(rsl::enum_cast<librii::gx::PaletteFormat>(m_opt.palette_format));
+  std::vector<u8> tlut(librii::image::getPaletteCapacity(format) * 2);
+  TRY(librii::image::transform(
+      tex.data, tex.width, tex.height, librii::gx::TextureFormat::RGBA8, format,
+      rgba8, tex.width, tex.height, tex.number_of_images - 1,
+      librii::image::ResizingAlgorithm::Lanczos, tlut, tlut_format, quality));
+  if (!tlut.empty()) {
+    auto plt0 = m_to;
+    plt0.replace_extension(".plt0");
+    TRY(librii::g3d::WritePLT0ToFile(tlut, tlut_format, tex.name,
+                                     plt0.string()));
+  }
+
   TRY(librii::g3d::WriteTEX0ToFile(tex, m_to.string()));
 
   return {};
@@ -1347,6 +1606,15 @@ int main(int argc, const char** argv) {
       fmt::print(stdout, "{}\n", ok.error());
       return -1;
     }
+  } else if (args->type == TYPE_COMPRESS_BATCH ||
+             args->type == TYPE_DECOMPRESS_BATCH) {
+    BatchSZS cmd(*args, args->type == TYPE_COMPRESS_BATCH);
+    auto ok = cmd.execute();
+    if (!ok) {
+      fmt::print(stderr, "{}\n", ok.error());
+      fmt::print(stdout, "{}\n", ok.error());
+      return -1;
+    }
   } else if (args->type == TYPE_COMPILE_RHST_BRRES) {
     progress_put("Processing...", 0.0f);
     CompileRHST<riistudio::g3d::Collection> cmd(*args);
@@ -87,6 +87,10 @@ pub struct ImportCommand {
     #[clap(long, default_value = "false")]
     no_tristrip: bool,
 
+    /// Store vertex positions, normals and UVs in the smallest fixed-point formats that stay accurate (.brres only)
+    #[clap(long, default_value = "false")]
+    optimize: bool,
+
     ///
     #[clap(long, default_value = "false")]
     ai_json: bool,
@@ -140,6 +144,7 @@ enum SzsAlgo {
     CTLib,
     LibYaz0,
     MK8,
+    BestRatio,
 }
 
 /// Compress a file as .szs
@@ -160,6 +165,62 @@ pub struct CompressCommand {
     #[clap(short, long, default_value = "false")]
     yay0: bool,
 
+    /// Number of threads to compress with (0 for one per CPU core).
+    #[arg(long, default_value = "1")]
+    threads: u32,
+
+    #[clap(short, long, default_value = "false")]
+    verbose: bool,
+}
+
+/// Compress every .arc file in a folder (recursively) as .szs
+#[derive(Parser, Debug)]
+pub struct CompressBatchCommand {
+    /// Folder to search for .arc files
+    #[arg(required = true)]
+    from: String,
+
+    /// Folder to write compressed files to, mirroring the input layout (default: next to each input)
+    to: Option<String>,
+
+    /// Compression algorithm to use.
+    #[clap(short, long, value_enum)]
+    algorithm: Option<SzsAlgo>,
+
+    /// Use YAY0 instead of YAZ0
+    #[clap(short, long, default_value = "false")]
+    yay0: bool,
+
+    /// Number of files to compress at once (0 for one per CPU core).
+    #[arg(long, default_value = "0")]
+    threads: u32,
+
+    /// Also process files whose output is newer than the input
+    #[clap(short, long, default_value = "false")]
+    force: bool,
+
+    #[clap(short, long, default_value = "false")]
+    verbose: bool,
+}
+
+/// Decompress every .szs file in a folder (recursively) as .arc
+#[derive(Parser, Debug)]
+pub struct DecompressBatchCommand {
+    /// Folder to search for .szs files
+    #[arg(required = true)]
+    from: String,
+
+    /// Folder to write decompressed files to, mirroring the input layout (default: next to each input)
+    to: Option<String>,
+
+    /// Number of files to decompress at once (0 for one per CPU core).
+    #[arg(long, default_value = "0")]
+    threads: u32,
+
+    /// Also process files whose output is newer than the input
+    #[clap(short, long, default_value = "false")]
+    force: bool,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -258,6 +319,10 @@ pub struct Rhst2BrresCommand {
     /// Output .brres file
     to: Option<String>,
 
+    /// Store vertex positions, normals and UVs in the smallest fixed-point formats that stay accurate
+    #[clap(long, default_value = "false")]
+    optimize: bool,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -366,6 +431,14 @@ pub struct ImportTex0 {
     #[arg(long, default_value = "14")]
     format: u32,
 
+    /// Palette format for C4/C8/C14X2 textures: 0 (IA8), 1 (RGB565) or 2 (RGB5A3). The palette is written as a .plt0 next to the .tex0
+    #[arg(long, default_value = "2")]
+    palette_format: u32,
+
+    /// Encoder effort for CMPR and palette formats: 0 (fast), 1 (balanced) or 2 (best)
+    #[arg(long, default_value = "1")]
+    quality: u32,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -387,6 +460,12 @@ pub enum Commands {
     /// Compress a file as .szs
     Compress(CompressCommand),
 
+    /// Compress every .arc file in a folder as .szs
+    CompressBatch(CompressBatchCommand),
+
+    /// Decompress every .szs file in a folder as .arc
+    DecompressBatch(DecompressBatchCommand),
+
     /// Convert a .rhst file to a .brres file
     Rhst2Brres(Rhst2BrresCommand),
 
@@ -446,6 +525,11 @@ pub struct CliOptions {
     pub szs_algo: c_uint,
     pub format: c_uint,
     pub yay0: c_uint,
+    pub threads: c_uint,
+    pub force: c_uint,
+    pub palette_format: c_uint,
+    pub quality: c_uint,
+    pub optimize: c_uint,
     // TYPE 2: "decompress"
     // Uses "from", "to" and "verbose" above
 }
@@ -501,6 +585,7 @@ impl MyArgs {
                     recompute_normals: i.recompute_normals as c_uint,
                     fuse_vertices: i.fuse_vertices as c_uint,
                     no_tristrip: i.no_tristrip as c_uint,
+                    optimize: i.optimize as c_uint,
                     ai_json: i.ai_json as c_uint,
                     verbose: i.verbose as c_uint,
 
@@ -510,6 +595,10 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
                 }
             }
             Commands::ImportBrres(i) => {
@@ -547,6 +636,7 @@ impl MyArgs {
                     recompute_normals: i.recompute_normals as c_uint,
                     fuse_vertices: i.fuse_vertices as c_uint,
                     no_tristrip: i.no_tristrip as c_uint,
+                    optimize: i.optimize as c_uint,
                     ai_json: i.ai_json as c_uint,
                     verbose: i.verbose as c_uint,
 
@@ -556,6 +646,10 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
                 }
             }
             Commands::ImportBmd(i) => {
@@ -593,6 +687,7 @@ impl MyArgs {
                     recompute_normals: i.recompute_normals as c_uint,
                     fuse_vertices: i.fuse_vertices as c_uint,
                     no_tristrip: i.no_tristrip as c_uint,
+                    optimize: i.optimize as c_uint,
                     ai_json: i.ai_json as c_uint,
                     verbose: i.verbose as c_uint,
 
@@ -602,6 +697,10 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
                 }
             }
             Commands::Decompress(i) => {
@@ -642,6 +741,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::Compress(i) => {
@@ -661,6 +765,7 @@ impl MyArgs {
                     verbose: i.verbose as c_uint,
                     szs_algo: i.algorithm.unwrap_or(SzsAlgo::CTGP) as c_uint,
                     yay0: i.yay0 as c_uint,
+                    threads: i.threads as c_uint,
 
                     // Junk fields
                     preset_path: [0; 256],
@@ -682,6 +787,100 @@ impl MyArgs {
                     no_compression: 0 as c_uint,
                     rarc: 0 as c_uint,
                     format: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
+                }
+            }
+            Commands::CompressBatch(i) => {
+                let mut from2: [i8; 256] = [0; 256];
+                let mut to2: [i8; 256] = [0; 256];
+                let from_bytes = i.from.as_bytes();
+                let default_str = String::new();
+                let to_bytes = i.to.as_ref().unwrap_or(&default_str).as_bytes();
+                from2[..from_bytes.len()]
+                    .copy_from_slice(unsafe { &*(from_bytes as *const _ as *const [i8]) });
+                to2[..to_bytes.len()]
+                    .copy_from_slice(unsafe { &*(to_bytes as *const _ as *const [i8]) });
+                CliOptions {
+                    c_type: 19,
+                    from: from2,
+                    to: to2,
+                    verbose: i.verbose as c_uint,
+                    szs_algo: i.algorithm.unwrap_or(SzsAlgo::CTGP) as c_uint,
+                    yay0: i.yay0 as c_uint,
+                    threads: i.threads as c_uint,
+                    force: i.force as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
+
+                    // Junk fields
+                    preset_path: [0; 256],
+                    scale: 0.0 as c_float,
+                    brawlbox_scale: 0 as c_uint,
+                    mipmaps: 0 as c_uint,
+                    min_mip: 0 as c_uint,
+                    max_mips: 0 as c_uint,
+                    auto_transparency: 0 as c_uint,
+                    merge_mats: 0 as c_uint,
+                    bake_uvs: 0 as c_uint,
+                    tint: 0 as c_uint,
+                    cull_degenerates: 0 as c_uint,
+                    cull_invalid: 0 as c_uint,
+                    recompute_normals: 0 as c_uint,
+                    fuse_vertices: 0 as c_uint,
+                    no_tristrip: 0 as c_uint,
+                    ai_json: 0 as c_uint,
+                    no_compression: 0 as c_uint,
+                    rarc: 0 as c_uint,
+                    format: 0 as c_uint,
+                }
+            }
+            Commands::DecompressBatch(i) => {
+                let mut from2: [i8; 256] = [0; 256];
+                let mut to2: [i8; 256] = [0; 256];
+                let from_bytes = i.from.as_bytes();
+                let default_str = String::new();
+                let to_bytes = i.to.as_ref().unwrap_or(&default_str).as_bytes();
+                from2[..from_bytes.len()]
+                    .copy_from_slice(unsafe { &*(from_bytes as *const _ as *const [i8]) });
+                to2[..to_bytes.len()]
+                    .copy_from_slice(unsafe { &*(to_bytes as *const _ as *const [i8]) });
+                CliOptions {
+                    c_type: 20,
+                    from: from2,
+                    to: to2,
+                    verbose: i.verbose as c_uint,
+                    threads: i.threads as c_uint,
+                    force: i.force as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
+
+                    // Junk fields
+                    preset_path: [0; 256],
+                    scale: 0.0 as c_float,
+                    brawlbox_scale: 0 as c_uint,
+                    mipmaps: 0 as c_uint,
+                    min_mip: 0 as c_uint,
+                    max_mips: 0 as c_uint,
+                    auto_transparency: 0 as c_uint,
+                    merge_mats: 0 as c_uint,
+                    bake_uvs: 0 as c_uint,
+                    tint: 0 as c_uint,
+                    cull_degenerates: 0 as c_uint,
+                    cull_invalid: 0 as c_uint,
+                    recompute_normals: 0 as c_uint,
+                    fuse_vertices: 0 as c_uint,
+                    no_tristrip: 0 as c_uint,
+                    ai_json: 0 as c_uint,
+                    no_compression: 0 as c_uint,
+                    rarc: 0 as c_uint,
+                    format: 0 as c_uint,
+                    szs_algo: 0 as c_uint,
+                    yay0: 0 as c_uint,
                 }
             }
             Commands::KmpToJson(i) => {
@@ -722,6 +921,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::JsonToKmp(i) => {
@@ -762,6 +966,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::KclToJson(i) => {
@@ -802,6 +1011,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::JsonToKcl(i) => {
@@ -842,6 +1056,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::BrresToJson(i) => {
@@ -882,6 +1101,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::JsonToBrres(i) => {
@@ -922,6 +1146,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::Rhst2Brres(i) => {
@@ -939,6 +1168,7 @@ impl MyArgs {
                     from: from2,
                     to: to2,
                     verbose: i.verbose as c_uint,
+                    optimize: i.optimize as c_uint,
 
                     // Junk fields
                     preset_path: [0; 256],
@@ -962,6 +1192,10 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
                 }
             }
             Commands::Rhst2Bmd(i) => {
@@ -979,6 +1213,7 @@ impl MyArgs {
                     from: from2,
                     to: to2,
                     verbose: i.verbose as c_uint,
+                    optimize: 0 as c_uint,
 
                     // Junk fields
                     preset_path: [0; 256],
@@ -1002,6 +1237,10 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
                 }
             }
             Commands::Extract(i) => {
@@ -1042,6 +1281,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::Create(i) => {
@@ -1082,6 +1326,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::DumpPresets(i) => {
@@ -1122,6 +1371,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::PreciseBMDDump(i) => {
@@ -1162,6 +1416,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::Optimize(i) => {
@@ -1202,6 +1461,11 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    quality: 0 as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
             Commands::ImportTex0(i) => {
@@ -1242,6 +1506,11 @@ impl MyArgs {
                     rarc: 0 as c_uint,
                     szs_algo: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    threads: 0 as c_uint,
+                    force: 0 as c_uint,
+                    palette_format: i.palette_format as c_uint,
+                    quality: i.quality as c_uint,
+                    optimize: 0 as c_uint,
                 }
             }
         }
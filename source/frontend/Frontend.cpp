@@ -33,7 +33,8 @@ private:
 } sRootHolder;
 
 int RiiStudio_main(int argc, const char** argv) {
-  rsl::logging::init();
+  // Keep the UI and worker threads off the console
+  rsl::logging::init(/* async */ true);
   if (argc > 0) {
     printf("%s\n", argv[0]);
     auto path = std::filesystem::path(argv[0]);
@@ -13,8 +13,17 @@
 #include <plugins/g3d/G3dIo.hpp>
 #include <plugins/j3d/J3dIo.hpp>
 
+std::size_t UndoHistoryMemoryCap();
+bool ParallelBrresRead();
+
 namespace riistudio::frontend {
 
+// Dirty tracking stays off: property actions may edit nodes besides the ones
+// they mark (e.g. renaming a bone's materials), so every node is compared.
+static void ConfigureHistory(kpi::History& history) {
+  history.setMemoryCap(UndoHistoryMemoryCap());
+}
+
 struct HistoryList : public StudioWindow, private HistoryListWidget {
   HistoryList(auto doCommit, auto doUndo, auto doRedo, auto doCursor,
               auto doSize)
@@ -143,6 +152,7 @@ static std::string getFileShort(const std::string& path) {
 }
 
 void BRRESEditor::init() {
+  ConfigureHistory(mHistory);
   // Don't require selection reset on first element
   mHistory.commit(*mRoot, &mSelection, false);
   for (auto& tex : mRoot->getTextures()) {
@@ -197,7 +207,8 @@ BRRESEditor::BRRESEditor(std::span<const u8> span, const std::string& path)
     Message emsg(message_class, std::string(domain), std::string(message_body));
     mLoadErrorMessages.push_back(emsg);
   };
-  auto ok = g3d::ReadBRRES(*out, reader, trans);
+  auto ok =
+      g3d::ReadBRRES(*out, reader, trans, ParallelBrresRead() ? 0 : 1);
   if (!ok) {
     rsl::error(ok.error());
     Message emsg(kpi::IOMessageClass::Error, "brres", std::string(ok.error()));
@@ -247,6 +258,8 @@ void BRRESEditor::draw_() {
     }
   }
   detachClosedChildren();
+  // The limit may have changed in the settings menu
+  mHistory.setMemoryCap(UndoHistoryMemoryCap());
 
   mPropertyEditor->draw();
   mHistoryList->draw();
@@ -286,6 +299,7 @@ void BRRESEditor::draw_() {
 }
 
 void BMDEditor::init() {
+  ConfigureHistory(mHistory);
   // Don't require selection reset on first element
   mHistory.commit(*mRoot, &mSelection, false);
   for (auto& tex : mRoot->getTextures()) {
@@ -399,6 +413,8 @@ void BMDEditor::draw_() {
     }
   }
   detachClosedChildren();
+  // The limit may have changed in the settings menu
+  mHistory.setMemoryCap(UndoHistoryMemoryCap());
 
   mPropertyEditor->draw();
   mHistoryList->draw();
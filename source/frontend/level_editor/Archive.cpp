@@ -25,44 +25,57 @@ Result<Archive> ReadArchive(std::span<const u8> buf) {
     return std::unexpected("Not a U8 archive");
   }
 
-  auto tarc = librii::U8::LoadU8Archive(decoded);
+  auto buffer = std::make_shared<const std::vector<u8>>(std::move(decoded));
+  auto tarc = librii::U8::LoadU8ArchiveNodes(*buffer);
   if (!tarc) {
     rsl::error("Failed to read archive");
     return std::unexpected("Invalid U8 archive");
   }
-  auto arc = *tarc;
+  auto& arc = *tarc;
 
   Archive n_arc;
 
   struct Pair {
-    Archive* folder;
+    size_t path_len;
     u32 sibling_next;
   };
   std::vector<Pair> n_path;
+  std::string path;
 
   assert(arc.nodes.size());
 
   n_path.push_back(
-      Pair{.folder = &n_arc, .sibling_next = arc.nodes[0].folder.sibling_next});
+      Pair{.path_len = 0, .sibling_next = arc.nodes[0].folder.sibling_next});
   for (int i = 1; i < arc.nodes.size(); ++i) {
     auto& node = arc.nodes[i];
 
     while (!n_path.empty() && i == n_path.back().sibling_next)
       n_path.resize(n_path.size() - 1);
+    if (n_path.empty())
+      break;
+    path.resize(n_path.back().path_len);
 
     if (node.is_folder) {
-      auto tmp = std::make_unique<Archive>();
-      n_path.push_back(
-          Pair{.folder = tmp.get(), .sibling_next = node.folder.sibling_next});
-      auto& parent = n_path[n_path.size() - 2];
-      parent.folder->folders.emplace(node.name, std::move(tmp));
+      // Eliminate the period
+      if (path.empty() && node.name == ".") {
+        n_path.push_back(
+            Pair{.path_len = 0, .sibling_next = node.folder.sibling_next});
+      } else {
+        path += node.name + "/";
+        n_path.push_back(Pair{.path_len = path.size(),
+                              .sibling_next = node.folder.sibling_next});
+      }
     } else {
-      const u32 start_pos = node.file.offset;
-      const u32 end_pos = node.file.offset + node.file.size;
-      assert(node.file.offset + node.file.size <= arc.file_data.size());
-      std::vector<u8> vec(arc.file_data.data() + start_pos,
-                          arc.file_data.data() + end_pos);
-      n_path.back().folder->files.emplace(node.name, std::move(vec));
+      if (u64(node.file.offset) + node.file.size > buffer->size()) {
+        rsl::error("File {} exceeds the archive", node.name);
+        return std::unexpected("Invalid U8 archive");
+      }
+      n_arc.mFiles.push_back(Archive::File{
+          .path = path + node.name,
+          .data = std::span(*buffer).subspan(node.file.offset,
+                                             node.file.size),
+          .storage = buffer,
+      });
     }
 
     while (!n_path.empty() && i + 1 == n_path.back().sibling_next)
@@ -73,39 +86,98 @@ Result<Archive> ReadArchive(std::span<const u8> buf) {
     return std::unexpected(".szs file was corrupted by BrawlBox");
   }
 
-  // Eliminate the period
-  if (!n_arc.folders.empty() && n_arc.folders.begin()->first == ".") {
-    return *n_arc.folders["."];
+  n_arc.reindex();
+  return n_arc;
+}
+
+void Archive::reindex() {
+  std::ranges::sort(mFiles, {}, &File::path);
+  mIndex.clear();
+  mIndex.reserve(mFiles.size());
+  for (size_t i = 0; i < mFiles.size(); ++i) {
+    mIndex.try_emplace(mFiles[i].path, i);
   }
+}
 
-  return n_arc;
+static std::string NormalizePath(std::string_view path) {
+  return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+const Archive::File* Archive::findFile(std::string_view path) const {
+  auto it = mIndex.find(NormalizePath(path));
+  if (it == mIndex.end()) {
+    return nullptr;
+  }
+  return &mFiles[it->second];
+}
+
+std::optional<std::span<const u8>> Archive::find(std::string_view path) const {
+  if (auto* file = findFile(path)) {
+    return file->data;
+  }
+  return std::nullopt;
+}
+
+void Archive::write(std::string_view path, std::vector<u8> data) {
+  auto owned = std::make_shared<const std::vector<u8>>(std::move(data));
+  auto key = NormalizePath(path);
+  if (auto it = mIndex.find(key); it != mIndex.end()) {
+    // Releases the previous storage, unless a ResolveQuery still holds it
+    auto& file = mFiles[it->second];
+    file.data = *owned;
+    file.storage = std::move(owned);
+  } else {
+    mFiles.push_back(
+        File{.path = std::move(key), .data = *owned, .storage = owned});
+    reindex();
+  }
 }
 
-static void ProcessArcs(const Archive* arc, std::string_view name,
+// |files| all live under the folder ending at |prefix_len| in their paths
+static void ProcessArcs(std::span<const Archive::File> files, size_t prefix_len,
+                        std::string_view name, u32 parent,
                         librii::U8::U8Archive& u8) {
   const auto node_index = u8.nodes.size();
 
   librii::U8::U8Archive::Node node{.is_folder = true,
                                    .name = std::string(name)};
-  // Since we write folders first, the parent will always be behind us
-  node.folder.parent = u8.nodes.size() - 1;
+  node.folder.parent = parent;
   node.folder.sibling_next = 0; // Filled in later
   u8.nodes.push_back(node);
 
-  for (auto& data : arc->folders) {
-    ProcessArcs(data.second.get(), data.first, u8);
+  // Folders first. Since the files are sorted, a folder is a contiguous run.
+  for (size_t i = 0; i < files.size();) {
+    const std::string_view rest =
+        std::string_view(files[i].path).substr(prefix_len);
+    const size_t slash = rest.find('/');
+    if (slash == std::string_view::npos) {
+      ++i;
+      continue;
+    }
+    const std::string_view folder = rest.substr(0, slash + 1);
+    size_t j = i + 1;
+    while (j < files.size() &&
+           std::string_view(files[j].path).substr(prefix_len).starts_with(
+               folder)) {
+      ++j;
+    }
+    ProcessArcs(files.subspan(i, j - i), prefix_len + folder.size(),
+                folder.substr(0, slash), node_index, u8);
+    i = j;
   }
 
-  for (auto& [n, f] : arc->files) {
-    {
-      librii::U8::U8Archive::Node node{.is_folder = false,
-                                       .name = std::string(n)};
-      node.file.offset =
-          u8.file_data.size(); // Note: relative->abs translation handled later
-      node.file.size = f.size();
-      u8.nodes.push_back(node);
-      u8.file_data.insert(u8.file_data.end(), f.begin(), f.end());
+  for (auto& f : files) {
+    const std::string_view n = std::string_view(f.path).substr(prefix_len);
+    if (n.find('/') != std::string_view::npos) {
+      continue;
     }
+    librii::U8::U8Archive::Node node{.is_folder = false,
+                                     .name = std::string(n)};
+    node.file.offset =
+        u8.file_data.size(); // Note: relative->abs translation handled later
+    node.file.size = f.data.size();
+    u8.nodes.push_back(node);
+    u8.file_data.insert(u8.file_data.end(), f.data.begin(), f.data.end());
   }
 
   u8.nodes[node_index].folder.sibling_next = u8.nodes.size();
@@ -115,7 +187,7 @@ Result<std::vector<u8>> WriteArchive(const Archive& arc) {
   librii::U8::U8Archive u8;
   u8.watermark = {0};
 
-  ProcessArcs(&arc, ".", u8);
+  ProcessArcs(arc.files(), 0, ".", 0, u8);
 
   auto u8_buf = librii::U8::SaveU8Archive(u8);
   auto szs_buf = librii::szs::encodeAlgo(u8_buf, librii::szs::Algo::WorstCaseEncoding);
@@ -123,38 +195,17 @@ Result<std::vector<u8>> WriteArchive(const Archive& arc) {
   return szs_buf;
 }
 
-std::optional<std::vector<u8>> FindFile(const Archive& arc, std::string path) {
-  std::filesystem::path _path = path;
-  _path = _path.lexically_normal();
-
-  const Archive* cur_arc = &arc;
-  for (auto&& part : _path) {
-    {
-      auto it = cur_arc->folders.find(part.string());
-      if (it != cur_arc->folders.end()) {
-        cur_arc = it->second.get();
-        continue;
-      }
-    }
-    {
-      auto it = cur_arc->files.find(part.string());
-      if (it != cur_arc->files.end()) {
-        // TODO: This will ignore everything else in the path and accept invalid
-        // item e.g. source/file.txt/invalid/other would ignore invalid/other
-        return it->second;
-      }
-    }
-  }
-
-  return std::nullopt;
+std::optional<std::span<const u8>> FindFile(const Archive& arc,
+                                            std::string_view path) {
+  return arc.find(path);
 }
 
 std::optional<ResolveQuery>
 FindFileWithOverloads(const Archive& arc, std::vector<std::string> paths) {
   for (auto& path : paths) {
-    auto found = FindFile(arc, path);
-    if (found.has_value()) {
-      return ResolveQuery{.file_data = std::move(*found),
+    if (auto* file = arc.findFile(path)) {
+      return ResolveQuery{.file_data = file->data,
+                          .storage = file->storage,
                           .resolved_path = path};
     }
   }
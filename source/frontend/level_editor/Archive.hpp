@@ -1,16 +1,51 @@
 #pragma once
 
 #include <core/common.h>
-#include <map>
 #include <memory>
 #include <optional>
+#include <rsl/DenseMap.hpp>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
-struct Archive {
-  std::map<std::string, std::shared_ptr<Archive>> folders;
-  std::map<std::string, std::vector<u8>> files;
+//! A .szs/.carc file, viewed in place.
+//!
+//! Files are spans into the one decompressed U8 buffer; nothing is copied on
+//! read. A file only gets storage of its own once it is overwritten. Storage
+//! is shared, so it lives as long as a file or a ResolveQuery still views it.
+class Archive {
+public:
+  struct File {
+    //! Full path, e.g. "pictures/dogs/1.png"
+    std::string path;
+    std::span<const u8> data;
+    //! Backs |data|
+    std::shared_ptr<const std::vector<u8>> storage;
+  };
+
+  //! Files sorted by path, so the contents of a folder are contiguous
+  std::span<const File> files() const { return mFiles; }
+
+  /*
+  find("pictures/dogs/1.png");
+  find("./pictures/dogs/../dogs/1.png");
+  */
+  std::optional<std::span<const u8>> find(std::string_view path) const;
+  //! As find(), but the whole entry
+  const File* findFile(std::string_view path) const;
+
+  //! Replace (or add) a file. Storage no longer viewed by anything is freed.
+  void write(std::string_view path, std::vector<u8> data);
+
+private:
+  friend Result<Archive> ReadArchive(std::span<const u8> buf);
+
+  void reindex();
+
+  std::vector<File> mFiles;
+  // Path -> index in mFiles
+  rsl::dense_map<std::string, size_t> mIndex;
 };
 
 //! Read a .szs/.carc file to a generic Archive
@@ -19,15 +54,14 @@ Result<Archive> ReadArchive(std::span<const u8> buf);
 //! Write a .szs/.carc file from a generic Archive
 Result<std::vector<u8>> WriteArchive(const Archive& arc);
 
-/*
-FindFile(arc, "pictures/dogs/1.png");
-
-return arc.folders.find("pictures")?.folders.find("dogs")?.files.find("1.png");
-*/
-std::optional<std::vector<u8>> FindFile(const Archive& arc, std::string path);
+std::optional<std::span<const u8>> FindFile(const Archive& arc,
+                                            std::string_view path);
 
 struct ResolveQuery {
-  std::vector<u8> file_data;
+  //! View into the archive; valid while this query is, even if the file is
+  //! overwritten
+  std::span<const u8> file_data;
+  std::shared_ptr<const std::vector<u8>> storage;
   std::string resolved_path;
 };
 
@@ -25,7 +25,7 @@ struct SimpleTransaction {
   kpi::LightIOTransaction trans;
 };
 
-Result<std::unique_ptr<g3d::Collection>> ReadBRRES(const std::vector<u8>& buf,
+Result<std::unique_ptr<g3d::Collection>> ReadBRRES(std::span<const u8> buf,
                                                    std::string path,
                                                    NeedResave need_resave) {
   auto result = std::make_unique<g3d::Collection>();
@@ -45,7 +45,7 @@ Result<std::unique_ptr<g3d::Collection>> ReadBRRES(const std::vector<u8>& buf,
 }
 
 Result<std::unique_ptr<librii::kmp::CourseMap>>
-ReadKMP(const std::vector<u8>& buf, std::string path) {
+ReadKMP(std::span<const u8> buf, std::string path) {
   auto map = TRY(librii::kmp::readKMP(buf));
   return std::make_unique<librii::kmp::CourseMap>(map);
 }
@@ -59,7 +59,7 @@ std::vector<u8> WriteKMP(const librii::kmp::CourseMap& map) {
 }
 
 Result<std::unique_ptr<librii::kcol::KCollisionData>>
-ReadKCL(const std::vector<u8>& buf, std::string path) {
+ReadKCL(std::span<const u8> buf, std::string path) {
   auto ok = librii::kcol::ReadKCollisionData(buf, buf.size());
 
   {
@@ -214,7 +214,7 @@ Result<void> LevelEditorWindow::tryOpenFile(std::span<const u8> buf,
 void LevelEditorWindow::saveFile(std::string path) {
   // Update archive cache
   if (mKmp != nullptr)
-    mLevel.root_archive.files["course.kmp"] = WriteKMP(*mKmp);
+    mLevel.root_archive.write("course.kmp", WriteKMP(*mKmp));
 
   // Flush archive cache
   auto szs_buf = WriteArchive(mLevel.root_archive);
@@ -230,18 +230,42 @@ void LevelEditorWindow::saveFile(std::string path) {
   }
 }
 
-static std::optional<std::pair<std::string, std::vector<u8>>>
-GatherNodes(Archive& arc) {
-  std::optional<std::pair<std::string, std::vector<u8>>> clicked;
-  for (auto& f : arc.folders) {
-    if (ImGui::TreeNode((f.first + "/").c_str())) {
-      GatherNodes(*f.second.get());
+// |files| all live under the folder ending at |prefix_len| in their paths
+static const Archive::File* GatherNodes(std::span<const Archive::File> files,
+                                        size_t prefix_len = 0) {
+  const Archive::File* clicked = nullptr;
+  // Since the files are sorted, a folder is a contiguous run
+  for (size_t i = 0; i < files.size();) {
+    const std::string_view rest =
+        std::string_view(files[i].path).substr(prefix_len);
+    const size_t slash = rest.find('/');
+    if (slash == std::string_view::npos) {
+      ++i;
+      continue;
+    }
+    const std::string_view folder = rest.substr(0, slash + 1);
+    size_t j = i + 1;
+    while (j < files.size() &&
+           std::string_view(files[j].path).substr(prefix_len).starts_with(
+               folder)) {
+      ++j;
+    }
+    if (ImGui::TreeNode(std::string(folder).c_str())) {
+      if (auto* f = GatherNodes(files.subspan(i, j - i),
+                                prefix_len + folder.size())) {
+        clicked = f;
+      }
       ImGui::TreePop();
     }
+    i = j;
   }
-  for (auto& f : arc.files) {
-    if (ImGui::Selectable(f.first.c_str())) {
-      clicked = f;
+  for (auto& f : files) {
+    const std::string_view name = std::string_view(f.path).substr(prefix_len);
+    if (name.find('/') != std::string_view::npos) {
+      continue;
+    }
+    if (ImGui::Selectable(std::string(name).c_str())) {
+      clicked = &f;
     }
   }
 
@@ -331,10 +355,10 @@ void LevelEditorWindow::draw_() {
     ImGui::EndMenuBar();
   }
   if (Begin(".szs", nullptr, 0, this)) {
-    auto clicked = GatherNodes(mLevel.root_archive);
-    if (clicked.has_value()) {
-      auto bytes = clicked->second;
-      auto path = clicked->first;
+    auto* clicked = GatherNodes(mLevel.root_archive.files());
+    if (clicked != nullptr) {
+      auto bytes = clicked->data;
+      auto path = clicked->path;
       frontend::FileData data;
       data.mData = std::make_unique<u8[]>(bytes.size());
       memcpy(data.mData.get(), bytes.data(), bytes.size());
@@ -27,6 +27,18 @@ bool gIsAdvancedMode = false;
 
 bool IsAdvancedMode() { return gIsAdvancedMode; }
 
+// Past this, editors drop their oldest undo steps
+int gUndoHistoryLimitMiB = 512;
+
+std::size_t UndoHistoryMemoryCap() {
+  return static_cast<std::size_t>(gUndoHistoryLimitMiB) << 20;
+}
+
+// Decode a BRRES's subfiles on every core when opening it
+bool gParallelBrresRead = false;
+
+bool ParallelBrresRead() { return gParallelBrresRead; }
+
 namespace libcube::UI {
 void InstallCrate();
 void ImageActionsInstaller();
@@ -254,6 +266,11 @@ void RootWindow::drawSettingsMenu() {
 
     ImGui::Checkbox("Advanced Mode"_j, &gIsAdvancedMode);
 
+    ImGui::SliderInt("Undo History Limit (MiB)"_j, &gUndoHistoryLimitMiB, 64,
+                     4096);
+
+    ImGui::Checkbox("Parallel BRRES Loading"_j, &gParallelBrresRead);
+
     ImGui::EndMenu();
   }
 }
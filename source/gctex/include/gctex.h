@@ -35,6 +35,12 @@ int32_t gctex_get_version_unstable_api(char* buf, uint32_t len);
 void rii_encode_cmpr(void* dst, uint32_t dst_len, const void* src,
                      uint32_t src_len, uint32_t width, uint32_t height);
 
+//! quality: 0 (fast range fit), 1 (default) or 2 (exhaustive cluster fit)
+//! num_threads: 0 for one per core
+void rii_encode_cmpr_ex(void* dst, uint32_t dst_len, const void* src,
+                        uint32_t src_len, uint32_t width, uint32_t height,
+                        uint32_t quality, uint32_t num_threads);
+
 void rii_encode_i4(void* dst, uint32_t dst_len, const void* src,
                    uint32_t src_len, uint32_t width, uint32_t height);
 
@@ -113,6 +119,18 @@ static inline std::vector<uint8_t> encode(uint32_t format,
   return dst;
 }
 
+//! Encode from raw 32-bit color to CMPR
+//!
+//! quality: 0 (fast range fit), 1 (default) or 2 (exhaustive cluster fit)
+//! num_threads: 0 for one per core
+static inline void encode_cmpr_into(std::span<uint8_t> dst,
+                                    std::span<const uint8_t> src,
+                                    uint32_t width, uint32_t height,
+                                    uint32_t quality, uint32_t num_threads) {
+  ::rii_encode_cmpr_ex(dst.data(), dst.size(), src.data(), src.size(), width,
+                       height, quality, num_threads);
+}
+
 //! Decode from the specified format to raw 32-bit color
 static inline void decode_into(std::span<uint8_t> dst,
                                std::span<const uint8_t> src, uint32_t width,
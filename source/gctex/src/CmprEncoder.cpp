@@ -3,12 +3,17 @@
  * @brief CMPR encoding. Based on WIMGT's implementation.
  */
 
-#include "util.h"
+#include "CmprEncoder.hpp"
 
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 namespace librii { namespace image {
 
 const u8 cc58[32] = // convert 5-bit color to 8-bit color
@@ -374,159 +379,319 @@ static inline void WIMGT_CMPR(const u8* data, cmpr_info_t* info) {
   memcpy(info->p[0], sum[best0].col, 4);
   memcpy(info->p[1], sum[best1].col, 4);
 }
-struct Image_t;
-u32 CalcImageSize(u32 width,  // width of image in pixel
-                  u32 height, // height of image in pixel
-
-                  u32 bits_per_pixel, // number of bits per pixel
-                  u32 block_width,    // width of a single block
-                  u32 block_height,   // height of a single block
-
-                  u32* x_width,  // not NULL: store extended width here
-                  u32* x_height, // not NULL: store extended height here
-                  u32* h_blocks, // not NULL: store number of horizontal blocks
-                  u32* v_blocks  // not NULL: store number of vertical blocks
-) {
-  const u32 hblocks = (width + block_width - 1) / block_width;
-  if (h_blocks)
-    *h_blocks = hblocks;
-
-  const u32 xwidth = hblocks * block_width;
-  if (x_width)
-    *x_width = xwidth;
-
-  const u32 vblocks = (height + block_height - 1) / block_height;
-  if (v_blocks)
-    *v_blocks = vblocks;
-
-  const u32 xheight = vblocks * block_height;
-  if (x_height)
-    *x_height = xheight;
+// Principal axis of the opaque pixels' colors, by power iteration on their
+// covariance. Returns false if they are all the same color.
+static bool PrincipalAxis(const u8* data, f32 axis[3]) {
+  f32 mean[3] = {0.0f, 0.0f, 0.0f};
+  u32 n = 0;
+  for (const u8* dat = data; dat < data + CMPR_DATA_SIZE; dat += 4) {
+    if (dat[3] & 0x80) {
+      for (int c = 0; c < 3; c++)
+        mean[c] += dat[c];
+      n++;
+    }
+  }
+  if (!n)
+    return false;
+  for (int c = 0; c < 3; c++)
+    mean[c] /= n;
+
+  // rr, rg, rb, gg, gb, bb
+  f32 cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  for (const u8* dat = data; dat < data + CMPR_DATA_SIZE; dat += 4) {
+    if (dat[3] & 0x80) {
+      const f32 r = dat[0] - mean[0], g = dat[1] - mean[1], b = dat[2] - mean[2];
+      cov[0] += r * r;
+      cov[1] += r * g;
+      cov[2] += r * b;
+      cov[3] += g * g;
+      cov[4] += g * b;
+      cov[5] += b * b;
+    }
+  }
 
-  return xwidth * xheight * bits_per_pixel / 8;
+  // Start from the covariance row with the largest variance, as squish does.
+  // A fixed seed such as (1, 1, 1) is orthogonal to, say, a red-green axis,
+  // which then never shows up.
+  const f32 rows[3][3] = {{cov[0], cov[1], cov[2]},
+                          {cov[1], cov[3], cov[4]},
+                          {cov[2], cov[4], cov[5]}};
+  int seed = 0;
+  for (int c = 1; c < 3; c++)
+    if (rows[c][c] > rows[seed][seed])
+      seed = c;
+  for (int c = 0; c < 3; c++)
+    axis[c] = rows[seed][c];
+  for (int i = 0; i < 8; i++) {
+    const f32 x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    const f32 y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    const f32 z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    f32 m = fabsf(x) > fabsf(y) ? fabsf(x) : fabsf(y);
+    m = m > fabsf(z) ? m : fabsf(z);
+    if (m == 0.0f)
+      return false;
+    axis[0] = x / m;
+    axis[1] = y / m;
+    axis[2] = z / m;
+  }
+  return true;
 }
 
-static void
-CalcImageBlock(u32 width, u32 height,
-               u32 bits_per_pixel, // number of bits per pixel
-               u32 block_width,    // width of a single block
-               u32 block_height,   // height of a single block
-
-               u32* h_blocks, // not NULL: store number of horizontal blocks
-               u32* v_blocks, // not NULL: store number of vertical blocks
-               u32* img_size  // not NULL: return image size
-) {
-
-  u32 xwidth, xheight;
-  const u32 size =
-      CalcImageSize(width, height, bits_per_pixel, block_width, block_height,
-                    &xwidth, &xheight, h_blocks, v_blocks);
-  if (img_size)
-    *img_size = size;
+static inline f32 Project(const u8* dat, const f32 axis[3]) {
+  return dat[0] * axis[0] + dat[1] * axis[1] + dat[2] * axis[2];
 }
 
-void NormalizeFrameIMG(u32 width, u32 height, u32 xwidth, u32 xheight,
-                       u8* data) {
-  const u32 cell_size = 4;
-
-  if (width > 0 && xwidth > width) {
-    const u32 fill_size = (xwidth - width) * cell_size;
-    u8* row = data + width * cell_size;
-    u32 ih = height;
-    while (ih-- > 0) {
-      u8* src = row - cell_size;
-      u8* dest = row;
-      u8* end = row + fill_size;
-      while (dest < end)
-        *dest++ = *src++;
-      row += xwidth * cell_size;
+// Fast mode: the endpoints are the pixels furthest apart along the principal
+// axis.
+static inline void RangeFit_CMPR(const u8* data, cmpr_info_t* info) {
+  assert(info);
+  memset(info, 0, sizeof(*info));
+
+  const u8* lo = nullptr;
+  const u8* hi = nullptr;
+  f32 axis[3];
+  if (!PrincipalAxis(data, axis)) {
+    // No direction to range over: fall back to the pair search
+    WIMGT_CMPR(data, info);
+    return;
+  }
+  f32 lo_proj = 0.0f, hi_proj = 0.0f;
+  for (const u8* dat = data; dat < data + CMPR_DATA_SIZE; dat += 4) {
+    if (!(dat[3] & 0x80))
+      continue;
+    info->opaque_count++;
+    const f32 proj = Project(dat, axis);
+    if (!lo || proj < lo_proj) {
+      lo = dat;
+      lo_proj = proj;
+    }
+    if (!hi || proj > hi_proj) {
+      hi = dat;
+      hi_proj = proj;
     }
   }
+  if (!info->opaque_count)
+    return;
 
-  if (height > 0 && xheight > height) {
-    const u32 line_size = xwidth * cell_size;
-    u8* dest = data + height * line_size;
-    u8* end = data + xheight * line_size;
-    u8* src = dest - line_size;
-    while (dest < end)
-      *dest++ = *src++;
-  }
+  memcpy(info->p[0], lo, 3);
+  info->p[0][3] = 0xff;
+  memcpy(info->p[1], hi, 3);
+  info->p[1][3] = 0xff;
 }
 
-void EncodeDXT1(u8* dest_img, const u8* source_img, u32 width, u32 height) {
-  assert(dest_img);
-  assert(source_img);
+// Best mode: order the pixels along the principal axis and try every way of
+// splitting that order into the block's 3 or 4 palette entries. For each
+// split, the endpoints are solved by least squares (after squish's
+// ClusterFit).
+static inline void ClusterFit_CMPR(const u8* data, cmpr_info_t* info) {
+  assert(info);
+  memset(info, 0, sizeof(*info));
 
-  const u32 xwidth = ((width + 7) & ~7);
-  const u32 xheight = ((height + 7) & ~7);
-
-  // Adjust to wiimm xheight/xwidth convention.
-  // The source image may be, say, 500x500, but will be stored as 504x504
-  // Not in-place because I'm lazy
-  u8* tmp = (u8*)calloc(1, xwidth * xheight * 4);
-
-  if (width > 0 && height > 0) {
-    for (u32 y = 0; y < xheight; ++y) {
-      for (u32 x = 0; x < xwidth; ++x) {
-        // Row-major matrix
-#define MIN(x, y) (x < y ? x : y)
-        u32 src_cell = width * MIN(y, height - 1) + MIN(x, width - 1);
-        u32 dst_cell = xwidth * y + x;
-#undef MIN
-        memcpy(&tmp[dst_cell * 4], &source_img[src_cell * 4], 4);
+  f32 axis[3];
+  if (!PrincipalAxis(data, axis)) {
+    WIMGT_CMPR(data, info);
+    return;
+  }
+
+  f32 px[CMPR_MAX_COL][3];
+  f32 proj[CMPR_MAX_COL];
+  u32 n = 0;
+  for (const u8* dat = data; dat < data + CMPR_DATA_SIZE; dat += 4) {
+    if (!(dat[3] & 0x80))
+      continue;
+    // Insertion sort by projection
+    const f32 p = Project(dat, axis);
+    u32 i = n++;
+    for (; i > 0 && proj[i - 1] > p; i--) {
+      memcpy(px[i], px[i - 1], sizeof(px[i]));
+      proj[i] = proj[i - 1];
+    }
+    for (int c = 0; c < 3; c++)
+      px[i][c] = dat[c];
+    proj[i] = p;
+  }
+  info->opaque_count = n;
+
+  // prefix[i]: Sum of the first i pixels
+  f32 prefix[CMPR_MAX_COL + 1][3] = {{0.0f, 0.0f, 0.0f}};
+  for (u32 i = 0; i < n; i++)
+    for (int c = 0; c < 3; c++)
+      prefix[i + 1][c] = prefix[i][c] + px[i][c];
+
+  // Weight of endpoint a for each palette entry, in order from a to b
+  static const f32 weights4[4] = {1.0f, 2.0f / 3.0f, 1.0f / 3.0f, 0.0f};
+  static const f32 weights3[4] = {1.0f, 0.5f, 0.0f, 0.0f};
+  const bool opaque = n == CMPR_MAX_COL;
+  const f32* weights = opaque ? weights4 : weights3;
+  const u32 num_clusters = opaque ? 4 : 3;
+
+  f32 best_error = 1e30f;
+  f32 best_a[3] = {0.0f, 0.0f, 0.0f}, best_b[3] = {0.0f, 0.0f, 0.0f};
+  for (u32 i = 0; i <= n; i++) {
+    for (u32 j = i; j <= n; j++) {
+      for (u32 k = opaque ? j : n; k <= n; k++) {
+        // Cluster c spans [bounds[c], bounds[c + 1])
+        const u32 bounds[5] = {0, i, j, opaque ? k : n, n};
+
+        f32 aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        f32 ax[3] = {0.0f, 0.0f, 0.0f};
+        for (u32 c = 0; c < num_clusters; c++) {
+          const u32 lo = bounds[c];
+          const u32 hi = bounds[c + 1];
+          const f32 count = (f32)(hi - lo);
+          const f32 alpha = weights[c], beta = 1.0f - alpha;
+          aa += alpha * alpha * count;
+          bb += beta * beta * count;
+          ab += alpha * beta * count;
+          for (int ch = 0; ch < 3; ch++)
+            ax[ch] += alpha * (prefix[hi][ch] - prefix[lo][ch]);
+        }
+        const f32 det = aa * bb - ab * ab;
+        if (fabsf(det) < 1e-6f)
+          continue;
+
+        f32 a[3], b[3], error = 0.0f;
+        for (int c = 0; c < 3; c++) {
+          const f32 bx = prefix[n][c] - ax[c];
+          a[c] = (ax[c] * bb - bx * ab) / det;
+          b[c] = (bx * aa - ax[c] * ab) / det;
+          a[c] = a[c] < 0.0f ? 0.0f : (a[c] > 255.0f ? 255.0f : a[c]);
+          b[c] = b[c] < 0.0f ? 0.0f : (b[c] > 255.0f ? 255.0f : b[c]);
+          // Sum of |alpha a + beta b - x|^2, less the constant sum of x^2
+          error += a[c] * a[c] * aa + b[c] * b[c] * bb + 2.0f * a[c] * b[c] * ab -
+                   2.0f * a[c] * ax[c] - 2.0f * b[c] * bx;
+        }
+        if (error < best_error) {
+          best_error = error;
+          memcpy(best_a, a, sizeof(a));
+          memcpy(best_b, b, sizeof(b));
+        }
       }
     }
   }
 
-  NormalizeFrameIMG(width, height, xwidth, xheight, tmp);
+  for (int c = 0; c < 3; c++) {
+    info->p[0][c] = (u8)(best_a[c] + 0.5f);
+    info->p[1][c] = (u8)(best_b[c] + 0.5f);
+  }
+  info->p[0][3] = info->p[1][3] = 0xff;
+}
 
-  const u32 bits_per_pixel = 4;
-  const u32 block_width = 8;
-  const u32 block_height = 8;
+// Squared color error of an encoded block, as CMPR_close_info computes its
+// palette
+static u32 BlockError(const u8* data, const u8* block) {
+  const u16 p0 = block[0] << 8 | block[1];
+  const u16 p1 = block[2] << 8 | block[3];
+  u8 pal[4][3] = {
+      {cc58[p0 >> 11], cc68[p0 >> 5 & 0x3f], cc58[p0 & 0x1f]},
+      {cc58[p1 >> 11], cc68[p1 >> 5 & 0x3f], cc58[p1 & 0x1f]},
+  };
+  for (int c = 0; c < 3; c++) {
+    if (p0 > p1) {
+      pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+      pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+    } else {
+      pal[2][c] = pal[3][c] = (pal[0][c] + pal[1][c]) / 2;
+    }
+  }
+  u32 error = 0;
+  for (u32 i = 0; i < CMPR_MAX_COL; i++, data += 4) {
+    if (!(data[3] & 0x80))
+      continue;
+    const u32 index = block[4 + i / 4] >> (6 - 2 * (i % 4)) & 3;
+    if (index == 3 && p0 <= p1)
+      return (u32)-1; // Opaque pixel made transparent
+    for (int c = 0; c < 3; c++) {
+      const int d = (int)data[c] - (int)pal[index][c];
+      error += d * d;
+    }
+  }
+  return error;
+}
 
-  u32 h_blocks, v_blocks, img_size;
-  CalcImageBlock(width, height, bits_per_pixel, block_width, block_height,
-                 &h_blocks, &v_blocks, &img_size);
+static void EncodeBlock(const u8* vector, u8* dest, u32 quality) {
+  cmpr_info_t info;
+  switch (quality) {
+  case CMPR_QUALITY_FAST:
+    RangeFit_CMPR(vector, &info);
+    CMPR_close_info(vector, &info, dest);
+    break;
+  case CMPR_QUALITY_BEST: {
+    // Cluster fit is usually, but not always, better than the pair search
+    u8 other[8];
+    WIMGT_CMPR(vector, &info);
+    CMPR_close_info(vector, &info, other);
+    ClusterFit_CMPR(vector, &info);
+    CMPR_close_info(vector, &info, dest);
+    if (BlockError(vector, other) <= BlockError(vector, dest))
+      memcpy(dest, other, 8);
+    break;
+  }
+  default:
+    WIMGT_CMPR(vector, &info);
+    CMPR_close_info(vector, &info, dest);
+    break;
+  }
+}
 
-  u8* dest = dest_img;
-  const u8* src1 = tmp;
+void EncodeDXT1(u8* dest_img, const u8* source_img, u32 width, u32 height,
+                u32 quality, u32 num_threads) {
+  assert(dest_img);
+  assert(source_img);
 
-  const u32 block_size = block_width * 4;
+  if (!width || !height)
+    return;
 
-  const u32 line_size = xwidth * 4;
-  const u32 delta[] = {0, 16, 4 * line_size, 4 * line_size + 16};
+  // Stored as 8x8 tiles of four 4x4 DXT1 blocks. The source image may be, say,
+  // 500x500, but will be stored as 504x504, repeating the edge pixels.
+  const u32 h_blocks = (width + 7) / 8;
+  const u32 v_blocks = (height + 7) / 8;
+
+  // Encodes rows of tiles until none are left
+  std::atomic<u32> next_row{0};
+  auto worker = [&]() {
+    for (u32 by; (by = next_row.fetch_add(1)) < v_blocks;) {
+      u8* dest = dest_img + by * h_blocks * 32;
+      for (u32 bx = 0; bx < h_blocks; bx++) {
+        for (u32 subb = 0; subb < 4; subb++) {
+          //---- first collect the data of the 16 pixel
+
+          u8 vector[16 * 4], *vect = vector;
+          const u32 x0 = bx * 8 + (subb & 1) * 4;
+          const u32 y0 = by * 8 + (subb >> 1) * 4;
+          for (u32 y = y0; y < y0 + 4; y++) {
+            const u32 sy = y < height ? y : height - 1;
+            for (u32 x = x0; x < x0 + 4; x++, vect += 4) {
+              const u32 sx = x < width ? x : width - 1;
+              memcpy(vect, &source_img[(sy * width + sx) * 4], 4);
+            }
+          }
+          assert(vect == vector + sizeof(vector));
 
-  while (v_blocks-- > 0) {
-    const u8* src2 = src1;
-    u32 hblk = h_blocks;
-    while (hblk-- > 0) {
-      for (u32 subb = 0; subb < 4; subb++) {
-        //---- first collect the data of the 16 pixel
+          //--- analyze data
 
-        u8 vector[16 * 4], *vect = vector;
-        const u8* src3 = src2 + delta[subb];
-        for (u32 i = 0; i < 4; i++) {
-          memcpy(vect, src3, 16);
-          vect += 16;
-          src3 += line_size;
+          EncodeBlock(vector, dest, quality);
+          dest += 8;
         }
-        assert(vect == vector + sizeof(vector));
-
-        //--- analyze data
-
-        cmpr_info_t info;
-        WIMGT_CMPR(vector, &info);
-        CMPR_close_info(vector, &info, dest);
-        dest += 8;
       }
-      src2 += block_size;
     }
-    src1 += line_size * block_height;
+  };
+
+  // One row of tiles per thread at minimum; small images aren't worth it.
+  if (!num_threads)
+    num_threads = std::thread::hardware_concurrency();
+  if (num_threads > v_blocks)
+    num_threads = v_blocks;
+  if (h_blocks * v_blocks < 64 || num_threads < 2) {
+    worker();
+    return;
   }
-
-  assert(dest == dest_img + img_size);
-  // assert(src1 <= dest_img->data + dest_img->data_size);
-  free(tmp);
+  std::vector<std::thread> threads;
+  for (u32 i = 1; i < num_threads; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& t : threads)
+    t.join();
 }
 
 } } // namespace librii::image
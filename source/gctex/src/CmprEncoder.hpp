@@ -4,6 +4,13 @@
 
 namespace librii { namespace image {
 
-void EncodeDXT1(u8* dest_img, const u8* source_img, u32 width, u32 height);
+//! Fast: endpoints from the extremes along the principal axis.
+//! Normal: best pair of the block's own colors (WIMGT).
+//! Best: least-squares cluster fit, falling back to Normal where it is better.
+enum { CMPR_QUALITY_FAST, CMPR_QUALITY_NORMAL, CMPR_QUALITY_BEST };
+
+//! Rows of 8x8 tiles are spread over |num_threads| threads (0: one per core).
+void EncodeDXT1(u8* dest_img, const u8* source_img, u32 width, u32 height,
+                u32 quality = CMPR_QUALITY_NORMAL, u32 num_threads = 0);
 
 } } // namespace librii::images
@@ -7,8 +7,9 @@ void impl_rii_decode(u8* dst, const u8* src, u32 width, u32 height,
   librii::image::decode(dst, src, width, height, texformat, tlut, tlutformat);
 }
 void impl_rii_encodeCMPR(u8* dest_img, const u8* source_img, u32 width,
-                         u32 height) {
-  return librii::image::EncodeDXT1(dest_img, source_img, width, height);
+                         u32 height, u32 quality, u32 num_threads) {
+  return librii::image::EncodeDXT1(dest_img, source_img, width, height,
+                                   quality, num_threads);
 }
 void impl_rii_encodeI4(u8* dst, const u8* src, u32 width, u32 height) {
   return librii::image::encodeI4(dst, (const u32*)src, width, height);
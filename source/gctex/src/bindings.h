@@ -9,7 +9,8 @@
 WASM_EXPORT void impl_rii_decode(u8* dst, const u8* src, u32 width, u32 height,
                                  u32 texformat, const u8* tlut, u32 tlutformat);
 WASM_EXPORT void impl_rii_encodeCMPR(u8* dest_img, const u8* source_img,
-                                     u32 width, u32 height);
+                                     u32 width, u32 height, u32 quality,
+                                     u32 num_threads);
 WASM_EXPORT void impl_rii_encodeI4(u8* dst, const u8* src, u32 width,
                                    u32 height);
 WASM_EXPORT void impl_rii_encodeI8(u8* dst, const u8* src, u32 width,
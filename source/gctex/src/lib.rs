@@ -495,9 +495,53 @@ pub fn decode(
     dst
 }
 
+/// Trades CMPR quality for encoding speed.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u32)]
+pub enum CmprQuality {
+    /// Endpoints from the extremes along the principal axis.
+    Fast = 0,
+    /// Best pair of each block's own colors.
+    Normal = 1,
+    /// Least-squares cluster fit over every ordering of the block's colors.
+    Best = 2,
+}
+
+impl CmprQuality {
+    pub fn from_u32(value: u32) -> Option<Self> {
+        match value {
+            0 => Some(CmprQuality::Fast),
+            1 => Some(CmprQuality::Normal),
+            2 => Some(CmprQuality::Best),
+            _ => None,
+        }
+    }
+}
+
 pub fn encode_cmpr_into(dst: &mut [u8], src: &[u8], width: u32, height: u32) {
+    encode_cmpr_ex_into(dst, src, width, height, CmprQuality::Normal, 0);
+}
+
+/// Encodes CMPR with the given quality, spreading rows of 8x8 tiles over `num_threads` threads (0 for one per core).
+pub fn encode_cmpr_ex_into(
+    dst: &mut [u8],
+    src: &[u8],
+    width: u32,
+    height: u32,
+    quality: CmprQuality,
+    num_threads: u32,
+) {
+    assert!(dst.len() >= compute_image_size(TextureFormat::CMPR, width, height) as usize);
+    assert!(src.len() >= (width * height * 4) as usize);
     unsafe {
-        bindings::impl_rii_encodeCMPR(dst.as_mut_ptr(), src.as_ptr(), width, height);
+        bindings::impl_rii_encodeCMPR(
+            dst.as_mut_ptr(),
+            src.as_ptr(),
+            width,
+            height,
+            quality as u32,
+            num_threads,
+        );
     }
 }
 
@@ -712,6 +756,28 @@ pub mod c_api {
         encode_cmpr_into(dst_slice, src_slice, width, height);
     }
 
+    #[no_mangle]
+    pub unsafe extern "C" fn rii_encode_cmpr_ex(
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        width: u32,
+        height: u32,
+        quality: u32,
+        num_threads: u32,
+    ) {
+        let dst_slice = slice::from_raw_parts_mut(dst as *mut u8, dst_len as usize);
+        let src_slice = slice::from_raw_parts(src as *const u8, src_len as usize);
+        let quality = match CmprQuality::from_u32(quality) {
+            Some(q) => q,
+            None => {
+                panic!("Invalid CMPR quality: {}", quality);
+            }
+        };
+        encode_cmpr_ex_into(dst_slice, src_slice, width, height, quality, num_threads);
+    }
+
     #[no_mangle]
     pub unsafe extern "C" fn rii_encode_i4(
         dst: *mut u8,
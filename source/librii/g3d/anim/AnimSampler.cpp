@@ -0,0 +1,575 @@
+#include "AnimSampler.hpp"
+
+#include <librii/trig/WiiTrig.hpp>
+#include <rsl/Simd.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+IMPORT_STD;
+
+namespace librii::g3d {
+
+f32 WrapFrame(f32 frame, u16 frameDuration, AnimationWrapMode wrapMode) {
+  const f32 duration = static_cast<f32>(frameDuration);
+  if (wrapMode == AnimationWrapMode::Clamp || duration <= 0.0f) {
+    return std::clamp(frame, 0.0f, duration);
+  }
+  frame = std::fmod(frame, duration);
+  return frame < 0.0f ? frame + duration : frame;
+}
+
+//
+// CurveSet
+//
+
+// Holds the first value for every frame before the first key
+static constexpr f32 BeforeAll = -std::numeric_limits<f32>::max();
+
+u32 CurveSet::addChannel(u32 first) {
+  mChannels.push_back({first, static_cast<u32>(mStarts.size())});
+  return size() - 1;
+}
+void CurveSet::addSegment(f32 start, const Coeffs& c) {
+  mStarts.push_back(start);
+  mCoeffs.push_back(c);
+}
+
+u32 CurveSet::addConstant(f32 value) {
+  const u32 first = static_cast<u32>(mStarts.size());
+  addSegment(BeforeAll, {value, 0.0f, 0.0f, 0.0f});
+  return addChannel(first);
+}
+
+u32 CurveSet::addHermite(std::span<const SRT0KeyFrame> keys) {
+  if (keys.empty()) {
+    return addConstant(0.0f);
+  }
+  std::vector<SRT0KeyFrame> sorted;
+  if (!std::ranges::is_sorted(keys, {}, &SRT0KeyFrame::frame)) {
+    sorted.assign(keys.begin(), keys.end());
+    std::ranges::stable_sort(sorted, {}, &SRT0KeyFrame::frame);
+    keys = sorted;
+  }
+
+  const u32 first = static_cast<u32>(mStarts.size());
+  addSegment(BeforeAll, {keys[0].value, 0.0f, 0.0f, 0.0f});
+  for (size_t i = 0; i + 1 < keys.size(); ++i) {
+    const auto& l = keys[i];
+    const auto& r = keys[i + 1];
+    const f32 d = r.frame - l.frame;
+    // A step: the next segment takes over at the same frame
+    if (d <= 0.0f) {
+      continue;
+    }
+    const f32 slope = (r.value - l.value) / d;
+    addSegment(l.frame, {
+                            l.value,
+                            l.tangent,
+                            (3.0f * slope - 2.0f * l.tangent - r.tangent) / d,
+                            (l.tangent + r.tangent - 2.0f * slope) / (d * d),
+                        });
+  }
+  if (keys.size() > 1) {
+    addSegment(keys.back().frame, {keys.back().value, 0.0f, 0.0f, 0.0f});
+  }
+  return addChannel(first);
+}
+
+u32 CurveSet::addBaked(std::span<const f32> values) {
+  if (values.size() <= 1) {
+    return addConstant(values.empty() ? 0.0f : values[0]);
+  }
+  const u32 first = static_cast<u32>(mStarts.size());
+  addSegment(BeforeAll, {values[0], 0.0f, 0.0f, 0.0f});
+  for (size_t i = 0; i + 1 < values.size(); ++i) {
+    addSegment(static_cast<f32>(i),
+               {values[i], values[i + 1] - values[i], 0.0f, 0.0f});
+  }
+  addSegment(static_cast<f32>(values.size() - 1),
+             {values.back(), 0.0f, 0.0f, 0.0f});
+  return addChannel(first);
+}
+
+u32 CurveSet::addAlias(u32 channel) {
+  assert(channel < size());
+  mChannels.push_back(mChannels[channel]);
+  return size() - 1;
+}
+
+u32 CurveSet::findSegment(u32 channel, f32 frame) const {
+  const auto& c = mChannels[channel];
+  // Never before |first|, which starts at BeforeAll
+  const auto it = std::upper_bound(mStarts.begin() + c.first,
+                                   mStarts.begin() + c.end, frame);
+  return static_cast<u32>(it - mStarts.begin()) - 1;
+}
+
+void CurveSet::evaluate(f32 frame, const u32* segs, f32* out,
+                        u32 count) const {
+  u32 i = 0;
+#if RSL_HAS_SSE2
+  const __m128 f = _mm_set1_ps(frame);
+  for (; i + 4 <= count; i += 4) {
+    // One segment per register, then one coefficient per register
+    __m128 c0 = _mm_loadu_ps(mCoeffs[segs[i]].data());
+    __m128 c1 = _mm_loadu_ps(mCoeffs[segs[i + 1]].data());
+    __m128 c2 = _mm_loadu_ps(mCoeffs[segs[i + 2]].data());
+    __m128 c3 = _mm_loadu_ps(mCoeffs[segs[i + 3]].data());
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    const __m128 t =
+        _mm_sub_ps(f, _mm_setr_ps(mStarts[segs[i]], mStarts[segs[i + 1]],
+                                  mStarts[segs[i + 2]], mStarts[segs[i + 3]]));
+    __m128 r = _mm_add_ps(_mm_mul_ps(c3, t), c2);
+    r = _mm_add_ps(_mm_mul_ps(r, t), c1);
+    r = _mm_add_ps(_mm_mul_ps(r, t), c0);
+    _mm_storeu_ps(out + i, r);
+  }
+#endif
+  for (; i < count; ++i) {
+    const auto& c = mCoeffs[segs[i]];
+    const f32 t = frame - mStarts[segs[i]];
+    out[i] = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+  }
+}
+
+void CurveSet::sample(f32 frame, std::span<f32> out) const {
+  assert(out.size() >= size());
+  // Segments are found a block at a time, so nothing is allocated
+  std::array<u32, 64> segs;
+  for (u32 base = 0; base < size(); base += segs.size()) {
+    const u32 n = std::min<u32>(segs.size(), size() - base);
+    for (u32 i = 0; i < n; ++i) {
+      segs[i] = findSegment(base + i, frame);
+    }
+    evaluate(frame, segs.data(), out.data() + base, n);
+  }
+}
+
+void CurveSet::sampleRange(std::span<const f32> frames,
+                           std::span<f32> out) const {
+  assert(out.size() >= frames.size() * size());
+  std::vector<u32> segs(size());
+  f32 prev = std::numeric_limits<f32>::infinity();
+  for (size_t i = 0; i < frames.size(); ++i) {
+    const f32 frame = frames[i];
+    if (frame < prev) {
+      for (u32 c = 0; c < size(); ++c) {
+        segs[c] = findSegment(c, frame);
+      }
+    } else {
+      for (u32 c = 0; c < size(); ++c) {
+        const u32 end = mChannels[c].end;
+        u32 s = segs[c];
+        while (s + 1 < end && mStarts[s + 1] <= frame) {
+          ++s;
+        }
+        segs[c] = s;
+      }
+    }
+    prev = frame;
+    evaluate(frame, segs.data(), out.data() + i * size(), size());
+  }
+}
+
+//
+// CHR0
+//
+
+static_assert(sizeof(math::SRT3) == 9 * sizeof(f32));
+static_assert(sizeof(TexSrtSample) == 5 * sizeof(f32));
+
+static Result<u32> AddChrTrack(CurveSet& curves, const CHR0AnyTrack& track) {
+  std::vector<SRT0KeyFrame> keys;
+  std::vector<f32> values;
+  if (auto* keyed = std::get_if<CHR0Track>(&track.data)) {
+    if (auto* t = std::get_if<CHR0Track32>(&keyed->data)) {
+      for (auto& f : t->frames) {
+        // Only the raw word is kept
+        const u32 x = f.bruh;
+        keys.push_back({
+            .frame = static_cast<f32>(x >> 24),
+            .value = ((x >> 12) & 0xFFF) * t->scale + t->offset,
+            .tangent = (static_cast<s32>(x << 20) >> 20) / 32.0f,
+        });
+      }
+    } else if (auto* t = std::get_if<CHR0Track48>(&keyed->data)) {
+      for (auto& f : t->frames) {
+        keys.push_back({
+            .frame = f.frame / 32.0f,
+            .value = f.value * t->scale + t->offset,
+            .tangent = f.slope / 256.0f,
+        });
+      }
+    } else if (auto* t = std::get_if<CHR0Track96>(&keyed->data)) {
+      for (auto& f : t->frames) {
+        keys.push_back(
+            {.frame = f.frame, .value = f.value, .tangent = f.slope});
+      }
+    }
+    EXPECT(!keys.empty(), "CHR0 track has no keyframes");
+    return curves.addHermite(keys);
+  }
+  auto& baked = std::get<CHR0BakedTrack>(track.data);
+  if (auto* t = std::get_if<CHR0BakedTrack8>(&baked.data)) {
+    for (u8 v : t->frames) {
+      values.push_back(v * t->scale + t->offset);
+    }
+  } else if (auto* t = std::get_if<CHR0BakedTrack16>(&baked.data)) {
+    for (u16 v : t->frames) {
+      values.push_back(v * t->scale + t->offset);
+    }
+  } else if (auto* t = std::get_if<CHR0BakedTrack32>(&baked.data)) {
+    values = t->frames;
+  }
+  return curves.addBaked(values);
+}
+
+Result<ChrSampler> ChrSampler::compile(const BinaryChr& chr,
+                                       std::span<const BoneData> bones) {
+  ChrSampler result;
+  result.mFrameDuration = chr.frameDuration;
+  result.mWrapMode = chr.wrapMode;
+
+  // Bone -> node
+  const size_t num_bones = bones.empty() ? chr.nodes.size() : bones.size();
+  std::vector<const CHR0Node*> nodes(num_bones, nullptr);
+  if (bones.empty()) {
+    for (size_t i = 0; i < chr.nodes.size(); ++i) {
+      nodes[i] = &chr.nodes[i];
+    }
+  } else {
+    std::unordered_map<std::string_view, size_t> by_name;
+    for (size_t i = 0; i < bones.size(); ++i) {
+      by_name.emplace(bones[i].mName, i);
+    }
+    for (auto& node : chr.nodes) {
+      if (auto it = by_name.find(node.name); it != by_name.end()) {
+        nodes[it->second] = &node;
+      }
+    }
+  }
+
+  // Tracks shared between nodes share a channel
+  std::map<u32, u32> track_channels;
+  for (size_t b = 0; b < num_bones; ++b) {
+    math::SRT3 pose{
+        .scale = {1.0f, 1.0f, 1.0f},
+        .rotation = {0.0f, 0.0f, 0.0f},
+        .translation = {0.0f, 0.0f, 0.0f},
+    };
+    if (!bones.empty()) {
+      pose = {bones[b].mScaling, bones[b].mRotation, bones[b].mTranslation};
+      result.mParents.push_back(bones[b].mParent);
+      result.mSsc.push_back(bones[b].ssc);
+    } else {
+      result.mParents.push_back(-1);
+      result.mSsc.push_back(false);
+    }
+    const f32* pose_values = &pose.scale.x;
+
+    const CHR0Node* node = nodes[b];
+    if (node == nullptr) {
+      for (int a = 0; a < 9; ++a) {
+        result.mCurves.addConstant(pose_values[a]);
+      }
+      continue;
+    }
+
+    const u32 flags = node->flags;
+    const u32 sx_channel = result.mCurves.size();
+    size_t k = 0;
+    for (auto attr : CHR0Attribs) {
+      const int a = static_cast<int>(attr);
+      if (CHR0Flags::HasAttrib(flags, attr)) {
+        EXPECT(k < node->tracks.size(),
+               std::format("CHR0 node {} is missing tracks", node->name));
+        const auto& track = node->tracks[k++];
+        if (auto* c = std::get_if<f32>(&track)) {
+          result.mCurves.addConstant(*c);
+          continue;
+        }
+        const u32 index = std::get<u32>(track);
+        EXPECT(index < chr.tracks.size());
+        if (auto it = track_channels.find(index);
+            it != track_channels.end()) {
+          result.mCurves.addAlias(it->second);
+        } else {
+          track_channels[index] =
+              TRY(AddChrTrack(result.mCurves, chr.tracks[index]));
+        }
+        continue;
+      }
+
+      // Not animated
+      const int group = a / 3;
+      const u32 from_model = std::array{CHR0Flags::SCL_MODEL,
+                                        CHR0Flags::ROT_MODEL,
+                                        CHR0Flags::TRANS_MODEL}[group];
+      if (flags & from_model) {
+        result.mCurves.addConstant(pose_values[a]);
+      } else if (group == 0 && a != 0 && (flags & CHR0Flags::SCL_ISOTROPIC) &&
+                 !(flags & (CHR0Flags::SRT_IDENTITY | CHR0Flags::SCL_ONE))) {
+        result.mCurves.addAlias(sx_channel);
+      } else {
+        result.mCurves.addConstant(group == 0 ? 1.0f : 0.0f);
+      }
+    }
+  }
+
+  // Parents before children. A bone whose parent is out of range, or in a
+  // cycle, is treated as a root.
+  const s32 n = static_cast<s32>(num_bones);
+  for (auto& parent : result.mParents) {
+    if (parent >= n) {
+      parent = -1;
+    }
+  }
+  std::vector<u8> placed(num_bones, 0);
+  std::vector<u32> chain;
+  for (u32 b = 0; b < num_bones; ++b) {
+    chain.clear();
+    for (s32 it = b; it >= 0 && !placed[it] && chain.size() <= num_bones;
+         it = result.mParents[it]) {
+      chain.push_back(it);
+    }
+    if (chain.size() > num_bones) {
+      result.mParents[b] = -1;
+      chain = {b};
+    }
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      if (!placed[*it]) {
+        placed[*it] = 1;
+        result.mOrder.push_back(*it);
+      }
+    }
+  }
+
+  return result;
+}
+
+void ChrSampler::sampleSrt(f32 frame, std::span<math::SRT3> out) const {
+  assert(out.size() >= numBones());
+  mCurves.sample(WrapFrame(frame, mFrameDuration, mWrapMode),
+                 {&out.data()->scale.x, numBones() * 9});
+}
+
+void ChrSampler::sampleSrtRange(std::span<const f32> frames,
+                                std::span<math::SRT3> out) const {
+  assert(out.size() >= frames.size() * numBones());
+  std::vector<f32> wrapped(frames.size());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    wrapped[i] = WrapFrame(frames[i], mFrameDuration, mWrapMode);
+  }
+  mCurves.sampleRange(wrapped,
+                      {&out.data()->scale.x, frames.size() * numBones() * 9});
+}
+
+void ChrSampler::computeMatrices(std::span<const math::SRT3> srts,
+                                 ScalingRule scalingRule,
+                                 std::span<glm::mat4> out) const {
+  assert(srts.size() >= numBones() && out.size() >= numBones());
+  // Each bone's envelope, before its own scale is applied
+  std::vector<glm::mat4> envelopes(numBones());
+  std::vector<glm::vec3> scales(numBones());
+  for (u32 b : mOrder) {
+    const s32 parent = mParents[b];
+    const glm::mat4 parent_mtx =
+        parent < 0 ? glm::mat4(1.0f) : envelopes[parent];
+    const glm::vec3 parent_scl = parent < 0 ? glm::vec3(1.0f) : scales[parent];
+    CalcEnvelopeContribution(/*out*/ envelopes[b], /*out*/ scales[b], srts[b],
+                             mSsc[b], parent_mtx, parent_scl, scalingRule);
+    glm::mat4x3 tmp;
+    Mtx_scale(tmp, envelopes[b], scales[b]);
+    out[b] = tmp;
+  }
+}
+
+//
+// SRT0
+//
+
+Result<SrtSampler> SrtSampler::compile(const SrtAnim& srt) {
+  SrtSampler result;
+  result.mFrameDuration = srt.frameDuration;
+  result.mWrapMode = srt.wrapMode;
+  static constexpr std::array<f32, 5> Defaults{1.0f, 1.0f, 0.0f, 0.0f, 0.0f};
+  for (auto& m : srt.matrices) {
+    result.mTargets.push_back(m.target);
+    for (size_t i = 0; i < 5; ++i) {
+      const auto& track = m.matrix.subtrack(i);
+      if (track.empty()) {
+        result.mCurves.addConstant(Defaults[i]);
+      } else {
+        result.mCurves.addHermite(track);
+      }
+    }
+  }
+  return result;
+}
+
+void SrtSampler::sample(f32 frame, std::span<TexSrtSample> out) const {
+  assert(out.size() >= mTargets.size());
+  mCurves.sample(WrapFrame(frame, mFrameDuration, mWrapMode),
+                 {&out.data()->scale.x, mTargets.size() * 5});
+}
+
+void SrtSampler::sampleRange(std::span<const f32> frames,
+                             std::span<TexSrtSample> out) const {
+  assert(out.size() >= frames.size() * mTargets.size());
+  std::vector<f32> wrapped(frames.size());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    wrapped[i] = WrapFrame(frames[i], mFrameDuration, mWrapMode);
+  }
+  mCurves.sampleRange(
+      wrapped, {&out.data()->scale.x, frames.size() * mTargets.size() * 5});
+}
+
+//
+// CLR0
+//
+
+Result<ClrSampler> ClrSampler::compile(const BinaryClr& clr) {
+  ClrSampler result;
+  result.mFrameDuration = clr.frameDuration;
+  result.mWrapMode = clr.wrapMode;
+  // Track -> first color
+  std::map<u32, u32> shared;
+  for (u32 m = 0; m < clr.materials.size(); ++m) {
+    const auto& mat = clr.materials[m];
+    size_t k = 0;
+    for (u32 i = 0; i < static_cast<u32>(CLR0Material::TargetId::Count); ++i) {
+      if (!(mat.flags & (CLR0Material::FLAG_ENABLED << (i * 2)))) {
+        continue;
+      }
+      EXPECT(k < mat.targets.size(),
+             std::format("CLR0 material {} is missing targets", mat.name));
+      const auto& target = mat.targets[k++];
+      result.mTargets.push_back({
+          .material = m,
+          .id = static_cast<CLR0Material::TargetId>(i),
+          .notAnimatedMask = target.notAnimatedMask,
+      });
+      if (auto* c = std::get_if<CLR0KeyFrame>(&target.data)) {
+        result.mFirst.push_back(static_cast<u32>(result.mColors.size()));
+        result.mCount.push_back(1);
+        result.mColors.push_back(c->data);
+        continue;
+      }
+      const u32 index = std::get<u32>(target.data);
+      EXPECT(index < clr.tracks.size());
+      const auto& keys = clr.tracks[index].keyframes;
+      EXPECT(!keys.empty(), "CLR0 track has no keyframes");
+      auto [it, added] =
+          shared.emplace(index, static_cast<u32>(result.mColors.size()));
+      if (added) {
+        for (auto& key : keys) {
+          result.mColors.push_back(key.data);
+        }
+      }
+      result.mFirst.push_back(it->second);
+      result.mCount.push_back(static_cast<u32>(keys.size()));
+    }
+  }
+  return result;
+}
+
+void ClrSampler::sample(f32 frame, std::span<u32> out) const {
+  assert(out.size() >= mTargets.size());
+  frame = WrapFrame(frame, mFrameDuration, mWrapMode);
+  const u32 index = static_cast<u32>(frame);
+  for (size_t i = 0; i < mTargets.size(); ++i) {
+    out[i] = mColors[mFirst[i] + std::min(index, mCount[i] - 1)];
+  }
+}
+
+//
+// PAT0
+//
+
+Result<PatSampler> PatSampler::compile(const BinaryTexPat& pat) {
+  PatSampler result;
+  result.mFrameDuration = pat.frameDuration;
+  result.mWrapMode = pat.wrapMode;
+  for (u32 m = 0; m < pat.materials.size(); ++m) {
+    const auto& mat = pat.materials[m];
+    size_t k = 0;
+    for (u32 i = 0; i < 8 && k < mat.samplers.size(); ++i) {
+      if (!(mat.flags & (PAT0Material::FLAG_ENABLED << (i * 4)))) {
+        continue;
+      }
+      const auto& sampler = mat.samplers[k++];
+      result.mTargets.push_back({.material = m, .sampler = i});
+      result.mFirst.push_back(static_cast<u32>(result.mKeys.size()));
+      if (auto* c = std::get_if<PAT0KeyFrame>(&sampler)) {
+        result.mKeyFrames.push_back(0.0f);
+        result.mKeys.push_back(*c);
+        result.mCount.push_back(1);
+        continue;
+      }
+      const u32 index = std::get<u32>(sampler);
+      EXPECT(index < pat.tracks.size());
+      const auto& keys = pat.tracks[index].keyframes;
+      EXPECT(!keys.empty(), "PAT0 track has no keyframes");
+      // Already sorted by frame
+      for (auto& [frame, key] : keys) {
+        result.mKeyFrames.push_back(frame);
+        result.mKeys.push_back(key);
+      }
+      result.mCount.push_back(static_cast<u32>(keys.size()));
+    }
+  }
+  return result;
+}
+
+void PatSampler::sample(f32 frame, std::span<PAT0KeyFrame> out) const {
+  assert(out.size() >= mTargets.size());
+  frame = WrapFrame(frame, mFrameDuration, mWrapMode);
+  for (size_t i = 0; i < mTargets.size(); ++i) {
+    const auto begin = mKeyFrames.begin() + mFirst[i];
+    const auto it = std::upper_bound(begin, begin + mCount[i], frame);
+    // Before the first key, the first key holds
+    const size_t key = it == begin ? mFirst[i] : it - mKeyFrames.begin() - 1;
+    out[i] = mKeys[key];
+  }
+}
+
+//
+// VIS0
+//
+
+Result<VisSampler> VisSampler::compile(const BinaryVis& vis) {
+  VisSampler result;
+  result.mFrameDuration = vis.frameDuration;
+  result.mWrapMode = vis.wrapMode;
+  for (auto& bone : vis.bones) {
+    result.mBones.push_back(bone.name);
+    result.mFirst.push_back(static_cast<u32>(result.mWords.size()));
+    if (!bone.target.has_value() || bone.target->keyframes.empty()) {
+      const bool visible = bone.flags & VIS0Bone::FLAG_CONSTANT_IS_VISIBLE;
+      result.mWords.push_back(visible ? ~0u : 0u);
+      result.mCount.push_back(1);
+      continue;
+    }
+    for (auto& word : bone.target->keyframes) {
+      result.mWords.push_back(word.data);
+    }
+    result.mCount.push_back(static_cast<u32>(bone.target->keyframes.size()));
+  }
+  return result;
+}
+
+void VisSampler::sample(f32 frame, std::span<u8> out) const {
+  assert(out.size() >= mBones.size());
+  frame = WrapFrame(frame, mFrameDuration, mWrapMode);
+  const u32 index = static_cast<u32>(frame);
+  for (size_t i = 0; i < mBones.size(); ++i) {
+    const u32 bit = std::min(index, mCount[i] * 32 - 1);
+    out[i] = (mWords[mFirst[i] + bit / 32] >> (31 - bit % 32)) & 1;
+  }
+}
+
+} // namespace librii::g3d
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <core/common.h>
+#include <glm/mat4x4.hpp>
+#include <librii/g3d/data/AnimData.hpp>
+#include <librii/g3d/data/BoneData.hpp>
+#include <librii/g3d/data/ModelData.hpp> // ScalingRule
+#include <librii/g3d/io/AnimChrIO.hpp>
+#include <librii/g3d/io/AnimClrIO.hpp>
+#include <librii/g3d/io/AnimTexPatIO.hpp>
+#include <librii/g3d/io/AnimVisIO.hpp>
+#include <librii/math/srt3.hpp>
+#include <span>
+#include <vector>
+
+namespace librii::g3d {
+
+//! Map a frame past the end of an animation back into [0, frameDuration]
+f32 WrapFrame(f32 frame, u16 frameDuration, AnimationWrapMode wrapMode);
+
+//! Many animated values ("channels"), each a piecewise cubic in the frame.
+//!
+//! Every track encoding compiles to the same form, so sampling is one loop
+//! over all channels: find each channel's segment, then evaluate four
+//! channels at a time. Segment start frames (searched) are stored apart from
+//! the segment coefficients (evaluated).
+//!
+//! Before its first key a channel holds the first value; after its last, the
+//! last value.
+class CurveSet {
+public:
+  //! Each add* function returns the new channel's index.
+  u32 addConstant(f32 value);
+  //! Hermite keys, sorted by frame. Keys sharing a frame make a step.
+  u32 addHermite(std::span<const SRT0KeyFrame> keys);
+  //! One value per frame from frame 0, linearly interpolated between
+  u32 addBaked(std::span<const f32> values);
+  //! A second channel sharing |channel|'s curve
+  u32 addAlias(u32 channel);
+
+  u32 size() const { return static_cast<u32>(mChannels.size()); }
+
+  //! out[i]: channel i at |frame|
+  void sample(f32 frame, std::span<f32> out) const;
+  //! out[i * size() + c]: channel c at frames[i]. Fastest when |frames| is
+  //! sorted, as each channel then resumes its search where it left off.
+  void sampleRange(std::span<const f32> frames, std::span<f32> out) const;
+
+private:
+  struct Channel {
+    u32 first; // Segment
+    u32 end;
+  };
+  // In t = frame - start: c[0] + c[1] t + c[2] t^2 + c[3] t^3
+  using Coeffs = std::array<f32, 4>;
+
+  u32 addChannel(u32 first);
+  void addSegment(f32 start, const Coeffs& c);
+  u32 findSegment(u32 channel, f32 frame) const;
+  void evaluate(f32 frame, const u32* segs, f32* out, u32 count) const;
+
+  std::vector<Channel> mChannels;
+  // Per segment
+  std::vector<f32> mStarts;
+  std::vector<Coeffs> mCoeffs;
+};
+
+//! A CHR0 bound to a model's bones.
+class ChrSampler {
+public:
+  //! Bones the animation does not name keep their pose from |bones|. With no
+  //! bones, there is one unparented bone per animated node.
+  static Result<ChrSampler> compile(const BinaryChr& chr,
+                                    std::span<const BoneData> bones);
+
+  u32 numBones() const { return static_cast<u32>(mParents.size()); }
+  u16 frameDuration() const { return mFrameDuration; }
+  AnimationWrapMode wrapMode() const { return mWrapMode; }
+
+  //! One SRT per bone. Rotations are in degrees.
+  void sampleSrt(f32 frame, std::span<math::SRT3> out) const;
+  //! out[i * numBones() + b]: bone b at frames[i] (wrapped)
+  void sampleSrtRange(std::span<const f32> frames,
+                      std::span<math::SRT3> out) const;
+
+  //! Model-space matrix of each bone, from one frame of sampleSrt(), composed
+  //! down the hierarchy with CalcEnvelopeContribution.
+  void computeMatrices(std::span<const math::SRT3> srts,
+                       ScalingRule scalingRule,
+                       std::span<glm::mat4> out) const;
+
+private:
+  // 9 channels per bone, in the order of math::SRT3
+  CurveSet mCurves;
+  std::vector<s32> mParents;
+  std::vector<u8> mSsc;
+  // Parents before children
+  std::vector<u32> mOrder;
+  u16 mFrameDuration = 0;
+  AnimationWrapMode mWrapMode = AnimationWrapMode::Repeat;
+};
+
+//! Texture matrix transform, as animated by a SRT0
+struct TexSrtSample {
+  glm::vec2 scale;
+  f32 rotate; // Degrees
+  glm::vec2 translate;
+};
+
+class SrtSampler {
+public:
+  static Result<SrtSampler> compile(const SrtAnim& srt);
+
+  //! What each sample is for
+  std::span<const SrtAnim::Target> targets() const { return mTargets; }
+
+  //! One transform per target
+  void sample(f32 frame, std::span<TexSrtSample> out) const;
+  //! out[i * targets().size() + t]: target t at frames[i] (wrapped)
+  void sampleRange(std::span<const f32> frames,
+                   std::span<TexSrtSample> out) const;
+
+private:
+  // 5 channels per target, in the order of TexSrtSample
+  CurveSet mCurves;
+  std::vector<SrtAnim::Target> mTargets;
+  u16 mFrameDuration = 0;
+  AnimationWrapMode mWrapMode = AnimationWrapMode::Repeat;
+};
+
+class ClrSampler {
+public:
+  struct Target {
+    u32 material; // Index in BinaryClr::materials
+    CLR0Material::TargetId id;
+    //! Bits of the material's own color to keep:
+    //! final = (base & notAnimatedMask) | (sample & ~notAnimatedMask)
+    u32 notAnimatedMask;
+  };
+
+  static Result<ClrSampler> compile(const BinaryClr& clr);
+
+  std::span<const Target> targets() const { return mTargets; }
+
+  //! One RGBA color per target. Colors are stored per frame and are not
+  //! blended: a fractional frame takes the color of the frame before it.
+  void sample(f32 frame, std::span<u32> out) const;
+
+private:
+  std::vector<Target> mTargets;
+  // Per target: range of mColors
+  std::vector<u32> mFirst;
+  std::vector<u32> mCount;
+  std::vector<u32> mColors;
+  u16 mFrameDuration = 0;
+  AnimationWrapMode mWrapMode = AnimationWrapMode::Repeat;
+};
+
+class PatSampler {
+public:
+  struct Target {
+    u32 material; // Index in BinaryTexPat::materials
+    u32 sampler;
+  };
+
+  static Result<PatSampler> compile(const BinaryTexPat& pat);
+
+  std::span<const Target> targets() const { return mTargets; }
+
+  //! Texture and palette of each target: those of the last key at or before
+  //! |frame|
+  void sample(f32 frame, std::span<PAT0KeyFrame> out) const;
+
+private:
+  std::vector<Target> mTargets;
+  // Per target: range of the keys
+  std::vector<u32> mFirst;
+  std::vector<u32> mCount;
+  std::vector<f32> mKeyFrames;
+  std::vector<PAT0KeyFrame> mKeys;
+  u16 mFrameDuration = 0;
+  AnimationWrapMode mWrapMode = AnimationWrapMode::Repeat;
+};
+
+class VisSampler {
+public:
+  static Result<VisSampler> compile(const BinaryVis& vis);
+
+  //! Bone names, in BinaryVis::bones order
+  std::span<const std::string> bones() const { return mBones; }
+
+  //! 1 if the bone is visible at |frame|, else 0
+  void sample(f32 frame, std::span<u8> out) const;
+
+private:
+  std::vector<std::string> mBones;
+  // Per bone: bit i of word (first + i / 32), most significant bit first
+  std::vector<u32> mFirst;
+  std::vector<u32> mCount;
+  std::vector<u32> mWords;
+  u16 mFrameDuration = 0;
+  AnimationWrapMode mWrapMode = AnimationWrapMode::Repeat;
+};
+
+} // namespace librii::g3d
@@ -36,7 +36,8 @@ struct Archive {
                                     kpi::LightIOTransaction& transaction);
   static Result<Archive> fromMemory(std::span<const u8> buf, std::string path);
   static Result<Archive> read(oishii::BinaryReader& reader,
-                              kpi::LightIOTransaction& transaction);
+                              kpi::LightIOTransaction& transaction,
+                              unsigned num_threads = 1);
   static Result<Archive> from(const BinaryArchive& model,
                               kpi::LightIOTransaction& transaction);
   Result<void> write(oishii::Writer& writer) const;
@@ -2,6 +2,7 @@
 
 #include <core/common.h>
 #include <librii/gx.h>
+#include <rsl/Interner.hpp>
 
 namespace librii::g3d {
 
@@ -67,3 +68,13 @@ struct G3dMaterialData : public librii::gx::GCMaterialData {
 };
 
 } // namespace librii::g3d
+
+template <> struct std::hash<librii::g3d::G3dShader> {
+  std::size_t operator()(const librii::g3d::G3dShader& shader) const {
+    std::size_t seed = 0;
+    rsl::HashContent(seed, shader.mSwapTable);
+    rsl::HashContent(seed, shader.mIndirectOrders);
+    rsl::HashContent(seed, shader.mStages);
+    return seed;
+  }
+};
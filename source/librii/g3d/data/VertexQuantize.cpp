@@ -0,0 +1,153 @@
+#include "VertexQuantize.hpp"
+
+#include <rsl/Simd.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+IMPORT_STD;
+
+namespace librii::g3d {
+
+using Generic = librii::gx::VertexBufferType::Generic;
+
+// Fractional bits, as the writer's (1 << divisor) allows
+static constexpr u32 MaxDivisor = 15;
+
+static u32 ComponentSize(Generic type) {
+  switch (type) {
+  case Generic::u8:
+  case Generic::s8:
+    return 1;
+  case Generic::u16:
+  case Generic::s16:
+    return 2;
+  case Generic::f32:
+  default:
+    return 4;
+  }
+}
+
+struct Range {
+  f32 lo;
+  f32 hi;
+};
+static Range ComponentRange(Generic type) {
+  switch (type) {
+  case Generic::u8:
+    return {0.0f, 255.0f};
+  case Generic::s8:
+    return {-128.0f, 127.0f};
+  case Generic::u16:
+    return {0.0f, 65535.0f};
+  case Generic::s16:
+  default:
+    return {-32768.0f, 32767.0f};
+  }
+}
+
+// Writes to |out| if not null. |in| and |out| may alias.
+static f32 Requantize(const f32* in, f32* out, size_t count, Generic type,
+                      u32 divisor) {
+  const auto [lo, hi] = ComponentRange(type);
+  const f32 scale = static_cast<f32>(1 << divisor);
+  const f32 inv_scale = 1.0f / scale;
+  f32 max_error = 0.0f;
+  size_t i = 0;
+#if RSL_HAS_SSE2
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 vinv = _mm_set1_ps(inv_scale);
+  const __m128 vlo = _mm_set1_ps(lo);
+  const __m128 vhi = _mm_set1_ps(hi);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 verr = _mm_setzero_ps();
+  for (; i + 4 <= count; i += 4) {
+    const __m128 v = _mm_loadu_ps(in + i);
+    // Round to nearest, as std::nearbyint below
+    __m128 q = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(v, vscale)));
+    q = _mm_mul_ps(_mm_min_ps(_mm_max_ps(q, vlo), vhi), vinv);
+    verr = _mm_max_ps(verr, _mm_andnot_ps(sign, _mm_sub_ps(q, v)));
+    if (out != nullptr) {
+      _mm_storeu_ps(out + i, q);
+    }
+  }
+  alignas(16) f32 lanes[4];
+  _mm_store_ps(lanes, verr);
+  max_error = std::max({lanes[0], lanes[1], lanes[2], lanes[3]});
+#endif
+  for (; i < count; ++i) {
+    const f32 q =
+        std::clamp(std::nearbyint(in[i] * scale), lo, hi) * inv_scale;
+    max_error = std::max(max_error, std::abs(q - in[i]));
+    if (out != nullptr) {
+      out[i] = q;
+    }
+  }
+  return max_error;
+}
+
+f32 RequantizeComponents(std::span<f32> values, Generic type, u32 divisor) {
+  return Requantize(values.data(), values.data(), values.size(), type,
+                    divisor);
+}
+f32 MeasureQuantizeError(std::span<const f32> values, Generic type,
+                         u32 divisor) {
+  return Requantize(values.data(), nullptr, values.size(), type, divisor);
+}
+
+std::optional<Quantization>
+ChooseQuantization(librii::gx::VertexBufferKind kind,
+                   const Quantization& current, std::span<const f32> values,
+                   f32 min, f32 max, f32 tolerance) {
+  const auto num_components =
+      librii::gx::computeComponentCount(kind, current.mComp);
+  if (!num_components || !std::isfinite(min) || !std::isfinite(max)) {
+    return std::nullopt;
+  }
+
+  struct Candidate {
+    Generic type;
+    std::optional<u32> divisor; // Otherwise, the finest that fits
+  };
+  std::array<Candidate, 2> candidates;
+  if (kind == librii::gx::VertexBufferKind::normal) {
+    candidates = {{{Generic::s8, 6}, {Generic::s16, 14}}};
+  } else if (min >= 0.0f) {
+    candidates = {{{Generic::u8, {}}, {Generic::u16, {}}}};
+  } else {
+    candidates = {{{Generic::s8, {}}, {Generic::s16, {}}}};
+  }
+
+  for (auto& [type, divisor] : candidates) {
+    const u32 stride = ComponentSize(type) * *num_components;
+    if (stride >= current.stride) {
+      continue;
+    }
+    const auto [lo, hi] = ComponentRange(type);
+    auto fits = [&](u32 d) {
+      const f32 scale = static_cast<f32>(1 << d);
+      return min * scale >= lo && max * scale <= hi;
+    };
+    if (!divisor.has_value()) {
+      for (u32 d = MaxDivisor + 1; d-- > 0;) {
+        if (fits(d)) {
+          divisor = d;
+          break;
+        }
+      }
+    }
+    if (!divisor.has_value() || !fits(*divisor) ||
+        MeasureQuantizeError(values, type, *divisor) > tolerance) {
+      continue;
+    }
+    return Quantization{
+        .mComp = current.mComp,
+        .mType = librii::gx::VertexBufferType(type),
+        .divisor = static_cast<u8>(*divisor),
+        .stride = static_cast<u8>(stride),
+    };
+  }
+  return std::nullopt;
+}
+
+} // namespace librii::g3d
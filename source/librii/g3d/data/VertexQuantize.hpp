@@ -0,0 +1,72 @@
+#pragma once
+
+#include <librii/g3d/data/VertexData.hpp>
+#include <optional>
+#include <span>
+
+namespace librii::g3d {
+
+//! Round every value to the nearest multiple of 2^-divisor that |type| can
+//! hold, as the buffer writer would. Returns the largest change made.
+f32 RequantizeComponents(std::span<f32> values,
+                         librii::gx::VertexBufferType::Generic type,
+                         u32 divisor);
+//! The largest change RequantizeComponents would make, without making it
+f32 MeasureQuantizeError(std::span<const f32> values,
+                         librii::gx::VertexBufferType::Generic type,
+                         u32 divisor);
+
+//! Smallest encoding of |values|, all within [min, max], whose largest
+//! rounding error is at most |tolerance|. Normals keep the fixed divisors of
+//! their formats. Empty if nothing beats |current|.
+std::optional<Quantization>
+ChooseQuantization(librii::gx::VertexBufferKind kind,
+                   const Quantization& current, std::span<const f32> values,
+                   f32 min, f32 max, f32 tolerance);
+
+struct QuantizeResult {
+  u32 bytes_before = 0;
+  u32 bytes_after = 0;
+  f32 max_error = 0.0f;
+};
+
+//! Re-encode |buf| in the smallest format within |tolerance|, snapping its
+//! entries to the values that will be written.
+template <typename T, bool HasMinimum, bool HasDivisor,
+          librii::gx::VertexBufferKind kind>
+QuantizeResult
+OptimizeQuantization(GenericBuffer<T, HasMinimum, HasDivisor, kind>& buf,
+                     f32 tolerance) {
+  static_assert(HasDivisor, "Only fixed-point buffers can be requantized");
+  static_assert(sizeof(T) == T::length() * sizeof(f32));
+  const u32 count = static_cast<u32>(buf.mEntries.size());
+  QuantizeResult result{
+      .bytes_before = count * buf.mQuantize.stride,
+      .bytes_after = count * buf.mQuantize.stride,
+  };
+  if (count == 0) {
+    return result;
+  }
+  const auto mm = ComputeMinMax(buf);
+  f32 min = mm.min[0];
+  f32 max = mm.max[0];
+  for (int c = 1; c < T::length(); ++c) {
+    min = std::min(min, mm.min[c]);
+    max = std::max(max, mm.max[c]);
+  }
+  std::span<f32> values{reinterpret_cast<f32*>(buf.mEntries.data()),
+                        count * T::length()};
+  const auto quant =
+      ChooseQuantization(kind, buf.mQuantize, values, min, max, tolerance);
+  if (!quant.has_value()) {
+    return result;
+  }
+  result.max_error =
+      RequantizeComponents(values, quant->mType.generic, quant->divisor);
+  result.bytes_after = count * quant->stride;
+  buf.mQuantize = *quant;
+  buf.mCachedMinMax.reset();
+  return result;
+}
+
+} // namespace librii::g3d
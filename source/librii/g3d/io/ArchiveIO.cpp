@@ -5,6 +5,7 @@
 #include <librii/g3d/io/AnimIO.hpp>
 #include <librii/g3d/io/DictWriteIO.hpp>
 #include <librii/g3d/io/TextureIO.hpp>
+#include <rsl/ThreadPool.hpp>
 
 namespace librii::g3d {
 
@@ -48,8 +49,60 @@ struct BRRESHeader2 {
   }
 };
 
+namespace {
+
+// A subfile located through the root dictionary, and how to decode it
+struct Subfile {
+  u32 stream_pos = 0; // 0: Nothing to seek to
+  std::function<Result<void>(oishii::BinaryReader&, kpi::LightIOTransaction&)>
+      decode;
+};
+
+struct LoggedMessage {
+  kpi::IOMessageClass message_class;
+  std::string domain;
+  std::string message_body;
+};
+
+// Reserves a slot in |out| for every entry of |cdic|, in dictionary order
+template <typename T>
+Result<void> AddSubfiles(std::vector<Subfile>& subfiles, std::vector<T>& out,
+                         const BetterDictionary& cdic, auto&& decode) {
+  const size_t base = out.size();
+  out.resize(base + cdic.nodes.size());
+  for (size_t i = 0; i < cdic.nodes.size(); ++i) {
+    auto& sub = cdic.nodes[i];
+    EXPECT(sub.stream_pos);
+    subfiles.push_back(Subfile{
+        .stream_pos = sub.stream_pos,
+        .decode = [&out, i = base + i, name = sub.name,
+                   decode](oishii::BinaryReader& reader,
+                           kpi::LightIOTransaction& transaction) {
+          return decode(out[i], name, reader, transaction);
+        },
+    });
+  }
+  return {};
+}
+
+auto DecodeAnim(const char* kind) {
+  return [kind](auto& anim, const std::string& name,
+                oishii::BinaryReader& reader,
+                kpi::LightIOTransaction&) -> Result<void> {
+    auto ok = anim.read(reader);
+    if (!ok) {
+      return std::unexpected(
+          std::format("Failed to read {} {}: {}", kind, name, ok.error()));
+    }
+    return {};
+  };
+}
+
+} // namespace
+
 Result<void> BinaryArchive::read(oishii::BinaryReader& reader,
-                                 kpi::LightIOTransaction& transaction) {
+                                 kpi::LightIOTransaction& transaction,
+                                 unsigned num_threads) {
   rsl::SafeReader safe(reader);
   TRY(BRRESHeader2::read(safe)); // TODO: Validate fields
 
@@ -59,6 +112,9 @@ Result<void> BinaryArchive::read(oishii::BinaryReader& reader,
   TRY(safe.U32());
   auto rootDict = TRY(ReadDictionary(safe));
 
+  // Locate every subfile before decoding any of them. Once their offsets are
+  // known they are independent.
+  std::vector<Subfile> subfiles;
   for (auto& node : rootDict.nodes) {
     EXPECT(node.stream_pos);
     reader.seekSet(node.stream_pos);
@@ -66,100 +122,109 @@ Result<void> BinaryArchive::read(oishii::BinaryReader& reader,
 
     // TODO
     if (node.name == "3DModels(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
-        auto& mdl = models.emplace_back();
-        bool isValid = true;
-        auto ok = mdl.read(reader, transaction,
-                           "/" + node.name + "/" + sub.name + "/", isValid);
-        if (!ok) {
-          return std::unexpected(
-              std::format("Failed to read MDL0 {}: {}", sub.name, ok.error()));
-        }
-        (void)isValid;
-      }
+      TRY(AddSubfiles(
+          subfiles, models, cdic,
+          [path = "/" + node.name + "/"](
+              BinaryModel& mdl, const std::string& name,
+              oishii::BinaryReader& reader,
+              kpi::LightIOTransaction& transaction) -> Result<void> {
+            bool isValid = true;
+            auto ok = mdl.read(reader, transaction, path + name + "/", isValid);
+            if (!ok) {
+              return std::unexpected(std::format("Failed to read MDL0 {}: {}",
+                                                 name, ok.error()));
+            }
+            (void)isValid;
+            return {};
+          }));
     } else if (node.name == "Textures(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
-        auto& tex = textures.emplace_back();
-        const bool ok =
-            librii::g3d::ReadTexture(tex, SliceStream(reader), sub.name);
-
-        if (!ok) {
-          transaction.callback(kpi::IOMessageClass::Warning, "/" + node.name,
-                               "Failed to read texture: " + sub.name);
-        }
-      }
+      TRY(AddSubfiles(
+          subfiles, textures, cdic,
+          [path = "/" + node.name](
+              TextureData& tex, const std::string& name,
+              oishii::BinaryReader& reader,
+              kpi::LightIOTransaction& transaction) -> Result<void> {
+            const bool ok =
+                librii::g3d::ReadTexture(tex, SliceStream(reader), name);
+
+            if (!ok) {
+              transaction.callback(kpi::IOMessageClass::Warning, path,
+                                   "Failed to read texture: " + name);
+            }
+            return {};
+          }));
     } else if (node.name == "AnmChr(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
-
-        auto& chr = chrs.emplace_back();
-        auto ok = chr.read(reader);
-        if (!ok) {
-          return std::unexpected(
-              std::format("Failed to read CHR0 {}: {}", sub.name, ok.error()));
-        }
-      }
+      TRY(AddSubfiles(subfiles, chrs, cdic, DecodeAnim("CHR0")));
     } else if (node.name == "AnmClr(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
-
-        auto& clr = clrs.emplace_back();
-        auto ok = clr.read(reader);
-        if (!ok) {
-          return std::unexpected(
-              std::format("Failed to read CLR0 {}: {}", sub.name, ok.error()));
-        }
-      }
+      TRY(AddSubfiles(subfiles, clrs, cdic, DecodeAnim("CLR0")));
     } else if (node.name == "AnmTexPat(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
-
-        auto& pat = pats.emplace_back();
-        auto ok = pat.read(reader);
-        if (!ok) {
-          return std::unexpected(
-              std::format("Failed to read PAT0 {}: {}", sub.name, ok.error()));
-        }
-      }
+      TRY(AddSubfiles(subfiles, pats, cdic, DecodeAnim("PAT0")));
     } else if (node.name == "AnmTexSrt(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
-
-        auto& srt = srts.emplace_back();
-        auto ok = srt.read(reader);
-        if (!ok) {
-          return std::unexpected(
-              std::format("Failed to read SRT0 {}: {}", sub.name, ok.error()));
-        }
-      }
+      TRY(AddSubfiles(subfiles, srts, cdic, DecodeAnim("SRT0")));
     } else if (node.name == "AnmVis(NW4R)") {
-      for (auto& sub : cdic.nodes) {
-        EXPECT(sub.stream_pos);
-        reader.seekSet(sub.stream_pos);
+      TRY(AddSubfiles(subfiles, viss, cdic, DecodeAnim("VIS0")));
+    } else {
+      // Queued so that it is reported in order with the subfiles
+      subfiles.push_back(Subfile{
+          .decode = [name = node.name](oishii::BinaryReader&,
+                                       kpi::LightIOTransaction& transaction)
+              -> Result<void> {
+            transaction.callback(kpi::IOMessageClass::Warning, "/" + name,
+                                 "[WILL NOT BE SAVED] Unsupported folder: " +
+                                     name);
+
+            rsl::error("Unsupported folder: {}", name.c_str());
+            return {};
+          },
+      });
+    }
+  }
 
-        auto& vis = viss.emplace_back();
-        auto ok = vis.read(reader);
-        if (!ok) {
-          return std::unexpected(
-              std::format("Failed to read VIS0 {}: {}", sub.name, ok.error()));
-        }
+  if (num_threads == 1 || subfiles.size() <= 1) {
+    for (auto& sub : subfiles) {
+      if (sub.stream_pos) {
+        reader.seekSet(sub.stream_pos);
       }
-    } else {
-      transaction.callback(kpi::IOMessageClass::Warning, "/" + node.name,
-                           "[WILL NOT BE SAVED] Unsupported folder: " +
-                               node.name);
+      TRY(sub.decode(reader, transaction));
+    }
+    return {};
+  }
 
-      rsl::error("Unsupported folder: {}", node.name.c_str());
+  // Each subfile is decoded with its own reader over the same memory. Messages
+  // are held back and replayed in dictionary order, as is the first error.
+  struct Outcome {
+    Result<void> result;
+    std::vector<LoggedMessage> messages;
+  };
+  std::vector<Outcome> outcomes(subfiles.size());
+  {
+    rsl::ThreadPool pool(num_threads);
+    for (size_t i = 0; i < subfiles.size(); ++i) {
+      pool.submit([&, i] {
+        oishii::BinaryReader view(reader.slice(), reader.getFile(),
+                                  reader.endian());
+        view.seekSet(subfiles[i].stream_pos);
+        kpi::LightIOTransaction log;
+        log.callback = [&messages = outcomes[i].messages](
+                           kpi::IOMessageClass message_class,
+                           const std::string_view domain,
+                           const std::string_view message_body) {
+          messages.push_back(LoggedMessage{
+              .message_class = message_class,
+              .domain = std::string(domain),
+              .message_body = std::string(message_body),
+          });
+        };
+        outcomes[i].result = subfiles[i].decode(view, log);
+      });
     }
   }
+  for (auto& outcome : outcomes) {
+    for (auto& msg : outcome.messages) {
+      transaction.callback(msg.message_class, msg.domain, msg.message_body);
+    }
+    TRY(outcome.result);
+  }
 
   return {};
 }
@@ -544,9 +609,10 @@ Result<Archive> Archive::fromFile(std::string path) {
   return fromFile(path, trans);
 }
 Result<Archive> Archive::read(oishii::BinaryReader& reader,
-                              kpi::LightIOTransaction& transaction) {
+                              kpi::LightIOTransaction& transaction,
+                              unsigned num_threads) {
   BinaryArchive bin;
-  TRY(bin.read(reader, transaction));
+  TRY(bin.read(reader, transaction, num_threads));
   return from(bin, transaction);
 }
 Result<Archive> Archive::fromMemory(std::span<const u8> buf, std::string path,
@@ -23,8 +23,11 @@ struct BinaryArchive {
   std::vector<librii::g3d::BinarySrt> srts;
   std::vector<librii::g3d::BinaryVis> viss;
 
+  // |num_threads| != 1: Decode the subfiles in parallel, 0 meaning one thread
+  // per core. Either way they come out in dictionary order.
   Result<void> read(oishii::BinaryReader& reader,
-                    kpi::LightIOTransaction& transaction);
+                    kpi::LightIOTransaction& transaction,
+                    unsigned num_threads = 1);
   Result<void> write(oishii::Writer& writer);
 };
 
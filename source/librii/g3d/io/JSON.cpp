@@ -22,6 +22,7 @@
 #pragma clang diagnostic pop
 #endif
 #include <rsl/EnumCast.hpp>
+#include <rsl/JsonStream.hpp>
 
 #include <vendor/json_struct.h>
 JS_OBJ_EXT(glm::vec2, x, y);
@@ -1122,4 +1123,93 @@ Result<Model> JSONToModel(std::string_view json) {
   return mdl.lift();
 }
 
+template <typename J, typename T>
+static void WriteRecords(rsl::JsonWriter& w, std::string_view key,
+                         const std::vector<T>& records) {
+  const JS::SerializerOptions compact(JS::SerializerOptions::Compact);
+  w.key(key);
+  w.beginArray();
+  for (const auto& record : records) {
+    w.raw(JS::serializeStruct(J::from(record), compact));
+  }
+  w.endArray();
+}
+
+void WriteModelJSON(std::ostream& out, const Model& model) {
+  rsl::JsonWriter w(out);
+  w.beginObject();
+  w.key("name");
+  w.value(model.name);
+  w.key("info");
+  w.raw(JS::serializeStruct(
+      JSONModelInfo::from(model.info),
+      JS::SerializerOptions(JS::SerializerOptions::Compact)));
+  WriteRecords<JSONBoneData>(w, "bones", model.bones);
+  WriteRecords<JSONPositionBuffer>(w, "positions", model.positions);
+  WriteRecords<JSONNormalBuffer>(w, "normals", model.normals);
+  WriteRecords<JSONColorBuffer>(w, "colors", model.colors);
+  WriteRecords<JSONTextureCoordinateBuffer>(w, "texcoords", model.texcoords);
+  WriteRecords<JSONG3dMaterialData>(w, "materials", model.materials);
+  WriteRecords<JSONPolygonData>(w, "meshes", model.meshes);
+  WriteRecords<JSONDrawMatrix>(w, "matrices", model.matrices);
+  w.endObject();
+}
+
+template <typename J> static Result<J> ParseRecord(rsl::JsonPullReader& r) {
+  const auto text = TRY(r.readValue());
+  JS::ParseContext context(text.data(), text.size());
+  J record;
+  auto err = context.parseTo(record);
+  if (err != JS::Error::NoError) {
+    auto n = magic_enum::enum_name(err);
+    return std::unexpected(
+        std::format("ReadModelJSON failed: Parse error {}", n));
+  }
+  return record;
+}
+
+// Each record is converted as soon as it is parsed
+template <typename J, typename T>
+static Result<void> ReadRecords(rsl::JsonPullReader& r,
+                                std::vector<T>& records) {
+  TRY(r.beginArray());
+  while (TRY(r.nextElement())) {
+    records.push_back(static_cast<T>(TRY(ParseRecord<J>(r))));
+  }
+  return {};
+}
+
+Result<Model> ReadModelJSON(std::istream& in) {
+  rsl::JsonPullReader r(in);
+  Model result;
+  TRY(r.beginObject());
+  while (auto key = TRY(r.nextKey())) {
+    if (*key == "name") {
+      result.name = TRY(r.readString());
+    } else if (*key == "info") {
+      result.info = TRY(TRY(ParseRecord<JSONModelInfo>(r)).to());
+    } else if (*key == "bones") {
+      TRY(ReadRecords<JSONBoneData>(r, result.bones));
+    } else if (*key == "positions") {
+      TRY(ReadRecords<JSONPositionBuffer>(r, result.positions));
+    } else if (*key == "normals") {
+      TRY(ReadRecords<JSONNormalBuffer>(r, result.normals));
+    } else if (*key == "colors") {
+      TRY(ReadRecords<JSONColorBuffer>(r, result.colors));
+    } else if (*key == "texcoords") {
+      TRY(ReadRecords<JSONTextureCoordinateBuffer>(r, result.texcoords));
+    } else if (*key == "materials") {
+      TRY(ReadRecords<JSONG3dMaterialData>(r, result.materials));
+    } else if (*key == "meshes") {
+      TRY(ReadRecords<JSONPolygonData>(r, result.meshes));
+    } else if (*key == "matrices") {
+      TRY(ReadRecords<JSONDrawMatrix>(r, result.matrices));
+    } else {
+      TRY(r.skipValue());
+    }
+  }
+  TRY(r.expectEnd());
+  return result;
+}
+
 } // namespace librii::g3d
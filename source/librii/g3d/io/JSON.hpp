@@ -1,3 +1,4 @@
+#include <iosfwd>
 #include <rsl/Result.hpp>
 #include <string>
 #include <string_view>
@@ -9,4 +10,10 @@ struct Model;
 std::string ModelToJSON(const Model& model);
 Result<Model> JSONToModel(std::string_view json);
 
+//! As ModelToJSON, written to |out| one bone, buffer, material, mesh or
+//! matrix at a time
+void WriteModelJSON(std::ostream& out, const Model& model);
+//! As JSONToModel, parsing one record at a time
+Result<Model> ReadModelJSON(std::istream& in);
+
 } // namespace librii::g3d
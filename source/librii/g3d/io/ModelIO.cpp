@@ -20,6 +20,7 @@
 #include <librii/math/mtx.hpp>
 #include <librii/math/srt3.hpp>
 #include <librii/trig/WiiTrig.hpp>
+#include <rsl/Interner.hpp>
 
 namespace librii::g3d {
 
@@ -146,11 +147,9 @@ Result<void> readGenericBuffer(
       TRY(librii::gx::computeComponentCount(kind, out.mQuantize.mComp));
 
   reader.seekSet(start + startOfs);
-  for (auto& entry : out.mEntries) {
-    entry = TRY(librii::gx::readComponents<T>(reader.getUnsafe(),
-                                              out.mQuantize.mType, nComponents,
-                                              out.mQuantize.divisor));
-  }
+  TRY(librii::gx::readComponentsBulk<T>(reader.getUnsafe(), out.mEntries,
+                                        out.mQuantize.mType, nComponents,
+                                        out.mQuantize.divisor));
 
   if constexpr (HasMinimum) {
     // Unset if not needed
@@ -368,6 +367,19 @@ template <typename T, bool HasMinimum, bool HasDivisor,
       librii::gx::computeComponentCount(kind, buf.mQuantize.mComp);
   EXPECT(nComponents.has_value());
 
+  // Unquantized vectors are stored exactly as they are laid out in memory
+  if constexpr (!std::is_same_v<T, librii::gx::Color>) {
+    static_assert(sizeof(T) == T::length() * sizeof(f32));
+    if (buf.mQuantize.mType.generic ==
+            librii::gx::VertexBufferType::Generic::f32 &&
+        *nComponents == T::length()) {
+      writer.writeSpan<f32>(
+          {reinterpret_cast<const f32*>(buf.mEntries.data()),
+           buf.mEntries.size() * T::length()});
+      writer.alignTo(32);
+      return {};
+    }
+  }
   for (auto& entry : buf.mEntries) {
     librii::gx::writeComponents(writer, entry, buf.mQuantize.mType,
                                 *nComponents, buf.mQuantize.divisor);
@@ -1280,19 +1292,12 @@ BuildRenderLists(const Model& mdl,
 
 struct ShaderAllocator {
   void alloc(const librii::g3d::G3dShader& shader) {
-    auto found = std::find(shaders.begin(), shaders.end(), shader);
-    if (found == shaders.end()) {
-      matToShaderMap.emplace_back(shaders.size());
-      shaders.emplace_back(shader);
-    } else {
-      matToShaderMap.emplace_back(found - shaders.begin());
-    }
+    matToShaderMap.emplace_back(shaders.intern(shader).first);
   }
 
   int find(const librii::g3d::G3dShader& shader) const {
-    if (const auto found = std::find(shaders.begin(), shaders.end(), shader);
-        found != shaders.end()) {
-      return std::distance(shaders.begin(), found);
+    if (auto found = shaders.find(shader)) {
+      return *found;
     }
 
     return -1;
@@ -1306,7 +1311,7 @@ struct ShaderAllocator {
     return "Shader" + std::to_string(found);
   }
 
-  std::vector<librii::g3d::G3dShader> shaders;
+  rsl::Interner<librii::g3d::G3dShader> shaders;
   std::vector<u32> matToShaderMap;
 };
 
@@ -1320,14 +1325,18 @@ Result<librii::g3d::BinaryModel> toBinaryModel(const Model& mdl) {
   std::vector<DrawMatrix> drawMatrices = mdl.matrices;
   std::vector<u32> boneToMatrix;
   rsl::debug("# Bones = {}", mdl.bones.size());
+  // First singly-bound matrix of each bone
+  std::unordered_map<u32, int> singleBound;
+  for (size_t j = 0; j < mdl.matrices.size(); ++j) {
+    auto& mtx = mdl.matrices[j];
+    if (mtx.mWeights.size() == 1) {
+      singleBound.try_emplace(mtx.mWeights[0].boneId, static_cast<int>(j));
+    }
+  }
   for (size_t i = 0; i < mdl.bones.size(); ++i) {
     int it = -1;
-    for (size_t j = 0; j < mdl.matrices.size(); ++j) {
-      auto& mtx = mdl.matrices[j];
-      if (mtx.mWeights.size() == 1 && mtx.mWeights[0].boneId == i) {
-        it = j;
-        break;
-      }
+    if (auto found = singleBound.find(i); found != singleBound.end()) {
+      it = found->second;
     }
     if (it == -1) {
       boneToMatrix.push_back(drawMatrices.size());
@@ -2,6 +2,7 @@
 
 #include "NameTableIO.hpp"
 #include <algorithm>
+#include <rsl/Interner.hpp>
 
 namespace librii::g3d {
 
@@ -50,39 +51,29 @@ void NameTable::poolNames(bool UseNMethod) {
   mPool.clear();
 
   // Pool names without duplicates
-  // TODO: this can be more efficient, no need for duplicate "pool" vector
   int size = 0; // size of all names + terminating zeroes
-  std::vector<std::pair<std::string, bool>> pool; // Name, NonVolatile
+  rsl::Interner<std::string> pool;
 
   std::sort(mEntries.begin(), mEntries.end(),
             [](const auto& s, const auto& s2) { return s.name < s2.name; });
 
   for (auto& it : mEntries) {
-    auto pastIt = std::find_if(pool.begin(), pool.end(),
-                               [it](const std::pair<std::string, bool>& s) {
-                                 return s.first == it.name;
-                               });
-
-    if (pastIt == pool.end()) {
-      mMapping[it.id] = pool.size();
-      pool.push_back({it.name, it.nonvolatile});
+    auto [index, inserted] = pool.intern(it.name);
+    mMapping[it.id] = index;
+    if (inserted) {
       size += it.name.size() + 5;
       if (UseNMethod) {
         while (size % 4)
           ++size;
       }
-    } else { // Duplicate
-      // std::cout << "Duplicate name " << it.name
-      //           << " (past Idx: " << std::to_string(pastIt - pool.begin())
-      //           << ")!\n";
-      mMapping[it.id] = pastIt - pool.begin();
     }
   }
 
   // Construct binary pool
   mPool.reserve(size);
-  int i = 0;
-  for (const auto& [name, nonvolatile] : pool) {
+  std::vector<s32> offsets;
+  offsets.reserve(pool.size());
+  for (const auto& name : pool.values()) {
     if (UseNMethod) {
       u32 sz = name.size();
       mPool.push_back((sz & 0xff000000) >> 24);
@@ -90,12 +81,9 @@ void NameTable::poolNames(bool UseNMethod) {
       mPool.push_back((sz & 0x0000ff00) >> 8);
       mPool.push_back((sz & 0x000000ff) >> 0);
     }
-    // Resolve indices to offsets
-    for (auto& mapIt : mMapping)
-      if (mapIt.second == i)
-        mapIt.second = -mPool.size();
+    offsets.push_back(-static_cast<s32>(mPool.size()));
     // Push the string
-    for (char c : (nonvolatile ? name : name))
+    for (char c : name)
       mPool.push_back(c);
     mPool.push_back(0);
 
@@ -103,9 +91,10 @@ void NameTable::poolNames(bool UseNMethod) {
       while (mPool.size() % 4)
         mPool.push_back(0);
     }
-
-    ++i;
   }
+  // Resolve indices to offsets
+  for (auto& mapIt : mMapping)
+    mapIt.second = offsets[mapIt.second];
 
   if (mPool.size() != size) {
     std::cout << "[Warning] Expected string pool of size "
@@ -1,6 +1,7 @@
 #include "PolygonIO.hpp"
 #include <librii/gpu/DLBuilder.hpp>
 #include <librii/gpu/DLInterpreter.hpp>
+#include <librii/gpu/DLMesh.hpp>
 #include <rsl/ArrayUtil.hpp>
 
 namespace librii::g3d {
@@ -203,41 +204,11 @@ ReadMPrims(rsl::SafeReader& reader, u32 buf_size,
         mPoly.mMatrixPrimitives.back().mCurrentMatrix = mCurrentMatrix;
       }
       auto& prim = mPoly.mMatrixPrimitives.back().mPrimitives.emplace_back(
-          librii::gx::IndexedPrimitive{});
-      prim.mType = type;
-      prim.mVertices.resize(nverts);
-      for (auto& vert : prim.mVertices) {
-        for (u32 i = 0; i < static_cast<u32>(librii::gx::VertexAttribute::Max);
-             ++i) {
-          if (mPoly.mVertexDescriptor.mBitfield & (1 << i)) {
-            const auto attr = static_cast<librii::gx::VertexAttribute>(i);
-            switch (mPoly.mVertexDescriptor.mAttributes[attr]) {
-            case librii::gx::VertexAttributeType::Direct:
-              if (attr ==
-                      librii::gx::VertexAttribute::PositionNormalMatrixIndex ||
-                  ((u32)attr >=
-                       (u32)librii::gx::VertexAttribute::Texture0MatrixIndex &&
-                   (u32)attr <=
-                       (u32)librii::gx::VertexAttribute::Texture7MatrixIndex)) {
-                vert[attr] =
-                    TRY(reader.tryRead<u8, oishii::EndianSelect::Big, true>());
-                break;
-              }
-              return std::unexpected("Mesh unsupported");
-            case librii::gx::VertexAttributeType::None:
-              break;
-            case librii::gx::VertexAttributeType::Byte:
-              vert[attr] =
-                  TRY(reader.tryRead<u8, oishii::EndianSelect::Big, true>());
-              break;
-            case librii::gx::VertexAttributeType::Short:
-              vert[attr] =
-                  TRY(reader.tryRead<u16, oishii::EndianSelect::Big, true>());
-              break;
-            }
-          }
-        }
-      }
+          type, nverts);
+      const auto layout =
+          TRY(librii::gpu::MakeVertexLayout(mPoly.mVertexDescriptor));
+      TRY(librii::gpu::DecodeVertices(reader, layout, stream_end,
+                                      prim.mVertices));
       return {};
     }
     Result<void> onCommandIndexedLoad(u32 cmd, u32 index, u16 address,
@@ -106,7 +106,7 @@ bool WriteTexture(std::span<u8> data, const TextureData& tex, s32 brres_ofs,
                .name = tex.name,
                .non_volatile = true};
 
-  rsl::store<u32>(0, data, 24); // flag, ci
+  rsl::store<u32>(gx::IsPaletteFormat(tex.format) ? 1 : 0, data, 24); // ci
   rsl::store<u16>(tex.width, data, 28);
   rsl::store<u16>(tex.height, data, 30);
   rsl::store<u32>(static_cast<u32>(tex.format), data, 32);
@@ -198,4 +198,41 @@ Result<void> WriteTEX0ToFile(const g3d::TextureData& tex, std::string path) {
   return {};
 }
 
+std::vector<u8> WritePLT0(std::span<const u8> tlut, gx::PaletteFormat format,
+                          std::string_view name) {
+  const u32 num_entries = tlut.size() / 2;
+  std::vector<u8> buffer(64 + roundUp(num_entries * 2, 32));
+
+  rsl::store<u32>('PLT0', buffer, 0);
+  rsl::store<u32>(buffer.size(), buffer, 4);
+  rsl::store<u32>(3, buffer, 8);   // revision
+  rsl::store<u32>(0, buffer, 12);  // brres offset
+  rsl::store<u32>(64, buffer, 16); // palette offset
+  rsl::store<u32>(~0, buffer, 20);
+  rsl::store<u32>(static_cast<u32>(format), buffer, 24);
+  rsl::store<u16>(num_entries, buffer, 28);
+  rsl::store<u16>(0, buffer, 30);
+  rsl::store<u32>(0, buffer, 32); // src path
+  rsl::store<u32>(0, buffer, 36); // user data
+
+  std::memcpy(buffer.data() + 64, tlut.data(), num_entries * 2);
+
+  SimpleRelocApplier applier(buffer);
+  applier.apply({.offset_of_delta_reference = 0,
+                 .offset_of_pointer_in_struct = 20,
+                 .name = std::string(name),
+                 .non_volatile = true},
+                0 /* structure offset */);
+
+  return buffer;
+}
+
+Result<void> WritePLT0ToFile(std::span<const u8> tlut,
+                             gx::PaletteFormat format, std::string_view name,
+                             std::string path) {
+  auto buf = WritePLT0(tlut, format, name);
+  TRY(rsl::WriteFile(buf, path));
+  return {};
+}
+
 } // namespace librii::g3d
@@ -2,6 +2,7 @@
 
 #include <core/common.h>
 #include <librii/g3d/io/CommonIO.hpp>
+#include <librii/gx/Texture.hpp>
 #include <span>
 #include <string_view>
 
@@ -27,4 +28,19 @@ bool WriteTexture(std::span<u8> data, const TextureData& tex, s32 brres_ofs,
 [[nodiscard]] Result<void> WriteTEX0ToFile(const g3d::TextureData& tex,
                                            std::string path);
 
+//! A "PLT0" file holds the palette of a C4/C8/C14X2 TEX0 of the same name.
+//!
+//! @param[in] tlut   Big-endian TLUT entries, two bytes each.
+//! @param[in] format Format of the entries.
+//! @param[in] name   Name of the palette, matching its texture.
+//!
+[[nodiscard]] std::vector<u8> WritePLT0(std::span<const u8> tlut,
+                                        gx::PaletteFormat format,
+                                        std::string_view name);
+
+[[nodiscard]] Result<void> WritePLT0ToFile(std::span<const u8> tlut,
+                                           gx::PaletteFormat format,
+                                           std::string_view name,
+                                           std::string path);
+
 } // namespace librii::g3d
@@ -1,51 +1,73 @@
 #include "DLInterpreter.hpp"
 
-#include <rsl/SafeReader.hpp>
-
 namespace librii::gpu {
 
-Result<void> RunDisplayList(oishii::BinaryReader& unsafeReader,
-                            QDisplayListHandler& handler, u32 dlSize) {
-  rsl::SafeReader reader(unsafeReader);
-  const auto start = reader.tell();
+template Result<void>
+RunDisplayList<QDisplayListHandler>(oishii::BinaryReader& reader,
+                                    QDisplayListHandler& handler, u32 dlSize);
+
+static u16 LoadU16(const u8* p) { return static_cast<u16>((p[0] << 8) | p[1]); }
+static u32 LoadU32(const u8* p) {
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
 
-  TRY(handler.onStreamBegin());
+Result<std::optional<QDrawCommand>>
+DecodeDisplayList(oishii::BinaryReader& reader, u32 end, QCommandBatch& batch) {
+  const u8* const buf = reader.getStreamStart();
+  const u32 buf_size = reader.endpos();
+  u32 pos = reader.tell();
+  u32 cmd_start = pos;
+
+  // A command may run past |end|, but not past the buffer
+  auto need = [&](u32 n, CommandType tag) -> Result<void> {
+    if (pos + static_cast<u64>(n) > buf_size) {
+      return std::unexpected(
+          std::format("Command {} at {:#x} is truncated.",
+                      static_cast<u32>(tag), cmd_start));
+    }
+    return {};
+  };
 
-  while (reader.tell() < start + (int)dlSize) {
-    CommandType tag = static_cast<CommandType>(TRY(reader.U8NoAlign()));
+  while (pos < end && !batch.full()) {
+    cmd_start = pos;
+    TRY(need(1, CommandType::NOP));
+    const auto tag = static_cast<CommandType>(buf[pos++]);
 
     switch (tag) {
     case CommandType::BP: {
-      QBPCommand cmd;
-      u32 rv = TRY(reader.U32NoAlign());
-      cmd.reg = static_cast<BPAddress>((rv & 0xff000000) >> 24);
-      cmd.val = (rv & 0x00ffffff);
-      TRY(handler.onCommandBP(cmd));
+      TRY(need(4, tag));
+      const u32 rv = LoadU32(buf + pos);
+      pos += 4;
+      batch.push(QBPCommand{
+          .reg = static_cast<BPAddress>((rv & 0xff000000) >> 24),
+          .val = rv & 0x00ffffff,
+      });
       break;
     }
     case CommandType::NOP:
       break;
     case CommandType::XF: {
-      // TODO: Verify
-      QXFCommand cmd;
-      const auto nCmd = TRY(reader.U16NoAlign());
-      const auto reg = TRY(reader.U16NoAlign());
-      cmd.reg = reg;
-      cmd.val = TRY(reader.U32NoAlign());
-      cmd.vals.resize(nCmd + 1);
-      cmd.vals[0] = cmd.val;
-      for (u16 i = 0; i < nCmd; ++i) {
-        cmd.vals[i] = TRY(reader.U32NoAlign());
-      }
-      TRY(handler.onCommandXF(cmd));
+      TRY(need(4, tag));
+      // Count is stored minus one
+      const u32 count = LoadU16(buf + pos) + 1;
+      const u16 reg = LoadU16(buf + pos + 2);
+      pos += 4;
+      TRY(need(count * 4, tag));
+      batch.push(QXFCommand{
+          .reg = reg,
+          .val = LoadU32(buf + pos),
+          .data = {buf + pos, count * 4},
+      });
+      pos += count * 4;
       break;
     }
     case CommandType::CP: {
-      QCPCommand cmd;
-      cmd.reg = TRY(reader.U8NoAlign());
-      cmd.val = TRY(reader.U32NoAlign());
-
-      TRY(handler.onCommandCP(cmd));
+      TRY(need(5, tag));
+      batch.push(QCPCommand{
+          .reg = buf[pos],
+          .val = LoadU32(buf + pos + 1),
+      });
+      pos += 5;
       break;
     }
     case CommandType::LOAD_INDX_A: // Position matrices - Start at 0, len=12
@@ -55,28 +77,35 @@ Result<void> RunDisplayList(oishii::BinaryReader& unsafeReader,
     case CommandType::LOAD_INDX_C: // Postmatrices - ??
     case CommandType::LOAD_INDX_D: // Lights - ??
     {
-      u32 val = TRY(reader.U32NoAlign());
-      u16 index = val >> 16;
-      u16 addr = val & 0x0FFF;
-      u8 len = ((val >> 12) & 0xF) + 1;
-      TRY(handler.onCommandIndexedLoad(static_cast<u8>(tag), index, addr, len));
+      TRY(need(4, tag));
+      const u32 val = LoadU32(buf + pos);
+      pos += 4;
+      batch.push(QIndexedLoadCommand{
+          .cmd = static_cast<u8>(tag),
+          .index = val >> 16,
+          .address = static_cast<u16>(val & 0x0FFF),
+          .size = static_cast<u8>(((val >> 12) & 0xF) + 1),
+      });
       break;
     }
     default:
       if (static_cast<u32>(tag) & 0x80) {
-        auto prim =
-            librii::gx::DecodeDrawPrimitiveCommand(static_cast<u32>(tag));
-        auto verts = TRY(reader.U16NoAlign());
-        TRY(handler.onCommandDraw(unsafeReader, prim, verts, start + dlSize));
-      } else {
-        return std::unexpected(std::format("Unrecognized command {} in stream.",
-                                           static_cast<u32>(tag)));
+        TRY(need(2, tag));
+        const QDrawCommand draw{
+            .type =
+                librii::gx::DecodeDrawPrimitiveCommand(static_cast<u32>(tag)),
+            .nverts = LoadU16(buf + pos),
+        };
+        reader.seekSet(pos + 2);
+        return draw;
       }
-      break;
+      return std::unexpected(std::format("Unrecognized command {} in stream.",
+                                         static_cast<u32>(tag)));
     }
   }
-  TRY(handler.onStreamEnd());
-  return {};
+
+  reader.seekSet(pos);
+  return std::nullopt;
 }
 
 } // namespace librii::gpu
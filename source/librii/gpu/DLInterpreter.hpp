@@ -2,9 +2,13 @@
 
 #include "GPUAddressSpace.hpp"
 #include "GPUCommand.hpp"
+#include <array>
 #include <core/common.h>
 #include <librii/gx.h>
 #include <oishii/reader/binary_reader.hxx>
+#include <optional>
+#include <span>
+#include <variant>
 
 namespace librii::gpu {
 
@@ -17,12 +21,57 @@ struct QXFCommand {
   u16 reg;
   u32 val; // first val
 
-  std::vector<u32> vals; // first val repeated
+  //! Every value, the first included: big-endian words in the display list
+  std::span<const u8> data;
+
+  u32 size() const { return static_cast<u32>(data.size() / 4); }
+  u32 operator[](u32 i) const {
+    const u8* p = data.data() + i * 4;
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  }
 };
 struct QCPCommand {
   u8 reg;
   u32 val;
 };
+struct QIndexedLoadCommand {
+  u32 cmd;
+  u32 index;
+  u16 address;
+  u8 size;
+};
+
+using QCommand =
+    std::variant<QBPCommand, QCPCommand, QXFCommand, QIndexedLoadCommand>;
+
+//! Commands decoded ahead of the handler, in a fixed buffer that never
+//! allocates. Reused for every batch of a display list.
+class QCommandBatch {
+public:
+  static constexpr u32 Capacity = 64;
+
+  std::span<const QCommand> commands() const {
+    return {mCommands.data(), mSize};
+  }
+  bool full() const { return mSize == Capacity; }
+  void push(const QCommand& cmd) { mCommands[mSize++] = cmd; }
+  void clear() { mSize = 0; }
+
+private:
+  std::array<QCommand, Capacity> mCommands;
+  u32 mSize = 0;
+};
+
+struct QDrawCommand {
+  librii::gx::PrimitiveType type;
+  u16 nverts;
+};
+
+//! Decode commands into |batch| until it is full, a draw command is reached or
+//! the stream ends at |end|. A draw command is returned with the reader left
+//! at its vertex data, which only the handler knows how to skip.
+Result<std::optional<QDrawCommand>>
+DecodeDisplayList(oishii::BinaryReader& reader, u32 end, QCommandBatch& batch);
 
 class QDisplayListHandler {
 public:
@@ -44,7 +93,49 @@ public:
   virtual Result<void> onStreamEnd() { return {}; }
 };
 
-Result<void> RunDisplayList(oishii::BinaryReader& reader,
-                            QDisplayListHandler& handler, u32 dlSize);
+//! Run a display list through |handler|, a batch of commands at a time.
+//!
+//! |Handler| needs the member functions of QDisplayListHandler but need not
+//! derive from it. Passing the concrete type of a final handler lets every
+//! call be resolved at compile time.
+template <typename Handler>
+Result<void> RunDisplayList(oishii::BinaryReader& reader, Handler& handler,
+                            u32 dlSize) {
+  const u32 end = reader.tell() + dlSize;
+  QCommandBatch batch;
+
+  TRY(handler.onStreamBegin());
+  while (true) {
+    const auto draw = TRY(DecodeDisplayList(reader, end, batch));
+    for (const auto& cmd : batch.commands()) {
+      TRY(std::visit(
+          [&]<typename T>(const T& c) -> Result<void> {
+            if constexpr (std::is_same_v<T, QBPCommand>) {
+              return handler.onCommandBP(c);
+            } else if constexpr (std::is_same_v<T, QCPCommand>) {
+              return handler.onCommandCP(c);
+            } else if constexpr (std::is_same_v<T, QXFCommand>) {
+              return handler.onCommandXF(c);
+            } else {
+              return handler.onCommandIndexedLoad(c.cmd, c.index, c.address,
+                                                  c.size);
+            }
+          },
+          cmd));
+    }
+    batch.clear();
+    if (draw.has_value()) {
+      TRY(handler.onCommandDraw(reader, draw->type, draw->nverts, end));
+    } else if (reader.tell() >= end) {
+      break;
+    }
+  }
+  TRY(handler.onStreamEnd());
+  return {};
+}
+
+extern template Result<void>
+RunDisplayList<QDisplayListHandler>(oishii::BinaryReader& reader,
+                                    QDisplayListHandler& handler, u32 dlSize);
 
 } // namespace librii::gpu
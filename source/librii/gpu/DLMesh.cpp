@@ -1,48 +1,182 @@
 #include "DLMesh.hpp"
 
+IMPORT_STD;
+
 namespace librii::gpu {
 
 // This is always BE
 constexpr oishii::EndianSelect CmdProcEndian = oishii::EndianSelect::Big;
 
-static std::expected<u16, std::string> ProcessAttr(
-    oishii::BinaryReader& reader,
-    const std::map<gx::VertexAttribute, gx::VertexAttributeType>& attribstypes,
-    gx::VertexAttribute a, u32 vi) {
-  u16 val = 0;
-
-  switch (attribstypes.at(a)) {
-  case gx::VertexAttributeType::None:
-    break;
-  case gx::VertexAttributeType::Byte:
-    val = TRY(reader.tryRead<u8, CmdProcEndian, true>());
-    EXPECT(val != 0xff);
-    break;
-  case gx::VertexAttributeType::Short:
-    val = TRY(reader.tryRead<u16, CmdProcEndian, true>());
-    if (val == 0xffff) {
-      printf("Index: %u, Attribute: %x\n", vi, (u32)a);
-      reader.warnAt("Disabled vertex", reader.tell() - 2, reader.tell());
+namespace {
+
+using Field = VertexLayout::Field;
+
+template <u8 Width> u16 LoadIndex(const u8* src) {
+  if constexpr (Width == 1) {
+    return src[0];
+  } else {
+    return static_cast<u16>((src[0] << 8) | src[1]);
+  }
+}
+
+// Every offset and width is a constant, so each vertex is a handful of loads
+template <Field... Fs>
+void DecodeFixed(const u8* src, std::span<gx::IndexedVertex> out,
+                 const VertexLayout&) {
+  constexpr u32 stride = (Fs.width + ...);
+  for (auto& vert : out) {
+    u32 ofs = 0;
+    ((vert.indices[static_cast<u32>(Fs.attr)] =
+          LoadIndex<Fs.width>(src + ofs),
+      ofs += Fs.width),
+     ...);
+    src += stride;
+  }
+}
+
+struct FixedDecoder {
+  u32 attributes;
+  u32 wide; // Attributes with 16-bit indices
+  VertexDecoder decoder;
+};
+
+template <Field... Fs> constexpr FixedDecoder MakeFixed() {
+  constexpr std::array<Field, sizeof...(Fs)> fields{Fs...};
+  // Fields must be listed in stream order
+  static_assert(std::ranges::is_sorted(fields, {}, [](const Field& f) {
+    return static_cast<u32>(f.attr);
+  }));
+  return {
+      .attributes = ((1u << static_cast<u32>(Fs.attr)) | ...),
+      .wide = ((Fs.width == 2 ? 1u << static_cast<u32>(Fs.attr) : 0u) | ...),
+      .decoder = &DecodeFixed<Fs...>,
+  };
+}
+
+constexpr Field PNM{gx::VertexAttribute::PositionNormalMatrixIndex, 1};
+constexpr Field Pos8{gx::VertexAttribute::Position, 1};
+constexpr Field Pos16{gx::VertexAttribute::Position, 2};
+constexpr Field Nrm8{gx::VertexAttribute::Normal, 1};
+constexpr Field Nrm16{gx::VertexAttribute::Normal, 2};
+constexpr Field Clr8{gx::VertexAttribute::Color0, 1};
+constexpr Field Clr16{gx::VertexAttribute::Color0, 2};
+constexpr Field Tex0_8{gx::VertexAttribute::TexCoord0, 1};
+constexpr Field Tex0_16{gx::VertexAttribute::TexCoord0, 2};
+constexpr Field Tex1_8{gx::VertexAttribute::TexCoord1, 1};
+constexpr Field Tex1_16{gx::VertexAttribute::TexCoord1, 2};
+
+// The layouts seen most in retail course and character models. Writers pick
+// the index width per buffer, so widths are often mixed.
+constexpr FixedDecoder sFixedDecoders[] = {
+    MakeFixed<Pos16, Clr8, Tex0_16>(),
+    MakeFixed<Pos16, Clr8, Tex0_8>(),
+    MakeFixed<Pos8, Clr8, Tex0_8>(),
+    MakeFixed<Pos8, Clr8, Tex0_8, Tex1_8>(),
+    MakeFixed<Pos16, Clr16, Tex0_16>(),
+    MakeFixed<Pos16, Clr8, Tex0_16, Tex1_16>(),
+    MakeFixed<Pos8, Nrm8, Clr8, Tex0_8>(),
+    MakeFixed<Pos8, Nrm8, Tex0_8>(),
+    MakeFixed<Pos8, Nrm8>(),
+    MakeFixed<Pos8, Tex0_8>(),
+    MakeFixed<Pos16, Tex0_16>(),
+    MakeFixed<Pos16, Nrm16, Tex0_16>(),
+    MakeFixed<Pos16, Nrm16, Clr8, Tex0_16>(),
+    MakeFixed<Pos16, Nrm16, Clr16, Tex0_16>(),
+    MakeFixed<PNM, Pos16, Nrm16, Tex0_16>(),
+    MakeFixed<PNM, Pos8, Nrm8, Clr8, Tex0_8>(),
+};
+
+bool IsMatrixIndex(gx::VertexAttribute a) {
+  return a == gx::VertexAttribute::PositionNormalMatrixIndex ||
+         gx::IsTexNMtxIdx(a);
+}
+
+} // namespace
+
+Result<VertexLayout> MakeVertexLayout(const gx::VertexDescriptor& descriptor) {
+  VertexLayout layout;
+  u32 wide = 0;
+  for (u32 a = 0; a < static_cast<u32>(gx::VertexAttribute::Max); ++a) {
+    if (!(descriptor.mBitfield & (1 << a))) {
+      continue;
+    }
+    const auto attr = static_cast<gx::VertexAttribute>(a);
+    const auto it = descriptor.mAttributes.find(attr);
+    if (it == descriptor.mAttributes.end()) {
+      continue;
+    }
+    u8 width = 0;
+    switch (it->second) {
+    case gx::VertexAttributeType::None:
+      break;
+    case gx::VertexAttributeType::Byte:
+      width = 1;
+      break;
+    case gx::VertexAttributeType::Short:
+      width = 2;
+      break;
+    case gx::VertexAttributeType::Direct:
+      // As matrix indices are always direct, we still use them in an
+      // all-indexed vertex
+      if (!IsMatrixIndex(attr)) {
+        return std::unexpected("Direct vertex data is unsupported.");
+      }
+      width = 1;
+      break;
+    default:
+      return std::unexpected("Unknown vertex attribute format.");
+    }
+    if (width == 0) {
+      continue;
+    }
+    layout.fields[layout.num_fields++] = {attr, width};
+    layout.stride += width;
+    if (width == 2) {
+      wide |= 1 << a;
+    }
+  }
+
+  u32 attributes = 0;
+  for (const auto& f : layout.getFields()) {
+    attributes |= 1 << static_cast<u32>(f.attr);
+  }
+  layout.decoder = &DecodeVerticesGeneric;
+  for (const auto& fixed : sFixedDecoders) {
+    if (fixed.attributes == attributes && fixed.wide == wide) {
+      layout.decoder = fixed.decoder;
+      break;
     }
-    EXPECT(val != 0xffff);
-    break;
-  case gx::VertexAttributeType::Direct:
-    if (a != gx::VertexAttribute::PositionNormalMatrixIndex &&
-        a != gx::VertexAttribute::Texture0MatrixIndex &&
-        a != gx::VertexAttribute::Texture1MatrixIndex) {
-
-      return std::unexpected("Direct vertex data is unsupported.");
+  }
+  return layout;
+}
+
+void DecodeVerticesGeneric(const u8* src, std::span<gx::IndexedVertex> out,
+                           const VertexLayout& layout) {
+  const auto fields = layout.getFields();
+  for (auto& vert : out) {
+    for (const auto& f : fields) {
+      vert.indices[static_cast<u32>(f.attr)] =
+          f.width == 1 ? LoadIndex<1>(src) : LoadIndex<2>(src);
+      src += f.width;
     }
-    // As PNM indices are always direct, we
-    // still use them in an all-indexed vertex
-    val = TRY(reader.tryRead<u8, CmdProcEndian, true>());
-    EXPECT(val != 0xff);
-    break;
-  default:
-    return std::unexpected("Unknown vertex attribute format.");
   }
+}
 
-  return val;
+Result<void> DecodeVertices(oishii::BinaryReader& reader,
+                            const VertexLayout& layout, u32 stream_end,
+                            std::span<gx::IndexedVertex> out) {
+  const u64 begin = reader.tell();
+  const u64 end = begin + static_cast<u64>(out.size()) * layout.stride;
+  if (end > stream_end || end > reader.endpos()) {
+    return std::unexpected(std::format(
+        "{} vertices of {} bytes at {:#x} overrun the display list (ends at "
+        "{:#x})",
+        out.size(), layout.stride, begin,
+        std::min<u32>(stream_end, reader.endpos())));
+  }
+  layout.decoder(reader.getStreamStart() + begin, out, layout);
+  reader.seekSet(static_cast<u32>(end));
+  return {};
 }
 
 Result<void>
@@ -52,6 +186,8 @@ DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
                       std::map<gx::VertexBufferAttribute, u32>* optUsageMap) {
   oishii::Jump<oishii::Whence::Set> g(reader, start);
 
+  const VertexLayout layout = TRY(MakeVertexLayout(descriptor));
+
   const u32 end = reader.tell() + size;
   while (reader.tell() < end) {
     const u8 tag = TRY(reader.tryRead<u8, CmdProcEndian, true>());
@@ -67,24 +203,30 @@ DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
     u16 nVerts = TRY(reader.tryRead<u16, CmdProcEndian, true>());
     auto& prim = delegate.addIndexedPrimitive(
         gx::DecodeDrawPrimitiveCommand(tag), nVerts);
-
-    for (u16 vi = 0; vi < nVerts; ++vi) {
-      for (int a = 0; a < (int)gx::VertexAttribute::Max; ++a) {
-        if (descriptor.mBitfield & (1 << a)) {
-          const auto attr = static_cast<gx::VertexAttribute>(a);
-          const auto attr_buf = static_cast<gx::VertexBufferAttribute>(a);
-
-          const u16 val =
-              TRY(ProcessAttr(reader, descriptor.mAttributes, attr, vi));
-          prim.mVertices[vi][attr] = val;
-
-          // TODO: Probably don't validate this here
-          if (attr != gx::VertexAttribute::PositionNormalMatrixIndex &&
-              !IsTexNMtxIdx(attr)) {
-            if (optUsageMap && (*optUsageMap)[attr_buf] <= val)
-              (*optUsageMap)[attr_buf] = val;
-          }
+    const u32 vtx_start = reader.tell();
+    TRY(DecodeVertices(reader, layout, end, prim.mVertices));
+
+    for (const auto& f : layout.getFields()) {
+      const u32 a = static_cast<u32>(f.attr);
+      // All bits set marks a disabled vertex
+      const u16 disabled = f.width == 1 ? 0xff : 0xffff;
+      u16 max_index = 0;
+      for (u32 vi = 0; vi < nVerts; ++vi) {
+        const u16 val = prim.mVertices[vi].indices[a];
+        if (val == disabled) {
+          const u32 at = vtx_start + vi * layout.stride;
+          reader.warnAt("Disabled vertex", at, at + layout.stride);
+          return std::unexpected(
+              std::format("Vertex {} disables attribute {}", vi, a));
         }
+        max_index = std::max(max_index, val);
+      }
+
+      // TODO: Probably don't validate this here
+      if (optUsageMap && !IsMatrixIndex(f.attr) && nVerts != 0) {
+        auto& usage =
+            (*optUsageMap)[static_cast<gx::VertexBufferAttribute>(a)];
+        usage = std::max<u32>(usage, max_index);
       }
     }
   }
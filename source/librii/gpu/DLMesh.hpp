@@ -3,9 +3,49 @@
 #include <librii/gx.h>
 #include <map>
 #include <oishii/reader/binary_reader.hxx>
+#include <span>
 
 namespace librii::gpu {
 
+struct VertexLayout;
+
+//! Decodes |out.size()| vertices from |src|, which holds at least
+//! |out.size() * layout.stride| bytes.
+using VertexDecoder = void (*)(const u8* src, std::span<gx::IndexedVertex> out,
+                               const VertexLayout& layout);
+
+//! Byte layout of one vertex of a draw command, as set by a descriptor
+struct VertexLayout {
+  struct Field {
+    gx::VertexAttribute attr;
+    //! Index width in bytes: 1 or 2
+    u8 width;
+  };
+
+  std::array<Field, static_cast<size_t>(gx::VertexAttribute::Max)> fields{};
+  u32 num_fields = 0;
+  //! Bytes per vertex
+  u32 stride = 0;
+  //! Specialized for this layout if it is a common one, generic otherwise
+  VertexDecoder decoder = nullptr;
+
+  std::span<const Field> getFields() const {
+    return {fields.data(), num_fields};
+  }
+};
+
+Result<VertexLayout> MakeVertexLayout(const gx::VertexDescriptor& descriptor);
+
+//! Table-driven decoder for any layout
+void DecodeVerticesGeneric(const u8* src, std::span<gx::IndexedVertex> out,
+                           const VertexLayout& layout);
+
+//! Decode |out.size()| vertices at the reader's position, checking once that
+//! they all lie before |stream_end|. Advances the reader past them.
+Result<void> DecodeVertices(oishii::BinaryReader& reader,
+                            const VertexLayout& layout, u32 stream_end,
+                            std::span<gx::IndexedVertex> out);
+
 struct IMeshDLDelegate {
   virtual gx::IndexedPrimitive& addIndexedPrimitive(gx::PrimitiveType type,
                                                     u16 nVerts) = 0;
@@ -28,7 +28,7 @@ struct GPUShader {
   bool isDefinedIndCmd(int i) { return definedIndCmds & (1 << i); }
 };
 
-class QDisplayListShaderHandler : public QDisplayListHandler {
+class QDisplayListShaderHandler final : public QDisplayListHandler {
 public:
   QDisplayListShaderHandler(librii::gx::LowLevelGxMaterial& material,
                             int numStages);
@@ -77,7 +77,7 @@ struct GPUMaterial {
   }
 };
 
-class QDisplayListMaterialHandler : public QDisplayListHandler {
+class QDisplayListMaterialHandler final : public QDisplayListHandler {
 public:
   QDisplayListMaterialHandler(gx::LowLevelGxMaterial& mat);
   ~QDisplayListMaterialHandler();
@@ -89,7 +89,7 @@ public:
   GPUMaterial mGpuMat;
 };
 
-class QDisplayListVertexSetupHandler : public QDisplayListHandler {
+class QDisplayListVertexSetupHandler final : public QDisplayListHandler {
 public:
   Result<void> onCommandBP(const QBPCommand& token) override;
   Result<void> onCommandCP(const QCPCommand& token) override;
@@ -77,3 +77,9 @@ inline ColorF32::operator ColorS10() const {
 }
 
 } // namespace librii::gx
+
+template <> struct std::hash<librii::gx::Color> {
+  std::size_t operator()(const librii::gx::Color& c) const {
+    return std::hash<u32>{}(static_cast<u32>(c));
+  }
+};
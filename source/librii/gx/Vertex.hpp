@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/common.h>
+#include <librii/gx/Color.hpp>
 #include <oishii/reader/binary_reader.hxx>
 #include <oishii/writer/binary_writer.hxx>
 #include <vendor/glm/vec3.hpp>
@@ -300,6 +301,28 @@ inline Result<gx::Color> readComponents<gx::Color>(oishii::BinaryReader& reader,
   return readColorComponents(reader, type.color);
 }
 
+// Read |out.size()| consecutive entries. Unquantized vectors are stored as
+// they are laid out in memory, so they are decoded in bulk straight into
+// |out|.
+template <typename T>
+inline Result<void> readComponentsBulk(oishii::BinaryReader& reader,
+                                       std::span<T> out,
+                                       gx::VertexBufferType type,
+                                       std::size_t true_count,
+                                       u32 divisor = 0) {
+  if constexpr (!std::is_same_v<T, gx::Color>) {
+    static_assert(sizeof(T) == T::length() * sizeof(f32));
+    if (type.generic == gx::VertexBufferType::Generic::f32 &&
+        true_count == T::length()) {
+      return reader.tryReadInto(out);
+    }
+  }
+  for (auto& entry : out) {
+    entry = TRY(readComponents<T>(reader, type, true_count, divisor));
+  }
+  return {};
+}
+
 [[nodiscard]] inline Result<void>
 writeColorComponents(oishii::Writer& writer, const librii::gx::Color& c,
                      VertexBufferType::Color colort) {
@@ -421,6 +444,12 @@ template <typename TB, VBufferKind kind> struct VertexBuffer {
     result = TRY(readColorComponents(reader, mQuant.type.color));
     return {};
   }
+  // Read every entry of |mData|, which must already be sized
+  Result<void> readBuffer(oishii::BinaryReader& reader) {
+    return readComponentsBulk<TB>(reader, mData, mQuant.type,
+                                  TRY(ComputeComponentCount()),
+                                  mQuant.divisor);
+  }
 
   template <int n, typename T, glm::qualifier q>
   [[nodiscard]] Result<void>
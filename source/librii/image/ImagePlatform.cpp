@@ -1,12 +1,14 @@
 #include "ImagePlatform.hpp"
+#include "Palette.hpp"
 
 #include <librii/gx.h>
-
-#include <rsl/Ranges.hpp>
+#include <rsl/ThreadPool.hpp>
 
 #include "avir-rs/include/avir_rs.h"
 #include "gctex/include/gctex.h"
 
+#include <algorithm>
+
 IMPORT_STD;
 
 namespace librii::image {
@@ -36,10 +38,21 @@ void decode(std::span<u8> dst, std::span<const u8> src, int width, int height,
 
 // raw 8-bit RGBA -> X
 Result<void> encode(std::span<u8> dst, std::span<const u8> src, int width,
-                    int height, gx::TextureFormat texformat) {
+                    int height, gx::TextureFormat texformat,
+                    std::span<u8> tlut, gx::PaletteFormat tlutformat,
+                    EncodeQuality quality) {
+  if (texformat == gx::TextureFormat::CMPR) {
+    // Inside a pool (e.g. batch texture import) the cores are spoken for
+    const u32 num_threads =
+        rsl::ThreadPool::current() != nullptr ? 1 : 0 /* All cores */;
+    // EncodeQuality matches gctex's CMPR levels
+    gctex::encode_cmpr_into(dst, src, width, height,
+                            static_cast<u32>(quality), num_threads);
+    return {};
+  }
+
   bool ok = false;
   switch (texformat) {
-  case gx::TextureFormat::CMPR:
   case gx::TextureFormat::I4:
   case gx::TextureFormat::I8:
   case gx::TextureFormat::IA4:
@@ -56,169 +69,293 @@ Result<void> encode(std::span<u8> dst, std::span<const u8> src, int width,
     return {};
   }
 
-  // No palette support
-  return std::unexpected("No palette support");
+  EXPECT(gx::IsPaletteFormat(texformat), "Unsupported texture format");
+  const u32 capacity = getPaletteCapacity(texformat);
+  EXPECT(tlut.size() >= capacity * 2, "Palette formats need a TLUT buffer");
+  const auto palette =
+      quantize(src.subspan(0, width * height * 4), capacity, tlutformat,
+               quality);
+  encodeTlut(tlut.subspan(0, capacity * 2), palette);
+  return encodeIndices(dst, src, width, height, texformat, palette);
 }
-// Change format, no resizing
-Result<void> reencode(std::span<u8> dst, std::span<const u8> src, int width,
-                      int height, gx::TextureFormat oldFormat,
-                      gx::TextureFormat newFormat) {
-  std::vector<u8> tmp(width * height * 4 + 1024 /* Bias for SIMD */);
-  decode(tmp, src, width, height, oldFormat);
-  return encode(dst, tmp, width, height, newFormat);
+
+// Whether two buffers share any memory
+static bool Overlaps(std::span<const u8> a, std::span<const u8> b) {
+  const std::less<const u8*> lt;
+  return !a.empty() && !b.empty() && lt(a.data(), b.data() + b.size()) &&
+         lt(b.data(), a.data() + a.size());
 }
 
 void resize(std::span<u8> dst, int dx, int dy, std::span<const u8> src, int sx,
             int sy, ResizingAlgorithm type) {
-  std::vector<u8> src_(src.begin(), src.end());
-  std::vector<u8> dst_(dst.begin(), dst.end());
+  // The resizers can't work in place
+  std::vector<u8> src_copy;
+  if (Overlaps(dst, src)) {
+    src_copy.assign(src.begin(), src.end());
+    src = src_copy;
+  }
   if (type == ResizingAlgorithm::AVIR) {
-    avir_resize(dst_.data(), dst_.size(), dx, dy, src_.data(), src_.size(), sx,
+    avir_resize(dst.data(), dst.size(), dx, dy, src.data(), src.size(), sx,
                 sy);
   } else {
-    clancir_resize(dst_.data(), dst_.size(), dx, dy, src_.data(), src_.size(),
-                   sx, sy);
+    clancir_resize(dst.data(), dst.size(), dx, dy, src.data(), src.size(), sx,
+                   sy);
   }
-
-  memcpy(dst.data(), dst_.data(), dst.size());
 }
 
-struct RGBA32ImageSource {
-  static Result<RGBA32ImageSource> make(std::span<const u8> buf, int w, int h,
-                                        gx::TextureFormat fmt) {
-    RGBA32ImageSource tmp;
-    tmp.mBuf = buf | rsl::ToList();
-    tmp.mW = w;
-    tmp.mH = h;
-    tmp.mFmt = fmt;
-    if (tmp.mFmt == gx::TextureFormat::Extension_RawRGBA32) {
-      tmp.mDecoded = buf | rsl::ToList();
-    } else {
-      tmp.mTmp.resize(roundUp(w, 32) * roundUp(h, 32) *
-                      4 /* Round up for SIMD */);
-      EXPECT(tmp.mBuf.size() >= getEncodedSize(w, h, tmp.mFmt));
-      decode(tmp.mTmp, tmp.mBuf, w, h, tmp.mFmt);
-      tmp.mDecoded = tmp.mTmp;
-    }
-    return tmp;
-  }
-
-  std::span<const u8> get() const { return mDecoded; }
-  u32 size() const { return mW * mH * 4; }
-  int width() const { return mW; }
-  int height() const { return mH; }
-
-private:
-  std::vector<u8> mTmp = {};
-  std::vector<u8> mDecoded = {};
-  std::vector<u8> mBuf = {};
-  int mW = {};
-  int mH = {};
-  gx::TextureFormat mFmt = {gx::TextureFormat::Extension_RawRGBA32};
-};
-struct RGBA32ImageTarget {
-  RGBA32ImageTarget(int w, int h) : mW(w), mH(h) {
-    mTmp.resize(roundUp(w, 32) * roundUp(h, 32) * 4);
-  }
-  [[nodiscard]] Result<void> copyTo(std::span<u8> dst, gx::TextureFormat fmt) {
-    if (fmt == gx::TextureFormat::Extension_RawRGBA32) {
-      EXPECT(dst.size() >= mTmp.size());
-      memcpy(dst.data(), mTmp.data(), mTmp.size());
-    } else {
-      EXPECT(dst.size() >= getEncodedSize(mW, mH, fmt));
-      EXPECT(mTmp.size() >= mW * mH * 4);
-      return encode(dst, mTmp, mW, mH, fmt);
+// Halves an image in each dimension, averaging 2x2 blocks
+static void downsampleBox(std::span<u8> dst, std::span<const u8> src, int sx,
+                          int sy) {
+  const int dx = sx / 2, dy = sy / 2;
+  for (int y = 0; y < dy; ++y) {
+    const u8* row0 = src.data() + (y * 2) * sx * 4;
+    const u8* row1 = row0 + sx * 4;
+    u8* out = dst.data() + y * dx * 4;
+    for (int x = 0; x < dx * 4; ++x) {
+      const int i = (x / 4) * 8 + x % 4;
+      out[x] = static_cast<u8>(
+          (row0[i] + row0[i + 4] + row1[i] + row1[i + 4] + 2) / 4);
     }
+  }
+}
+
+// Raw 8-bit RGBA bytes of one image
+static size_t rawSize(int width, int height) {
+  return static_cast<size_t>(width) * height * 4;
+}
+
+// Decoding may write whole blocks, past the image proper
+static size_t decodeScratchSize(int width, int height,
+                                gx::TextureFormat format) {
+  return format == gx::TextureFormat::Extension_RawRGBA32
+             ? 0
+             : roundUp(width, 32) * roundUp(height, 32) * 4;
+}
+
+static bool isRaw(gx::TextureFormat format) {
+  return format == gx::TextureFormat::Extension_RawRGBA32;
+}
+
+// Encodes raw level |lod| of a |width| x |height| chain straight into its
+// place in |dst|
+static Result<void> encodeLevel(std::span<u8> dst, int width, int height,
+                                gx::TextureFormat format, u32 lod,
+                                std::span<const u8> rgba,
+                                EncodeQuality quality) {
+  const int ofs = lod == 0 ? 0 : getEncodedSize(width, height, format, lod - 1);
+  const int w = width >> lod, h = height >> lod;
+  EXPECT(dst.size() >= static_cast<size_t>(ofs + getEncodedSize(w, h, format)));
+  EXPECT(rgba.size() >= rawSize(w, h));
+  if (isRaw(format)) {
+    memcpy(dst.data() + ofs, rgba.data(), rawSize(w, h));
     return {};
   }
-  void fromOtherSized(std::span<const u8> src, u32 ow, u32 oh,
-                      ResizingAlgorithm al) {
-    mTmp.resize(mW * mH * 4);
-    // assert(src.size() >= mTmp.size());
-    if (ow == mW && oh == mH) {
-      memcpy(mTmp.data(), src.data(), mTmp.size());
-    } else {
-      resize(mTmp, mW, mH, src, ow, oh, al);
-    }
+  return encode(dst.subspan(ofs), rgba.subspan(0, rawSize(w, h)), w, h, format,
+                {}, gx::PaletteFormat::IA8, quality);
+}
+
+// |levels| holds every raw level back to back. They share one palette.
+static Result<void> encodePaletteLevels(std::span<u8> dst, int width,
+                                        int height, gx::TextureFormat format,
+                                        u32 mipMapCount,
+                                        std::span<const u8> levels,
+                                        std::span<u8> tlut,
+                                        gx::PaletteFormat tlutformat,
+                                        EncodeQuality quality) {
+  const u32 capacity = getPaletteCapacity(format);
+  EXPECT(tlut.size() >= capacity * 2, "Palette formats need a TLUT buffer");
+  const auto palette = quantize(levels, capacity, tlutformat, quality);
+  encodeTlut(tlut.subspan(0, capacity * 2), palette);
+  size_t raw_ofs = 0;
+  for (u32 i = 0; i <= mipMapCount; ++i) {
+    const int dst_ofs =
+        i == 0 ? 0 : getEncodedSize(width, height, format, i - 1);
+    TRY(encodeIndices(dst.subspan(dst_ofs), levels.subspan(raw_ofs),
+                      width >> i, height >> i, format, palette));
+    raw_ofs += rawSize(width >> i, height >> i);
   }
-  void fromOtherSized(const RGBA32ImageSource& source, ResizingAlgorithm al) {
-    fromOtherSized(source.get(), source.width(), source.height(), al);
-  }
-  std::span<u8> get() { return {mTmp.data(), mTmp.size()}; }
-  std::span<const u8> get() const { return {mTmp.data(), mTmp.size()}; }
-  u32 size() const { return mW * mH * 4; }
-
-private:
-  std::vector<u8> mTmp;
-  int mW;
-  int mH;
-};
-[[nodiscard]] Result<void> transform(std::span<u8> dst_, int dwidth,
-                                     int dheight, gx::TextureFormat oldformat,
-                                     std::optional<gx::TextureFormat> newformat,
-                                     std::span<const u8> src_, int swidth,
-                                     int sheight, u32 mipMapCount,
-                                     ResizingAlgorithm algorithm) {
-  std::vector<u8> dst(dst_.begin(), dst_.end());
-  std::vector<u8> src(src_.begin(), src_.end());
+  return {};
+}
+
+Result<void> transform(std::span<u8> dst, int dwidth, int dheight,
+                       gx::TextureFormat oldformat,
+                       std::optional<gx::TextureFormat> newformat,
+                       std::span<const u8> src, int swidth, int sheight,
+                       u32 mipMapCount, ResizingAlgorithm algorithm,
+                       std::span<u8> tlut, gx::PaletteFormat tlutformat,
+                       EncodeQuality quality) {
 #ifdef IMAGE_DEBUG
   printf(
       "Transform: Dest={%p, w:%i, h:%i}, Source={%p, w:%i, h:%i}, NumMip=%u\n",
       dst.data(), dwidth, dheight, src.data(), swidth, sheight, mipMapCount);
 #endif // IMAGE_DEBUG
   EXPECT(!dst.empty());
-  EXPECT(!src.empty());
   EXPECT(dwidth > 0 && dheight > 0);
+  if (src.empty())
+    src = dst;
   if (swidth <= 0)
     swidth = dwidth;
   if (sheight <= 0)
     sheight = dheight;
-  if (src.empty())
-    src = dst;
   if (!newformat.has_value())
     newformat = oldformat;
 
-  // Determine whether to decode this sublevel as an image or many sublvels.
   if (mipMapCount >= 1) {
     if (!is_power_of_2(swidth) || !is_power_of_2(sheight) ||
         !is_power_of_2(dwidth) || !is_power_of_2(dheight)) {
       return std::unexpected(
           "It is a GPU hardware requirement that mipmaps be powers of two");
     }
-    TRY(transform(dst, dwidth, dheight, oldformat, newformat, src, swidth,
-                  sheight, 0, algorithm));
+  }
+
+  // Encoding one level in place could clobber the source of the next
+  std::vector<u8> src_copy;
+  if (Overlaps(dst, src)) {
+    src_copy.assign(src.begin(), src.end());
+    src = src_copy;
+  }
+
+  // One arena: a decoded source level, then either the resized level being
+  // encoded, or (for palettes, which are built over the whole chain) every
+  // resized level.
+  const bool palette = gx::IsPaletteFormat(*newformat);
+  const size_t decode_size = decodeScratchSize(swidth, sheight, oldformat);
+  size_t level_size = rawSize(dwidth, dheight);
+  if (palette) {
     for (u32 i = 1; i <= mipMapCount; ++i) {
-      const auto src_lod_ofs =
-          getEncodedSize(swidth, sheight, oldformat, i - 1);
-      const auto dst_lod_ofs =
-          getEncodedSize(dwidth, dheight, newformat.value(), i - 1);
-      const auto src_lod_x = swidth >> i;
-      const auto src_lod_y = sheight >> i;
-      auto dst_lod_x = dwidth >> i;
-      auto dst_lod_y = dheight >> i;
-
-      TRY(transform(std::span(dst).subspan(dst_lod_ofs), dst_lod_x, dst_lod_y,
-                    oldformat, newformat.value(),
-                    std::span(src).subspan(src_lod_ofs), src_lod_x, src_lod_y,
-                    0, algorithm));
+      level_size += rawSize(dwidth >> i, dheight >> i);
     }
-  } else {
-    EXPECT(swidth > 0 && sheight > 0);
-    auto source = TRY(RGBA32ImageSource::make(src, swidth, sheight, oldformat));
-    EXPECT(source.get().size());
+  }
+  std::vector<u8> arena(decode_size + level_size);
+  const auto decoded = std::span(arena).subspan(0, decode_size);
+  auto level = std::span(arena).subspan(decode_size);
 
-    // TODO: We don't always need to allocate this
-    RGBA32ImageTarget target(dwidth, dheight);
-    EXPECT(target.get().size());
+  for (u32 i = 0; i <= mipMapCount; ++i) {
+    const int sw = swidth >> i, sh = sheight >> i;
+    const int dw = dwidth >> i, dh = dheight >> i;
+    const int src_ofs =
+        i == 0 ? 0 : getEncodedSize(swidth, sheight, oldformat, i - 1);
+    EXPECT(src.size() >=
+           static_cast<size_t>(src_ofs + getEncodedSize(sw, sh, oldformat)));
 
-    target.fromOtherSized(source, algorithm);
+    std::span<const u8> rgba = src.subspan(src_ofs, rawSize(sw, sh));
+    if (!isRaw(oldformat)) {
+      decode(decoded, src.subspan(src_ofs), sw, sh, oldformat);
+      rgba = decoded.subspan(0, rawSize(sw, sh));
+    }
+    if (sw != dw || sh != dh) {
+      resize(level.subspan(0, rawSize(dw, dh)), dw, dh, rgba, sw, sh,
+             algorithm);
+      rgba = level.subspan(0, rawSize(dw, dh));
+    }
 
-    // TODO: A copy here can be prevented
-    TRY(target.copyTo(dst, newformat.value()));
+    if (palette) {
+      if (rgba.data() != level.data()) {
+        memcpy(level.data(), rgba.data(), rawSize(dw, dh));
+      }
+      level = level.subspan(rawSize(dw, dh));
+    } else {
+      TRY(encodeLevel(dst, dwidth, dheight, *newformat, i, rgba, quality));
+    }
+  }
+
+  if (palette) {
+    TRY(encodePaletteLevels(dst, dwidth, dheight, *newformat, mipMapCount,
+                            std::span(arena).subspan(decode_size), tlut,
+                            tlutformat, quality));
   }
+  return {};
+}
 
-  EXPECT(dst_.size() == dst.size());
-  memcpy(&dst_[0], &dst[0], dst_.size());
+Result<void> generateMipChain(std::span<u8> dst, int dwidth, int dheight,
+                              gx::TextureFormat newformat, u32 mipMapCount,
+                              std::span<const u8> src, int swidth, int sheight,
+                              gx::TextureFormat oldformat, MipFilter filter,
+                              ResizingAlgorithm algorithm, std::span<u8> tlut,
+                              gx::PaletteFormat tlutformat,
+                              EncodeQuality quality) {
+  EXPECT(!dst.empty());
+  EXPECT(!src.empty());
+  EXPECT(dwidth > 0 && dheight > 0);
+  EXPECT(swidth > 0 && sheight > 0);
+  if (mipMapCount >= 1) {
+    if (!is_power_of_2(dwidth) || !is_power_of_2(dheight)) {
+      return std::unexpected(
+          "It is a GPU hardware requirement that mipmaps be powers of two");
+    }
+    EXPECT((dwidth >> mipMapCount) > 0 && (dheight >> mipMapCount) > 0,
+           "Too many mipmaps for the image size");
+  }
+  EXPECT(src.size() >=
+         static_cast<size_t>(getEncodedSize(swidth, sheight, oldformat)));
+
+  std::vector<u8> src_copy;
+  if (Overlaps(dst, src)) {
+    src_copy.assign(src.begin(), src.end());
+    src = src_copy;
+  }
+
+  // One arena: the decoded source, then the levels. A palette is built over
+  // the whole chain, so every level is kept; otherwise two buffers suffice,
+  // the previous level and the one being downsampled from it.
+  const bool palette = gx::IsPaletteFormat(newformat);
+  const size_t decode_size = decodeScratchSize(swidth, sheight, oldformat);
+  size_t levels_size = 0;
+  for (u32 i = 0; i <= (palette ? mipMapCount : std::min(mipMapCount, 1u));
+       ++i) {
+    levels_size += rawSize(dwidth >> i, dheight >> i);
+  }
+  std::vector<u8> arena(decode_size + levels_size);
+  const auto decoded = std::span(arena).subspan(0, decode_size);
+  const auto levels = std::span(arena).subspan(decode_size);
+
+  // Where level |i| is built
+  auto slot = [&](u32 i) {
+    size_t ofs = 0;
+    if (palette) {
+      for (u32 j = 0; j < i; ++j) {
+        ofs += rawSize(dwidth >> j, dheight >> j);
+      }
+    } else if (i % 2 == 1) {
+      ofs = rawSize(dwidth, dheight);
+    }
+    return levels.subspan(ofs, rawSize(dwidth >> i, dheight >> i));
+  };
+
+  std::span<const u8> prev = src.subspan(0, rawSize(swidth, sheight));
+  if (!isRaw(oldformat)) {
+    decode(decoded, src, swidth, sheight, oldformat);
+    prev = decoded.subspan(0, rawSize(swidth, sheight));
+  }
+  if (swidth != dwidth || sheight != dheight || palette) {
+    if (swidth != dwidth || sheight != dheight) {
+      resize(slot(0), dwidth, dheight, prev, swidth, sheight, algorithm);
+    } else {
+      memcpy(slot(0).data(), prev.data(), rawSize(dwidth, dheight));
+    }
+    prev = slot(0);
+  }
+
+  for (u32 i = 0; i <= mipMapCount; ++i) {
+    const int w = dwidth >> i, h = dheight >> i;
+    if (i != 0) {
+      const auto cur = slot(i);
+      if (filter == MipFilter::Box) {
+        downsampleBox(cur, prev, w * 2, h * 2);
+      } else {
+        resize(cur, w, h, prev, w * 2, h * 2, ResizingAlgorithm::Lanczos);
+      }
+      prev = cur;
+    }
+    if (!palette) {
+      TRY(encodeLevel(dst, dwidth, dheight, newformat, i, prev, quality));
+    }
+  }
+
+  if (palette) {
+    TRY(encodePaletteLevels(dst, dwidth, dheight, newformat, mipMapCount,
+                            levels, tlut, tlutformat, quality));
+  }
   return {};
 }
 
@@ -9,6 +9,11 @@
 
 namespace librii::image {
 
+//! @brief Trades encoding quality for speed. Applies to CMPR and the palette
+//! formats; other formats are encoded exactly.
+//!
+enum class EncodeQuality { Fast, Balanced, Best };
+
 //! @brief Compute padded dimensions for an image.
 //!
 //! @param[in] width  Width of the image.
@@ -60,18 +65,30 @@ void decode(std::span<u8> dst, std::span<const u8> src, int width, int height,
 //! @param[in] width The width of the image in pixels.
 //! @param[in] height The height of the image in pixels.
 //! @param[in] texformat The format of the image.
+//! @param[out] tlut Palette (Texture Lookup) data. Required for palette
+//! formats, and must hold getPaletteCapacity(texformat) entries.
+//! @param[in] tlutformat Format of the palette (Texture Lookup) data.
+//! @param[in] quality Encoder effort.
 //!
 //! @pre For efficiency reasons, this method does not handle the case where dst
 //! == src.
 //!
-[[nodiscard]] Result<void> encode(std::span<u8> dst, std::span<const u8> src,
-                                  int width, int height,
-                                  gx::TextureFormat texformat);
+[[nodiscard]] Result<void>
+encode(std::span<u8> dst, std::span<const u8> src, int width, int height,
+       gx::TextureFormat texformat, std::span<u8> tlut = {},
+       gx::PaletteFormat tlutformat = gx::PaletteFormat::IA8,
+       EncodeQuality quality = EncodeQuality::Balanced);
 
 //! @brief Specifies an algorithm for downscaling/upscaling an image.
 //!
 enum class ResizingAlgorithm { AVIR, Lanczos };
 
+//! @brief Specifies how each mipmap is downsampled from the one above it.
+//!
+//! Box averages 2x2 blocks; Lanczos runs the Lanczos resizer.
+//!
+enum class MipFilter { Box, Lanczos };
+
 // dst and source may be equal
 // raw 8-bit RGBA resize
 //! @brief Resize a raw, 8-bit RGBA buffer.
@@ -109,6 +126,10 @@ void resize(std::span<u8> dst, int dx, int dy, std::span<const u8> src, int sx,
 //! @param[in] mipMapCount	Number of additional levels of detail past the
 //! first image. Zero corresponds to the base image--no mipmapping.
 //! @param[in] algorithm	Algorithm to utilize for upscaling/downscaling.
+//! @param[out] tlut		Palette of the target data, if newformat is a
+//! palette format. Every level of detail shares it.
+//! @param[in] tlutformat	Format of the target palette.
+//! @param[in] quality		Encoder effort.
 //!
 [[nodiscard]] Result<void>
 transform(std::span<u8> dst, int dwidth, int dheight,
@@ -116,7 +137,45 @@ transform(std::span<u8> dst, int dwidth, int dheight,
           std::optional<gx::TextureFormat> newformat = std::nullopt,
           std::span<const u8> src = {}, int sx = -1, int sy = -1,
           u32 mipMapCount = 0,
-          ResizingAlgorithm algorithm = ResizingAlgorithm::Lanczos);
+          ResizingAlgorithm algorithm = ResizingAlgorithm::Lanczos,
+          std::span<u8> tlut = {},
+          gx::PaletteFormat tlutformat = gx::PaletteFormat::IA8,
+          EncodeQuality quality = EncodeQuality::Balanced);
+
+//! @brief Encode an image and a mipmap chain generated from it.
+//!
+//! The source is decoded once and resized to the base level. Every further
+//! level is downsampled from the one above it, in a single scratch buffer, and
+//! encoded straight into the destination.
+//!
+//! @param[in] dst			The destination pointer, sized for the
+//! whole chain.
+//! @param[in] dwidth		Width of the base level in pixels.
+//! @param[in] dheight		Height of the base level in pixels.
+//! @param[in] newformat	Format of the target data.
+//! @param[in] mipMapCount	Number of additional levels of detail past the
+//! first image.
+//! @param[in] src			Pointer to the source image. Only its base
+//! level is read.
+//! @param[in] swidth		Width of the source image in pixels.
+//! @param[in] sheight		Height of the source image in pixels.
+//! @param[in] oldformat	Format of the source data.
+//! @param[in] filter		How each level is derived from the previous.
+//! @param[in] algorithm	Algorithm for resizing the source to the base
+//! level.
+//! @param[out] tlut		Palette of the target data, for palette formats.
+//! @param[in] tlutformat	Format of the target palette.
+//! @param[in] quality		Encoder effort.
+//!
+[[nodiscard]] Result<void> generateMipChain(
+    std::span<u8> dst, int dwidth, int dheight, gx::TextureFormat newformat,
+    u32 mipMapCount, std::span<const u8> src, int swidth, int sheight,
+    gx::TextureFormat oldformat = gx::TextureFormat::Extension_RawRGBA32,
+    MipFilter filter = MipFilter::Lanczos,
+    ResizingAlgorithm algorithm = ResizingAlgorithm::Lanczos,
+    std::span<u8> tlut = {},
+    gx::PaletteFormat tlutformat = gx::PaletteFormat::IA8,
+    EncodeQuality quality = EncodeQuality::Balanced);
 
 std::string_view gctex_version();
 
@@ -0,0 +1,485 @@
+#include "Palette.hpp"
+
+#include <librii/image/ImagePlatform.hpp>
+
+#include <rsl/ThreadPool.hpp>
+
+#include <algorithm>
+#include <queue>
+
+IMPORT_STD;
+
+namespace librii::image {
+
+namespace {
+
+// Below this many items, spinning up threads costs more than it saves
+constexpr size_t ParallelThreshold = 1 << 15;
+
+// Pool for a data-parallel loop over |n| items, or nullptr to run serially.
+// Inside another pool (e.g. batch texture import) we stay on the calling
+// thread rather than oversubscribe.
+std::unique_ptr<rsl::ThreadPool> MakePool(size_t n) {
+  if (n < ParallelThreshold || rsl::ThreadPool::current() != nullptr) {
+    return nullptr;
+  }
+  return std::make_unique<rsl::ThreadPool>();
+}
+
+// Calls job(chunk, begin, end) over [0, n) in chunks of |chunk_size|
+template <typename F>
+void ForEachChunk(rsl::ThreadPool* pool, size_t n, size_t chunk_size, F&& job) {
+  for (size_t i = 0, begin = 0; begin < n; ++i, begin += chunk_size) {
+    const size_t end = std::min(n, begin + chunk_size);
+    if (pool != nullptr) {
+      pool->submit([&job, i, begin, end] { job(i, begin, end); });
+    } else {
+      job(i, begin, end);
+    }
+  }
+  if (pool != nullptr) {
+    pool->wait();
+  }
+}
+
+size_t NumChunks(size_t n, size_t chunk_size) {
+  return (n + chunk_size - 1) / chunk_size;
+}
+
+u32 Pack(u32 r, u32 g, u32 b, u32 a) {
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+u32 Channel(u32 c, int i) { return (c >> (i * 8)) & 0xff; }
+
+u32 Quantize(u32 v, u32 max) { return (v * max + 127) / 255; }
+u32 Expand3(u32 v) { return (v << 5) | (v << 2) | (v >> 1); }
+u32 Expand4(u32 v) { return (v << 4) | v; }
+u32 Expand5(u32 v) { return (v << 3) | (v >> 2); }
+u32 Expand6(u32 v) { return (v << 2) | (v >> 4); }
+
+u32 Intensity(u32 c) {
+  return (Channel(c, 0) * 77 + Channel(c, 1) * 150 + Channel(c, 2) * 29 + 128) >>
+         8;
+}
+bool IsOpaque5A3(u32 c) { return Quantize(Channel(c, 3), 7) == 7; }
+
+// Rounds |c| to the nearest color the TLUT can represent
+u32 Snap(u32 c, gx::PaletteFormat format) {
+  const u32 r = Channel(c, 0), g = Channel(c, 1), b = Channel(c, 2),
+            a = Channel(c, 3);
+  switch (format) {
+  case gx::PaletteFormat::IA8: {
+    const u32 i = Intensity(c);
+    return Pack(i, i, i, a);
+  }
+  case gx::PaletteFormat::RGB565:
+    return Pack(Expand5(Quantize(r, 31)), Expand6(Quantize(g, 63)),
+                Expand5(Quantize(b, 31)), 0xff);
+  case gx::PaletteFormat::RGB5A3:
+    if (IsOpaque5A3(c)) {
+      return Pack(Expand5(Quantize(r, 31)), Expand5(Quantize(g, 31)),
+                  Expand5(Quantize(b, 31)), 0xff);
+    }
+    return Pack(Expand4(Quantize(r, 15)), Expand4(Quantize(g, 15)),
+                Expand4(Quantize(b, 15)), Expand3(Quantize(a, 7)));
+  }
+  return c;
+}
+
+u16 ToTlutEntry(u32 c, gx::PaletteFormat format) {
+  const u32 r = Channel(c, 0), g = Channel(c, 1), b = Channel(c, 2),
+            a = Channel(c, 3);
+  switch (format) {
+  case gx::PaletteFormat::IA8:
+    return static_cast<u16>((a << 8) | Intensity(c));
+  case gx::PaletteFormat::RGB565:
+    return static_cast<u16>((Quantize(r, 31) << 11) | (Quantize(g, 63) << 5) |
+                            Quantize(b, 31));
+  case gx::PaletteFormat::RGB5A3:
+    if (IsOpaque5A3(c)) {
+      return static_cast<u16>(0x8000 | (Quantize(r, 31) << 10) |
+                              (Quantize(g, 31) << 5) | Quantize(b, 31));
+    }
+    return static_cast<u16>((Quantize(a, 7) << 12) | (Quantize(r, 15) << 8) |
+                            (Quantize(g, 15) << 4) | Quantize(b, 15));
+  }
+  return 0;
+}
+
+u32 Distance(u32 x, u32 y) {
+  u32 d = 0;
+  for (int i = 0; i < 4; ++i) {
+    const s32 delta = static_cast<s32>(Channel(x, i)) -
+                      static_cast<s32>(Channel(y, i));
+    d += static_cast<u32>(delta * delta);
+  }
+  return d;
+}
+
+// A distinct source color and how many pixels use it
+struct HistogramEntry {
+  u32 color;
+  u32 weight;
+};
+
+std::vector<HistogramEntry> BuildHistogram(std::span<const u8> rgba,
+                                           gx::PaletteFormat format) {
+  std::vector<u32> keys(rgba.size() / 4);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = Snap(Pack(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2],
+                        rgba[i * 4 + 3]),
+                   format);
+  }
+  std::ranges::sort(keys);
+
+  std::vector<HistogramEntry> hist;
+  for (size_t i = 0; i < keys.size();) {
+    size_t j = i;
+    while (j < keys.size() && keys[j] == keys[i]) {
+      ++j;
+    }
+    hist.push_back({keys[i], static_cast<u32>(j - i)});
+    i = j;
+  }
+  return hist;
+}
+
+// Weighted mean of a run of histogram entries
+u32 Centroid(std::span<const HistogramEntry> entries) {
+  std::array<u64, 4> sum{};
+  u64 total = 0;
+  for (auto& e : entries) {
+    for (int i = 0; i < 4; ++i) {
+      sum[i] += u64(Channel(e.color, i)) * e.weight;
+    }
+    total += e.weight;
+  }
+  std::array<u32, 4> mean{};
+  for (int i = 0; i < 4; ++i) {
+    mean[i] = static_cast<u32>((sum[i] + total / 2) / std::max<u64>(total, 1));
+  }
+  return Pack(mean[0], mean[1], mean[2], mean[3]);
+}
+
+// Heckbert's median cut: repeatedly split the box with the largest squared
+// error along its widest channel, at the weighted median.
+//
+// Reorders |hist|; writes the box of each entry to |assignment|.
+std::vector<u32> MedianCut(std::vector<HistogramEntry>& hist, u32 max_colors,
+                           std::vector<u16>& assignment) {
+  struct Box {
+    u32 begin;
+    u32 end;
+    int axis;
+    double error;
+    bool operator<(const Box& rhs) const { return error < rhs.error; }
+  };
+  auto make_box = [&](u32 begin, u32 end) {
+    std::array<double, 4> sum{}, sum_sq{};
+    double total = 0.0;
+    for (u32 i = begin; i < end; ++i) {
+      for (int c = 0; c < 4; ++c) {
+        const double v = Channel(hist[i].color, c);
+        sum[c] += v * hist[i].weight;
+        sum_sq[c] += v * v * hist[i].weight;
+      }
+      total += hist[i].weight;
+    }
+    Box box{.begin = begin, .end = end, .axis = 0, .error = 0.0};
+    if (end - begin < 2) {
+      return box;
+    }
+    for (int c = 0; c < 4; ++c) {
+      const double error = sum_sq[c] - sum[c] * sum[c] / total;
+      if (error > box.error) {
+        box.axis = c;
+        box.error = error;
+      }
+    }
+    return box;
+  };
+
+  std::priority_queue<Box> queue;
+  std::vector<Box> done;
+  queue.push(make_box(0, static_cast<u32>(hist.size())));
+  while (!queue.empty() && queue.size() + done.size() < max_colors) {
+    const Box box = queue.top();
+    queue.pop();
+    if (box.error <= 0.0) {
+      done.push_back(box);
+      continue;
+    }
+    auto first = hist.begin() + box.begin;
+    auto last = hist.begin() + box.end;
+    std::sort(first, last, [axis = box.axis](auto& l, auto& r) {
+      return Channel(l.color, axis) < Channel(r.color, axis);
+    });
+    u64 total = 0;
+    for (auto it = first; it != last; ++it) {
+      total += it->weight;
+    }
+    // First entry past half the weight, keeping both halves non-empty
+    u32 split = box.begin + 1;
+    for (u64 acc = hist[box.begin].weight; split < box.end - 1; ++split) {
+      if (acc * 2 >= total) {
+        break;
+      }
+      acc += hist[split].weight;
+    }
+    queue.push(make_box(box.begin, split));
+    queue.push(make_box(split, box.end));
+  }
+  for (; !queue.empty(); queue.pop()) {
+    done.push_back(queue.top());
+  }
+  // Deterministic palette order, regardless of split order
+  std::ranges::sort(done, {}, &Box::begin);
+
+  std::vector<u32> colors;
+  assignment.resize(hist.size());
+  for (auto& box : done) {
+    const auto index = static_cast<u16>(colors.size());
+    colors.push_back(Centroid(
+        std::span(hist).subspan(box.begin, box.end - box.begin)));
+    std::fill(assignment.begin() + box.begin, assignment.begin() + box.end,
+              index);
+  }
+  return colors;
+}
+
+// Lloyd's algorithm over the histogram, starting from |colors|. Each
+// iteration snaps the centroids to TLUT precision, so the final assignment
+// is against colors the hardware will actually produce.
+void KMeans(std::span<const HistogramEntry> hist, std::vector<u32>& colors,
+            std::vector<u16>& assignment, int max_iterations,
+            gx::PaletteFormat format) {
+  const size_t k = colors.size();
+  // Struct-of-arrays, so the distance loop vectorizes
+  std::vector<s32> pr(k), pg(k), pb(k), pa(k);
+  auto load_palette = [&] {
+    for (size_t j = 0; j < k; ++j) {
+      pr[j] = Channel(colors[j], 0);
+      pg[j] = Channel(colors[j], 1);
+      pb[j] = Channel(colors[j], 2);
+      pa[j] = Channel(colors[j], 3);
+    }
+  };
+
+  struct ClusterSum {
+    std::array<u64, 4> sum{};
+    u64 weight = 0;
+  };
+  constexpr size_t ChunkSize = 4096;
+  const size_t num_chunks = NumChunks(hist.size(), ChunkSize);
+  std::vector<std::vector<ClusterSum>> sums(num_chunks);
+  std::vector<size_t> changes(num_chunks);
+  auto pool = MakePool(hist.size() * k / 16);
+
+  for (int iteration = 0;; ++iteration) {
+    load_palette();
+    ForEachChunk(pool.get(), hist.size(), ChunkSize,
+                 [&](size_t chunk, size_t begin, size_t end) {
+                   std::vector<s32> dist(k);
+                   auto& local = sums[chunk];
+                   local.assign(k, {});
+                   changes[chunk] = 0;
+                   for (size_t i = begin; i < end; ++i) {
+                     const s32 r = Channel(hist[i].color, 0);
+                     const s32 g = Channel(hist[i].color, 1);
+                     const s32 b = Channel(hist[i].color, 2);
+                     const s32 a = Channel(hist[i].color, 3);
+                     for (size_t j = 0; j < k; ++j) {
+                       const s32 dr = pr[j] - r, dg = pg[j] - g,
+                                 db = pb[j] - b, da = pa[j] - a;
+                       dist[j] = dr * dr + dg * dg + db * db + da * da;
+                     }
+                     const auto best = static_cast<u16>(
+                         std::ranges::min_element(dist) - dist.begin());
+                     changes[chunk] += assignment[i] != best;
+                     assignment[i] = best;
+                     auto& s = local[best];
+                     for (int c = 0; c < 4; ++c) {
+                       s.sum[c] += u64(Channel(hist[i].color, c)) *
+                                   hist[i].weight;
+                     }
+                     s.weight += hist[i].weight;
+                   }
+                 });
+    const size_t changed = std::accumulate(changes.begin(), changes.end(),
+                                           size_t{0});
+    if ((iteration > 0 && changed == 0) || iteration == max_iterations) {
+      break;
+    }
+    for (size_t j = 0; j < k; ++j) {
+      ClusterSum total;
+      for (auto& local : sums) {
+        for (int c = 0; c < 4; ++c) {
+          total.sum[c] += local[j].sum[c];
+        }
+        total.weight += local[j].weight;
+      }
+      // Empty clusters keep their color
+      if (total.weight == 0) {
+        continue;
+      }
+      std::array<u32, 4> mean{};
+      for (int c = 0; c < 4; ++c) {
+        mean[c] =
+            static_cast<u32>((total.sum[c] + total.weight / 2) / total.weight);
+      }
+      colors[j] = Snap(Pack(mean[0], mean[1], mean[2], mean[3]), format);
+    }
+  }
+}
+
+int KMeansIterations(EncodeQuality quality) {
+  switch (quality) {
+  case EncodeQuality::Fast:
+    return 0;
+  case EncodeQuality::Balanced:
+    return 4;
+  case EncodeQuality::Best:
+    return 64;
+  }
+  return 0;
+}
+
+} // namespace
+
+u32 getPaletteCapacity(gx::TextureFormat format) {
+  switch (format) {
+  case gx::TextureFormat::C4:
+    return 16;
+  case gx::TextureFormat::C8:
+    return 256;
+  case gx::TextureFormat::C14X2:
+    return 16384;
+  default:
+    return 0;
+  }
+}
+
+u16 Palette::lookup(u32 rgba) const {
+  const u32 key = Snap(rgba, format);
+  if (auto it = std::ranges::lower_bound(keys, key);
+      it != keys.end() && *it == key) {
+    return indices[it - keys.begin()];
+  }
+  u16 best = 0;
+  for (size_t i = 0; i < colors.size(); ++i) {
+    if (Distance(colors[i], key) < Distance(colors[best], key)) {
+      best = static_cast<u16>(i);
+    }
+  }
+  return best;
+}
+
+Palette quantize(std::span<const u8> rgba, u32 max_colors,
+                 gx::PaletteFormat tlutformat, EncodeQuality quality) {
+  assert(max_colors > 0 && max_colors <= 16384);
+  Palette palette;
+  palette.format = tlutformat;
+
+  auto hist = BuildHistogram(rgba, tlutformat);
+  std::vector<u16> assignment;
+  if (hist.size() <= max_colors) {
+    // Lossless
+    for (auto& e : hist) {
+      assignment.push_back(static_cast<u16>(palette.colors.size()));
+      palette.colors.push_back(e.color);
+    }
+  } else {
+    palette.colors = MedianCut(hist, max_colors, assignment);
+    for (auto& c : palette.colors) {
+      c = Snap(c, tlutformat);
+    }
+    // Searching 16K colors per histogram entry isn't viable; C14X2 keeps the
+    // median cut boxes.
+    if (max_colors <= 256) {
+      KMeans(hist, palette.colors, assignment, KMeansIterations(quality),
+             tlutformat);
+    }
+  }
+
+  std::vector<u32> order(hist.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::sort(order, {}, [&](u32 i) { return hist[i].color; });
+  palette.keys.reserve(hist.size());
+  palette.indices.reserve(hist.size());
+  for (u32 i : order) {
+    palette.keys.push_back(hist[i].color);
+    palette.indices.push_back(assignment[i]);
+  }
+  return palette;
+}
+
+void encodeTlut(std::span<u8> dst, const Palette& palette) {
+  std::ranges::fill(dst, 0);
+  for (size_t i = 0; i < palette.colors.size() && i * 2 + 1 < dst.size();
+       ++i) {
+    const u16 entry = ToTlutEntry(palette.colors[i], palette.format);
+    dst[i * 2] = static_cast<u8>(entry >> 8);
+    dst[i * 2 + 1] = static_cast<u8>(entry & 0xff);
+  }
+}
+
+Result<void> encodeIndices(std::span<u8> dst, std::span<const u8> src,
+                           int width, int height, gx::TextureFormat texformat,
+                           const Palette& palette) {
+  EXPECT(gx::IsPaletteFormat(texformat));
+  EXPECT(width > 0 && height > 0);
+  EXPECT(palette.colors.size() <= getPaletteCapacity(texformat));
+  EXPECT(src.size() >= static_cast<size_t>(width) * height * 4);
+  EXPECT(dst.size() >= static_cast<size_t>(getEncodedSize(width, height,
+                                                          texformat)));
+
+  // Every block is 32 bytes
+  const int block_w = texformat == gx::TextureFormat::C14X2 ? 4 : 8;
+  const int block_h = texformat == gx::TextureFormat::C4 ? 8 : 4;
+  const int blocks_x = (width + block_w - 1) / block_w;
+  const int blocks_y = (height + block_h - 1) / block_h;
+
+  auto encode_row = [&](size_t, size_t begin, size_t end) {
+    // Runs of a single color are common; skip their lookups
+    u32 last_color = 0;
+    u16 last_index = palette.lookup(0);
+    for (size_t by = begin; by < end; ++by) {
+      u8* block = dst.data() + by * blocks_x * 32;
+      for (int bx = 0; bx < blocks_x; ++bx, block += 32) {
+        std::fill_n(block, 32, 0);
+        for (int y = 0; y < block_h; ++y) {
+          for (int x = 0; x < block_w; ++x) {
+            // Padding repeats the edge
+            const int px = std::min(bx * block_w + x, width - 1);
+            const int py = std::min(static_cast<int>(by) * block_h + y,
+                                    height - 1);
+            const u8* p = src.data() + (py * width + px) * 4;
+            const u32 color = Pack(p[0], p[1], p[2], p[3]);
+            if (color != last_color) {
+              last_color = color;
+              last_index = palette.lookup(color);
+            }
+            const int i = y * block_w + x;
+            switch (texformat) {
+            case gx::TextureFormat::C4:
+              block[i / 2] |= (last_index & 0xf) << (i % 2 == 0 ? 4 : 0);
+              break;
+            case gx::TextureFormat::C8:
+              block[i] = static_cast<u8>(last_index);
+              break;
+            default:
+              block[i * 2] = static_cast<u8>((last_index >> 8) & 0x3f);
+              block[i * 2 + 1] = static_cast<u8>(last_index & 0xff);
+              break;
+            }
+          }
+        }
+      }
+    }
+  };
+  auto pool = MakePool(static_cast<size_t>(width) * height);
+  ForEachChunk(pool.get(), blocks_y, 8, encode_row);
+  return {};
+}
+
+} // namespace librii::image
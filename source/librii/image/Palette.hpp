@@ -0,0 +1,75 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <span>
+#include <vector>
+
+#include <librii/gx.h>
+#include <librii/image/ImagePlatform.hpp>
+
+namespace librii::image {
+
+//! @brief Number of TLUT entries addressable by a palette format.
+//!
+//! @return 16 for C4, 256 for C8, 16384 for C14X2 and 0 otherwise.
+//!
+[[nodiscard]] u32 getPaletteCapacity(gx::TextureFormat format);
+
+//! @brief A quantized color table and the mapping of source colors onto it.
+//!
+struct Palette {
+  gx::PaletteFormat format = gx::PaletteFormat::IA8;
+  //! Packed 8-bit RGBA (R in the low byte), already at TLUT precision.
+  std::vector<u32> colors;
+  //! Every source color seen by the quantizer, at TLUT precision, sorted.
+  std::vector<u32> keys;
+  //! Palette index of each entry of keys.
+  std::vector<u16> indices;
+
+  //! @brief Palette index for an 8-bit RGBA color. Colors the quantizer did
+  //! not see fall back to a nearest-color search.
+  //!
+  [[nodiscard]] u16 lookup(u32 rgba) const;
+};
+
+//! @brief Build a palette for raw 8-bit RGBA pixels.
+//!
+//! @param[in] rgba        Pixels to quantize. May span several images (e.g.
+//! every level of detail), which then share the palette.
+//! @param[in] max_colors  Palette size. See getPaletteCapacity.
+//! @param[in] tlutformat  Precision of the palette entries.
+//! @param[in] quality     Fast: median cut only. Balanced: a few rounds of
+//! k-means refinement. Best: k-means until it converges. k-means is only
+//! performed for palettes of up to 256 colors.
+//!
+//! @return A palette of at most max_colors entries. Images with no more
+//! distinct colors (at TLUT precision) than that are represented exactly.
+//!
+[[nodiscard]] Palette quantize(std::span<const u8> rgba, u32 max_colors,
+                               gx::PaletteFormat tlutformat,
+                               EncodeQuality quality);
+
+//! @brief Encode a palette as TLUT data.
+//!
+//! @param[in] dst     Destination. Every entry past the palette is zeroed.
+//! @param[in] palette Palette to encode.
+//!
+void encodeTlut(std::span<u8> dst, const Palette& palette);
+
+//! @brief Encode raw 8-bit RGBA pixels as C4, C8 or C14X2 indices.
+//!
+//! @param[in] dst       Destination, sized for the blocked image.
+//! @param[in] src       Source pixels, width * height * 4 bytes.
+//! @param[in] width     Width of the image in pixels.
+//! @param[in] height    Height of the image in pixels.
+//! @param[in] texformat C4, C8 or C14X2.
+//! @param[in] palette   Palette to index. Must fit the format.
+//!
+[[nodiscard]] Result<void> encodeIndices(std::span<u8> dst,
+                                         std::span<const u8> src, int width,
+                                         int height,
+                                         gx::TextureFormat texformat,
+                                         const Palette& palette);
+
+} // namespace librii::image
@@ -10,6 +10,8 @@
 
 #include <LibBadUIFramework/Plugins.hpp> // LightIOTransaction
 
+#include <rsl/Interner.hpp>
+
 namespace librii::j3d {
 
 struct TevOrder {
@@ -57,7 +59,7 @@ struct Indirect {
   bool operator==(const Indirect& rhs) const noexcept = default;
 };
 struct MatCache {
-  template <typename T> using Section = std::vector<T>;
+  template <typename T> using Section = rsl::Interner<T>;
   Section<Indirect> indirectInfos;
   Section<librii::gx::CullMode> cullModes;
   Section<librii::gx::Color> matColors;
@@ -91,14 +93,11 @@ struct MatCache {
   bool operator==(const MatCache&) const = default;
 
   void clear() { *this = MatCache{}; }
-  template <typename T>
-  void update_section(std::vector<T>& sec, const T& data) {
-    if (std::find(sec.begin(), sec.end(), data) == sec.end()) {
-      sec.push_back(data);
-    }
+  template <typename T> void update_section(Section<T>& sec, const T& data) {
+    sec.intern(data);
   }
   template <typename T, typename U>
-  void update_section_multi(std::vector<T>& sec, const U& source) {
+  void update_section_multi(Section<T>& sec, const U& source) {
     for (int i = 0; i < source.size(); ++i) {
       update_section(sec, source[i]);
     }
@@ -105,18 +105,33 @@ processModelForWrite(BMDExportContext& model,
 
   libcube::GCMaterialData::SamplerData samp;
 
+  // Samplers by texture name, in material order
+  using SamplerList = std::vector<libcube::GCMaterialData::SamplerData*>;
+  std::unordered_map<std::string, SamplerList> samplersByTexture;
+  for (auto& mat : model.mdl.materials) {
+    if (model.mdl.textures.empty()) {
+      break;
+    }
+    for (int i = 0; i < mat.samplers.size(); ++i) {
+      auto& csamp = mat.samplers[i];
+      EXPECT(!csamp.mTexture.empty());
+      samplersByTexture[csamp.mTexture].push_back(&csamp);
+    }
+  }
+
+  // Tex::operator== compares btiId, so only entries of the same texture merge
+  struct TexHash {
+    std::size_t operator()(const Tex& tex) const {
+      return std::hash<s32>{}(tex.btiId);
+    }
+  };
+  rsl::Interner<Tex, TexHash> texPool;
   for (size_t i = 0; i < model.mdl.textures.size(); ++i) {
     auto& tex = model.mdl.textures[i];
-    std::vector<libcube::GCMaterialData::SamplerData*> its;
-    for (auto& mat : model.mdl.materials) {
-      for (int i = 0; i < mat.samplers.size(); ++i) {
-        auto& csamp = mat.samplers[i];
-        EXPECT(!csamp.mTexture.empty());
-
-        if (csamp.mTexture == tex.name) {
-          its.push_back(&csamp);
-        }
-      }
+    SamplerList its;
+    if (auto found = samplersByTexture.find(tex.name);
+        found != samplersByTexture.end()) {
+      its = found->second;
     }
     // Include unused textures
     if (its.empty()) {
@@ -129,17 +144,12 @@ processModelForWrite(BMDExportContext& model,
       Tex tmp(tex, samp);
       tmp.btiId = i;
 
-      auto found = std::find(texCache.begin(), texCache.end(), tmp);
-      if (found == texCache.end()) {
-        texCache.push_back(tmp);
-        if (it)
-          it->btiId = texCache.size() - 1;
-      } else {
-        if (it)
-          it->btiId = found - texCache.begin();
-      }
+      const u32 index = texPool.intern(tmp).first;
+      if (it)
+        it->btiId = index;
     }
   }
+  texCache = texPool.values();
 
   for (auto& mat : model.mdl.materials) {
     matCache.propagate(mat);
@@ -584,23 +584,15 @@ public:
   }
 
   u32 append(const T& entry) {
-    const auto found = std::find(mEntries.begin(), mEntries.end(), entry);
-    if (found == mEntries.end() || !compress) {
+    if (!compress) {
       mEntries.push_back(entry);
       return mEntries.size() - 1;
     }
-    return found - mEntries.begin();
+    return mEntries.intern(entry).first;
   }
   int find(const T& entry) const {
-    int outIdx = -1;
-    for (int i = 0; i < mEntries.size(); ++i)
-      if (entry == mEntries[i]) {
-        outIdx = i;
-        break;
-      }
-    // Intentionally complete
-    // TODO: rfind
-    return outIdx;
+    auto found = mEntries.find(entry);
+    return found ? static_cast<int>(*found) : -1;
   }
   u32 getNumEntries() const { return mEntries.size(); }
   const T& getEntry(u32 idx) const {
@@ -613,7 +605,7 @@ public:
   }
 
 public:
-  std::vector<T> mEntries;
+  rsl::Interner<T, std::hash<T>> mEntries;
 };
 struct MAT3Node;
 struct SerializableMaterial {
@@ -625,16 +617,21 @@ struct SerializableMaterial {
 
   bool operator==(const SerializableMaterial& rhs) const noexcept;
 };
+} // namespace librii::j3d
+
+// Equal materials have equal names, which are almost always unique
+template <> struct std::hash<librii::j3d::SerializableMaterial> {
+  std::size_t operator()(const librii::j3d::SerializableMaterial& smat) const;
+};
+
+namespace librii::j3d {
 auto find = [](const auto& buf, const auto x) {
-  auto found = std::find(buf.begin(), buf.end(), x);
-  // if (found == buf.end()) {
-  // 	buf.push_back(x);
-  // }
-  assert(found != buf.end());
-  if (found == buf.end()) {
+  auto found = buf.find(x);
+  assert(found);
+  if (!found) {
     printf("Invalid data entry not cached.\n");
   }
-  return found == buf.end() ? -1 : found - buf.begin();
+  return found ? static_cast<int>(*found) : -1;
 };
 template <typename TIdx, typename T, typename TPool>
 void write_array_vec(oishii::Writer& writer, const T& vec, TPool& pool) {
@@ -644,7 +641,7 @@ void write_array_vec(oishii::Writer& writer, const T& vec, TPool& pool) {
     writer.write<TIdx>(-1);
 }
 template <typename T>
-int write_cache(oishii::Writer& writer, const std::vector<T>& cache) {
+int write_cache(oishii::Writer& writer, const MatCache::Section<T>& cache) {
   // while (writer.tell() % io_wrapper<T>::SizeOf) writer.write(0xff);
   const auto start = writer.tell();
   for (auto& x : cache) {
@@ -825,6 +822,15 @@ struct MAT3Node : public oishii::Node {
     return {};
   }
 };
+} // namespace librii::j3d
+
+std::size_t std::hash<librii::j3d::SerializableMaterial>::operator()(
+    const librii::j3d::SerializableMaterial& smat) const {
+  return std::hash<std::string>{}(smat.mMAT3.mMdl.materials[smat.mIdx].name);
+}
+
+namespace librii::j3d {
+
 bool SerializableMaterial::operator==(
     const SerializableMaterial& rhs) const noexcept {
   Material a;
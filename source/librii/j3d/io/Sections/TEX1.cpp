@@ -198,12 +198,9 @@ Result<void> readTEX1(BMDOutputContext& ctx) {
     UniqueImage(u32 ofs, int idx) : offset(ofs), bti_index(idx) {}
   };
   std::vector<UniqueImage> uniques;
+  rsl::Interner<u32> offsets;
   for (int i = 0; i < size; ++i) {
-    const auto found =
-        std::find_if(uniques.begin(), uniques.end(), [&](const auto& it) {
-          return it.offset == texRaw[i].absolute_file_offset;
-        });
-    if (found == uniques.end())
+    if (offsets.intern(texRaw[i].absolute_file_offset).second)
       uniques.emplace_back(texRaw[i].absolute_file_offset, i);
   }
 
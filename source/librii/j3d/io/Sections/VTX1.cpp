@@ -196,18 +196,14 @@ Result<void> readVTX1(BMDOutputContext& ctx) {
         auto pos = reinterpret_cast<decltype(ctx.mdl.vertexData.pos)*>(buf);
 
         pos->mData.resize(ensize);
-        for (int i = 0; i < ensize; ++i) {
-          TRY(pos->readBufferEntryGeneric(reader.getUnsafe(), pos->mData[i]));
-        }
+        TRY(pos->readBuffer(reader.getUnsafe()));
         break;
       }
       case VBufferKind::normal: {
         auto nrm = reinterpret_cast<decltype(ctx.mdl.vertexData.norm)*>(buf);
 
         nrm->mData.resize(ensize);
-        for (int i = 0; i < ensize; ++i) {
-          TRY(nrm->readBufferEntryGeneric(reader.getUnsafe(), nrm->mData[i]));
-        }
+        TRY(nrm->readBuffer(reader.getUnsafe()));
         break;
       }
       case VBufferKind::color: {
@@ -216,9 +212,7 @@ Result<void> readVTX1(BMDOutputContext& ctx) {
                 buf);
 
         clr->mData.resize(ensize);
-        for (int i = 0; i < ensize; ++i) {
-          TRY(clr->readBufferEntryColor(reader.getUnsafe(), clr->mData[i]));
-        }
+        TRY(clr->readBuffer(reader.getUnsafe()));
         break;
       }
       case VBufferKind::textureCoordinate: {
@@ -226,9 +220,7 @@ Result<void> readVTX1(BMDOutputContext& ctx) {
             reinterpret_cast<decltype(ctx.mdl.vertexData.uv)::value_type*>(buf);
 
         uv->mData.resize(ensize);
-        for (int i = 0; i < ensize; ++i) {
-          TRY(uv->readBufferEntryGeneric(reader.getUnsafe(), uv->mData[i]));
-        }
+        TRY(uv->readBuffer(reader.getUnsafe()));
         break;
       }
       }
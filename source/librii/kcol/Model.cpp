@@ -1,7 +1,10 @@
 #include "Model.hpp"
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <math.h>
 #include <nlohmann/json.hpp>
+#include <rsl/JsonStream.hpp>
 
 using json = nlohmann::json;
 
@@ -67,6 +70,118 @@ static SectionSizes GetSectionSizes(const KCollisionV1Header& header,
   return {pos_data_size, nrm_data_size, prism_data_size, block_data_size};
 }
 
+std::array<u32, 3> GetRootGridSize(const KCollisionData& data) {
+  if (data.block_width_shift < 0 || data.block_width_shift >= 32) {
+    return {0, 0, 0};
+  }
+  const u32 shift = data.block_width_shift;
+  return {(~data.area_x_width_mask >> shift) + 1,
+          (~data.area_y_width_mask >> shift) + 1,
+          (~data.area_z_width_mask >> shift) + 1};
+}
+
+namespace {
+
+// The file's octree: a root cube's entry is a u32 offset from the start of the
+// block data. With the high bit clear, it points to a group of eight child
+// entries, relative to the group holding the entry. With it set, it points to
+// a u16 list of 1-based prism indices, 0-terminated. The game skips the first
+// u16 before reading the list.
+class OctreeReader {
+public:
+  OctreeReader(std::span<const u8> block_data, size_t prism_count,
+               KCollisionOctree& out)
+      : mData(block_data), mPrismCount(prism_count), mOut(out) {}
+
+  Result<KCollisionOctree::Cell> readEntry(u32 group, u32 index, s32 shift) {
+    const u64 entry_pos = u64(group) + index * 4;
+    EXPECT(entry_pos + 4 <= mData.size(), "Octree entry out of bounds");
+    const u32 entry = rsl::load<u32>(mData, static_cast<unsigned>(entry_pos));
+    if (entry & 0x8000'0000) {
+      return readList(u64(group) + (entry & 0x7fff'ffff));
+    }
+    // Each level halves the cube; a branch below the 1-unit cube is corrupt
+    EXPECT(shift > 0, "Octree is too deep");
+    return readGroup(u64(group) + entry, shift - 1);
+  }
+
+private:
+  Result<KCollisionOctree::Cell> readList(u64 pos) {
+    if (auto it = mLists.find(pos); it != mLists.end()) {
+      return it->second;
+    }
+    KCollisionOctree::Cell cell{.first = static_cast<u32>(mOut.prisms.size())};
+    for (u64 i = pos + 2;; i += 2) {
+      EXPECT(i + 2 <= mData.size(), "Prism list out of bounds");
+      const u16 prism = rsl::load<u16>(mData, static_cast<unsigned>(i));
+      if (prism == 0) {
+        break;
+      }
+      EXPECT(prism - 1 < mPrismCount, "Invalid prism index in octree");
+      mOut.prisms.push_back(prism - 1);
+      ++cell.count;
+    }
+    mLists.emplace(pos, cell);
+    return cell;
+  }
+  Result<KCollisionOctree::Cell> readGroup(u64 pos, s32 shift) {
+    EXPECT(pos + 32 <= mData.size(), "Octree group out of bounds");
+    const u64 key = (pos << 5) | static_cast<u32>(shift);
+    if (auto it = mGroups.find(key); it != mGroups.end()) {
+      return KCollisionOctree::Cell{.first = it->second, .leaf = false};
+    }
+    const u32 first = static_cast<u32>(mOut.cells.size());
+    mOut.cells.resize(mOut.cells.size() + 8);
+    mGroups.emplace(key, first);
+    for (u32 i = 0; i < 8; ++i) {
+      const auto child = TRY(readEntry(static_cast<u32>(pos), i, shift));
+      mOut.cells[first + i] = child;
+    }
+    return KCollisionOctree::Cell{.first = first, .leaf = false};
+  }
+
+  std::span<const u8> mData;
+  size_t mPrismCount;
+  KCollisionOctree& mOut;
+  // File offset -> parsed list
+  std::unordered_map<u64, KCollisionOctree::Cell> mLists;
+  // (File offset, shift) -> first child
+  std::unordered_map<u64, u32> mGroups;
+};
+
+Result<KCollisionOctree> ReadOctree(std::span<const u8> block_data,
+                                    const KCollisionData& data) {
+  const auto [x_blocks, y_blocks, z_blocks] = GetRootGridSize(data);
+  EXPECT(x_blocks != 0, "Invalid block_width_shift");
+  EXPECT(data.area_x_blocks_shift >= 0 && data.area_x_blocks_shift < 32 &&
+             data.area_xy_blocks_shift >= 0 &&
+             data.area_xy_blocks_shift < 32,
+         "Invalid area block shifts");
+  const u64 last_root = (u64(z_blocks - 1) << data.area_xy_blocks_shift) |
+                        (u64(y_blocks - 1) << data.area_x_blocks_shift) |
+                        (x_blocks - 1);
+  EXPECT((last_root + 1) * 4 <= block_data.size(),
+         "Octree roots out of bounds");
+
+  KCollisionOctree octree;
+  octree.root_count = static_cast<u32>(last_root + 1);
+  octree.cells.resize(octree.root_count);
+  OctreeReader reader(block_data, data.prism_data.size(), octree);
+  for (u32 z = 0; z < z_blocks; ++z) {
+    for (u32 y = 0; y < y_blocks; ++y) {
+      for (u32 x = 0; x < x_blocks; ++x) {
+        const u32 root = (z << data.area_xy_blocks_shift) |
+                         (y << data.area_x_blocks_shift) | x;
+        octree.cells[root] =
+            TRY(reader.readEntry(0, root, data.block_width_shift));
+      }
+    }
+  }
+  return octree;
+}
+
+} // namespace
+
 Result<KCollisionData> ReadKCollisionData(std::span<const u8> bytes,
                                           u32 file_size) {
   KCollisionData data;
@@ -139,13 +254,181 @@ Result<KCollisionData> ReadKCollisionData(std::span<const u8> bytes,
     return std::unexpected("Bug in reading code");
   }
 
-  data.block_data = {bytes.data() + header->block_data_offset,
-                     bytes.data() + header->block_data_offset +
-                         sizes.block_data_size};
+  data.octree = TRY(ReadOctree(
+      bytes.subspan(header->block_data_offset, sizes.block_data_size), data));
 
   return data;
 }
 
+namespace {
+
+// Inverse of OctreeReader. Groups are laid out parents first, so that every
+// entry points forward, as the offsets are unsigned. Leaves over the same run
+// of |prisms| share a list, and each list's terminator doubles as the u16 the
+// game skips before the next.
+class OctreeWriter {
+public:
+  OctreeWriter(const KCollisionOctree& octree, size_t prism_count)
+      : mIn(octree), mPrismCount(prism_count) {}
+
+  Result<std::vector<u8>> write() {
+    EXPECT(mIn.root_count <= mIn.cells.size(), "Octree roots out of bounds");
+    for (u32 i = 0; i < mIn.root_count; ++i) {
+      TRY(visit(mIn.cells[i]));
+    }
+    std::reverse(mGroups.begin(), mGroups.end());
+
+    u32 pos = mIn.root_count * 4;
+    for (u32 first : mGroups) {
+      mGroupPos[first] = pos;
+      pos += 32;
+    }
+    // An empty list, then the non-empty lists
+    const u32 lists_pos = pos;
+    mOut.resize(lists_pos + 4);
+    for (u32 i = 0; i < mIn.root_count; ++i) {
+      TRY(placeList(mIn.cells[i], lists_pos));
+    }
+    for (u32 first : mGroups) {
+      for (u32 i = 0; i < 8; ++i) {
+        TRY(placeList(mIn.cells[first + i], lists_pos));
+      }
+    }
+
+    for (u32 i = 0; i < mIn.root_count; ++i) {
+      TRY(writeEntry(0, i, mIn.cells[i]));
+    }
+    for (u32 first : mGroups) {
+      for (u32 i = 0; i < 8; ++i) {
+        TRY(writeEntry(mGroupPos[first], i, mIn.cells[first + i]));
+      }
+    }
+    return std::move(mOut);
+  }
+
+private:
+  // Post-order over the groups below |cell|
+  Result<void> visit(const KCollisionOctree::Cell& cell) {
+    if (cell.leaf) {
+      EXPECT(u64(cell.first) + cell.count <= mIn.prisms.size(),
+             "Octree leaf out of bounds");
+      return {};
+    }
+    EXPECT(u64(cell.first) + 8 <= mIn.cells.size(),
+           "Octree branch out of bounds");
+    if (!mVisited.insert(cell.first).second) {
+      return {};
+    }
+    for (u32 i = 0; i < 8; ++i) {
+      TRY(visit(mIn.cells[cell.first + i]));
+    }
+    mGroups.push_back(cell.first);
+    return {};
+  }
+  Result<void> placeList(const KCollisionOctree::Cell& cell, u32 lists_pos) {
+    if (!cell.leaf) {
+      return {};
+    }
+    if (cell.count == 0) {
+      mListPos[0] = lists_pos;
+      return {};
+    }
+    const u64 key = (u64(cell.first) << 32) | cell.count;
+    if (mListPos.contains(key)) {
+      return {};
+    }
+    // The previous terminator is the skipped u16
+    const u32 pos = static_cast<u32>(mOut.size());
+    mListPos[key] = pos - 2;
+    mOut.resize(pos + (cell.count + 1) * 2);
+    for (u32 i = 0; i < cell.count; ++i) {
+      const u16 prism = mIn.prisms[cell.first + i];
+      EXPECT(prism < mPrismCount && prism < 0xffff,
+             "Invalid prism index in octree");
+      rsl::store<u16>(prism + 1, mOut, pos + i * 2);
+    }
+    rsl::store<u16>(0, mOut, pos + cell.count * 2);
+    return {};
+  }
+  Result<void> writeEntry(u32 group, u32 index,
+                          const KCollisionOctree::Cell& cell) {
+    u32 offset = 0;
+    if (cell.leaf) {
+      const u64 key =
+          cell.count == 0 ? 0 : (u64(cell.first) << 32) | cell.count;
+      offset = mListPos[key] - group;
+    } else {
+      const u32 child = mGroupPos[cell.first];
+      EXPECT(child > group, "Octree has a cycle");
+      offset = child - group;
+    }
+    EXPECT(offset < 0x8000'0000, "Octree is too large");
+    const u32 entry = cell.leaf ? 0x8000'0000 | offset : offset;
+    rsl::store<u32>(entry, mOut, group + index * 4);
+    return {};
+  }
+
+  const KCollisionOctree& mIn;
+  size_t mPrismCount;
+  std::vector<u8> mOut;
+  // First child of each group, parents first once reversed
+  std::vector<u32> mGroups;
+  std::set<u32> mVisited;
+  // First child -> offset of the group
+  std::unordered_map<u32, u32> mGroupPos;
+  // (first, count) -> offset the leaf entry points to
+  std::unordered_map<u64, u32> mListPos;
+};
+
+} // namespace
+
+Result<std::vector<u8>> WriteKCollisionData(const KCollisionData& data) {
+  EXPECT(data.octree.root_count != 0, "KCL has no octree");
+  const auto blocks =
+      TRY(OctreeWriter(data.octree, data.prism_data.size()).write());
+
+  const u32 pos_offset = sizeof(KCollisionV1Header);
+  const u32 nrm_offset = pos_offset + data.pos_data.size() * sizeof(Vector3f);
+  const u32 prism_offset =
+      nrm_offset + data.nrm_data.size() * sizeof(Vector3f);
+  const u32 block_offset =
+      prism_offset + data.prism_data.size() * sizeof(KCollisionPrismData);
+
+  std::vector<u8> out(block_offset + blocks.size());
+  const auto vec = [](const glm::vec3& v) {
+    return Vector3f{.x = v.x, .y = v.y, .z = v.z};
+  };
+  const KCollisionV1Header header{
+      .pos_data_offset = pos_offset,
+      .nrm_data_offset = nrm_offset,
+      // 1-indexed, as the reader expects
+      .prism_data_offset = prism_offset - sizeof(KCollisionPrismData),
+      .block_data_offset = block_offset,
+      .prism_thickness = data.prism_thickness,
+      .area_min_pos = vec(data.area_min_pos),
+      .area_x_width_mask = data.area_x_width_mask,
+      .area_y_width_mask = data.area_y_width_mask,
+      .area_z_width_mask = data.area_z_width_mask,
+      .block_width_shift = data.block_width_shift,
+      .area_x_blocks_shift = data.area_x_blocks_shift,
+      .area_xy_blocks_shift = data.area_xy_blocks_shift,
+      .sphere_radius = data.sphere_radius,
+  };
+  std::memcpy(out.data(), &header, sizeof(header));
+  for (size_t i = 0; i < data.pos_data.size(); ++i) {
+    const auto v = vec(data.pos_data[i]);
+    std::memcpy(out.data() + pos_offset + i * sizeof(v), &v, sizeof(v));
+  }
+  for (size_t i = 0; i < data.nrm_data.size(); ++i) {
+    const auto v = vec(data.nrm_data[i]);
+    std::memcpy(out.data() + nrm_offset + i * sizeof(v), &v, sizeof(v));
+  }
+  std::memcpy(out.data() + prism_offset, data.prism_data.data(),
+              data.prism_data.size() * sizeof(KCollisionPrismData));
+  std::copy(blocks.begin(), blocks.end(), out.begin() + block_offset);
+  return out;
+}
+
 constexpr std::array<char, 8> WiimmSZSIdentifier = {'W', 'i', 'i', 'm',
                                                     'm', 'S', 'Z', 'S'};
 
@@ -223,12 +506,34 @@ void from_json(const json& j, KCollisionPrismData& p) {
   p.attribute = static_cast<int>(j.at("attribute"));
 }
 
+void to_json(json& j, const KCollisionOctree::Cell& c) {
+  j = json{{"first", c.first}, {"count", c.count}, {"leaf", c.leaf}};
+}
+
+void from_json(const json& j, KCollisionOctree::Cell& c) {
+  j.at("first").get_to(c.first);
+  j.at("count").get_to(c.count);
+  j.at("leaf").get_to(c.leaf);
+}
+
+void to_json(json& j, const KCollisionOctree& o) {
+  j = json{{"cells", o.cells},
+           {"root_count", o.root_count},
+           {"prisms", o.prisms}};
+}
+
+void from_json(const json& j, KCollisionOctree& o) {
+  j.at("cells").get_to(o.cells);
+  j.at("root_count").get_to(o.root_count);
+  j.at("prisms").get_to(o.prisms);
+}
+
 // Convert KCollisionData to JSON
 void to_json(json& j, const KCollisionData& k) {
   j = json{{"pos_data", k.pos_data},
            {"nrm_data", k.nrm_data},
            {"prism_data", k.prism_data},
-           {"block_data", k.block_data},
+           {"octree", k.octree},
            {"prism_thickness", k.prism_thickness},
            {"area_min_pos", k.area_min_pos},
            {"area_x_width_mask", k.area_x_width_mask},
@@ -246,6 +551,9 @@ void from_json(const json& j, KCollisionData& k) {
   j.at("pos_data").get_to(k.pos_data);
   j.at("nrm_data").get_to(k.nrm_data);
   j.at("prism_data").get_to(k.prism_data);
+  if (j.contains("octree")) {
+    j.at("octree").get_to(k.octree);
+  }
   j.at("prism_thickness").get_to(k.prism_thickness);
   j.at("area_min_pos").get_to(k.area_min_pos);
   j.at("area_x_width_mask").get_to(k.area_x_width_mask);
@@ -269,4 +577,251 @@ KCollisionData LoadJSON(std::string_view map) {
   return kcl;
 }
 
+static void WriteVec3(rsl::JsonWriter& w, const glm::vec3& v) {
+  w.beginArray();
+  w.value(v.x);
+  w.value(v.y);
+  w.value(v.z);
+  w.endArray();
+}
+
+void WriteJSON(std::ostream& out, const KCollisionData& k) {
+  rsl::JsonWriter w(out);
+  w.beginObject();
+  w.key("pos_data");
+  w.beginArray();
+  for (const auto& v : k.pos_data) {
+    WriteVec3(w, v);
+  }
+  w.endArray();
+  w.key("nrm_data");
+  w.beginArray();
+  for (const auto& v : k.nrm_data) {
+    WriteVec3(w, v);
+  }
+  w.endArray();
+  w.key("prism_data");
+  w.beginArray();
+  for (const auto& p : k.prism_data) {
+    w.beginObject();
+    w.key("height");
+    w.value(static_cast<f32>(p.height));
+    w.key("pos_i");
+    w.value(static_cast<u16>(p.pos_i));
+    w.key("fnrm_i");
+    w.value(static_cast<u16>(p.fnrm_i));
+    w.key("enrm1_i");
+    w.value(static_cast<u16>(p.enrm1_i));
+    w.key("enrm2_i");
+    w.value(static_cast<u16>(p.enrm2_i));
+    w.key("enrm3_i");
+    w.value(static_cast<u16>(p.enrm3_i));
+    w.key("attribute");
+    w.value(static_cast<u16>(p.attribute));
+    w.endObject();
+  }
+  w.endArray();
+  w.key("octree");
+  w.beginObject();
+  w.key("cells");
+  w.beginArray();
+  for (const auto& c : k.octree.cells) {
+    w.beginObject();
+    w.key("first");
+    w.value(c.first);
+    w.key("count");
+    w.value(c.count);
+    w.key("leaf");
+    w.value(c.leaf);
+    w.endObject();
+  }
+  w.endArray();
+  w.key("root_count");
+  w.value(k.octree.root_count);
+  w.key("prisms");
+  w.beginArray();
+  for (u16 i : k.octree.prisms) {
+    w.value(i);
+  }
+  w.endArray();
+  w.endObject();
+  w.key("prism_thickness");
+  w.value(k.prism_thickness);
+  w.key("area_min_pos");
+  WriteVec3(w, k.area_min_pos);
+  w.key("area_x_width_mask");
+  w.value(k.area_x_width_mask);
+  w.key("area_y_width_mask");
+  w.value(k.area_y_width_mask);
+  w.key("area_z_width_mask");
+  w.value(k.area_z_width_mask);
+  w.key("block_width_shift");
+  w.value(k.block_width_shift);
+  w.key("area_x_blocks_shift");
+  w.value(k.area_x_blocks_shift);
+  w.key("area_xy_blocks_shift");
+  w.value(k.area_xy_blocks_shift);
+  w.key("sphere_radius");
+  w.value(k.sphere_radius);
+  w.key("version");
+  w.value(k.version);
+  w.endObject();
+}
+
+static Result<glm::vec3> ReadVec3(rsl::JsonPullReader& r) {
+  glm::vec3 v;
+  TRY(r.beginArray());
+  for (int i = 0; i < 3; ++i) {
+    if (!TRY(r.nextElement())) {
+      return std::unexpected("KCL JSON: Expected [x, y, z]");
+    }
+    v[i] = static_cast<f32>(TRY(r.readNumber()));
+  }
+  if (TRY(r.nextElement())) {
+    return std::unexpected("KCL JSON: Expected [x, y, z]");
+  }
+  return v;
+}
+
+static Result<std::vector<glm::vec3>> ReadVec3Array(rsl::JsonPullReader& r) {
+  std::vector<glm::vec3> result;
+  TRY(r.beginArray());
+  while (TRY(r.nextElement())) {
+    result.push_back(TRY(ReadVec3(r)));
+  }
+  return result;
+}
+
+template <typename T> static Result<T> ReadInt(rsl::JsonPullReader& r) {
+  const f64 x = TRY(r.readNumber());
+  if (!(x >= std::numeric_limits<T>::min() &&
+        x <= std::numeric_limits<T>::max() && x == std::trunc(x))) {
+    return std::unexpected(std::format("JSON: {} is not a valid integer", x));
+  }
+  return static_cast<T>(x);
+}
+
+static Result<KCollisionPrismData> ReadPrism(rsl::JsonPullReader& r) {
+  KCollisionPrismData p;
+  TRY(r.beginObject());
+  while (auto key = TRY(r.nextKey())) {
+    if (*key == "height") {
+      p.height = static_cast<f32>(TRY(r.readNumber()));
+    } else if (*key == "pos_i") {
+      p.pos_i = TRY(ReadInt<u16>(r));
+    } else if (*key == "fnrm_i") {
+      p.fnrm_i = TRY(ReadInt<u16>(r));
+    } else if (*key == "enrm1_i") {
+      p.enrm1_i = TRY(ReadInt<u16>(r));
+    } else if (*key == "enrm2_i") {
+      p.enrm2_i = TRY(ReadInt<u16>(r));
+    } else if (*key == "enrm3_i") {
+      p.enrm3_i = TRY(ReadInt<u16>(r));
+    } else if (*key == "attribute") {
+      p.attribute = TRY(ReadInt<u16>(r));
+    } else {
+      TRY(r.skipValue());
+    }
+  }
+  return p;
+}
+
+static Result<KCollisionOctree> ReadOctree(rsl::JsonPullReader& r) {
+  KCollisionOctree o;
+  TRY(r.beginObject());
+  while (auto key = TRY(r.nextKey())) {
+    if (*key == "cells") {
+      TRY(r.beginArray());
+      while (TRY(r.nextElement())) {
+        auto& c = o.cells.emplace_back();
+        TRY(r.beginObject());
+        while (auto field = TRY(r.nextKey())) {
+          if (*field == "first") {
+            c.first = TRY(ReadInt<u32>(r));
+          } else if (*field == "count") {
+            c.count = TRY(ReadInt<u32>(r));
+          } else if (*field == "leaf") {
+            c.leaf = TRY(r.readBool());
+          } else {
+            TRY(r.skipValue());
+          }
+        }
+      }
+    } else if (*key == "root_count") {
+      o.root_count = TRY(ReadInt<u32>(r));
+    } else if (*key == "prisms") {
+      TRY(r.beginArray());
+      while (TRY(r.nextElement())) {
+        o.prisms.push_back(TRY(ReadInt<u16>(r)));
+      }
+    } else {
+      TRY(r.skipValue());
+    }
+  }
+  return o;
+}
+
+Result<KCollisionData> ReadJSON(std::istream& in) {
+  rsl::JsonPullReader r(in);
+  KCollisionData k;
+  // Keys LoadJSON requires; the octree is optional
+  std::set<std::string> missing{"pos_data",
+                                "nrm_data",
+                                "prism_data",
+                                "prism_thickness",
+                                "area_min_pos",
+                                "area_x_width_mask",
+                                "area_y_width_mask",
+                                "area_z_width_mask",
+                                "block_width_shift",
+                                "area_x_blocks_shift",
+                                "area_xy_blocks_shift",
+                                "sphere_radius",
+                                "version"};
+  TRY(r.beginObject());
+  while (auto key = TRY(r.nextKey())) {
+    missing.erase(*key);
+    if (*key == "pos_data") {
+      k.pos_data = TRY(ReadVec3Array(r));
+    } else if (*key == "nrm_data") {
+      k.nrm_data = TRY(ReadVec3Array(r));
+    } else if (*key == "prism_data") {
+      TRY(r.beginArray());
+      while (TRY(r.nextElement())) {
+        k.prism_data.push_back(TRY(ReadPrism(r)));
+      }
+    } else if (*key == "octree") {
+      k.octree = TRY(ReadOctree(r));
+    } else if (*key == "prism_thickness") {
+      k.prism_thickness = static_cast<f32>(TRY(r.readNumber()));
+    } else if (*key == "area_min_pos") {
+      k.area_min_pos = TRY(ReadVec3(r));
+    } else if (*key == "area_x_width_mask") {
+      k.area_x_width_mask = TRY(ReadInt<u32>(r));
+    } else if (*key == "area_y_width_mask") {
+      k.area_y_width_mask = TRY(ReadInt<u32>(r));
+    } else if (*key == "area_z_width_mask") {
+      k.area_z_width_mask = TRY(ReadInt<u32>(r));
+    } else if (*key == "block_width_shift") {
+      k.block_width_shift = TRY(ReadInt<s32>(r));
+    } else if (*key == "area_x_blocks_shift") {
+      k.area_x_blocks_shift = TRY(ReadInt<s32>(r));
+    } else if (*key == "area_xy_blocks_shift") {
+      k.area_xy_blocks_shift = TRY(ReadInt<s32>(r));
+    } else if (*key == "sphere_radius") {
+      k.sphere_radius = static_cast<f32>(TRY(r.readNumber()));
+    } else if (*key == "version") {
+      k.version = TRY(r.readString());
+    } else {
+      TRY(r.skipValue());
+    }
+  }
+  TRY(r.expectEnd());
+  if (!missing.empty()) {
+    return std::unexpected(
+        std::format("KCL JSON: Missing key \"{}\"", *missing.begin()));
+  }
+  return k;
+}
+
 } // namespace librii::kcol
@@ -4,6 +4,7 @@
 #include <core/common.h>
 #include <glm/glm.hpp>
 #include <glm/vec3.hpp>
+#include <iosfwd>
 #include <rsl/SimpleReader.hpp>
 #include <span>
 #include <string>
@@ -93,11 +94,34 @@ using KclVersion =
 KclVersion InspectKclFile(std::span<const u8> kcl_file);
 std::string GetKCLVersion(KclVersion metadata);
 
+//! Spatial index over the prisms.
+//!
+//! The area is a grid of cubes, each 1 << block_width_shift wide and each the
+//! root of an octree. A leaf lists every prism the game tests for a point in
+//! it. Identical subtrees and lists in the file stay shared.
+struct KCollisionOctree {
+  struct Cell {
+    //! Branch: first of eight children in |cells|, ordered x | y << 1 | z << 2
+    //! Leaf: first prism in |prisms|
+    u32 first = 0;
+    //! Prisms in a leaf
+    u32 count = 0;
+    bool leaf = true;
+  };
+
+  //! The first |root_count| cells are the roots, indexed as in the game:
+  //! (z << area_xy_blocks_shift) | (y << area_x_blocks_shift) | x
+  std::vector<Cell> cells;
+  u32 root_count = 0;
+  //! Prism indices of all leaves, 0-based
+  std::vector<u16> prisms;
+};
+
 struct KCollisionData {
   std::vector<glm::vec3> pos_data;
   std::vector<glm::vec3> nrm_data;
   std::vector<KCollisionPrismData> prism_data;
-  std::vector<u8> block_data; // TODO: Binary blob, for now
+  KCollisionOctree octree;
   float prism_thickness = 300.0f;
   glm::vec3 area_min_pos;
 
@@ -116,6 +140,11 @@ struct KCollisionData {
 
 Result<KCollisionData> ReadKCollisionData(std::span<const u8> bytes,
                                           u32 file_size);
+//! Inverse of ReadKCollisionData. Fails if the octree does not index the data.
+Result<std::vector<u8>> WriteKCollisionData(const KCollisionData& data);
+
+//! Root cubes along each axis, as implied by the area masks
+std::array<u32, 3> GetRootGridSize(const KCollisionData& data);
 
 static inline std::array<glm::vec3, 3>
 FromPrism(const KCollisionData& data, const KCollisionPrismData& prism) {
@@ -127,4 +156,9 @@ FromPrism(const KCollisionData& data, const KCollisionPrismData& prism) {
 std::string DumpJSON(const KCollisionData& map);
 KCollisionData LoadJSON(std::string_view map);
 
+//! As DumpJSON, written to |out| as it is produced
+void WriteJSON(std::ostream& out, const KCollisionData& map);
+//! As LoadJSON, reading values straight into the arrays: no document is built
+Result<KCollisionData> ReadJSON(std::istream& in);
+
 } // namespace librii::kcol
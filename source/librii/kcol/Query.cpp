@@ -0,0 +1,567 @@
+#include "Query.hpp"
+
+#include <rsl/Simd.hpp>
+#include <rsl/ThreadPool.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+IMPORT_STD;
+
+namespace librii::kcol {
+
+namespace {
+
+// Rays per task when casting in parallel
+constexpr size_t RayChunkSize = 4096;
+// Below this many rays, spinning up threads costs more than it saves
+constexpr size_t ParallelThreshold = 2 * RayChunkSize;
+
+// Rejects rays nearly parallel to a triangle
+constexpr float DetEpsilon = 1e-8f;
+
+// Entry and exit of a ray through an axis-aligned box, clipped to [t0, t1]
+bool ClipToBox(const glm::vec3& origin, const glm::vec3& inv_dir,
+               const glm::vec3& lo, const glm::vec3& hi, float& t0,
+               float& t1) {
+  for (int a = 0; a < 3; ++a) {
+    float near = (lo[a] - origin[a]) * inv_dir[a];
+    float far = (hi[a] - origin[a]) * inv_dir[a];
+    if (near > far) {
+      std::swap(near, far);
+    }
+    t0 = std::max(t0, near);
+    t1 = std::min(t1, far);
+  }
+  return t0 <= t1;
+}
+
+struct SweepContact {
+  float t;
+  glm::vec3 normal;
+};
+
+// Earliest t in [0, 1] at which a sphere at |c| moving by |m| touches the
+// sphere of radius |r| at |center|
+std::optional<float> SweepSpherePoint(const glm::vec3& c, const glm::vec3& m,
+                                      float r, const glm::vec3& center) {
+  const glm::vec3 d = c - center;
+  const float k = glm::dot(d, d) - r * r;
+  if (k <= 0.0f) {
+    return 0.0f;
+  }
+  const float a = glm::dot(m, m);
+  const float b = glm::dot(d, m);
+  const float disc = b * b - a * k;
+  if (a == 0.0f || b >= 0.0f || disc < 0.0f) {
+    return std::nullopt;
+  }
+  const float t = (-b - std::sqrt(disc)) / a;
+  if (t > 1.0f) {
+    return std::nullopt;
+  }
+  return t;
+}
+
+// As above, against the cylinder of radius |r| around the segment [p, q]. The
+// rounded ends are left to SweepSpherePoint.
+std::optional<float> SweepSphereSegment(const glm::vec3& c, const glm::vec3& m,
+                                        float r, const glm::vec3& p,
+                                        const glm::vec3& q) {
+  // Real-Time Collision Detection, 5.3.7
+  const glm::vec3 d = q - p;
+  const glm::vec3 w = c - p;
+  const float dd = glm::dot(d, d);
+  if (dd == 0.0f) {
+    return std::nullopt;
+  }
+  const float md = glm::dot(w, d);
+  const float nd = glm::dot(m, d);
+  const float a = dd * glm::dot(m, m) - nd * nd;
+  const float k = glm::dot(w, w) - r * r;
+  const float cc = dd * k - md * md;
+  if (cc <= 0.0f && md >= 0.0f && md <= dd) {
+    return 0.0f;
+  }
+  if (std::abs(a) < DetEpsilon * dd) {
+    return std::nullopt;
+  }
+  const float b = dd * glm::dot(w, m) - nd * md;
+  const float disc = b * b - a * cc;
+  if (disc < 0.0f) {
+    return std::nullopt;
+  }
+  const float t = (-b - std::sqrt(disc)) / a;
+  const float along = md + t * nd;
+  if (t < 0.0f || t > 1.0f || along < 0.0f || along > dd) {
+    return std::nullopt;
+  }
+  return t;
+}
+
+bool InTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b,
+                const glm::vec3& c, const glm::vec3& n) {
+  return glm::dot(glm::cross(b - a, p - a), n) >= 0.0f &&
+         glm::dot(glm::cross(c - b, p - b), n) >= 0.0f &&
+         glm::dot(glm::cross(a - c, p - c), n) >= 0.0f;
+}
+
+// Earliest contact in [0, 1] of a sphere at |c| moving by |m| with a triangle
+std::optional<SweepContact>
+SweepSphereTriangle(const glm::vec3& c, const glm::vec3& m, float r,
+                    const std::array<glm::vec3, 3>& v) {
+  const glm::vec3 cross = glm::cross(v[1] - v[0], v[2] - v[0]);
+  const float area = glm::length(cross);
+  if (area > 0.0f) {
+    // Touching the face is always the first contact, if it happens at all
+    const glm::vec3 n = cross / area;
+    const float dist = glm::dot(c - v[0], n);
+    const float side = dist >= 0.0f ? 1.0f : -1.0f;
+    if (std::abs(dist) <= r) {
+      if (InTriangle(c - n * dist, v[0], v[1], v[2], n)) {
+        return SweepContact{0.0f, n * side};
+      }
+    } else if (const float dn = glm::dot(m, n); dist * dn < 0.0f) {
+      const float t = (side * r - dist) / dn;
+      if (t <= 1.0f &&
+          InTriangle(c + m * t - n * (side * r), v[0], v[1], v[2], n)) {
+        return SweepContact{t, n * side};
+      }
+    }
+  }
+
+  // Otherwise it meets an edge or a corner first
+  std::optional<SweepContact> best;
+  auto consider = [&](std::optional<float> t, auto&& closest) {
+    if (t && (!best || *t < best->t)) {
+      const glm::vec3 at = c + m * *t;
+      const glm::vec3 away = at - closest(at);
+      const float len = glm::length(away);
+      best = SweepContact{*t, len > 0.0f ? away / len : -glm::normalize(m)};
+    }
+  };
+  for (int i = 0; i < 3; ++i) {
+    const glm::vec3& p = v[i];
+    const glm::vec3& q = v[(i + 1) % 3];
+    consider(SweepSphereSegment(c, m, r, p, q), [&](const glm::vec3& at) {
+      const glm::vec3 d = q - p;
+      return p + d * (glm::dot(at - p, d) / glm::dot(d, d));
+    });
+    consider(SweepSpherePoint(c, m, r, p),
+             [&](const glm::vec3&) { return p; });
+  }
+  return best;
+}
+
+// The game converts positions to area units with fctiwz: a point below the
+// area wraps to a large value and then fails the width mask.
+std::optional<u32> ToAreaUnits(float offset) {
+  if (!(offset > -2147483648.0f && offset < 2147483648.0f)) {
+    return std::nullopt;
+  }
+  return static_cast<u32>(static_cast<s32>(offset));
+}
+
+} // namespace
+
+struct KclQuery::RayState {
+  explicit RayState(const KclRay& ray)
+      : origin(ray.origin), dir(ray.dir), best_t(ray.max_t) {
+    for (int a = 0; a < 3; ++a) {
+      // A huge (rather than infinite) slope keeps 0 * inv_dir finite
+      inv_dir[a] = 1.0f / (dir[a] != 0.0f ? dir[a] : 1e-30f);
+    }
+    octant = (dir.x < 0.0f ? 1 : 0) | (dir.y < 0.0f ? 2 : 0) |
+             (dir.z < 0.0f ? 4 : 0);
+  }
+
+  glm::vec3 origin;
+  glm::vec3 dir;
+  glm::vec3 inv_dir;
+  // Children are visited in order i ^ octant, near to far
+  u32 octant;
+  float best_t;
+  std::optional<u16> best_prism;
+};
+
+KclQuery::KclQuery(const KCollisionData& data) : mData(data) {
+  const size_t count = data.prism_data.size();
+  for (int a = 0; a < 3; ++a) {
+    mTris.v0[a].resize(count);
+    mTris.e1[a].resize(count);
+    mTris.e2[a].resize(count);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const auto& prism = data.prism_data[i];
+    std::array<glm::vec3, 3> v;
+    const size_t nrm_count = data.nrm_data.size();
+    if (prism.pos_i < data.pos_data.size() && prism.fnrm_i < nrm_count &&
+        prism.enrm1_i < nrm_count && prism.enrm2_i < nrm_count &&
+        prism.enrm3_i < nrm_count) {
+      v = FromPrism(data, prism);
+    } else {
+      // Never hit
+      v.fill(glm::vec3(std::numeric_limits<float>::quiet_NaN()));
+    }
+    for (int a = 0; a < 3; ++a) {
+      mTris.v0[a][i] = v[0][a];
+      mTris.e1[a][i] = v[1][a] - v[0][a];
+      mTris.e2[a][i] = v[2][a] - v[0][a];
+    }
+  }
+
+  mGrid = GetRootGridSize(data);
+  if (data.octree.root_count == 0) {
+    mGrid = {0, 0, 0};
+  }
+  mRootSize = std::ldexp(1.0f, std::clamp(data.block_width_shift, 0, 31));
+  mAreaMin = data.area_min_pos;
+  mAreaMax = mAreaMin + glm::vec3(mGrid[0], mGrid[1], mGrid[2]) * mRootSize;
+}
+
+s32 KclQuery::rootCoord(float pos, int axis) const {
+  const float rel = std::floor((pos - mAreaMin[axis]) / mRootSize);
+  return static_cast<s32>(
+      std::clamp(rel, 0.0f, static_cast<float>(mGrid[axis] - 1)));
+}
+
+std::span<const u16> KclQuery::prismsAt(const glm::vec3& pos) const {
+  const auto& octree = mData.octree;
+  if (octree.root_count == 0) {
+    return {};
+  }
+  const auto x = ToAreaUnits(pos.x - mAreaMin.x);
+  const auto y = ToAreaUnits(pos.y - mAreaMin.y);
+  const auto z = ToAreaUnits(pos.z - mAreaMin.z);
+  if (!x || !y || !z || (*x & mData.area_x_width_mask) ||
+      (*y & mData.area_y_width_mask) || (*z & mData.area_z_width_mask)) {
+    return {};
+  }
+
+  s32 shift = mData.block_width_shift;
+  const auto* cell =
+      &octree.cells[((*z >> shift) << mData.area_xy_blocks_shift) |
+                    ((*y >> shift) << mData.area_x_blocks_shift) |
+                    (*x >> shift)];
+  while (!cell->leaf) {
+    --shift;
+    cell = &octree.cells[cell->first + (((*x >> shift) & 1) |
+                                        (((*y >> shift) & 1) << 1) |
+                                        (((*z >> shift) & 1) << 2))];
+  }
+  return std::span(octree.prisms).subspan(cell->first, cell->count);
+}
+
+void KclQuery::intersectLeaf(std::span<const u16> prisms,
+                             RayState& ray) const {
+  // Moller-Trumbore, four prisms at a time
+  size_t i = 0;
+#if RSL_HAS_SSE2
+  const __m128 ox = _mm_set1_ps(ray.origin.x);
+  const __m128 oy = _mm_set1_ps(ray.origin.y);
+  const __m128 oz = _mm_set1_ps(ray.origin.z);
+  const __m128 dx = _mm_set1_ps(ray.dir.x);
+  const __m128 dy = _mm_set1_ps(ray.dir.y);
+  const __m128 dz = _mm_set1_ps(ray.dir.z);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 eps = _mm_set1_ps(DetEpsilon);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  for (; i + 4 <= prisms.size(); i += 4) {
+    const u16* idx = &prisms[i];
+    auto gather = [idx](const std::vector<float>& v) {
+      return _mm_setr_ps(v[idx[0]], v[idx[1]], v[idx[2]], v[idx[3]]);
+    };
+    const __m128 e1x = gather(mTris.e1[0]);
+    const __m128 e1y = gather(mTris.e1[1]);
+    const __m128 e1z = gather(mTris.e1[2]);
+    const __m128 e2x = gather(mTris.e2[0]);
+    const __m128 e2y = gather(mTris.e2[1]);
+    const __m128 e2z = gather(mTris.e2[2]);
+
+    const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    const __m128 det =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+                   _mm_mul_ps(e1z, pz));
+    const __m128 inv = _mm_div_ps(one, det);
+
+    const __m128 tx = _mm_sub_ps(ox, gather(mTris.v0[0]));
+    const __m128 ty = _mm_sub_ps(oy, gather(mTris.v0[1]));
+    const __m128 tz = _mm_sub_ps(oz, gather(mTris.v0[2]));
+    const __m128 u = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)),
+                   _mm_mul_ps(tz, pz)),
+        inv);
+
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+    const __m128 v = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+                   _mm_mul_ps(dz, qz)),
+        inv);
+    const __m128 t = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+                   _mm_mul_ps(e2z, qz)),
+        inv);
+
+    __m128 hit = _mm_cmpgt_ps(_mm_andnot_ps(sign, det), eps);
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(ray.best_t)));
+    const int mask = _mm_movemask_ps(hit);
+    if (mask == 0) {
+      continue;
+    }
+    alignas(16) float ts[4];
+    _mm_store_ps(ts, t);
+    for (int m = mask; m != 0; m &= m - 1) {
+      const int lane = std::countr_zero(static_cast<unsigned>(m));
+      if (ts[lane] < ray.best_t) {
+        ray.best_t = ts[lane];
+        ray.best_prism = idx[lane];
+      }
+    }
+  }
+#endif
+  for (; i < prisms.size(); ++i) {
+    const u16 p = prisms[i];
+    const glm::vec3 e1(mTris.e1[0][p], mTris.e1[1][p], mTris.e1[2][p]);
+    const glm::vec3 e2(mTris.e2[0][p], mTris.e2[1][p], mTris.e2[2][p]);
+    const glm::vec3 pv = glm::cross(ray.dir, e2);
+    const float det = glm::dot(e1, pv);
+    if (!(std::abs(det) > DetEpsilon)) {
+      continue;
+    }
+    const float inv = 1.0f / det;
+    const glm::vec3 tv =
+        ray.origin - glm::vec3(mTris.v0[0][p], mTris.v0[1][p], mTris.v0[2][p]);
+    const float u = glm::dot(tv, pv) * inv;
+    const glm::vec3 qv = glm::cross(tv, e1);
+    const float v = glm::dot(ray.dir, qv) * inv;
+    const float t = glm::dot(e2, qv) * inv;
+    if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f &&
+        t < ray.best_t) {
+      ray.best_t = t;
+      ray.best_prism = p;
+    }
+  }
+}
+
+void KclQuery::traverse(u32 root, const glm::vec3& root_min,
+                        RayState& ray) const {
+  struct Entry {
+    u32 cell;
+    s32 shift;
+    glm::vec3 min;
+  };
+  // Each level leaves at most seven siblings behind
+  std::array<Entry, 8 * 33> stack;
+  size_t size = 0;
+  stack[size++] = {root, mData.block_width_shift, root_min};
+  while (size != 0) {
+    const Entry e = stack[--size];
+    const float width = std::ldexp(1.0f, e.shift);
+    float t0 = 0.0f, t1 = ray.best_t;
+    if (!ClipToBox(ray.origin, ray.inv_dir, e.min, e.min + width, t0, t1)) {
+      continue;
+    }
+    const auto& cell = mData.octree.cells[e.cell];
+    if (cell.leaf) {
+      intersectLeaf(
+          std::span(mData.octree.prisms).subspan(cell.first, cell.count), ray);
+      continue;
+    }
+    const float half = width * 0.5f;
+    // Pushed far to near, so the nearest child is visited first
+    for (int k = 7; k >= 0; --k) {
+      const u32 c = static_cast<u32>(k) ^ ray.octant;
+      stack[size++] = {cell.first + c, e.shift - 1,
+                       e.min + glm::vec3((c & 1) ? half : 0.0f,
+                                         (c & 2) ? half : 0.0f,
+                                         (c & 4) ? half : 0.0f)};
+    }
+  }
+}
+
+std::optional<KclHit> KclQuery::makeHit(const RayState& ray) const {
+  if (!ray.best_prism) {
+    return std::nullopt;
+  }
+  const auto& prism = mData.prism_data[*ray.best_prism];
+  return KclHit{
+      .t = ray.best_t,
+      .position = ray.origin + ray.dir * ray.best_t,
+      .normal = mData.nrm_data[prism.fnrm_i],
+      .prism = *ray.best_prism,
+      .attribute = prism.attribute,
+  };
+}
+
+std::optional<KclHit> KclQuery::rayCast(const KclRay& in) const {
+  RayState ray(in);
+  float t0 = 0.0f, t1 = in.max_t;
+  if (mGrid[0] == 0 ||
+      !ClipToBox(ray.origin, ray.inv_dir, mAreaMin, mAreaMax, t0, t1)) {
+    return std::nullopt;
+  }
+
+  // Walk the root cubes along the ray (Amanatides and Woo), then descend
+  const glm::vec3 entry = ray.origin + ray.dir * t0;
+  std::array<s32, 3> cell, step;
+  std::array<float, 3> t_next, t_delta;
+  for (int a = 0; a < 3; ++a) {
+    cell[a] = rootCoord(entry[a], a);
+    const float lo = mAreaMin[a] + cell[a] * mRootSize;
+    if (ray.dir[a] > 0.0f) {
+      step[a] = 1;
+      t_next[a] = (lo + mRootSize - ray.origin[a]) * ray.inv_dir[a];
+      t_delta[a] = mRootSize * ray.inv_dir[a];
+    } else if (ray.dir[a] < 0.0f) {
+      step[a] = -1;
+      t_next[a] = (lo - ray.origin[a]) * ray.inv_dir[a];
+      t_delta[a] = -mRootSize * ray.inv_dir[a];
+    } else {
+      step[a] = 0;
+      t_next[a] = std::numeric_limits<float>::infinity();
+      t_delta[a] = std::numeric_limits<float>::infinity();
+    }
+  }
+
+  while (true) {
+    const u32 root = (static_cast<u32>(cell[2]) << mData.area_xy_blocks_shift) |
+                     (static_cast<u32>(cell[1]) << mData.area_x_blocks_shift) |
+                     static_cast<u32>(cell[0]);
+    traverse(root,
+             mAreaMin + glm::vec3(cell[0], cell[1], cell[2]) * mRootSize, ray);
+
+    const int a = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2)
+                                        : (t_next[1] < t_next[2] ? 1 : 2);
+    // Nothing further along can be nearer than a hit within this cube
+    if (ray.best_t <= t_next[a] || t_next[a] > t1) {
+      break;
+    }
+    cell[a] += step[a];
+    if (cell[a] < 0 || cell[a] >= static_cast<s32>(mGrid[a])) {
+      break;
+    }
+    t_next[a] += t_delta[a];
+  }
+
+  return makeHit(ray);
+}
+
+void KclQuery::rayCast(std::span<const KclRay> rays,
+                       std::span<std::optional<KclHit>> hits) const {
+  assert(hits.size() == rays.size());
+  auto job = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      hits[i] = rayCast(rays[i]);
+    }
+  };
+  // Inside another pool, stay on the calling thread rather than oversubscribe
+  if (rays.size() < ParallelThreshold ||
+      rsl::ThreadPool::current() != nullptr) {
+    job(0, rays.size());
+    return;
+  }
+  rsl::ThreadPool pool;
+  for (size_t begin = 0; begin < rays.size(); begin += RayChunkSize) {
+    const size_t end = std::min(rays.size(), begin + RayChunkSize);
+    pool.submit([&job, begin, end] { job(begin, end); });
+  }
+  pool.wait();
+}
+
+void KclQuery::gatherPrisms(const glm::vec3& lo, const glm::vec3& hi,
+                            std::vector<u16>& out) const {
+  if (mGrid[0] == 0) {
+    return;
+  }
+  std::array<s32, 3> first, last;
+  for (int a = 0; a < 3; ++a) {
+    if (hi[a] < mAreaMin[a] || lo[a] > mAreaMax[a]) {
+      return;
+    }
+    first[a] = rootCoord(lo[a], a);
+    last[a] = rootCoord(hi[a], a);
+  }
+
+  struct Entry {
+    u32 cell;
+    s32 shift;
+    glm::vec3 min;
+  };
+  std::vector<Entry> stack;
+  for (s32 z = first[2]; z <= last[2]; ++z) {
+    for (s32 y = first[1]; y <= last[1]; ++y) {
+      for (s32 x = first[0]; x <= last[0]; ++x) {
+        const u32 root = (static_cast<u32>(z) << mData.area_xy_blocks_shift) |
+                         (static_cast<u32>(y) << mData.area_x_blocks_shift) |
+                         static_cast<u32>(x);
+        stack.push_back({root, mData.block_width_shift,
+                         mAreaMin + glm::vec3(x, y, z) * mRootSize});
+      }
+    }
+  }
+  while (!stack.empty()) {
+    const Entry e = stack.back();
+    stack.pop_back();
+    const auto& cell = mData.octree.cells[e.cell];
+    if (cell.leaf) {
+      const auto prisms =
+          std::span(mData.octree.prisms).subspan(cell.first, cell.count);
+      out.insert(out.end(), prisms.begin(), prisms.end());
+      continue;
+    }
+    const float half = std::ldexp(1.0f, e.shift - 1);
+    for (u32 c = 0; c < 8; ++c) {
+      const glm::vec3 min = e.min + glm::vec3((c & 1) ? half : 0.0f,
+                                              (c & 2) ? half : 0.0f,
+                                              (c & 4) ? half : 0.0f);
+      const glm::vec3 max = min + half;
+      if (hi.x >= min.x && lo.x <= max.x && hi.y >= min.y && lo.y <= max.y &&
+          hi.z >= min.z && lo.z <= max.z) {
+        stack.push_back({cell.first + c, e.shift - 1, min});
+      }
+    }
+  }
+}
+
+std::optional<KclHit> KclQuery::sphereSweep(const glm::vec3& start,
+                                            const glm::vec3& end,
+                                            float radius) const {
+  std::vector<u16> prisms;
+  gatherPrisms(glm::min(start, end) - radius, glm::max(start, end) + radius,
+               prisms);
+  // Leaves overlap in what they list
+  std::ranges::sort(prisms);
+  prisms.erase(std::unique(prisms.begin(), prisms.end()), prisms.end());
+
+  const glm::vec3 move = end - start;
+  std::optional<KclHit> best;
+  for (const u16 p : prisms) {
+    const glm::vec3 v0(mTris.v0[0][p], mTris.v0[1][p], mTris.v0[2][p]);
+    const std::array<glm::vec3, 3> tri{
+        v0, v0 + glm::vec3(mTris.e1[0][p], mTris.e1[1][p], mTris.e1[2][p]),
+        v0 + glm::vec3(mTris.e2[0][p], mTris.e2[1][p], mTris.e2[2][p])};
+    const auto contact = SweepSphereTriangle(start, move, radius, tri);
+    if (contact && (!best || contact->t < best->t)) {
+      best = KclHit{
+          .t = contact->t,
+          .position = start + move * contact->t,
+          .normal = contact->normal,
+          .prism = p,
+          .attribute = mData.prism_data[p].attribute,
+      };
+    }
+  }
+  return best;
+}
+
+} // namespace librii::kcol
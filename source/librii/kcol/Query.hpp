@@ -0,0 +1,79 @@
+#pragma once
+
+#include <librii/kcol/Model.hpp>
+
+#include <array>
+#include <limits>
+#include <optional>
+
+namespace librii::kcol {
+
+struct KclRay {
+  glm::vec3 origin{};
+  //! Need not be normalized: hit distances are in multiples of it
+  glm::vec3 dir{};
+  float max_t = std::numeric_limits<float>::infinity();
+};
+
+struct KclHit {
+  //! Ray: origin + dir * t. Sweep: fraction of the way from start to end.
+  float t = 0.0f;
+  //! Ray: the point hit. Sweep: the sphere's center at contact.
+  glm::vec3 position{};
+  //! Ray: the prism's face normal. Sweep: from the contact to the center.
+  glm::vec3 normal{};
+  u16 prism = 0;
+  u16 attribute = 0;
+};
+
+//! Collision queries against a KCL, accelerated by its octree.
+//!
+//! Prism triangles are expanded once up front; |data| must outlive the query.
+//! Queries are const and safe to run from many threads at once.
+class KclQuery {
+public:
+  explicit KclQuery(const KCollisionData& data);
+
+  //! Prisms the game tests for a point at |pos|: the leaf holding it, found
+  //! with the game's mask and shift arithmetic. Empty outside the area.
+  std::span<const u16> prismsAt(const glm::vec3& pos) const;
+
+  //! Nearest prism the ray hits within [0, max_t)
+  std::optional<KclHit> rayCast(const KclRay& ray) const;
+  //! Casts every ray, in parallel. |hits| must be as long as |rays|.
+  void rayCast(std::span<const KclRay> rays,
+               std::span<std::optional<KclHit>> hits) const;
+
+  //! First prism touched by a sphere of |radius| moving from |start| to |end|
+  std::optional<KclHit> sphereSweep(const glm::vec3& start,
+                                    const glm::vec3& end, float radius) const;
+
+  //! Prism triangles, for brute-force checks: vertex 0 and the two edges
+  //! leaving it, one array per component.
+  struct Triangles {
+    std::array<std::vector<float>, 3> v0;
+    std::array<std::vector<float>, 3> e1;
+    std::array<std::vector<float>, 3> e2;
+  };
+  const Triangles& triangles() const { return mTris; }
+
+private:
+  struct RayState;
+
+  //! Root cube holding |pos| along |axis|, clamped to the grid
+  s32 rootCoord(float pos, int axis) const;
+  void traverse(u32 root, const glm::vec3& root_min, RayState& ray) const;
+  void intersectLeaf(std::span<const u16> prisms, RayState& ray) const;
+  void gatherPrisms(const glm::vec3& lo, const glm::vec3& hi,
+                    std::vector<u16>& out) const;
+  std::optional<KclHit> makeHit(const RayState& ray) const;
+
+  const KCollisionData& mData;
+  Triangles mTris;
+  glm::vec3 mAreaMin{};
+  glm::vec3 mAreaMax{};
+  std::array<u32, 3> mGrid{};
+  float mRootSize = 0.0f;
+};
+
+} // namespace librii::kcol
@@ -1,6 +1,8 @@
 #include "CourseMap.hpp"
 #include <fmt/color.h>
+#include <limits>
 #include <librii/objflow/ObjFlow.hpp>
+#include <rsl/JsonStream.hpp>
 #include <vendor/nlohmann/json.hpp>
 
 using namespace librii::kmp;
@@ -404,4 +406,112 @@ CourseMap LoadJSON(std::string_view map) {
   return courseMap;
 }
 
+template <typename T>
+static void WriteRecords(rsl::JsonWriter& w, std::string_view key,
+                         const std::vector<T>& records) {
+  w.key(key);
+  w.beginArray();
+  for (const auto& record : records) {
+    w.raw(json(record).dump());
+  }
+  w.endArray();
+}
+
+void WriteJSON(std::ostream& out, const CourseMap& map) {
+  rsl::JsonWriter w(out);
+  w.beginObject();
+  w.key("mRevision");
+  w.value(map.mRevision);
+  w.key("mOpeningPanIndex");
+  w.value(map.mOpeningPanIndex);
+  w.key("mVideoPanIndex");
+  w.value(map.mVideoPanIndex);
+  WriteRecords(w, "mStartPoints", map.mStartPoints);
+  WriteRecords(w, "mEnemyPaths", map.mEnemyPaths);
+  WriteRecords(w, "mItemPaths", map.mItemPaths);
+  WriteRecords(w, "mCheckPaths", map.mCheckPaths);
+  WriteRecords(w, "mPaths", map.mPaths);
+  WriteRecords(w, "mGeoObjs", map.mGeoObjs);
+  WriteRecords(w, "mAreas", map.mAreas);
+  WriteRecords(w, "mCameras", map.mCameras);
+  WriteRecords(w, "mRespawnPoints", map.mRespawnPoints);
+  WriteRecords(w, "mCannonPoints", map.mCannonPoints);
+  WriteRecords(w, "mStages", map.mStages);
+  WriteRecords(w, "mMissionPoints", map.mMissionPoints);
+  w.endObject();
+}
+
+template <typename T>
+static Result<void> ReadRecords(rsl::JsonPullReader& r, std::string_view key,
+                                std::vector<T>& records) {
+  TRY(r.beginArray());
+  while (TRY(r.nextElement())) {
+    const auto text = TRY(r.readValue());
+    const auto j = json::parse(text, nullptr, /*allow_exceptions*/ false);
+    if (j.is_discarded()) {
+      return std::unexpected(std::format("KMP JSON: Malformed record {}[{}]",
+                                         key, records.size()));
+    }
+    // allow_exceptions only covers parsing: a record of the wrong shape
+    // still throws on conversion
+    try {
+      records.push_back(j.get<T>());
+    } catch (const json::exception& e) {
+      return std::unexpected(std::format("KMP JSON: Invalid record {}[{}]: {}",
+                                         key, records.size(), e.what()));
+    }
+  }
+  return {};
+}
+
+template <typename T> static Result<T> ReadScalar(rsl::JsonPullReader& r) {
+  const f64 x = TRY(r.readNumber());
+  EXPECT(x >= std::numeric_limits<T>::min() &&
+         x <= std::numeric_limits<T>::max());
+  return static_cast<T>(x);
+}
+
+Result<CourseMap> ReadJSON(std::istream& in) {
+  rsl::JsonPullReader r(in);
+  CourseMap map;
+  TRY(r.beginObject());
+  while (auto key = TRY(r.nextKey())) {
+    if (*key == "mRevision") {
+      map.mRevision = TRY(ReadScalar<u16>(r));
+    } else if (*key == "mOpeningPanIndex") {
+      map.mOpeningPanIndex = TRY(ReadScalar<u8>(r));
+    } else if (*key == "mVideoPanIndex") {
+      map.mVideoPanIndex = TRY(ReadScalar<u8>(r));
+    } else if (*key == "mStartPoints") {
+      TRY(ReadRecords(r, *key, map.mStartPoints));
+    } else if (*key == "mEnemyPaths") {
+      TRY(ReadRecords(r, *key, map.mEnemyPaths));
+    } else if (*key == "mItemPaths") {
+      TRY(ReadRecords(r, *key, map.mItemPaths));
+    } else if (*key == "mCheckPaths") {
+      TRY(ReadRecords(r, *key, map.mCheckPaths));
+    } else if (*key == "mPaths") {
+      TRY(ReadRecords(r, *key, map.mPaths));
+    } else if (*key == "mGeoObjs") {
+      TRY(ReadRecords(r, *key, map.mGeoObjs));
+    } else if (*key == "mAreas") {
+      TRY(ReadRecords(r, *key, map.mAreas));
+    } else if (*key == "mCameras") {
+      TRY(ReadRecords(r, *key, map.mCameras));
+    } else if (*key == "mRespawnPoints") {
+      TRY(ReadRecords(r, *key, map.mRespawnPoints));
+    } else if (*key == "mCannonPoints") {
+      TRY(ReadRecords(r, *key, map.mCannonPoints));
+    } else if (*key == "mStages") {
+      TRY(ReadRecords(r, *key, map.mStages));
+    } else if (*key == "mMissionPoints") {
+      TRY(ReadRecords(r, *key, map.mMissionPoints));
+    } else {
+      TRY(r.skipValue());
+    }
+  }
+  TRY(r.expectEnd());
+  return map;
+}
+
 } // namespace librii::kmp
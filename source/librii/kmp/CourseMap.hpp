@@ -9,6 +9,8 @@
 #include <librii/kmp/data/MapRespawn.hpp>
 #include <librii/kmp/data/MapStage.hpp>
 #include <librii/kmp/data/MapStart.hpp>
+#include <iosfwd>
+#include <rsl/Result.hpp>
 #include <string>
 #include <vector>
 
@@ -37,4 +39,9 @@ struct CourseMap {
 std::string DumpJSON(const CourseMap& map);
 CourseMap LoadJSON(std::string_view map);
 
+//! As DumpJSON, written to |out| one record at a time
+void WriteJSON(std::ostream& out, const CourseMap& map);
+//! As LoadJSON, holding only one record's document at a time
+Result<CourseMap> ReadJSON(std::istream& in);
+
 } // namespace librii::kmp
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <librii/rhst/RHST.hpp>
+#include <map>
 
 namespace librii::rhst {
 
@@ -10,10 +11,15 @@ template <typename T = u32> struct IndexBuffer {
     EXPECT(prim.primitives.size() == 1);
     EXPECT(prim.primitives[0].topology == Topology::Triangles);
     IndexBuffer<T> tmp;
+    // First index of each vertex. A linear search here made every
+    // stripification algorithm quadratic.
+    std::map<Vertex, T> lookup;
     for (auto& v : prim.primitives[0].vertices) {
-      auto it = std::find(tmp.vertices.begin(), tmp.vertices.end(), v);
-      if (it != tmp.vertices.end()) {
-        tmp.index_data.push_back(it - tmp.vertices.begin());
+      auto [it, inserted] =
+          lookup.try_emplace(v, static_cast<T>(tmp.vertices.size()));
+      // NaN components compare unordered, so check the match is real
+      if (!inserted && tmp.vertices[it->second] == v) {
+        tmp.index_data.push_back(it->second);
         continue;
       }
       tmp.index_data.push_back(static_cast<T>(tmp.vertices.size()));
@@ -6,7 +6,16 @@
 #include <rsmeshopt/include/rsmeshopt.h>
 
 #include <fmt/color.h>
+#include <rsl/Filesystem.hpp>
 #include <rsl/Ranges.hpp>
+#include <rsl/ThreadPool.hpp>
+#include <rsl/WriteFile.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <thread>
 
 // TODO: Bad, intrusive dependency
@@ -138,6 +147,266 @@ Result<void> ValidateMeshesEqual(const MatrixPrimitive& l,
   return ValidateMeshesEqualImpl(ll, rl);
 }
 
+// Runs job(0) .. job(n - 1). The calling thread runs the first job itself and
+// the rest go to a pool, unless the caller already is a pool worker: then the
+// cores are spoken for, and the jobs run in order.
+static void RunConcurrently(size_t n, const std::function<void(size_t)>& job) {
+  if (n <= 1 || rsl::ThreadPool::current() != nullptr) {
+    for (size_t i = 0; i < n; ++i) {
+      job(i);
+    }
+    return;
+  }
+  const size_t num_cores = std::max(std::thread::hardware_concurrency(), 1u);
+  rsl::ThreadPool pool(static_cast<unsigned>(std::min(n - 1, num_cores)));
+  for (size_t i = 1; i < n; ++i) {
+    pool.submit([&job, i] { job(i); });
+  }
+  job(0);
+  pool.wait();
+}
+
+// Fewest vertices any encoding of |prim| can use. Consecutive triangles of a
+// strip or fan share an edge, so a primitive never spans two edge-connected
+// groups of triangles: at best, each group of t triangles is one primitive of
+// t + 2 vertices. Meshes of disjoint quads or cards, common in foliage and
+// effects, reach this. 0 (no bound) unless |prim| is a triangle list.
+static u32 MinVertexCount(const MatrixPrimitive& prim) {
+  // Vertices merged by mistake (NaN) only join groups, lowering the bound
+  std::map<Vertex, u32> ids;
+  std::vector<std::array<u32, 3>> tris;
+  for (auto& p : prim.primitives) {
+    if (p.topology != Topology::Triangles) {
+      return 0;
+    }
+    for (size_t i = 0; i + 2 < p.vertices.size(); i += 3) {
+      std::array<Vertex, 3> tri{p.vertices[i], p.vertices[i + 1],
+                                p.vertices[i + 2]};
+      if (IsTriDegenerate(tri)) {
+        continue;
+      }
+      auto& t = tris.emplace_back();
+      for (int k = 0; k < 3; ++k) {
+        const u32 next = static_cast<u32>(ids.size());
+        t[k] = ids.try_emplace(tri[k], next).first->second;
+      }
+    }
+  }
+  if (tris.empty()) {
+    return 0;
+  }
+  // Union-find over the triangles, joined through shared edges
+  std::vector<u32> parent(tris.size());
+  std::iota(parent.begin(), parent.end(), 0u);
+  auto find = [&](u32 x) {
+    while (parent[x] != x) {
+      parent[x] = parent[parent[x]];
+      x = parent[x];
+    }
+    return x;
+  };
+  std::map<std::pair<u32, u32>, u32> edges;
+  for (u32 i = 0; i < tris.size(); ++i) {
+    for (int k = 0; k < 3; ++k) {
+      const auto [a, b] = std::minmax(tris[i][k], tris[i][(k + 1) % 3]);
+      auto [it, inserted] = edges.try_emplace({a, b}, i);
+      if (!inserted) {
+        parent[find(i)] = find(it->second);
+      }
+    }
+  }
+  u32 num_groups = 0;
+  for (u32 i = 0; i < tris.size(); ++i) {
+    num_groups += find(i) == i;
+  }
+  return static_cast<u32>(tris.size()) + 2 * num_groups;
+}
+
+// Best score of a set of concurrent experiments. Once it hits the lower bound,
+// no experiment can beat it, and those not yet started can be skipped.
+class SharedBestScore {
+public:
+  explicit SharedBestScore(u32 bound) : bound_(bound) {}
+
+  void Submit(u32 score) {
+    u32 best = best_.load();
+    while (score < best && !best_.compare_exchange_weak(best, score)) {
+    }
+  }
+  bool IsOptimal(u32 score) const { return score <= bound_; }
+  bool ReachedBound() const { return IsOptimal(best_.load()); }
+
+private:
+  u32 bound_{};
+  std::atomic<u32> best_{std::numeric_limits<u32>::max()};
+};
+
+// On-disk cache of StripifyTriangles winners. A file holds u32 words in host
+// byte order:
+//   magic, version, algo, number of input vertices, number of primitives,
+//   then per primitive: topology, vertex count, input vertex indices.
+static constexpr u32 StripCacheMagic = 0x52535443; // RSTC
+// Bump whenever an algorithm changes, so stale strip sets are not reused
+static constexpr u32 StripCacheVersion = 1;
+
+static std::mutex sStripCacheLock;
+// std::nullopt: Not yet defaulted
+static std::optional<std::filesystem::path> sStripCacheDir;
+
+void SetStripifyCacheDirectory(std::filesystem::path dir) {
+  std::unique_lock g(sStripCacheLock);
+  sStripCacheDir = std::move(dir);
+}
+
+static std::filesystem::path GetStripCachePath(u64 key) {
+  std::unique_lock g(sStripCacheLock);
+  if (!sStripCacheDir) {
+    auto tmp = rsl::filesystem::temp_directory_path();
+    sStripCacheDir = tmp ? *tmp / "RiiStudio" / "strip_cache"
+                         : std::filesystem::path{};
+  }
+  if (sStripCacheDir->empty()) {
+    return {};
+  }
+  return *sStripCacheDir / std::format("{:016x}.strips", key);
+}
+
+// FNV-1a of everything that affects the output of StripifyTriangles
+static u64 HashMatrixPrimitive(const MatrixPrimitive& prim) {
+  u64 h = 0xcbf2'9ce4'8422'2325;
+  auto mix = [&](const auto& x) {
+    static_assert(std::is_trivially_copyable_v<std::decay_t<decltype(x)>>);
+    auto* bytes = reinterpret_cast<const u8*>(&x);
+    for (size_t i = 0; i < sizeof(x); ++i) {
+      h = (h ^ bytes[i]) * 0x100'0000'01b3;
+    }
+  };
+  mix(StripCacheVersion);
+  mix(prim.draw_matrices);
+  for (auto& p : prim.primitives) {
+    mix(p.topology);
+    mix(p.vertices.size());
+    // Field by field: Vertex has padding
+    for (auto& v : p.vertices) {
+      mix(v.position);
+      mix(v.normal);
+      mix(v.uvs);
+      mix(v.colors);
+      mix(v.matrix_index);
+    }
+  }
+  return h;
+}
+
+static std::vector<const Vertex*> FlattenVertices(const MatrixPrimitive& prim) {
+  std::vector<const Vertex*> result;
+  for (auto& p : prim.primitives) {
+    for (auto& v : p.vertices) {
+      result.push_back(&v);
+    }
+  }
+  return result;
+}
+
+// Replaces |prim| with its cached strip set, if there is one
+static std::optional<Algo> LoadCachedStrips(u64 key, MatrixPrimitive& prim) {
+  auto path = GetStripCachePath(key);
+  if (path.empty()) {
+    return std::nullopt;
+  }
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return std::nullopt;
+  }
+  const size_t size = file.tellg();
+  if (size % sizeof(u32) != 0) {
+    return std::nullopt;
+  }
+  std::vector<u32> words(size / sizeof(u32));
+  file.seekg(0, std::ios::beg);
+  if (!file.read(reinterpret_cast<char*>(words.data()), size)) {
+    return std::nullopt;
+  }
+
+  auto verts = FlattenVertices(prim);
+  if (words.size() < 5 || words[0] != StripCacheMagic ||
+      words[1] != StripCacheVersion || words[3] != verts.size()) {
+    return std::nullopt;
+  }
+  auto algo = magic_enum::enum_cast<Algo>(words[2]);
+  if (!algo) {
+    return std::nullopt;
+  }
+  MatrixPrimitive result;
+  result.draw_matrices = prim.draw_matrices;
+  size_t pos = 5;
+  for (u32 i = 0; i < words[4]; ++i) {
+    if (words.size() - pos < 2) {
+      return std::nullopt;
+    }
+    auto topology = magic_enum::enum_cast<Topology>(words[pos]);
+    const u32 count = words[pos + 1];
+    pos += 2;
+    if (!topology || words.size() - pos < count) {
+      return std::nullopt;
+    }
+    auto& p = result.primitives.emplace_back();
+    p.topology = *topology;
+    p.vertices.reserve(count);
+    for (u32 j = 0; j < count; ++j) {
+      const u32 index = words[pos++];
+      if (index >= verts.size()) {
+        return std::nullopt;
+      }
+      p.vertices.push_back(*verts[index]);
+    }
+  }
+  // Also guards against hash collisions
+  if (pos != words.size() || !ValidateMeshesEqual(prim, result)) {
+    return std::nullopt;
+  }
+  prim = std::move(result);
+  return *algo;
+}
+
+// Caching is best-effort: failures are ignored
+static void StoreCachedStrips(u64 key, const MatrixPrimitive& input,
+                              const MatrixPrimitive& output, Algo algo) {
+  auto path = GetStripCachePath(key);
+  if (path.empty()) {
+    return;
+  }
+  auto verts = FlattenVertices(input);
+  std::map<Vertex, u32> lookup;
+  for (u32 i = 0; i < verts.size(); ++i) {
+    lookup.try_emplace(*verts[i], i);
+  }
+  std::vector<u32> words{
+      StripCacheMagic,
+      StripCacheVersion,
+      static_cast<u32>(algo),
+      static_cast<u32>(verts.size()),
+      static_cast<u32>(output.primitives.size()),
+  };
+  for (auto& p : output.primitives) {
+    words.push_back(static_cast<u32>(p.topology));
+    words.push_back(static_cast<u32>(p.vertices.size()));
+    for (auto& v : p.vertices) {
+      auto it = lookup.find(v);
+      if (it == lookup.end() || *verts[it->second] != v) {
+        return;
+      }
+      words.push_back(it->second);
+    }
+  }
+  if (!rsl::filesystem::create_directories(path.parent_path())) {
+    return;
+  }
+  std::span<const u8> bytes(reinterpret_cast<const u8*>(words.data()),
+                            words.size() * sizeof(u32));
+  (void)rsl::WriteFileAtomic(bytes, path.string());
+}
+
 // Instruments collection of Optimizer stats of a certain primitive encoding
 // algorithm like triangle stripification.
 class MeshOptimizerStatsCollector {
@@ -524,13 +793,32 @@ Result<MeshOptimizerStats> ToFanTriangles2(MatrixPrimitive& prim) {
     return stats.End();
   }
 
-  std::array<size_t, 6> depths = {vc, 5, 10, 20, 40, 80};
+  std::vector<size_t> depths = {vc, 5, 10, 20, 40, 80};
+  std::ranges::sort(depths);
+  depths.erase(std::unique(depths.begin(), depths.end()), depths.end());
 
   MeshOptimizerExperimentHolder<size_t> experiments(prim);
+  // The holder may not be modified during the sweep; create everything first
+  std::vector<MatrixPrimitive*> slots;
   for (auto& d : depths) {
-    auto& tmp = experiments.CreateExperiment(d);
-    auto stats = TRY(ToFanTriangles(tmp, 4, d));
-    experiments.SetStats(d, stats);
+    slots.push_back(&experiments.CreateExperiment(d));
+  }
+  // std::nullopt: Skipped
+  std::vector<std::optional<Result<MeshOptimizerStats>>> results(depths.size());
+  SharedBestScore best(MinVertexCount(prim));
+  RunConcurrently(depths.size(), [&](size_t i) {
+    if (best.ReachedBound()) {
+      return;
+    }
+    results[i] = ToFanTriangles(*slots[i], 4, depths[i]);
+    if (*results[i]) {
+      best.Submit(VertexCount(*slots[i]));
+    }
+  });
+  for (size_t i = 0; i < depths.size(); ++i) {
+    if (results[i]) {
+      experiments.SetStats(depths[i], TRY(*results[i]));
+    }
   }
   // TRY(experiments.ValidateAllWithBaseline());
   prim = experiments.GetFirstWinner();
@@ -575,8 +863,21 @@ Result<MeshOptimizerStats> StripifyTrianglesAlgo(MatrixPrimitive& prim,
 Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
                                std::optional<Algo> except,
                                std::string_view debug_name, bool verbose) {
-  MeshOptimizerExperimentHolder<Algo> experiments(prim);
-  u32 ms_on_validate = 0;
+  // Only whole-mesh searches are cached. ToFanTriangles also comes through
+  // here for its leftover triangles, with RiiFans excluded.
+  std::optional<u64> cache_key;
+  if (!except) {
+    cache_key = HashMatrixPrimitive(prim);
+    if (auto algo = LoadCachedStrips(*cache_key, prim)) {
+      if (verbose) {
+        fmt::print(stderr, "----\n| Compiling {}: reused cached {}\n---\n",
+                   debug_name, magic_enum::enum_name(*algo));
+      }
+      return *algo;
+    }
+  }
+
+  std::vector<Algo> algos;
   for (auto e : magic_enum::enum_values<Algo>()) {
     if (except && *except == e) {
       // Disabled by user input
@@ -594,28 +895,82 @@ Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
       // This almost *never* wins, and is quite slow at that, but is here so we
       // can never possibly lose to BrawlBox.
     }
-    auto& tmp = experiments.CreateExperiment(e);
-    auto results = StripifyTrianglesAlgo(tmp, e);
-    if (!results) {
-      experiments.CreateExperiment(e);
-      experiments.SetStats(e, {.comment = results.error()});
+    algos.push_back(e);
+  }
+  // RunConcurrently runs the first job on this thread, which is not a pool
+  // worker. RiiFans goes there so that its depth sweep gets a pool too.
+  std::ranges::stable_partition(algos,
+                                [](Algo e) { return e == Algo::RiiFans; });
+
+  MeshOptimizerExperimentHolder<Algo> experiments(prim);
+  // The holder may not be modified while experiments run; create them first
+  std::vector<MatrixPrimitive*> slots;
+  for (Algo e : algos) {
+    slots.push_back(&experiments.CreateExperiment(e));
+  }
+  // std::nullopt: Skipped, as another experiment was already optimal
+  std::vector<std::optional<Result<MeshOptimizerStats>>> results(algos.size());
+  // Not std::vector<bool>: written concurrently
+  std::vector<u8> validated(algos.size());
+  SharedBestScore best(MinVertexCount(prim));
+  RunConcurrently(algos.size(), [&](size_t i) {
+    if (best.ReachedBound()) {
+      return;
+    }
+    results[i] = StripifyTrianglesAlgo(*slots[i], algos[i]);
+    if (!*results[i]) {
+      return;
+    }
+    // Only a valid result may cancel the others, so validate it right away
+    const u32 score = VertexCount(*slots[i]);
+    if (best.IsOptimal(score)) {
+      if (auto ok = ValidateMeshesEqual(prim, *slots[i]); !ok) {
+        results[i] = std::unexpected(ok.error());
+        return;
+      }
+      validated[i] = true;
+      best.Submit(score);
+    }
+  });
+
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < algos.size(); ++i) {
+    const Algo e = algos[i];
+    if (!results[i]) {
+      experiments.SetStats(e, {.comment = "Skipped: another algo is optimal"});
       continue;
     }
-    // If invalid, reset and comment the error
-    rsl::Timer timer;
-    auto ok = experiments.ValidateExperimentWithBaseline(e);
-    ms_on_validate += timer.elapsed();
-    if (!ok) {
+    // If failed, reset and comment the error
+    if (!*results[i]) {
       experiments.CreateExperiment(e);
-      experiments.SetStats(e, {.comment = ok.error()});
+      experiments.SetStats(e, {.comment = results[i]->error()});
       continue;
     }
-    experiments.SetStats(e, *results);
-  }
-  std::vector<std::string_view> winners;
-  for (Algo e : experiments.CalcWinners()) {
-    winners.push_back(magic_enum::enum_name(e));
+    experiments.SetStats(e, **results[i]);
+    candidates.push_back(i);
+  }
+  // Only the winner needs validating. Try the best experiments first; if one
+  // is invalid, reset it and comment the error.
+  std::ranges::stable_sort(candidates, {}, [&](size_t i) {
+    return VertexCount(experiments.GetExperiment(algos[i]));
+  });
+  std::optional<Algo> winner;
+  rsl::Timer timer;
+  for (size_t i : candidates) {
+    const Algo e = algos[i];
+    if (!validated[i]) {
+      auto ok = experiments.ValidateExperimentWithBaseline(e);
+      if (!ok) {
+        experiments.CreateExperiment(e);
+        experiments.SetStats(e, {.comment = ok.error()});
+        continue;
+      }
+    }
+    winner = e;
+    break;
   }
+  const u32 ms_on_validate = timer.elapsed();
+
   if (verbose && !except) {
     auto table = PrintScoresOfExperiment(experiments);
     std::stringstream thread_id;
@@ -627,8 +982,16 @@ Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
                "validation\n---\n",
                debug_name, thread_id.str(), table, ms_on_validate);
   }
-  prim = experiments.GetFirstWinner();
-  return experiments.GetFirstWinnerAlgo();
+  if (!winner) {
+    // Every experiment failed; |prim| is left as it was
+    return experiments.GetFirstWinnerAlgo();
+  }
+  if (cache_key) {
+    StoreCachedStrips(*cache_key, prim, experiments.GetExperiment(*winner),
+                      *winner);
+  }
+  prim = experiments.GetExperiment(*winner);
+  return *winner;
 }
 
 } // namespace librii::rhst
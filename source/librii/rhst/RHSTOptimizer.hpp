@@ -4,6 +4,8 @@
 
 #include <librii/rhst/RHST.hpp>
 
+#include <filesystem>
+
 namespace librii::rhst {
 
 struct MeshOptimizerStats {
@@ -57,10 +59,15 @@ enum class Algo {
 Result<MeshOptimizerStats> StripifyTrianglesAlgo(MatrixPrimitive& prim,
                                                  Algo algo);
 
-// Brute-force every algorithm
+// Brute-force every algorithm, concurrently. Winners of whole-mesh searches
+// are cached on disk (see SetStripifyCacheDirectory).
 Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
                                std::optional<Algo> except = std::nullopt,
                                std::string_view debug_name = "?",
                                bool verbose = true);
 
+// Where StripifyTriangles caches winning strip sets, keyed by a hash of the
+// input mesh. Defaults to a folder in the temp directory; empty disables it.
+void SetStripifyCacheDirectory(std::filesystem::path dir);
+
 } // namespace librii::rhst
@@ -6,7 +6,15 @@
 namespace librii::szs {
 
 Result<std::vector<u8>> encodeAlgo(std::span<const u8> buf, Algo algo,
-                                   bool yay0) {
+                                   bool yay0, u32 num_threads) {
+  if (num_threads != 1) {
+    auto szs = TRY(::szs::encode_parallel(buf, static_cast<::szs::Algo>(algo),
+                                          num_threads));
+    if (yay0) {
+      return ::szs::deinterlace(szs);
+    }
+    return szs;
+  }
   if (yay0) {
     return ::szs::encode_yay0(buf, static_cast<::szs::Algo>(algo));
   }
@@ -33,8 +41,24 @@ Result<void> decode(std::span<u8> dst, std::span<const u8> src, bool yay0) {
   return ::szs::decode_into(dst, src);
 }
 
+struct StreamDecoder::Impl {
+  ::szs::StreamDecoder decoder;
+};
+StreamDecoder::StreamDecoder() : m_impl(std::make_unique<Impl>()) {}
+StreamDecoder::~StreamDecoder() = default;
+
+Result<StreamDecoder::Progress> StreamDecoder::decode(std::span<const u8> src,
+                                                      std::span<u8> dst) {
+  auto p = TRY(m_impl->decoder.decode(src, dst));
+  return Progress{.src_used = p.src_used, .dst_used = p.dst_used};
+}
+bool StreamDecoder::done() const { return m_impl->decoder.is_done(); }
+u32 StreamDecoder::expandedSize() const {
+  return m_impl->decoder.expanded_size();
+}
+
 u32 getWorstEncodingSize(std::span<const u8> src) {
-  return 16 + roundUp(src.size(), 8) / 8 * 9 - 1;
+  return 16 + roundUp(src.size(), 8) / 8 * 9;
 }
 
 std::string_view szs_version() {
@@ -12,6 +12,28 @@ Result<u32> getExpandedSize(std::span<const u8> src);
 Result<void> decode(std::span<u8> dst, std::span<const u8> src,
                     bool yay0 = false);
 
+// Incremental YAZ0 decoder. Only the 4 KiB back-reference window is retained,
+// so arbitrarily large streams can be decoded in constant memory.
+class StreamDecoder {
+public:
+  struct Progress {
+    u32 src_used = 0;
+    u32 dst_used = 0;
+  };
+
+  StreamDecoder();
+  ~StreamDecoder();
+
+  // Unconsumed input must be passed again on the next call.
+  Result<Progress> decode(std::span<const u8> src, std::span<u8> dst);
+  bool done() const;
+  u32 expandedSize() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
 u32 getWorstEncodingSize(std::span<const u8> src);
 
 enum class Algo {
@@ -23,9 +45,12 @@ enum class Algo {
   CTLib,
   LibYaz0,
   MK8,
+  BestRatio,
 };
+// |num_threads| != 1 encodes segments concurrently (0: one per hardware
+// thread). The output remains a single valid stream.
 Result<std::vector<u8>> encodeAlgo(std::span<const u8> buf, Algo algo,
-                                   bool yay0 = false);
+                                   bool yay0 = false, u32 num_threads = 1);
 
 std::string_view szs_version();
 
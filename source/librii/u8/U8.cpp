@@ -45,7 +45,7 @@ struct LowU8Archive {
   rvlArchiveHeader header;
   std::vector<rvlArchiveNode> nodes;
   std::string strings;       // One giant string
-  std::vector<u8> file_data; // One giant buffer
+  rsl::byte_view file_data; // One giant buffer, viewed in |data|
 };
 
 #define rvlArchiveNodeIsFolder(node) ((node).packed_type_name & 0xff000000)
@@ -127,10 +127,8 @@ Result<void> LoadU8Archive(LowU8Archive& result, rsl::byte_view data) {
   return {};
 }
 
-Result<U8Archive> LoadU8Archive(rsl::byte_view data) {
+static U8Archive LoadU8Nodes(const LowU8Archive& low) {
   U8Archive result;
-  LowU8Archive low;
-  TRY(LoadU8Archive(low, data));
 
   result.watermark = low.header.watermark;
   for (auto& node : low.nodes) {
@@ -148,7 +146,29 @@ Result<U8Archive> LoadU8Archive(rsl::byte_view data) {
     result.nodes.push_back(tmp);
   }
 
-  result.file_data = std::move(low.file_data);
+  return result;
+}
+
+Result<U8Archive> LoadU8Archive(rsl::byte_view data) {
+  LowU8Archive low;
+  TRY(LoadU8Archive(low, data));
+
+  U8Archive result = LoadU8Nodes(low);
+  result.file_data = {low.file_data.begin(), low.file_data.end()};
+  return result;
+}
+
+Result<U8Archive> LoadU8ArchiveNodes(rsl::byte_view data) {
+  LowU8Archive low;
+  TRY(LoadU8Archive(low, data));
+
+  U8Archive result = LoadU8Nodes(low);
+  const u32 fd_trans = low.file_data.data() - data.data();
+  for (auto& node : result.nodes) {
+    if (!node.is_folder) {
+      node.file.offset += fd_trans;
+    }
+  }
   return result;
 }
 
@@ -34,6 +34,9 @@ struct U8Archive {
 bool IsDataU8Archive(rsl::byte_view data);
 
 Result<U8Archive> LoadU8Archive(rsl::byte_view data);
+//! Reads the node tree but leaves |file_data| empty. File offsets are relative
+//! to the start of |data|, so contents can be viewed in place.
+Result<U8Archive> LoadU8ArchiveNodes(rsl::byte_view data);
 std::vector<u8> SaveU8Archive(const U8Archive& arc);
 
 //! Get the Node associated with a certain path, or -1.
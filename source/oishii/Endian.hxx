@@ -1,7 +1,24 @@
 #pragma once
 
 #include <bit>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#define OISHII_SWAP_AVX2
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+#define OISHII_SWAP_SSSE3
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OISHII_SWAP_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define OISHII_SWAP_NEON
+#include <arm_neon.h>
+#endif
 
 namespace oishii {
 
@@ -90,6 +107,100 @@ inline T endianDecode(T val, std::endian fileEndian) {
   return val;
 }
 
+template <EndianSelect E = EndianSelect::Current>
+constexpr bool needsSwap(std::endian fileEndian) {
+  if constexpr (E == EndianSelect::Big) {
+    return std::endian::native != std::endian::big;
+  } else if constexpr (E == EndianSelect::Little) {
+    return std::endian::native != std::endian::little;
+  }
+  return std::endian::native != fileEndian;
+}
+
+namespace detail {
+
+// Swap one 16-byte block of 2- or 4-byte values. Returns false if there is no
+// vector unit to do it with.
+template <size_t Size>
+inline bool swapBlock16(uint8_t* out, const uint8_t* in) {
+#if defined(OISHII_SWAP_SSSE3)
+  const __m128i mask =
+      Size == 2 ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12,
+                                15, 14)
+                : _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14,
+                                13, 12);
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(v, mask));
+  return true;
+#elif defined(OISHII_SWAP_SSE2)
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  if constexpr (Size == 4) {
+    // Swap the halfwords, then the bytes within them
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+  }
+  v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+  return true;
+#elif defined(OISHII_SWAP_NEON)
+  const uint8x16_t v = vld1q_u8(in);
+  vst1q_u8(out, Size == 2 ? vrev16q_u8(v) : vrev32q_u8(v));
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace detail
+
+//! @brief Copy |count| values of type |T| from |src| to |dst|, endian swapping
+//! each.
+//!
+//! Neither pointer needs to be aligned. 2- and 4-byte values are swapped 16
+//! (AVX2: 32) bytes at a time with SSE2/SSSE3/AVX2 or NEON byte shuffles.
+template <typename T>
+inline void swapEndianBulk(void* dst, const void* src, size_t count) {
+  static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4,
+                "T must of size 1, 2, or 4");
+  using integral_t = typename integral_of_equal_size<sizeof(T)>::type;
+  auto* out = static_cast<uint8_t*>(dst);
+  const auto* in = static_cast<const uint8_t*>(src);
+  if constexpr (sizeof(T) == 1) {
+    memmove(out, in, count);
+    return;
+  } else {
+    size_t i = 0;
+    const size_t bytes = count * sizeof(T);
+#if defined(OISHII_SWAP_AVX2)
+    const __m256i mask =
+        sizeof(T) == 2
+            ? _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15,
+                               14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13,
+                               12, 15, 14)
+            : _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13,
+                               12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15,
+                               14, 13, 12);
+    for (; i + 32 <= bytes; i += 32) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                          _mm256_shuffle_epi8(v, mask));
+    }
+#endif
+    for (; i + 16 <= bytes; i += 16) {
+      if (!detail::swapBlock16<sizeof(T)>(out + i, in + i)) {
+        break;
+      }
+    }
+    for (; i < bytes; i += sizeof(T)) {
+      integral_t v;
+      memcpy(&v, in + i, sizeof(T));
+      v = std::byteswap(v);
+      memcpy(out + i, &v, sizeof(T));
+    }
+  }
+}
+
 constexpr uint32_t roundDown(uint32_t in, uint32_t align) {
   return align ? in & ~(align - 1) : in;
 }
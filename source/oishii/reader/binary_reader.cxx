@@ -172,19 +172,29 @@ void BinaryReader::warnAt(const char* msg, uint32_t selectBegin,
 
 BinaryReader::BinaryReader(std::vector<u8>&& view, std::string_view path,
                            std::endian endian)
-    : VectorStream(std::move(view)), m_endian(endian), m_path(path) {}
+    : mOwned(std::move(view)), mView(mOwned), m_endian(endian), m_path(path) {}
 BinaryReader::BinaryReader(std::span<const u8> view, std::string_view path,
                            std::endian endian)
-    : VectorStream(std::vector<u8>{view.begin(), view.end()}), m_endian(endian),
+    : mView(view), m_endian(endian), m_path(path) {}
+BinaryReader::BinaryReader(MemoryMap&& map, std::string_view path,
+                           std::endian endian)
+    : mMap(std::move(map)), mView(mMap.data()), m_endian(endian),
       m_path(path) {}
 BinaryReader::~BinaryReader() = default;
 
+// Moving |mOwned| and |mMap| keeps their storage in place, so |mView| remains
+// valid
 BinaryReader::BinaryReader(BinaryReader&&) = default;
 
 std::expected<BinaryReader, std::string>
 BinaryReader::FromFilePath(std::string_view path, std::endian endian) {
-  auto vec = TRY(UtilReadFile(path));
-  return BinaryReader(std::move(vec), path, endian);
+  auto map = MemoryMap::Open(path);
+  if (!map) {
+    // Not every file can be mapped (e.g. pipes); fall back to reading it
+    auto vec = TRY(UtilReadFile(path));
+    return BinaryReader(std::move(vec), path, endian);
+  }
+  return BinaryReader(std::move(*map), path, endian);
 }
 
 template <typename T, EndianSelect E = EndianSelect::Current,
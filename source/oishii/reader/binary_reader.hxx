@@ -1,8 +1,9 @@
 #pragma once
 
+#include "../AbstractStream.hxx"
 #include "../Endian.hxx"
-#include "../VectorStream.hxx"
 #include "../interfaces.hxx"
+#include "memory_map.hxx"
 #include <rsl/DebugBreak.hpp>
 #include <rsl/Expected.hpp>
 #include <rsl/Format.hpp>
@@ -12,24 +13,36 @@ extern bool gTestMode;
 
 namespace oishii {
 
-class BinaryReader final : public VectorStream {
+//! Reads from memory it does not copy: a buffer it takes ownership of, a span
+//! borrowed from the caller, or a memory-mapped file.
+class BinaryReader final : public AbstractStream {
 public:
   //! Failure type is always `std::string`
   template <typename T> using Result = std::expected<T, std::string>;
 
-  //! Read file from memory
+  //! Read file from memory, taking ownership of it
   BinaryReader(std::vector<u8>&& view, std::string_view path,
                std::endian endian);
+  //! Read file from memory without copying. |view| must outlive the reader.
   BinaryReader(std::span<const u8> view, std::string_view path,
                std::endian endian);
+  //! Read a memory-mapped file
+  BinaryReader(MemoryMap&& map, std::string_view path, std::endian endian);
   BinaryReader(const BinaryReader&) = delete;
   BinaryReader(BinaryReader&&);
   ~BinaryReader();
 
-  //! Read file from disc
+  //! Read file from disc. The file is memory-mapped, not read in.
   static Result<BinaryReader> FromFilePath(std::string_view path,
                                            std::endian endian);
 
+  void seekSet(uint32_t pos) override { mPos = pos; }
+  uint32_t tell() const override { return mPos; }
+  uint32_t endpos() const override {
+    return static_cast<uint32_t>(mView.size());
+  }
+  const uint8_t* getStreamStart() const { return mView.data(); }
+
   // The |BinaryReader| keeps track of the files endianness
   std::endian endian() const { return m_endian; }
   void setEndian(std::endian endian) noexcept { m_endian = endian; }
@@ -38,7 +51,7 @@ public:
   const char* getFile() const noexcept { return m_path.c_str(); }
 
   //! Get a read-only view of the file
-  std::span<const u8> slice() const { return mBuf; }
+  std::span<const u8> slice() const { return mView; }
 
   //! Pop a value from the stream (of type |T|)
   template <typename T,                             //
@@ -121,41 +134,76 @@ public:
   void warnAt(const char* msg, uint32_t selectBegin, uint32_t selectEnd,
               bool checkStack = true);
 
+  //! Decode |out.size()| values at |addr| straight into |out|.
+  //!
+  //! One bounds check covers the whole span, and the values are endian
+  //! swapped in bulk. |T| is either a 1-, 2- or 4-byte scalar or an aggregate
+  //! of them with a `value_type`, such as `glm::vec3`; each of its scalars is
+  //! swapped separately.
   template <typename T>
-  auto tryReadBuffer(uint32_t size, uint32_t addr) -> Result<std::vector<T>> {
-    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4);
-    if (addr + size * sizeof(T) > endpos()) {
+  auto tryReadInto(std::span<T> out, uint32_t addr) -> Result<void> {
+    using Scalar = typename ScalarOf<T>::type;
+    static_assert(sizeof(Scalar) == 1 || sizeof(Scalar) == 2 ||
+                  sizeof(Scalar) == 4);
+    static_assert(sizeof(T) % sizeof(Scalar) == 0);
+    const size_t bytes = out.size_bytes();
+    if (addr + static_cast<uint64_t>(bytes) > endpos()) {
       auto err = std::format("Bounds error: Reading {} bytes from 0x{:} ({} "
                              "decimal) exceeds buffer size of 0x{:x} ({})",
-                             sizeof(T) * size, addr, addr, endpos(), endpos());
-      rsl::debug_break();
+                             bytes, addr, addr, endpos(), endpos());
+      if (gTestMode) {
+        fprintf(stderr, "%s\n", err.c_str());
+        rsl::debug_break();
+      }
       return std::unexpected(err);
     }
-    readerBpCheck(size, addr - tell());
-    if constexpr (sizeof(T) == 1) {
-      std::vector<T> out(size);
-      std::copy_n(mBuf.begin() + addr, size, out.begin());
-      return out;
+    readerBpCheck(static_cast<uint32_t>(bytes), addr - tell());
+    if (needsSwap(m_endian)) {
+      swapEndianBulk<Scalar>(out.data(), mView.data() + addr,
+                             bytes / sizeof(Scalar));
+    } else if (bytes != 0) {
+      memcpy(out.data(), mView.data() + addr, bytes);
     }
+    return {};
+  }
+  //! Decode |out.size()| values from the stream straight into |out|
+  template <typename T> auto tryReadInto(std::span<T> out) -> Result<void> {
+    TRY(tryReadInto(out, tell()));
+    seekSet(tell() + static_cast<uint32_t>(out.size_bytes()));
+    return {};
+  }
+
+  template <typename T>
+  auto tryReadBuffer(uint32_t size, uint32_t addr) -> Result<std::vector<T>> {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4);
     std::vector<T> out(size);
-    auto it = addr;
-    for (auto& t : out) {
-      t = TRY(tryGetAt<T>(it));
-      it += sizeof(T);
-    }
+    TRY(tryReadInto<T>(out, addr));
     return out;
   }
   template <typename T>
   auto tryReadBuffer(uint32_t size) -> Result<std::vector<T>> {
-    auto buf = tryReadBuffer<T>(size, tell());
-    if (!buf) {
-      return std::unexpected(buf.error());
-    }
-    seekSet(tell() + size);
-    return *buf;
+    std::vector<T> out(size);
+    TRY(tryReadInto<T>(out));
+    return out;
   }
 
 private:
+  template <typename T> struct ScalarOf {
+    using type = T;
+  };
+  template <typename T>
+    requires requires { typename T::value_type; }
+  struct ScalarOf<T> {
+    using type = typename T::value_type;
+  };
+
+  // Backing storage; |mView| points into one of these, or into memory owned
+  // by the caller.
+  std::vector<u8> mOwned;
+  MemoryMap mMap;
+  std::span<const u8> mView;
+  uint32_t mPos = 0;
+
   std::endian m_endian = std::endian::big;
   std::string m_path = "Unknown Path";
 
@@ -168,6 +216,8 @@ private:
   void exitRegion(uint32_t jump_save, uint32_t jump_size_save);
 };
 
+//! View of the rest of the stream. Points into the reader's backing memory;
+//! nothing is copied.
 inline std::span<const u8> SliceStream(oishii::BinaryReader& reader) {
   return {reader.getStreamStart() + reader.tell(),
           reader.endpos() - reader.tell()};
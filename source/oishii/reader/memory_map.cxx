@@ -0,0 +1,123 @@
+#if defined(_WIN32)
+#include <Windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "memory_map.hxx"
+
+#include "../util/util.hxx"
+
+namespace oishii {
+
+MemoryMap& MemoryMap::operator=(MemoryMap&& rhs) noexcept {
+  if (this != &rhs) {
+    close();
+    // Moving a std::vector keeps its storage, so views into it stay valid
+    mOwned = std::move(rhs.mOwned);
+    mView = rhs.mView;
+    mMapping = rhs.mMapping;
+    rhs.mView = {};
+    rhs.mMapping = nullptr;
+  }
+  return *this;
+}
+
+#if defined(_WIN32)
+std::expected<MemoryMap, std::string> MemoryMap::Open(std::string_view path) {
+  HANDLE file = CreateFileA(std::string(path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return std::unexpected("Failed to open file " + std::string(path));
+  }
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return std::unexpected("Failed to stat file " + std::string(path));
+  }
+  MemoryMap result;
+  if (size.QuadPart == 0) {
+    // Empty files cannot be mapped
+    CloseHandle(file);
+    return result;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  // The mapping keeps the file open
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return std::unexpected("Failed to map file " + std::string(path));
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    return std::unexpected("Failed to map file " + std::string(path));
+  }
+  result.mMapping = mapping;
+  result.mView = {static_cast<const uint8_t*>(view),
+                  static_cast<size_t>(size.QuadPart)};
+  return result;
+}
+void MemoryMap::close() {
+  if (mMapping != nullptr) {
+    UnmapViewOfFile(mView.data());
+    CloseHandle(static_cast<HANDLE>(mMapping));
+  }
+  mMapping = nullptr;
+  mView = {};
+  mOwned.clear();
+}
+#elif !defined(__EMSCRIPTEN__)
+std::expected<MemoryMap, std::string> MemoryMap::Open(std::string_view path) {
+  int fd = ::open(std::string(path).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return std::unexpected("Failed to open file " + std::string(path));
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return std::unexpected("Failed to stat file " + std::string(path));
+  }
+  MemoryMap result;
+  if (st.st_size == 0) {
+    // Empty files cannot be mapped
+    ::close(fd);
+    return result;
+  }
+  void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file open
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    return std::unexpected("Failed to map file " + std::string(path));
+  }
+  result.mMapping = view;
+  result.mView = {static_cast<const uint8_t*>(view),
+                  static_cast<size_t>(st.st_size)};
+  return result;
+}
+void MemoryMap::close() {
+  if (mMapping != nullptr) {
+    munmap(mMapping, mView.size());
+  }
+  mMapping = nullptr;
+  mView = {};
+  mOwned.clear();
+}
+#else
+std::expected<MemoryMap, std::string> MemoryMap::Open(std::string_view path) {
+  MemoryMap result;
+  result.mOwned = TRY(UtilReadFile(path));
+  result.mView = result.mOwned;
+  return result;
+}
+void MemoryMap::close() {
+  mView = {};
+  mOwned.clear();
+}
+#endif
+
+} // namespace oishii
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <rsl/Expected.hpp>
+#include <span>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace oishii {
+
+//! Read-only view of a file, mapped into memory rather than copied.
+//!
+//! Pages are only loaded as they are touched, and are shared with the OS file
+//! cache, so opening a large file costs neither a full read nor a second copy
+//! of it in memory. On platforms without file mapping (Emscripten), the file is
+//! read into an owned buffer instead.
+class MemoryMap {
+public:
+  static std::expected<MemoryMap, std::string> Open(std::string_view path);
+
+  MemoryMap() = default;
+  MemoryMap(MemoryMap&& rhs) noexcept { *this = std::move(rhs); }
+  MemoryMap& operator=(MemoryMap&& rhs) noexcept;
+  MemoryMap(const MemoryMap&) = delete;
+  MemoryMap& operator=(const MemoryMap&) = delete;
+  ~MemoryMap() { close(); }
+
+  std::span<const uint8_t> data() const { return mView; }
+
+private:
+  void close();
+
+  std::span<const uint8_t> mView;
+  // Platform mapping handle, if any
+  void* mMapping = nullptr;
+  // Fallback when the file could not be mapped
+  std::vector<uint8_t> mOwned;
+};
+
+} // namespace oishii
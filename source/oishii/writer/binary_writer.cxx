@@ -27,6 +27,30 @@ uint32_t Writer::reserveNext(int32_t n) {
 
 void Writer::saveToDisk(std::string_view path) const { FlushFile(mBuf, path); }
 
+#ifndef NDEBUG
+void Writer::checkMatch(uint32_t pos, const void* data, uint32_t size) {
+  if (mDebugMatch.size() < pos + size) {
+    return;
+  }
+  const u8* expected = mDebugMatch.data() + pos;
+  const u8* actual = static_cast<const u8*>(data);
+  // Placeholders for links are written as 0xcc bytes, then overwritten
+  if (memcmp(expected, actual, size) == 0 ||
+      std::all_of(actual, actual + size, [](u8 x) { return x == 0xcc; })) {
+    return;
+  }
+  for (uint32_t i = 0; i < size; ++i) {
+    if (expected[i] != actual[i]) {
+      fprintf(stderr,
+              "Matching violation at 0x%x: writing %x where should be %x\n",
+              pos + i, actual[i], expected[i]);
+      break;
+    }
+  }
+  rsl::debug_break();
+}
+#endif
+
 void Writer::breakPointProcess(uint32_t tell, uint32_t size) {
   if (shouldBreak(tell, size)) {
     printf("Writing to %04u (0x%04x) sized %u\n", tell, tell, size);
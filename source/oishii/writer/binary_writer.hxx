@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <bit>
+#include <span>
+#include <string.h>
 #include <string>
 #include <vector>
 
@@ -19,15 +22,11 @@ public:
   template <typename T, EndianSelect E = EndianSelect::Current>
   void write(T val, bool checkmatch = true) {
     using integral_t = integral_of_equal_size_t<T>;
-    if (tell() > 200'000'000) {
-      fprintf(stderr, "File size is astronomical");
-      rsl::debug_break();
-      abort();
-    }
-    while (tell() + sizeof(T) > mBuf.size())
-      mBuf.push_back(0);
+    growTo(tell() + sizeof(T));
 
+#ifndef NDEBUG
     breakPointProcess(sizeof(T));
+#endif
 
     union {
       integral_t integral;
@@ -37,55 +36,58 @@ public:
     const auto decoded = endianDecode<integral_t, E>(raw.integral, m_endian);
 
 #ifndef NDEBUG
-    if (checkmatch && mDebugMatch.size() > tell() + sizeof(T)) {
-      const auto before = *reinterpret_cast<integral_t*>(&mDebugMatch[tell()]);
-      if (before != decoded && decoded != 0xcccccccc) {
-        fprintf(stderr,
-                "Matching violation at 0x%x: writing %x where should be %x\n",
-                tell(), (uint32_t)decoded, (uint32_t)before);
-
-        rsl::debug_break();
-      }
+    if (checkmatch) {
+      checkMatch(tell(), &decoded, sizeof(T));
     }
 #endif
 
-    *reinterpret_cast<integral_t*>(&mBuf[tell()]) = decoded;
+    memcpy(&mBuf[tell()], &decoded, sizeof(T));
 
     seek<Whence::Current>(sizeof(T));
   }
 
+  //! Write an array of values at once, byte-swapping them in bulk.
+  template <typename T, EndianSelect E = EndianSelect::Current>
+  void writeSpan(std::span<const T> vals, bool checkmatch = true) {
+    const uint32_t size = static_cast<uint32_t>(vals.size_bytes());
+    if (size == 0) {
+      return;
+    }
+    growTo(tell() + size);
+
+#ifndef NDEBUG
+    breakPointProcess(size);
+#endif
+
+    u8* dst = &mBuf[tell()];
+    if (needsSwap<E>(m_endian)) {
+      swapEndianBulk<T>(dst, vals.data(), vals.size());
+    } else {
+      memcpy(dst, vals.data(), size);
+    }
+
+#ifndef NDEBUG
+    if (checkmatch) {
+      checkMatch(tell(), dst, size);
+    }
+#endif
+
+    seek<Whence::Current>(size);
+  }
+
+  //! Reserve capacity for a file of |size| bytes up front.
+  void reserve(uint32_t size) { mBuf.reserve(size); }
+
   template <typename T, EndianSelect E = EndianSelect::Current>
   inline void writeUnaligned(T value) {
     write<T, E>(value);
   }
   template <EndianSelect E = EndianSelect::Current>
   void writeN(std::size_t sz, uint32_t val) {
-    if (tell() > 200'000'000) {
-      fprintf(stderr, "File size is astronomical");
-      rsl::debug_break();
-      abort();
-    }
-    while (tell() + sz > mBuf.size())
-      mBuf.push_back(0);
-
-    uint32_t decoded = endianDecode<uint32_t, E>(val);
-
-#if 0
-#ifndef NDEBUG1
-		if (/*checkmatch && */mDebugMatch.size() > tell() + sz)
-		{
-			for (int i = 0; i < sz; ++i)
-			{
-				const auto before = mDebugMatch[tell() + i];
-				if (before != decoded >> (8 * i))
-				{
-					printf("Matching violation at %x: writing %x where should be %x\n", tell(), decoded, before);
-					rsl::debug_break();
-				}
-			}
-		}
-#endif
-#endif
+    growTo(tell() + sz);
+
+    uint32_t decoded = endianDecode<uint32_t, E>(val, m_endian);
+
     for (int i = 0; i < sz; ++i)
       mBuf[tell() + i] = static_cast<u8>(decoded >> (8 * i));
 
@@ -149,6 +151,26 @@ public:
   void breakPointProcess(uint32_t size);
 
 private:
+  void growTo(uint32_t end) {
+    if (end <= mBuf.size()) {
+      return;
+    }
+    if (end > 200'000'000) {
+      fprintf(stderr, "File size is astronomical");
+      rsl::debug_break();
+      abort();
+    }
+    // Double the capacity so a stream of small writes is amortized O(1)
+    if (end > mBuf.capacity()) {
+      mBuf.reserve(std::max<size_t>(end, mBuf.capacity() * 2));
+    }
+    mBuf.resize(end);
+  }
+
+#ifndef NDEBUG
+  void checkMatch(uint32_t pos, const void* data, uint32_t size);
+#endif
+
   std::endian m_endian = std::endian::big; // to swap
 };
 
@@ -10,9 +10,11 @@ namespace riistudio::g3d {
 
 Result<void> ReadBRRES(Collection& collection, librii::g3d::Archive& archive,
                        std::string path);
+//! |num_threads| != 1 decodes the subfiles in parallel (0: one per core)
 [[nodiscard]] Result<void> ReadBRRES(Collection& collection,
                                      oishii::BinaryReader& reader,
-                                     kpi::LightIOTransaction& transaction);
+                                     kpi::LightIOTransaction& transaction,
+                                     unsigned num_threads = 1);
 [[nodiscard]] Result<void> WriteBRRES(Collection& collection,
                                       oishii::Writer& writer);
 
@@ -104,9 +104,10 @@ Result<void> ReadBRRES(Collection& collection, librii::g3d::Archive& archive,
 }
 
 Result<void> ReadBRRES(Collection& collection, oishii::BinaryReader& reader,
-                       kpi::LightIOTransaction& transaction) {
+                       kpi::LightIOTransaction& transaction,
+                       unsigned num_threads) {
   librii::g3d::BinaryArchive bin;
-  if (auto r = bin.read(reader, transaction); !r) {
+  if (auto r = bin.read(reader, transaction, num_threads); !r) {
     transaction.callback(kpi::IOMessageClass::Error, "BRRES", r.error());
     return std::unexpected(r.error());
   }
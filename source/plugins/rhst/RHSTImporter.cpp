@@ -4,6 +4,7 @@
 #include <plugins/3d/i3dmodel.hpp>
 
 #include <librii/crate/g3d_crate.hpp>
+#include <librii/g3d/data/VertexQuantize.hpp>
 #include <librii/g3d/io/TextureIO.hpp>
 #include <librii/hx/CullMode.hpp>
 #include <librii/hx/PixMode.hpp>
@@ -20,8 +21,9 @@
 
 #include <rsl/FsDialog.hpp>
 #include <rsl/Stb.hpp>
+#include <rsl/ThreadPool.hpp>
 
-#include <future>
+#include <latch>
 
 // XXX: Hack, though we'll refactor all of this way soon
 std::string rebuild_dest;
@@ -945,8 +947,8 @@ static inline std::string getFileShort(const std::string& path) {
   return tmp;
 }
 Result<void> importTextureImpl(libcube::Texture& data, std::span<u8> image,
-                               std::vector<u8>& scratch, int num_mip, int width,
-                               int height, int source_w, int source_h,
+                               int num_mip, int width, int height,
+                               int source_w, int source_h,
                                librii::gx::TextureFormat fmt,
                                librii::image::ResizingAlgorithm resize) {
   data.setTextureFormat(fmt);
@@ -955,35 +957,16 @@ Result<void> importTextureImpl(libcube::Texture& data, std::span<u8> image,
   data.setMipmapCount(num_mip);
   data.setLod(false, 0.0f, static_cast<f32>(data.getImageCount()));
   data.resizeData();
-  if (num_mip == 0) {
-    std::vector<u8> scratch(4 * width * height);
-    librii::image::resize(scratch, width, height, image, source_w, source_h,
-                          resize);
-    TRY(data.encode(scratch));
-  } else {
-    rsl::trace("Width: {}, Height: {}.", width, height);
-    u32 size = 0;
-    for (int i = 0; i <= num_mip; ++i) {
-      size += (width >> i) * (height >> i) * 4;
-      rsl::trace("Image {}: {}, {}. -> Total Size: {}", i, width >> i,
-                 height >> i, size);
-    }
-    scratch.resize(size);
-
-    u32 slide = 0;
-    for (int i = 0; i <= num_mip; ++i) {
-      librii::image::resize(std::span(scratch).subspan(slide), width >> i,
-                            height >> i, image, source_w, source_h, resize);
-      slide += (width >> i) * (height >> i) * 4;
-    }
-
-    TRY(data.encode(scratch));
-  }
+  // Decodes |image| once and derives each level from the one above it
+  TRY(librii::image::generateMipChain(
+      data.getData(), width, height, fmt, num_mip, image, source_w, source_h,
+      librii::gx::TextureFormat::Extension_RawRGBA32,
+      librii::image::MipFilter::Lanczos, resize));
   return {};
 }
 Result<void> importTexture(libcube::Texture& data, std::span<u8> image,
-                           std::vector<u8>& scratch, bool mip_gen, int min_dim,
-                           int max_mip, int width, int height, int channels,
+                           bool mip_gen, int min_dim, int max_mip, int width,
+                           int height, int channels,
                            librii::gx::TextureFormat format) {
   if (image.empty()) {
     return std::unexpected(
@@ -1005,22 +988,32 @@ Result<void> importTexture(libcube::Texture& data, std::span<u8> image,
       ++num_mip;
   }
 
-  return importTextureImpl(data, image, scratch, num_mip, width, height, width,
-                           height, format);
+  return importTextureImpl(data, image, num_mip, width, height, width, height,
+                           format);
 }
 
 Result<void> importTextureFromMemory(libcube::Texture& data,
-                                     std::span<const u8> span,
-                                     std::vector<u8>& scratch, bool mip_gen,
+                                     std::span<const u8> span, bool mip_gen,
                                      int min_dim, int max_mip) {
   auto image = TRY(rsl::stb::load_from_memory(span));
-  return importTexture(data, image.data, scratch, mip_gen, min_dim, max_mip,
+  return importTexture(data, image.data, mip_gen, min_dim, max_mip,
                        image.width, image.height, image.channels);
 }
+
+// Scratch memory texture import may hold across all threads
+constexpr size_t TextureImportBudget = 512 * 1024 * 1024;
+
+// Peak memory of importing a |width| x |height| image: stb's buffer and our
+// copy of it, the mip scratch arena and the encoded chain. Each is at most
+// about the raw RGBA size.
+static size_t TextureImportFootprint(int width, int height) {
+  return static_cast<size_t>(width) * height * 4 * 4;
+}
+
 Result<void> importTextureFromFile(libcube::Texture& data,
-                                   std::string_view path,
-                                   std::vector<u8>& scratch, bool mip_gen,
-                                   int min_dim, int max_mip) {
+                                   std::string_view path, bool mip_gen,
+                                   int min_dim, int max_mip,
+                                   rsl::MemoryBudget* budget) {
   if (path.ends_with(".tex0")) {
     auto obuf = ReadFile(path);
     if (!obuf) {
@@ -1038,16 +1031,21 @@ Result<void> importTextureFromFile(libcube::Texture& data,
     memcpy(span.data(), tex.data.data(), span.size());
     return {};
   }
+  rsl::MemoryBudget::Grant grant;
+  if (budget != nullptr) {
+    auto header = TRY(rsl::stb::info(path));
+    grant = budget->reserve(
+        TextureImportFootprint(header.width, header.height));
+  }
   auto image = TRY(rsl::stb::load(path));
-  return importTexture(data, image.data, scratch, mip_gen, min_dim, max_mip,
+  return importTexture(data, image.data, mip_gen, min_dim, max_mip,
                        image.width, image.height, image.channels);
 }
 
 void import_texture(std::string tex, libcube::Texture* pdata,
                     std::filesystem::path file_path,
-                    std::optional<MipGen> mips) {
+                    std::optional<MipGen> mips, rsl::MemoryBudget* budget) {
   libcube::Texture& data = *pdata;
-  std::vector<u8> scratch;
   bool mip_gen = mips.has_value();
   u32 min_dim = mips ? mips->min_dim : 0;
   u32 max_mip = mips ? mips->max_mip : 0;
@@ -1061,8 +1059,8 @@ void import_texture(std::string tex, libcube::Texture* pdata,
   search_paths.push_back(file_path.parent_path() / "textures" / (tex + ".png"));
 
   for (const auto& path : search_paths) {
-    if (importTextureFromFile(data, path.string().c_str(), scratch, mip_gen,
-                              min_dim, max_mip)) {
+    if (importTextureFromFile(data, path.string().c_str(), mip_gen, min_dim,
+                              max_mip, budget)) {
       return;
     }
   }
@@ -1072,15 +1070,55 @@ void import_texture(std::string tex, libcube::Texture* pdata,
   const auto dummy_height = 32;
   data.setWidth(dummy_width);
   data.setHeight(dummy_height);
-  scratch.resize(dummy_width * dummy_height * 4);
+  std::vector<u8> checkerboard(dummy_width * dummy_height * 4);
   // Make a basic checkerboard
-  librii::image::generateCheckerboard(scratch, dummy_width, dummy_height);
+  librii::image::generateCheckerboard(checkerboard, dummy_width, dummy_height);
   data.setMipmapCount(0);
   data.setTextureFormat(librii::gx::TextureFormat::CMPR);
-  data.encode(scratch);
+  data.encode(checkerboard);
   // unresolved.emplace(i, tex);
 }
 
+QuantizeReport OptimizeVertexQuantization(libcube::Model& mdl) {
+  // Largest error accepted: for positions, a fraction of the buffer's extent
+  constexpr f32 PositionTolerance = 1.0f / 4096.0f;
+  constexpr f32 NormalTolerance = 1.0f / 100.0f;
+  constexpr f32 TexCoordTolerance = 1.0f / 1024.0f;
+
+  QuantizeReport report;
+  auto* g = dynamic_cast<riistudio::g3d::Model*>(&mdl);
+  if (g == nullptr) {
+    return report;
+  }
+  auto optimize = [&](auto& buf, f32 tolerance) {
+    const auto result = librii::g3d::OptimizeQuantization(buf, tolerance);
+    report.bytes_before += result.bytes_before;
+    report.bytes_after += result.bytes_after;
+    if (result.bytes_after != result.bytes_before) {
+      ++report.buffers;
+      rsl::info("{}: {} -> {} bytes ({} fractional bits, max error {})",
+                buf.mName, result.bytes_before, result.bytes_after,
+                buf.mQuantize.divisor, result.max_error);
+    }
+  };
+  for (auto& buf : g->getBuf_Pos()) {
+    if (buf.mEntries.empty()) {
+      continue;
+    }
+    const auto mm = librii::g3d::ComputeMinMax(buf);
+    const glm::vec3 extent = mm.max - mm.min;
+    const f32 widest = std::max({extent.x, extent.y, extent.z});
+    optimize(buf, widest * PositionTolerance);
+  }
+  for (auto& buf : g->getBuf_Nrm()) {
+    optimize(buf, NormalTolerance);
+  }
+  for (auto& buf : g->getBuf_Uv()) {
+    optimize(buf, TexCoordTolerance);
+  }
+  return report;
+}
+
 bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
                  std::string path,
                  std::function<void(std::string, std::string)> info,
@@ -1128,14 +1166,18 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
   // Favor PNG, and the current directory
   auto file_path = std::filesystem::path(path);
 
-  std::vector<std::future<void>> futures;
+  // Textures and mesh optimization share one pool, bounded by the core count
+  // rather than the texture count. The budget bounds how many decoded images
+  // are alive at once.
+  rsl::MemoryBudget texture_budget(TextureImportBudget);
+  rsl::ThreadPool pool;
 
   for (int i = 0; i < scene.getTextures().size(); ++i) {
     libcube::Texture* data = &scene.getTextures()[i];
 
-    futures.push_back(std::async(std::launch::async, [=] {
-      import_texture(data->getName(), data, file_path, mips);
-    }));
+    pool.submit([=, &texture_budget] {
+      import_texture(data->getName(), data, file_path, mips, &texture_budget);
+    });
   }
 
   // Optimize meshes
@@ -1146,35 +1188,36 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
     progress(std::format("Optimizing meshes ({} / {})", 0, total), 0.0f);
 
     rsl::Timer timer;
-    for (auto& mesh : rhst.meshes) {
-      auto task = [&](librii::rhst::Mesh* mesh) {
-        assert(mesh != nullptr);
-        int i = 0;
-        for (auto& mp : mesh->matrix_primitives) {
-          auto ok = librii::rhst::StripifyTriangles(
-              mp, std::nullopt,
-              mesh->matrix_primitives.size() > 1
-                  ? std::format("{}::{}", mesh->name, i)
-                  : mesh->name,
-              verbose);
-          ++i;
-          if (!ok) {
-            rsl::error("Error: Failed to stripify mesh {}. {}", mesh->name,
-                       ok.error());
-          }
+    std::latch stripped(total);
+    auto task = [&](librii::rhst::Mesh* mesh) {
+      assert(mesh != nullptr);
+      int i = 0;
+      for (auto& mp : mesh->matrix_primitives) {
+        auto ok = librii::rhst::StripifyTriangles(
+            mp, std::nullopt,
+            mesh->matrix_primitives.size() > 1
+                ? std::format("{}::{}", mesh->name, i)
+                : mesh->name,
+            verbose);
+        ++i;
+        if (!ok) {
+          rsl::error("Error: Failed to stripify mesh {}. {}", mesh->name,
+                     ok.error());
         }
-        ++so_far;
-        int x = static_cast<int>(so_far);
-        progress(std::format("Optimizing meshes ({} / {})", x, total),
-                 static_cast<float>(x) / static_cast<float>(total));
-      };
-      futures.push_back(std::async(std::launch::async, std::bind(task, &mesh)));
+      }
+      ++so_far;
+      int x = static_cast<int>(so_far);
+      progress(std::format("Optimizing meshes ({} / {})", x, total),
+               static_cast<float>(x) / static_cast<float>(total));
+      stripped.count_down();
+    };
+    for (auto& mesh : rhst.meshes) {
+      pool.submit([&task, mesh = &mesh] { task(mesh); });
     }
 
-    futures.clear();
-    rsl::error("Elapsed stripping time (multicore) (or texture import time if "
-               "greater): {}ms",
-               timer.elapsed());
+    // Textures may still be importing; mesh compilation overlaps them
+    stripped.wait();
+    rsl::error("Elapsed stripping time (multicore): {}ms", timer.elapsed());
   }
 
   progress(std::format("Compiling meshes {}/{}", 0, rhst.meshes.size()), 0.0f);
@@ -1255,6 +1298,8 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
     }
   }
 
+  pool.wait();
+
   // Now that all textures are loaded, correct sampler settings
   for (auto& mat : mdl.getMaterials()) {
     for (auto& sampler : mat.getMaterialData().samplers) {
@@ -5,30 +5,29 @@
 #include <librii/rhst/RHST.hpp>
 #include <plugins/gc/Export/Scene.hpp>
 #include <plugins/gc/Export/Texture.hpp>
+#include <rsl/MemoryBudget.hpp>
 
 namespace riistudio::rhst {
 
 [[nodiscard]] Result<void>
-importTextureImpl(libcube::Texture& data, std::span<u8> image,
-                  std::vector<u8>& scratch, int num_mip, int width, int height,
-                  int first_w, int first_h, librii::gx::TextureFormat fmt,
+importTextureImpl(libcube::Texture& data, std::span<u8> image, int num_mip,
+                  int width, int height, int first_w, int first_h,
+                  librii::gx::TextureFormat fmt,
                   librii::image::ResizingAlgorithm resize =
                       librii::image::ResizingAlgorithm::Lanczos);
 
 [[nodiscard]] Result<void> importTexture(
-    libcube::Texture& data, std::span<u8> image, std::vector<u8>& scratch,
-    bool mip_gen, int min_dim, int max_mip, int width, int height, int channels,
+    libcube::Texture& data, std::span<u8> image, bool mip_gen, int min_dim,
+    int max_mip, int width, int height, int channels,
     librii::gx::TextureFormat format = librii::gx::TextureFormat::CMPR);
 [[nodiscard]] Result<void> importTextureFromMemory(libcube::Texture& data,
                                                    std::span<const u8> span,
-                                                   std::vector<u8>& scratch,
                                                    bool mip_gen, int min_dim,
                                                    int max_mip);
-[[nodiscard]] Result<void> importTextureFromFile(libcube::Texture& data,
-                                                 std::string_view path,
-                                                 std::vector<u8>& scratch,
-                                                 bool mip_gen, int min_dim,
-                                                 int max_mip);
+[[nodiscard]] Result<void>
+importTextureFromFile(libcube::Texture& data, std::string_view path,
+                      bool mip_gen, int min_dim, int max_mip,
+                      rsl::MemoryBudget* budget = nullptr);
 
 struct MipGen {
   u32 min_dim = 32;
@@ -40,6 +39,16 @@ struct MipGen {
     std::function<void(std::string_view, float)> progress,
     std::optional<MipGen> mips = {}, bool tristrip = true, bool verbose = true);
 
+struct QuantizeReport {
+  u32 buffers = 0; // Re-encoded
+  u32 bytes_before = 0;
+  u32 bytes_after = 0;
+};
+//! Re-encode the position, normal and UV buffers of a BRRES model in the
+//! smallest fixed-point formats that keep them visually intact. Other models
+//! are left alone.
+QuantizeReport OptimizeVertexQuantization(libcube::Model& mdl);
+
 [[nodiscard]] Result<librii::rhst::Mesh>
 decompileMesh(const libcube::IndexedPolygon& src, const libcube::Model& mdl);
 
@@ -1,20 +1,601 @@
 #pragma once
 
-#if 0
-#include <vendor/llvm/ADT/DenseMap.h>
-#else
-#include <map>
-#endif
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <rsl/Simd.hpp>
 
 namespace rsl {
 
-#if 0
-//! Dense-Map ADT
-template<typename K, typename V>
-using dense_map = llvm::DenseMap<K, V>;
+//! Hash for rsl::dense_map. std::hash is the identity for integers on some
+//! standard libraries, so its result is mixed to spread the low and high bits
+//! the table takes apart.
+template <typename K> struct dense_hash {
+  size_t operator()(const K& key) const {
+    auto x = static_cast<std::uint64_t>(std::hash<K>{}(key));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+  }
+};
+
+namespace detail {
+
+// Open-addressing hash table in the style of Abseil's "Swiss table".
+//
+// Slots are stored flat, in groups of 16, with one control byte per slot. A
+// control byte is empty, deleted, or the low 7 bits of the hash of the key in
+// the slot. A lookup compares the 7 bits against a whole group of control
+// bytes at once (one SSE2 compare where available), and only touches the
+// slots that match. Groups are probed quadratically.
+//
+// Unlike std::map, iterators and references are invalidated by any insertion
+// that grows the table.
+//
+// Slots are built, moved and destroyed as |Stored|, whose key is mutable, and
+// only handed out as |Slot|, whose key is const.
+template <typename K, typename Slot, typename Stored, typename KeyOf,
+          typename Hash, typename Eq>
+class swiss_table {
+  using ctrl_t = std::int8_t;
+  static constexpr ctrl_t kEmpty = -128;  // 0b10000000
+  static constexpr ctrl_t kDeleted = -2;  // 0b11111110
+  static constexpr size_t kGroupWidth = 16;
+
+  // Bit i is set when slot i of the group matched
+  struct BitMask {
+    std::uint32_t mask;
+    explicit operator bool() const { return mask != 0; }
+    unsigned lowest() const { return std::countr_zero(mask); }
+    void clearLowest() { mask &= mask - 1; }
+  };
+
+  struct Group {
+    explicit Group(const ctrl_t* pos) {
+#if RSL_HAS_SSE2
+      ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
 #else
-template <typename K, typename V>
-using dense_map = std::map<K, V>;
+      std::memcpy(ctrl, pos, kGroupWidth);
 #endif
+    }
+    BitMask match(ctrl_t h2) const {
+#if RSL_HAS_SSE2
+      const auto cmp = _mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl);
+      return {static_cast<std::uint32_t>(_mm_movemask_epi8(cmp))};
+#else
+      std::uint32_t mask = 0;
+      for (size_t i = 0; i < kGroupWidth; ++i) {
+        mask |= static_cast<std::uint32_t>(ctrl[i] == h2) << i;
+      }
+      return {mask};
+#endif
+    }
+    BitMask matchEmpty() const { return match(kEmpty); }
+    // Empty and deleted are the only control bytes with the sign bit set
+    BitMask matchEmptyOrDeleted() const {
+#if RSL_HAS_SSE2
+      return {static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl))};
+#else
+      std::uint32_t mask = 0;
+      for (size_t i = 0; i < kGroupWidth; ++i) {
+        mask |= static_cast<std::uint32_t>(ctrl[i] < 0) << i;
+      }
+      return {mask};
+#endif
+    }
+
+#if RSL_HAS_SSE2
+    __m128i ctrl;
+#else
+    ctrl_t ctrl[kGroupWidth];
+#endif
+  };
+
+public:
+  using key_type = K;
+  using value_type = Slot;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = Eq;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  template <bool Const> class basic_iterator {
+    friend class swiss_table;
+    template <bool> friend class basic_iterator;
+    using table_ptr =
+        std::conditional_t<Const, const swiss_table*, swiss_table*>;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Slot;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const Slot*, Slot*>;
+    using reference = std::conditional_t<Const, const Slot&, Slot&>;
+
+    basic_iterator() = default;
+    // iterator -> const_iterator
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    basic_iterator(const basic_iterator<false>& rhs)
+        : mTable(rhs.mTable), mIndex(rhs.mIndex) {}
+
+    reference operator*() const { return *mTable->slotAt(mIndex); }
+    pointer operator->() const { return mTable->slotAt(mIndex); }
+    basic_iterator& operator++() {
+      ++mIndex;
+      skipEmpty();
+      return *this;
+    }
+    basic_iterator operator++(int) {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    bool operator==(const basic_iterator& rhs) const {
+      return mIndex == rhs.mIndex;
+    }
+
+  private:
+    basic_iterator(table_ptr table, size_t index)
+        : mTable(table), mIndex(index) {}
+    void skipEmpty() {
+      while (mIndex < mTable->mCapacity && mTable->mCtrl[mIndex] < 0) {
+        ++mIndex;
+      }
+    }
+
+    table_ptr mTable = nullptr;
+    size_t mIndex = 0;
+  };
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  swiss_table() = default;
+  swiss_table(const swiss_table& rhs) : mHash(rhs.mHash), mEq(rhs.mEq) {
+    reserve(rhs.mSize);
+    for (const auto& x : rhs) {
+      insertUnique(x);
+    }
+  }
+  swiss_table(swiss_table&& rhs) noexcept { swap(rhs); }
+  swiss_table& operator=(const swiss_table& rhs) {
+    if (this != &rhs) {
+      swiss_table tmp(rhs);
+      swap(tmp);
+    }
+    return *this;
+  }
+  swiss_table& operator=(swiss_table&& rhs) noexcept {
+    if (this != &rhs) {
+      destroy();
+      swap(rhs);
+    }
+    return *this;
+  }
+  ~swiss_table() { destroy(); }
+
+  void swap(swiss_table& rhs) noexcept {
+    std::swap(mCtrl, rhs.mCtrl);
+    std::swap(mSlots, rhs.mSlots);
+    std::swap(mCapacity, rhs.mCapacity);
+    std::swap(mSize, rhs.mSize);
+    std::swap(mGrowthLeft, rhs.mGrowthLeft);
+    std::swap(mHash, rhs.mHash);
+    std::swap(mEq, rhs.mEq);
+  }
+
+  iterator begin() {
+    iterator it(this, 0);
+    it.skipEmpty();
+    return it;
+  }
+  const_iterator begin() const {
+    const_iterator it(this, 0);
+    it.skipEmpty();
+    return it;
+  }
+  iterator end() { return {this, mCapacity}; }
+  const_iterator end() const { return {this, mCapacity}; }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  size_t size() const { return mSize; }
+  bool empty() const { return mSize == 0; }
+  size_t capacity() const { return mCapacity; }
+
+  void clear() {
+    destroySlots();
+    if (mCapacity != 0) {
+      std::memset(mCtrl, kEmpty, mCapacity);
+    }
+    mSize = 0;
+    mGrowthLeft = maxLoad(mCapacity);
+  }
+
+  void reserve(size_t n) {
+    if (n > maxLoad(mCapacity)) {
+      rehash(capacityFor(n));
+    }
+  }
+
+  iterator find(const K& key) {
+    const size_t i = findIndex(key);
+    return i == npos ? end() : iterator(this, i);
+  }
+  const_iterator find(const K& key) const {
+    const size_t i = findIndex(key);
+    return i == npos ? end() : const_iterator(this, i);
+  }
+  bool contains(const K& key) const { return findIndex(key) != npos; }
+  size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+
+  size_t erase(const K& key) {
+    const size_t i = findIndex(key);
+    if (i == npos) {
+      return 0;
+    }
+    eraseAt(i);
+    return 1;
+  }
+  iterator erase(const_iterator pos) {
+    eraseAt(pos.mIndex);
+    iterator it(this, pos.mIndex + 1);
+    it.skipEmpty();
+    return it;
+  }
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+protected:
+  static constexpr size_t npos = ~size_t(0);
+
+  // Finds |key|, or claims a slot for it. The slot is constructed by |make|.
+  template <typename F>
+  std::pair<iterator, bool> findOrInsert(const K& key, F&& make) {
+    const size_t hash = mHash(key);
+    if (const size_t i = findIndex(key, hash); i != npos) {
+      return {iterator(this, i), false};
+    }
+    const size_t i = prepareInsert(hash);
+    ::new (rawSlot(i)) Stored(make());
+    commitInsert(i, hash);
+    return {iterator(this, i), true};
+  }
+  void insertUnique(const Slot& slot) {
+    const size_t hash = mHash(KeyOf{}(slot));
+    const size_t i = prepareInsert(hash);
+    ::new (rawSlot(i)) Stored(slot);
+    commitInsert(i, hash);
+  }
+
+  void* rawSlot(size_t i) { return &mSlots[i].stored; }
+  Stored* storedAt(size_t i) { return std::launder(&mSlots[i].stored); }
+  Slot* slotAt(size_t i) { return std::launder(&mSlots[i].value); }
+  const Slot* slotAt(size_t i) const {
+    return std::launder(&mSlots[i].value);
+  }
+
+private:
+  static_assert(sizeof(Slot) == sizeof(Stored) &&
+                alignof(Slot) == alignof(Stored));
+
+  // Raw storage: slots are constructed in place as |stored| and viewed
+  // through |value|, which differs only in the constness of the key
+  union SlotStorage {
+    SlotStorage() {}
+    ~SlotStorage() {}
+    Stored stored;
+    Slot value;
+  };
+
+  static ctrl_t H2(size_t hash) { return static_cast<ctrl_t>(hash & 0x7f); }
+  static size_t H1(size_t hash) { return hash >> 7; }
+
+  // Tables are at most 7/8 full
+  static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+  static size_t capacityFor(size_t n) {
+    size_t cap = kGroupWidth;
+    while (maxLoad(cap) < n) {
+      cap *= 2;
+    }
+    return cap;
+  }
+
+  // Visits groups in a triangular sequence, which covers every group of a
+  // power-of-two table
+  template <typename F> size_t probe(size_t hash, F&& visit) const {
+    const size_t num_groups = mCapacity / kGroupWidth;
+    size_t g = H1(hash) & (num_groups - 1);
+    for (size_t step = 1;; ++step) {
+      if (const size_t i = visit(g * kGroupWidth); i != npos) {
+        return i;
+      }
+      if (step > num_groups) {
+        return npos;
+      }
+      g = (g + step) & (num_groups - 1);
+    }
+  }
+
+  size_t findIndex(const K& key) const { return findIndex(key, mHash(key)); }
+  size_t findIndex(const K& key, size_t hash) const {
+    if (mCapacity == 0) {
+      return npos;
+    }
+    const ctrl_t h2 = H2(hash);
+    size_t found = npos;
+    probe(hash, [&](size_t base) -> size_t {
+      const Group group(mCtrl + base);
+      for (auto m = group.match(h2); m; m.clearLowest()) {
+        const size_t i = base + m.lowest();
+        if (mEq(KeyOf{}(*slotAt(i)), key)) {
+          found = i;
+          return i;
+        }
+      }
+      // An empty slot ends the chain: the key was never pushed past it
+      return group.matchEmpty() ? base : npos;
+    });
+    return found;
+  }
+
+  // First free slot on the probe chain of |hash|
+  size_t findFree(size_t hash) const {
+    return probe(hash, [&](size_t base) -> size_t {
+      const auto m = Group(mCtrl + base).matchEmptyOrDeleted();
+      return m ? base + m.lowest() : npos;
+    });
+  }
+
+  // Slot for a new key, growing the table if needed. It is only marked full
+  // by commitInsert, once constructed.
+  size_t prepareInsert(size_t hash) {
+    if (mCapacity == 0) {
+      rehash(kGroupWidth);
+    }
+    size_t i = findFree(hash);
+    if (mGrowthLeft == 0 && mCtrl[i] != kDeleted) {
+      // Mostly tombstones: clean up in place. Otherwise grow.
+      rehash(mSize < maxLoad(mCapacity) / 2 ? mCapacity : mCapacity * 2);
+      i = findFree(hash);
+    }
+    return i;
+  }
+  void commitInsert(size_t i, size_t hash) {
+    if (mCtrl[i] == kEmpty) {
+      --mGrowthLeft;
+    }
+    mCtrl[i] = H2(hash);
+    ++mSize;
+  }
+
+  void eraseAt(size_t i) {
+    storedAt(i)->~Stored();
+    // A slot whose group never filled up can go back to empty: no chain can
+    // have probed past it.
+    const size_t base = i & ~(kGroupWidth - 1);
+    if (Group(mCtrl + base).matchEmpty()) {
+      mCtrl[i] = kEmpty;
+      ++mGrowthLeft;
+    } else {
+      mCtrl[i] = kDeleted;
+    }
+    --mSize;
+  }
+
+  void rehash(size_t capacity) {
+    ctrl_t* old_ctrl = mCtrl;
+    SlotStorage* old_slots = mSlots;
+    const size_t old_capacity = mCapacity;
+
+    mCtrl = new ctrl_t[capacity];
+    std::memset(mCtrl, kEmpty, capacity);
+    mSlots = std::allocator<SlotStorage>{}.allocate(capacity);
+    mCapacity = capacity;
+    mGrowthLeft = maxLoad(capacity) - mSize;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (old_ctrl[i] < 0) {
+        continue;
+      }
+      Stored& src = *std::launder(&old_slots[i].stored);
+      const size_t hash = mHash(KeyOf{}(src));
+      const size_t j = findFree(hash);
+      mCtrl[j] = H2(hash);
+      ::new (rawSlot(j)) Stored(std::move(src));
+      src.~Stored();
+    }
+    delete[] old_ctrl;
+    if (old_slots != nullptr) {
+      std::allocator<SlotStorage>{}.deallocate(old_slots, old_capacity);
+    }
+  }
+
+  void destroySlots() {
+    if constexpr (!std::is_trivially_destructible_v<Stored>) {
+      for (size_t i = 0; i < mCapacity; ++i) {
+        if (mCtrl[i] >= 0) {
+          storedAt(i)->~Stored();
+        }
+      }
+    }
+  }
+  void destroy() {
+    destroySlots();
+    delete[] mCtrl;
+    if (mSlots != nullptr) {
+      std::allocator<SlotStorage>{}.deallocate(mSlots, mCapacity);
+    }
+    mCtrl = nullptr;
+    mSlots = nullptr;
+    mCapacity = mSize = mGrowthLeft = 0;
+  }
+
+  ctrl_t* mCtrl = nullptr;
+  SlotStorage* mSlots = nullptr;
+  size_t mCapacity = 0;
+  size_t mSize = 0;
+  // Empty slots that may still be filled before the table must grow
+  size_t mGrowthLeft = 0;
+  [[no_unique_address]] Hash mHash;
+  [[no_unique_address]] Eq mEq;
+};
+
+struct pair_first {
+  template <typename P> const auto& operator()(const P& p) const {
+    return p.first;
+  }
+};
+struct identity {
+  template <typename T> const T& operator()(const T& x) const { return x; }
+};
+
+} // namespace detail
+
+//! Dense-Map ADT: a flat, open-addressing hash map. Lookups and insertions
+//! are constant time on average; iteration order is unspecified.
+template <typename K, typename V, typename Hash = dense_hash<K>,
+          typename Eq = std::equal_to<K>>
+class dense_map
+    : public detail::swiss_table<K, std::pair<const K, V>, std::pair<K, V>,
+                                 detail::pair_first, Hash, Eq> {
+  using base = detail::swiss_table<K, std::pair<const K, V>, std::pair<K, V>,
+                                   detail::pair_first, Hash, Eq>;
+  using stored_type = std::pair<K, V>;
+
+public:
+  using mapped_type = V;
+  using typename base::iterator;
+  using typename base::value_type;
+
+  dense_map() = default;
+  dense_map(std::initializer_list<value_type> init) {
+    this->reserve(init.size());
+    for (auto& x : init) {
+      insert(x);
+    }
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+    return this->findOrInsert(key, [&] {
+      return stored_type(std::piecewise_construct, std::forward_as_tuple(key),
+                         std::forward_as_tuple(std::forward<Args>(args)...));
+    });
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+    return this->findOrInsert(key, [&] {
+      return stored_type(std::piecewise_construct,
+                         std::forward_as_tuple(std::move(key)),
+                         std::forward_as_tuple(std::forward<Args>(args)...));
+    });
+  }
+  std::pair<iterator, bool> insert(const value_type& kv) {
+    return try_emplace(kv.first, kv.second);
+  }
+  std::pair<iterator, bool> insert(value_type&& kv) {
+    return try_emplace(kv.first, std::move(kv.second));
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    stored_type kv(std::forward<Args>(args)...);
+    return try_emplace(std::move(kv.first), std::move(kv.second));
+  }
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+    auto res = try_emplace(key, std::forward<M>(value));
+    if (!res.second) {
+      res.first->second = std::forward<M>(value);
+    }
+    return res;
+  }
+
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+  V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+  V& at(const K& key) {
+    auto it = this->find(key);
+    if (it == this->end()) {
+      throw std::out_of_range("rsl::dense_map::at");
+    }
+    return it->second;
+  }
+  const V& at(const K& key) const {
+    auto it = this->find(key);
+    if (it == this->end()) {
+      throw std::out_of_range("rsl::dense_map::at");
+    }
+    return it->second;
+  }
+
+  bool operator==(const dense_map& rhs) const {
+    if (this->size() != rhs.size()) {
+      return false;
+    }
+    for (const auto& [k, v] : *this) {
+      auto it = rhs.find(k);
+      if (it == rhs.end() || !(it->second == v)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+//! Dense-Set ADT, the companion of rsl::dense_map
+template <typename K, typename Hash = dense_hash<K>,
+          typename Eq = std::equal_to<K>>
+class dense_set : public detail::swiss_table<K, const K, K, detail::identity,
+                                             Hash, Eq> {
+  using base =
+      detail::swiss_table<K, const K, K, detail::identity, Hash, Eq>;
+
+public:
+  using typename base::iterator;
+
+  dense_set() = default;
+  dense_set(std::initializer_list<K> init) {
+    this->reserve(init.size());
+    for (auto& x : init) {
+      insert(x);
+    }
+  }
+
+  std::pair<iterator, bool> insert(const K& key) {
+    return this->findOrInsert(key, [&] { return key; });
+  }
+  std::pair<iterator, bool> insert(K&& key) {
+    return this->findOrInsert(key, [&] { return std::move(key); });
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(K(std::forward<Args>(args)...));
+  }
+
+  bool operator==(const dense_set& rhs) const {
+    if (this->size() != rhs.size()) {
+      return false;
+    }
+    for (const auto& k : *this) {
+      if (!rhs.contains(k)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
 
 } // namespace rsl
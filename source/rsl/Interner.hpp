@@ -0,0 +1,156 @@
+#pragma once
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wmissing-braces"
+#endif
+
+#include <vendor/cista.h>
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rsl {
+
+//! Mixes |h| into |seed|
+inline void HashCombine(std::size_t& seed, std::size_t h) {
+  seed ^= h + 0x9e37'79b9'7f4a'7c15 + (seed << 6) + (seed >> 2);
+}
+
+//! Mixes the content of |x| into |seed|. See ContentHash.
+template <typename T> void HashContent(std::size_t& seed, const T& x) {
+  if constexpr (std::is_floating_point_v<T>) {
+    // -0.0 == 0.0
+    HashCombine(seed, std::hash<T>{}(x == T{} ? T{} : x));
+  } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+    HashCombine(seed, std::hash<T>{}(x));
+  } else if constexpr (std::is_invocable_v<std::hash<T>, const T&>) {
+    HashCombine(seed, std::hash<T>{}(x));
+  } else if constexpr (std::ranges::range<const T>) {
+    std::size_t n = 0;
+    for (auto& e : x) {
+      HashContent(seed, e);
+      ++n;
+    }
+    HashCombine(seed, n);
+  } else if constexpr (std::is_aggregate_v<T> && !std::is_array_v<T>) {
+    cista::for_each_field(x, [&](auto&& field) { HashContent(seed, field); });
+  }
+  // Anything else (glm vectors, classes with constructors) contributes nothing.
+  // The hash stays consistent with ==, just coarser.
+}
+
+//! Hash consistent with a defaulted operator==: mixes every scalar, character,
+//! element and aggregate member it can reach.
+template <typename T> struct ContentHash {
+  std::size_t operator()(const T& x) const {
+    std::size_t seed = 0;
+    HashContent(seed, x);
+    return seed;
+  }
+};
+
+//! Pool of distinct values, indexed in order of first appearance. Lookups hash
+//! the value and compare only within its bucket, instead of scanning the pool.
+//!
+//! Mutable access (non-const operator[], iteration, resize) marks the index
+//! stale; it is rebuilt on the next lookup.
+template <typename T, typename Hash = ContentHash<T>> class Interner {
+public:
+  using value_type = T;
+
+  //! Index of |x|, adding it if new. second: Whether it was added.
+  std::pair<std::uint32_t, bool> intern(const T& x) {
+    const std::size_t h = Hash{}(x);
+    if (auto found = findHashed(x, h)) {
+      return {*found, false};
+    }
+    const auto index = static_cast<std::uint32_t>(mValues.size());
+    mValues.push_back(x);
+    mIndex.emplace(h, index);
+    return {index, true};
+  }
+  //! Index of the first value equal to |x|
+  std::optional<std::uint32_t> find(const T& x) const {
+    return findHashed(x, Hash{}(x));
+  }
+  bool contains(const T& x) const { return find(x).has_value(); }
+
+  //! Appends |x| even if it is already present, as a raw std::vector would
+  void push_back(const T& x) {
+    ensureIndex();
+    mIndex.emplace(Hash{}(x), static_cast<std::uint32_t>(mValues.size()));
+    mValues.push_back(x);
+  }
+
+  std::size_t size() const { return mValues.size(); }
+  bool empty() const { return mValues.empty(); }
+  void clear() {
+    mValues.clear();
+    mIndex.clear();
+    mStale = false;
+  }
+  void resize(std::size_t n) {
+    mValues.resize(n);
+    mStale = true;
+  }
+
+  const T& operator[](std::size_t i) const { return mValues[i]; }
+  T& operator[](std::size_t i) {
+    mStale = true;
+    return mValues[i];
+  }
+  auto begin() const { return mValues.begin(); }
+  auto end() const { return mValues.end(); }
+  auto begin() {
+    mStale = true;
+    return mValues.begin();
+  }
+  auto end() { return mValues.end(); }
+
+  const std::vector<T>& values() const { return mValues; }
+
+  bool operator==(const Interner& rhs) const { return mValues == rhs.mValues; }
+
+private:
+  std::optional<std::uint32_t> findHashed(const T& x, std::size_t h) const {
+    ensureIndex();
+    // With duplicates (from push_back), the bucket order is unspecified
+    std::optional<std::uint32_t> first;
+    auto [it, end] = mIndex.equal_range(h);
+    for (; it != end; ++it) {
+      if ((!first || it->second < *first) && mValues[it->second] == x) {
+        first = it->second;
+      }
+    }
+    return first;
+  }
+  void ensureIndex() const {
+    if (!mStale) {
+      return;
+    }
+    mIndex.clear();
+    mIndex.reserve(mValues.size());
+    for (std::size_t i = 0; i < mValues.size(); ++i) {
+      mIndex.emplace(Hash{}(mValues[i]), static_cast<std::uint32_t>(i));
+    }
+    mStale = false;
+  }
+
+  std::vector<T> mValues;
+  // Hash -> index into mValues
+  mutable std::unordered_multimap<std::size_t, std::uint32_t> mIndex;
+  mutable bool mStale = false;
+};
+
+} // namespace rsl
@@ -0,0 +1,404 @@
+#include "JsonStream.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+
+namespace rsl {
+
+void JsonWriter::separate() {
+  if (mAfterKey) {
+    mAfterKey = false;
+    return;
+  }
+  if (mStarted.empty()) {
+    return;
+  }
+  if (mStarted.back()) {
+    mOut.put(',');
+  }
+  mStarted.back() = true;
+}
+
+void JsonWriter::beginObject() {
+  separate();
+  mOut.put('{');
+  mStarted.push_back(false);
+}
+void JsonWriter::endObject() {
+  mStarted.pop_back();
+  mOut.put('}');
+}
+void JsonWriter::beginArray() {
+  separate();
+  mOut.put('[');
+  mStarted.push_back(false);
+}
+void JsonWriter::endArray() {
+  mStarted.pop_back();
+  mOut.put(']');
+}
+void JsonWriter::key(std::string_view k) {
+  value(k);
+  mOut.put(':');
+  mAfterKey = true;
+}
+
+template <typename T> static void WriteNumber(std::ostream& out, T x) {
+  // Shortest text that reads back as the same value
+  std::array<char, 32> buf;
+  auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), x);
+  out.write(buf.data(), end - buf.data());
+}
+
+void JsonWriter::value(f64 x) {
+  separate();
+  if (!std::isfinite(x)) {
+    mOut << "null";
+    return;
+  }
+  WriteNumber(mOut, x);
+}
+void JsonWriter::value(f32 x) {
+  separate();
+  if (!std::isfinite(x)) {
+    mOut << "null";
+    return;
+  }
+  WriteNumber(mOut, x);
+}
+void JsonWriter::writeInt(s64 x) {
+  separate();
+  WriteNumber(mOut, x);
+}
+void JsonWriter::writeUInt(u64 x) {
+  separate();
+  WriteNumber(mOut, x);
+}
+void JsonWriter::writeBool(bool x) {
+  separate();
+  mOut << (x ? "true" : "false");
+}
+void JsonWriter::value(std::string_view s) {
+  separate();
+  mOut.put('"');
+  size_t run = 0; // Characters not needing escapes, written in one go
+  for (size_t i = 0; i < s.size(); ++i) {
+    const unsigned char c = s[i];
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    mOut.write(s.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+    case '"':
+      mOut << "\\\"";
+      break;
+    case '\\':
+      mOut << "\\\\";
+      break;
+    case '\n':
+      mOut << "\\n";
+      break;
+    case '\r':
+      mOut << "\\r";
+      break;
+    case '\t':
+      mOut << "\\t";
+      break;
+    default:
+      mOut << std::format("\\u{:04x}", c);
+      break;
+    }
+  }
+  mOut.write(s.data() + run, s.size() - run);
+  mOut.put('"');
+}
+void JsonWriter::raw(std::string_view json) {
+  separate();
+  mOut.write(json.data(), json.size());
+}
+bool JsonWriter::good() const { return mOut.good(); }
+
+JsonPullReader::JsonPullReader(std::istream& in) : mBuf(in.rdbuf()) {}
+
+int JsonPullReader::peek() { return mBuf->sgetc(); }
+int JsonPullReader::get() {
+  const int c = mBuf->sbumpc();
+  if (c != std::char_traits<char>::eof()) {
+    ++mOffset;
+  }
+  return c;
+}
+void JsonPullReader::skipWhitespace() {
+  for (int c = peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t';
+       c = peek()) {
+    get();
+  }
+}
+std::string JsonPullReader::error(std::string_view what) const {
+  return std::format("JSON: {} at byte {}", what, mOffset);
+}
+Result<void> JsonPullReader::expect(char c) {
+  skipWhitespace();
+  if (get() != c) {
+    return std::unexpected(error(std::format("expected '{}'", c)));
+  }
+  return {};
+}
+
+Result<void> JsonPullReader::beginObject() {
+  TRY(expect('{'));
+  mStarted.push_back(false);
+  return {};
+}
+Result<std::optional<std::string>> JsonPullReader::nextKey() {
+  skipWhitespace();
+  if (mStarted.empty()) {
+    return std::unexpected(error("nextKey() outside of an object"));
+  }
+  if (peek() == '}') {
+    get();
+    mStarted.pop_back();
+    return std::nullopt;
+  }
+  if (mStarted.back()) {
+    TRY(expect(','));
+  }
+  mStarted.back() = true;
+  std::string k;
+  TRY(scanString(&k));
+  TRY(expect(':'));
+  return k;
+}
+Result<void> JsonPullReader::beginArray() {
+  TRY(expect('['));
+  mStarted.push_back(false);
+  return {};
+}
+Result<bool> JsonPullReader::nextElement() {
+  skipWhitespace();
+  if (mStarted.empty()) {
+    return std::unexpected(error("nextElement() outside of an array"));
+  }
+  if (peek() == ']') {
+    get();
+    mStarted.pop_back();
+    return false;
+  }
+  if (mStarted.back()) {
+    TRY(expect(','));
+  }
+  mStarted.back() = true;
+  return true;
+}
+
+static bool IsNumberChar(int c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+         c == 'e' || c == 'E';
+}
+
+Result<f64> JsonPullReader::readNumber() {
+  skipWhitespace();
+  if (peek() == 'n') {
+    TRY(skipValue());
+    return std::nan("");
+  }
+  std::array<char, 64> buf;
+  size_t len = 0;
+  while (IsNumberChar(peek())) {
+    if (len + 1 == buf.size()) {
+      return std::unexpected(error("number too long"));
+    }
+    buf[len++] = static_cast<char>(get());
+  }
+  buf[len] = '\0';
+  char* end = nullptr;
+  const f64 x = std::strtod(buf.data(), &end);
+  if (len == 0 || end != buf.data() + len) {
+    return std::unexpected(error("expected a number"));
+  }
+  return x;
+}
+Result<std::string> JsonPullReader::readString() {
+  skipWhitespace();
+  std::string s;
+  TRY(scanString(&s));
+  return s;
+}
+Result<bool> JsonPullReader::readBool() {
+  skipWhitespace();
+  const std::string_view word = peek() == 't' ? "true" : "false";
+  for (char c : word) {
+    if (get() != c) {
+      return std::unexpected(error("expected true or false"));
+    }
+  }
+  return word == "true";
+}
+Result<std::string> JsonPullReader::readValue() {
+  std::string s;
+  TRY(scanValue(&s));
+  return s;
+}
+Result<void> JsonPullReader::skipValue() { return scanValue(nullptr); }
+
+Result<void> JsonPullReader::expectEnd() {
+  skipWhitespace();
+  if (peek() != std::char_traits<char>::eof()) {
+    return std::unexpected(error("trailing characters"));
+  }
+  return {};
+}
+
+static void AppendUtf8(std::string& s, u32 cp) {
+  if (cp < 0x80) {
+    s += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    s += static_cast<char>(0xC0 | (cp >> 6));
+    s += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    s += static_cast<char>(0xE0 | (cp >> 12));
+    s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    s += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    s += static_cast<char>(0xF0 | (cp >> 18));
+    s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    s += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// Decodes escapes into |out|
+Result<void> JsonPullReader::scanString(std::string* out) {
+  skipWhitespace();
+  if (get() != '"') {
+    return std::unexpected(error("expected a string"));
+  }
+  auto hex4 = [&]() -> Result<u32> {
+    u32 x = 0;
+    for (int i = 0; i < 4; ++i) {
+      const int c = get();
+      const int d = c >= '0' && c <= '9'   ? c - '0'
+                    : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                    : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                           : -1;
+      if (d < 0) {
+        return std::unexpected(error("bad \\u escape"));
+      }
+      x = (x << 4) | static_cast<u32>(d);
+    }
+    return x;
+  };
+  while (true) {
+    const int c = get();
+    if (c == std::char_traits<char>::eof()) {
+      return std::unexpected(error("unterminated string"));
+    }
+    if (c == '"') {
+      return {};
+    }
+    if (c != '\\') {
+      *out += static_cast<char>(c);
+      continue;
+    }
+    switch (get()) {
+    case '"':
+      *out += '"';
+      break;
+    case '\\':
+      *out += '\\';
+      break;
+    case '/':
+      *out += '/';
+      break;
+    case 'b':
+      *out += '\b';
+      break;
+    case 'f':
+      *out += '\f';
+      break;
+    case 'n':
+      *out += '\n';
+      break;
+    case 'r':
+      *out += '\r';
+      break;
+    case 't':
+      *out += '\t';
+      break;
+    case 'u': {
+      u32 cp = TRY(hex4());
+      if (cp >= 0xD800 && cp < 0xDC00 && peek() == '\\') {
+        get();
+        if (get() != 'u') {
+          return std::unexpected(error("bad surrogate pair"));
+        }
+        const u32 lo = TRY(hex4());
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+      }
+      AppendUtf8(*out, cp);
+      break;
+    }
+    default:
+      return std::unexpected(error("bad escape"));
+    }
+  }
+}
+
+// Copies the text verbatim to |out|, if not null. Only tracks nesting; the
+// consumer of the text validates it.
+Result<void> JsonPullReader::scanValue(std::string* out) {
+  skipWhitespace();
+  auto put = [&](int c) {
+    if (out != nullptr) {
+      *out += static_cast<char>(c);
+    }
+  };
+  int depth = 0;
+  bool inString = false;
+  bool any = false;
+  while (true) {
+    const int c = peek();
+    if (c == std::char_traits<char>::eof()) {
+      if (depth == 0 && !inString && any) {
+        return {};
+      }
+      return std::unexpected(error("unexpected end of input"));
+    }
+    if (inString) {
+      put(get());
+      if (c == '\\') {
+        put(get());
+      } else if (c == '"') {
+        inString = false;
+        if (depth == 0) {
+          return {};
+        }
+      }
+      continue;
+    }
+    if (depth == 0 && (c == ',' || c == '}' || c == ']' || c == ' ' ||
+                       c == '\n' || c == '\r' || c == '\t')) {
+      if (!any) {
+        return std::unexpected(error("expected a value"));
+      }
+      return {};
+    }
+    put(get());
+    any = true;
+    if (c == '"') {
+      inString = true;
+    } else if (c == '{' || c == '[') {
+      ++depth;
+    } else if (c == '}' || c == ']') {
+      if (--depth == 0) {
+        return {};
+      }
+    }
+  }
+}
+
+} // namespace rsl
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <core/common.h>
+#include <concepts>
+#include <iosfwd>
+#include <optional>
+
+namespace rsl {
+
+//! Writes JSON to a stream as it is produced, without building a document.
+//! Commas and colons are placed automatically; the caller balances the
+//! begin/end calls.
+class JsonWriter {
+public:
+  explicit JsonWriter(std::ostream& out) : mOut(out) {}
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+  //! Must precede every value of an object
+  void key(std::string_view k);
+
+  //! Non-finite numbers are written as null
+  void value(f64 x);
+  void value(f32 x);
+  void value(std::string_view s);
+  void value(const char* s) { value(std::string_view(s)); }
+  template <std::integral T> void value(T x) {
+    if constexpr (std::same_as<T, bool>) {
+      writeBool(x);
+    } else if constexpr (std::is_signed_v<T>) {
+      writeInt(static_cast<s64>(x));
+    } else {
+      writeUInt(static_cast<u64>(x));
+    }
+  }
+  //! A value that is already serialized, written as is
+  void raw(std::string_view json);
+
+  //! False once the stream has failed
+  bool good() const;
+
+private:
+  void separate();
+  void writeBool(bool x);
+  void writeInt(s64 x);
+  void writeUInt(u64 x);
+
+  std::ostream& mOut;
+  // Per open container: has it a member yet?
+  std::vector<bool> mStarted;
+  bool mAfterKey = false;
+};
+
+//! Reads JSON from a stream one token at a time, without building a
+//! document. The caller walks the structure it expects:
+//!
+//!   TRY(r.beginObject());
+//!   while (auto k = TRY(r.nextKey())) {
+//!     if (*k == "x") x = TRY(r.readNumber());
+//!     else TRY(r.skipValue());
+//!   }
+class JsonPullReader {
+public:
+  explicit JsonPullReader(std::istream& in);
+
+  Result<void> beginObject();
+  //! The next key of the innermost object, or empty at its end
+  Result<std::optional<std::string>> nextKey();
+  Result<void> beginArray();
+  //! Whether the innermost array has another element
+  Result<bool> nextElement();
+
+  //! null reads as NaN
+  Result<f64> readNumber();
+  Result<std::string> readString();
+  Result<bool> readBool();
+  //! The text of the next value, whatever its type. For handing one record
+  //! to a document parser.
+  Result<std::string> readValue();
+  Result<void> skipValue();
+
+  //! Fails unless only whitespace remains
+  Result<void> expectEnd();
+
+private:
+  int peek();
+  int get();
+  void skipWhitespace();
+  Result<void> expect(char c);
+  Result<void> scanString(std::string* out);
+  Result<void> scanValue(std::string* out);
+  std::string error(std::string_view what) const;
+
+  std::streambuf* mBuf;
+  u64 mOffset = 0;
+  // Per open container: has it a member yet?
+  std::vector<bool> mStarted;
+};
+
+} // namespace rsl
@@ -2,35 +2,23 @@
 
 #include <core/common.h>
 
+#include <atomic>
+#include <memory>
+#include <thread>
+
 namespace rsl {
 namespace logging {
 
 extern "C" void rsl_log_init();
+extern "C" void rsl_log_set_level(u32 level);
 extern "C" void rsl_c_debug(const char* s, u32 len);
 extern "C" void rsl_c_error(const char* s, u32 len);
 extern "C" void rsl_c_info(const char* s, u32 len);
 extern "C" void rsl_c_trace(const char* s, u32 len);
 extern "C" void rsl_c_warn(const char* s, u32 len);
 
-void init() { rsl_log_init(); }
-void debug(std::string_view s_) {
-  // TODO: Since rust API doesnt care about length, null terminate
-  std::string s(s_);
-  rsl_c_debug(s.c_str(), s.size());
-}
-void error(std::string_view s_) {
-  // TODO: Since rust API doesnt care about length, null terminate
-  std::string s(s_);
-  rsl_c_error(s.c_str(), s.size());
-}
-void info(std::string_view s_) {
-  // TODO: Since rust API doesnt care about length, null terminate
-  std::string s(s_);
-  rsl_c_info(s.c_str(), s.size());
-}
-void log(Level l, std::string_view s_) {
-  // TODO: Since rust API doesnt care about length, null terminate
-  std::string s(s_);
+// std::string is always null-terminated, as the Rust side expects
+static void writeNow(Level l, const std::string& s) {
   switch (l) {
   case Level::Error:
     rsl_c_error(s.c_str(), s.size());
@@ -49,15 +37,149 @@ void log(Level l, std::string_view s_) {
     break;
   }
 }
-void trace(std::string_view s_) {
-  // TODO: Since rust API doesnt care about length, null terminate
-  std::string s(s_);
-  rsl_c_trace(s.c_str(), s.size());
+
+// Bounded multi-producer, single-consumer ring buffer (Vyukov's queue), drained
+// by a background thread. Producers never take a lock. If the ring is full, the
+// producer writes its message itself rather than wait.
+class AsyncSink {
+public:
+  AsyncSink() : mCells(std::make_unique<Cell[]>(Capacity)) {
+    for (size_t i = 0; i < Capacity; ++i) {
+      mCells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    mThread = std::thread([this] { drainMain(); });
+  }
+  ~AsyncSink() {
+    mStop.store(true);
+    mPending.fetch_add(1);
+    mPending.notify_one();
+    mThread.join();
+  }
+
+  void push(Level level, std::string&& s) {
+    size_t pos = mTail.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    while (true) {
+      cell = &mCells[pos & (Capacity - 1)];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (mTail.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // Full
+        writeNow(level, s);
+        return;
+      } else {
+        pos = mTail.load(std::memory_order_relaxed);
+      }
+    }
+    // Counted before it is published, so the drain thread never pops a
+    // message it has not been told about
+    const bool wasIdle = mPending.fetch_add(1) == 0;
+    cell->level = level;
+    cell->message = std::move(s);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    if (wasIdle) {
+      mPending.notify_one();
+    }
+  }
+
+  void flush() {
+    while (mPending.load() != 0 && !mStop.load()) {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  static constexpr size_t Capacity = 4096;
+
+  struct Cell {
+    std::atomic<size_t> seq;
+    Level level;
+    std::string message;
+  };
+
+  bool pop(Level& level, std::string& message) {
+    Cell& cell = mCells[mHead & (Capacity - 1)];
+    if (cell.seq.load(std::memory_order_acquire) != mHead + 1) {
+      return false;
+    }
+    level = cell.level;
+    message = std::move(cell.message);
+    cell.seq.store(mHead + Capacity, std::memory_order_release);
+    ++mHead;
+    return true;
+  }
+
+  void drainMain() {
+    Level level;
+    std::string message;
+    while (true) {
+      size_t drained = 0;
+      while (pop(level, message)) {
+        writeNow(level, message);
+        ++drained;
+      }
+      if (mStop.load()) {
+        return;
+      }
+      // Never underflows: a message is counted before it can be popped
+      const size_t left = mPending.fetch_sub(drained) - drained;
+      if (left == 0) {
+        mPending.wait(0);
+      } else if (drained == 0) {
+        // Counted, but its producer has yet to publish it
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  std::unique_ptr<Cell[]> mCells;
+  alignas(64) std::atomic<size_t> mTail = 0;
+  // Consumer only
+  alignas(64) size_t mHead = 0;
+  // Messages pushed but not yet written
+  std::atomic<size_t> mPending = 0;
+  std::atomic<bool> mStop = false;
+  std::thread mThread;
+};
+
+static std::atomic<AsyncSink*> sActiveSink = nullptr;
+// Messages logged during static destruction go straight to the console
+static struct SinkHolder {
+  ~SinkHolder() { sActiveSink.store(nullptr); }
+  std::unique_ptr<AsyncSink> sink;
+} sAsyncSink;
+
+void init(bool async) {
+  rsl_log_init();
+  rsl_log_set_level(detail::gLogLevel.load());
+#ifndef __EMSCRIPTEN__
+  if (async && sAsyncSink.sink == nullptr) {
+    sAsyncSink.sink = std::make_unique<AsyncSink>();
+    sActiveSink.store(sAsyncSink.sink.get());
+  }
+#endif
+}
+void flush() {
+  if (auto* sink = sActiveSink.load()) {
+    sink->flush();
+  }
+}
+void setLevel(Level level) {
+  detail::gLogLevel.store(static_cast<int>(level));
+  rsl_log_set_level(static_cast<u32>(level));
 }
-void warn(std::string_view s_) {
-  // TODO: Since rust API doesnt care about length, null terminate
-  std::string s(s_);
-  rsl_c_warn(s.c_str(), s.size());
+void write(Level l, std::string&& s) {
+  if (auto* sink = sActiveSink.load()) {
+    sink->push(l, std::move(s));
+  } else {
+    writeNow(l, s);
+  }
 }
 
 } // namespace logging
@@ -1,8 +1,20 @@
 #pragma once
 
+#include <atomic>
 #include <fmt/format.h>
+#include <string>
 #include <string_view>
 
+// Most verbose level compiled in; calls past it compile to nothing. Release
+// builds stop at Info, dropping debug and trace messages.
+#ifndef RSL_LOG_MAX_LEVEL
+#ifdef NDEBUG
+#define RSL_LOG_MAX_LEVEL 2
+#else
+#define RSL_LOG_MAX_LEVEL 4
+#endif
+#endif
+
 namespace rsl {
 
 namespace logging {
@@ -15,42 +27,110 @@ enum class Level {
   Trace,
 };
 
-void init();
-void debug(std::string_view s);
-void error(std::string_view s);
-void info(std::string_view s);
-void log(Level level, std::string_view s);
-void trace(std::string_view s);
-void warn(std::string_view s);
+inline constexpr Level MaxCompiledLevel =
+    static_cast<Level>(RSL_LOG_MAX_LEVEL);
+
+} // namespace logging
+
+// Not nested in |logging|, which rsl pulls in with a using-directive: a second
+// |detail| would make rsl::detail ambiguous.
+namespace detail {
+// Most verbose level enabled at runtime
+inline std::atomic<int> gLogLevel = static_cast<int>(logging::Level::Trace);
+} // namespace detail
 
+namespace logging {
+
+// |async|: Messages are queued and written by a background thread, so a
+// logging thread never waits on the console. Output may then trail stdout
+// written directly.
+void init(bool async = false);
+// Blocks until every queued message has been written
+void flush();
+
+void setLevel(Level level);
+inline bool isEnabled(Level level) {
+  return level <= MaxCompiledLevel &&
+         static_cast<int>(level) <=
+             detail::gLogLevel.load(std::memory_order_relaxed);
+}
+
+// Takes ownership of an already formatted message
+void write(Level level, std::string&& s);
+
+} // namespace logging
+
+namespace detail {
+// Formatting only happens for enabled levels
+template <typename... T>
+inline void log(logging::Level level, fmt::format_string<T...> s,
+                T&&... args) {
+  if (logging::isEnabled(level)) {
+    logging::write(level, fmt::format(s, std::forward<T>(args)...));
+  }
+}
+inline void log(logging::Level level, std::string_view s) {
+  if (logging::isEnabled(level)) {
+    logging::write(level, std::string(s));
+  }
+}
+} // namespace detail
+
+namespace logging {
+
+inline void log(Level level, std::string_view s) { detail::log(level, s); }
+inline void debug(std::string_view s) {
+  if constexpr (Level::Debug <= MaxCompiledLevel) {
+    detail::log(Level::Debug, s);
+  }
+}
+inline void error(std::string_view s) { detail::log(Level::Error, s); }
+inline void info(std::string_view s) {
+  if constexpr (Level::Info <= MaxCompiledLevel) {
+    detail::log(Level::Info, s);
+  }
+}
+inline void trace(std::string_view s) {
+  if constexpr (Level::Trace <= MaxCompiledLevel) {
+    detail::log(Level::Trace, s);
+  }
+}
+inline void warn(std::string_view s) {
+  if constexpr (Level::Warn <= MaxCompiledLevel) {
+    detail::log(Level::Warn, s);
+  }
+}
+
+template <typename... T>
+inline void log(Level level, fmt::format_string<T...> s, T&&... args) {
+  detail::log(level, s, std::forward<T>(args)...);
+}
 template <typename... T>
 inline void debug(fmt::format_string<T...> s, T&&... args) {
-  auto buf = fmt::format(s, std::forward<T>(args)...);
-  debug(buf);
+  if constexpr (Level::Debug <= MaxCompiledLevel) {
+    detail::log(Level::Debug, s, std::forward<T>(args)...);
+  }
 }
 template <typename... T>
 inline void error(fmt::format_string<T...> s, T&&... args) {
-  auto buf = fmt::format(s, std::forward<T>(args)...);
-  error(buf);
+  detail::log(Level::Error, s, std::forward<T>(args)...);
 }
 template <typename... T>
 inline void info(fmt::format_string<T...> s, T&&... args) {
-  auto buf = fmt::format(s, std::forward<T>(args)...);
-  info(buf);
-}
-template <typename... T>
-inline void log(Level level, fmt::format_string<T...> s, T&&... args) {
-  auto buf = fmt::format(s, std::forward<T>(args)...);
-  log(level, buf);
+  if constexpr (Level::Info <= MaxCompiledLevel) {
+    detail::log(Level::Info, s, std::forward<T>(args)...);
+  }
 }
 template <typename... T>
 inline void trace(fmt::format_string<T...> s, T&&... args) {
-  auto buf = fmt::format(s, std::forward<T>(args)...);
-  trace(buf);
+  if constexpr (Level::Trace <= MaxCompiledLevel) {
+    detail::log(Level::Trace, s, std::forward<T>(args)...);
+  }
 }
 template <typename... T> inline void warn(fmt::format_string<T...> s, T&&... args) {
-  auto buf = fmt::format(s, std::forward<T>(args)...);
-  warn(buf);
+  if constexpr (Level::Warn <= MaxCompiledLevel) {
+    detail::log(Level::Warn, s, std::forward<T>(args)...);
+  }
 }
 
 } // namespace logging
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace rsl {
+
+// Caps how many bytes of scratch memory concurrent tasks hold at once.
+//
+// A task reserves its estimated footprint before allocating and blocks while
+// the budget is spent. A single reservation larger than the whole budget is
+// still granted once nothing else is outstanding, so it cannot deadlock.
+class MemoryBudget {
+public:
+  explicit MemoryBudget(size_t bytes) : mCapacity(bytes) {}
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  // Holds a reservation until destroyed
+  class Grant {
+  public:
+    Grant() = default;
+    Grant(MemoryBudget& budget, size_t bytes) : mBudget(&budget), mBytes(bytes) {
+      mBudget->acquire(mBytes);
+    }
+    ~Grant() { reset(); }
+
+    Grant(Grant&& rhs) noexcept : mBudget(rhs.mBudget), mBytes(rhs.mBytes) {
+      rhs.mBudget = nullptr;
+    }
+    Grant& operator=(Grant&& rhs) noexcept {
+      if (this != &rhs) {
+        reset();
+        mBudget = rhs.mBudget;
+        mBytes = rhs.mBytes;
+        rhs.mBudget = nullptr;
+      }
+      return *this;
+    }
+
+    void reset() {
+      if (mBudget != nullptr) {
+        mBudget->release(mBytes);
+        mBudget = nullptr;
+      }
+    }
+
+  private:
+    MemoryBudget* mBudget = nullptr;
+    size_t mBytes = 0;
+  };
+
+  [[nodiscard]] Grant reserve(size_t bytes) { return Grant(*this, bytes); }
+
+  size_t capacity() const { return mCapacity; }
+
+private:
+  void acquire(size_t bytes) {
+    std::unique_lock g(mLock);
+    mFreed.wait(g, [&] { return mUsed == 0 || mUsed + bytes <= mCapacity; });
+    mUsed += bytes;
+  }
+  void release(size_t bytes) {
+    {
+      std::unique_lock g(mLock);
+      mUsed -= bytes;
+    }
+    mFreed.notify_all();
+  }
+
+  const size_t mCapacity;
+  std::mutex mLock;
+  std::condition_variable mFreed;
+  // Bytes currently reserved
+  size_t mUsed = 0;
+};
+
+} // namespace rsl
@@ -0,0 +1,11 @@
+#pragma once
+
+// RSL_HAS_SSE2 is 1 where SSE2 intrinsics can be used unconditionally, with
+// <emmintrin.h> included. Code using them keeps a scalar path for the rest.
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RSL_HAS_SSE2 1
+#else
+#define RSL_HAS_SSE2 0
+#endif
@@ -52,6 +52,15 @@ Result<ImageResult> load(std::string_view path) {
   };
 }
 
+Result<ImageInfo> info(std::string_view path) {
+  ImageInfo tmp;
+  std::string path_(path);
+  if (!stbi_info(path_.c_str(), &tmp.width, &tmp.height, &tmp.channels)) {
+    return std::unexpected("stbi_info failed");
+  }
+  return tmp;
+}
+
 Result<void> writeImageStb(const char* filename, STBImage type, int x, int y,
                            int channel_component_count, const void* data) {
   int len = 0;
@@ -14,6 +14,15 @@ struct ImageResult {
 [[nodiscard]] Result<ImageResult> load_from_memory(std::span<const u8> view);
 [[nodiscard]] Result<ImageResult> load(std::string_view path);
 
+struct ImageInfo {
+  int width{};
+  int height{};
+  int channels{};
+};
+
+// Reads only the header, to size an image before decoding it
+[[nodiscard]] Result<ImageInfo> info(std::string_view path);
+
 // Import from librii
 // TODO: Rename
 enum class STBImage {
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rsl {
+
+// Fixed-size work-stealing thread pool.
+//
+// Each worker owns a queue. Tasks submitted from outside the pool are dealt
+// round-robin; tasks submitted from a worker go to its own queue. A worker
+// runs its own newest task first and, once idle, steals the oldest task of
+// another worker, so uneven workloads still keep every thread busy.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  // |num_threads| == 0: one per hardware thread
+  explicit ThreadPool(unsigned num_threads = 0) {
+    if (num_threads == 0) {
+      num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned i = 0; i < num_threads; ++i) {
+      mQueues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < num_threads; ++i) {
+      mWorkers.emplace_back([this, i] { workerMain(i); });
+    }
+  }
+  ~ThreadPool() {
+    wait();
+    {
+      std::unique_lock g(mLock);
+      mStop = true;
+    }
+    mWake.notify_all();
+    for (auto& t : mWorkers) {
+      t.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(mWorkers.size()); }
+
+  // Pool whose worker is running the calling thread, or nullptr
+  static const ThreadPool* current() { return sPool; }
+
+  void submit(Task task) {
+    const size_t i =
+        sPool == this ? sIndex : mNextQueue++ % mQueues.size();
+    {
+      std::unique_lock g(mQueues[i]->lock);
+      mQueues[i]->tasks.push_back(std::move(task));
+    }
+    {
+      std::unique_lock g(mLock);
+      ++mQueued;
+      ++mPending;
+    }
+    mWake.notify_one();
+  }
+
+  // Blocks until every submitted task, including those submitted by other
+  // tasks, has finished. Must not be called from a worker.
+  void wait() {
+    std::unique_lock g(mLock);
+    mIdle.wait(g, [&] { return mPending == 0; });
+  }
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+  // Pool and queue of the worker running on this thread, if any
+  static inline thread_local const ThreadPool* sPool = nullptr;
+  static inline thread_local size_t sIndex = 0;
+
+  bool popOwn(size_t i, Task& out) {
+    auto& q = *mQueues[i];
+    std::unique_lock g(q.lock);
+    if (q.tasks.empty()) {
+      return false;
+    }
+    out = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+  }
+  bool steal(size_t thief, Task& out) {
+    for (size_t k = 1; k < mQueues.size(); ++k) {
+      auto& q = *mQueues[(thief + k) % mQueues.size()];
+      std::unique_lock g(q.lock);
+      if (q.tasks.empty()) {
+        continue;
+      }
+      out = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  void workerMain(size_t i) {
+    sPool = this;
+    sIndex = i;
+    Task task;
+    while (true) {
+      {
+        std::unique_lock g(mLock);
+        mWake.wait(g, [&] { return mStop || mQueued > 0; });
+        if (mQueued == 0) {
+          return;
+        }
+        // Claim a task before looking for it, so there is always one left in
+        // some queue for every claim.
+        --mQueued;
+      }
+      while (!popOwn(i, task) && !steal(i, task)) {
+        // Raced with a thief scanning the queues; try again
+        std::this_thread::yield();
+      }
+      task();
+      task = nullptr;
+      std::unique_lock g(mLock);
+      if (--mPending == 0) {
+        mIdle.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> mQueues;
+  std::vector<std::thread> mWorkers;
+  std::atomic<size_t> mNextQueue = 0;
+
+  std::mutex mLock;
+  std::condition_variable mWake;
+  std::condition_variable mIdle;
+  // Tasks in queues not yet claimed by a worker
+  size_t mQueued = 0;
+  // Tasks submitted but not yet finished
+  size_t mPending = 0;
+  bool mStop = false;
+};
+
+} // namespace rsl
@@ -1,4 +1,6 @@
 #include "WriteFile.hpp"
+#include <filesystem>
+#include <format>
 #include <fstream>
 
 #ifdef __EMSCRIPTEN__
@@ -37,6 +39,32 @@ Result<void> WriteFile(const std::span<const uint8_t> data,
   stream.write(reinterpret_cast<const char*>(data.data()), data.size());
   return {};
 }
+Result<void> WriteFileAtomic(const std::span<const uint8_t> data,
+                             const std::string_view path) {
+  const std::filesystem::path dst(path);
+  auto tmp = dst;
+  tmp += ".tmp";
+  {
+    std::ofstream stream(tmp, std::ios::binary | std::ios::out);
+    stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    stream.close();
+    if (!stream) {
+      std::error_code ec;
+      std::filesystem::remove(tmp, ec);
+      return std::unexpected(
+          std::format("Failed to write file {}", tmp.string()));
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, dst, ec);
+  if (ec) {
+    auto err = std::format("Failed to rename {} to {}: {}", tmp.string(),
+                           dst.string(), ec.message());
+    std::filesystem::remove(tmp, ec);
+    return std::unexpected(err);
+  }
+  return {};
+}
 #else
 Result<void> WriteFile(const std::span<const uint8_t> data,
                        const std::string_view path) {
@@ -48,6 +76,11 @@ Result<void> WriteFile(const std::span<const uint8_t> data,
          reinterpret_cast<uint32_t>(path.data()), path.size());
   return {};
 }
+// There is no filesystem to tear a file on; the download is all-or-nothing.
+Result<void> WriteFileAtomic(const std::span<const uint8_t> data,
+                             const std::string_view path) {
+  return WriteFile(data, path);
+}
 #endif
 
 } // namespace rsl
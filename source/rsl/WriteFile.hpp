@@ -7,4 +7,9 @@ namespace rsl {
 [[nodiscard]] Result<void> WriteFile(const std::span<const uint8_t> data,
                                      const std::string_view path);
 
+// Writes to a temporary file next to |path|, then renames it into place. A
+// crash or failed write never leaves a truncated file at |path|.
+[[nodiscard]] Result<void> WriteFileAtomic(const std::span<const uint8_t> data,
+                                           const std::string_view path);
+
 } // namespace rsl
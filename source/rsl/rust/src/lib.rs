@@ -198,7 +198,19 @@ pub unsafe fn c_rsl_extract_zip(from_file: *const c_char, to_folder: *const c_ch
 
 #[no_mangle]
 pub fn rsl_log_init() {
-    SimpleLogger::new().init().unwrap();
+    // Several entry points call init; only the first logger sticks
+    let _ = SimpleLogger::new().init();
+}
+// Mirrors rsl::logging::Level
+#[no_mangle]
+pub fn rsl_log_set_level(level: u32) {
+    set_max_level(match level {
+        0 => LevelFilter::Error,
+        1 => LevelFilter::Warn,
+        2 => LevelFilter::Info,
+        3 => LevelFilter::Debug,
+        _ => LevelFilter::Trace,
+    });
 }
 
 #[no_mangle]
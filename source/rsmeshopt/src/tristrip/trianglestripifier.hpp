@@ -50,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+#include <atomic>
 #include <cassert>
 #include <deque>
 #include <list>
@@ -88,7 +89,8 @@ public:
 	int strip_id;
 
 	//! Number of strips declared. Used to determine next strip id.
-	static int NUM_STRIPS; // Initialized to zero in cpp file.
+	//! Atomic: stripifiers may run on several threads at once.
+	static std::atomic<int> NUM_STRIPS; // Initialized to zero in cpp file.
 
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	//~ Public Methods
@@ -148,7 +150,8 @@ public:
 
 	//! Number of experiments declared. Used to determine next
 	//! experiment id.
-	static int NUM_EXPERIMENTS; // Initialized to zero in cpp file.
+	//! Atomic: stripifiers may run on several threads at once.
+	static std::atomic<int> NUM_EXPERIMENTS; // Initialized to zero in cpp file.
 
 	Experiment(int _vertex, MFacePtr _face);
 
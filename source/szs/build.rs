@@ -30,6 +30,8 @@ fn main() {
     build.include(".").include("src");
     build.file("src/SZS.cpp");
     build.file("src/CTGP.cpp");
+    build.file("src/Parallel.cpp");
+    build.file("src/Optimal.cpp");
     build.file("src/bindings.cpp");
     build.compile("szs.a");
 
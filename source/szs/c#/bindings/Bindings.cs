@@ -40,6 +40,7 @@ public static class szs_native
     CTlib,
     LibYaz0,
     MK8,
+    BestRatio,
   }
 
   [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
@@ -64,6 +65,7 @@ public static class szs
     CTlib = szs_native.RiiszsEncodeAlgo.CTlib,
     LibYaz0 = szs_native.RiiszsEncodeAlgo.LibYaz0,
     MK8 = szs_native.RiiszsEncodeAlgo.MK8,
+    BestRatio = szs_native.RiiszsEncodeAlgo.BestRatio,
   }
   public static bool IsCompressed(byte[] data)
   {
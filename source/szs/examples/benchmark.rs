@@ -0,0 +1,130 @@
+// Compares single-threaded and parallel encoding for every algorithm.
+//
+// Usage: cargo run --release --example benchmark -- [--threads N] <files...>
+//
+// Files that are already SZS (YAZ0) compressed are decoded first, so a folder
+// of retail tracks can be passed directly.
+use std::time::Instant;
+
+const ALGOS: [(&str, u32); 9] = [
+    ("worst-case-encoding", 0),
+    ("nintendo", 1),
+    ("mkw-sp", 2),
+    ("ctgp", 3),
+    ("haroohie", 4),
+    ("ct-lib", 5),
+    ("lib-yaz0", 6),
+    ("mk8", 7),
+    ("best-ratio", 8),
+];
+
+fn algo_from_u32(x: u32) -> szs::EncodeAlgo {
+    match x {
+        0 => szs::EncodeAlgo::WorstCaseEncoding,
+        1 => szs::EncodeAlgo::MKW,
+        2 => szs::EncodeAlgo::MkwSp,
+        3 => szs::EncodeAlgo::CTGP,
+        4 => szs::EncodeAlgo::Haroohie,
+        5 => szs::EncodeAlgo::CTLib,
+        6 => szs::EncodeAlgo::LibYaz0,
+        7 => szs::EncodeAlgo::MK8,
+        _ => szs::EncodeAlgo::BestRatio,
+    }
+}
+
+struct Totals {
+    src: usize,
+    dst: usize,
+    seconds: f64,
+}
+
+impl Totals {
+    fn print(&self, name: &str, threads: &str) {
+        let mb = self.src as f64 / (1024.0 * 1024.0);
+        println!(
+            "| {:<20} | {:>7} | {:>9.2}s | {:>9.2} MB/s | {:>7.2}% |",
+            name,
+            threads,
+            self.seconds,
+            mb / self.seconds.max(1e-9),
+            100.0 * self.dst as f64 / self.src.max(1) as f64
+        );
+    }
+}
+
+fn main() {
+    let mut threads: u32 = 0;
+    let mut paths: Vec<String> = Vec::new();
+    let mut args = std::env::args().skip(1);
+    while let Some(arg) = args.next() {
+        if arg == "--threads" {
+            threads = args.next().and_then(|x| x.parse().ok()).unwrap_or(0);
+        } else {
+            paths.push(arg);
+        }
+    }
+    if paths.is_empty() {
+        eprintln!("Usage: benchmark [--threads N] <files...>");
+        std::process::exit(1);
+    }
+
+    let mut corpus: Vec<Vec<u8>> = Vec::new();
+    for path in &paths {
+        let data = std::fs::read(path).expect("Failed to read file");
+        if szs::is_compressed(&data) {
+            match szs::decode(&data) {
+                Ok(x) => corpus.push(x),
+                Err(szs::Error::Error(err)) => eprintln!("{}: {}", path, err),
+            }
+        } else {
+            corpus.push(data);
+        }
+    }
+    let total: usize = corpus.iter().map(|x| x.len()).sum();
+    println!("{} files, {} bytes decompressed", corpus.len(), total);
+    println!("| Method               | Threads |       Time |        Throughput |    Rate |");
+    println!("|----------------------|---------|------------|-------------------|---------|");
+
+    let threads_str = if threads == 0 {
+        "auto".to_string()
+    } else {
+        threads.to_string()
+    };
+    for (name, algo) in ALGOS {
+        let mut single = Totals {
+            src: 0,
+            dst: 0,
+            seconds: 0.0,
+        };
+        let mut parallel = Totals {
+            src: 0,
+            dst: 0,
+            seconds: 0.0,
+        };
+        for data in &corpus {
+            let start = Instant::now();
+            let Ok(a) = szs::encode(data, algo_from_u32(algo)) else {
+                continue;
+            };
+            single.seconds += start.elapsed().as_secs_f64();
+
+            let start = Instant::now();
+            let Ok(b) = szs::encode_parallel(data, algo_from_u32(algo), threads) else {
+                continue;
+            };
+            parallel.seconds += start.elapsed().as_secs_f64();
+
+            match szs::decode(&b) {
+                Ok(x) if x == *data => {}
+                _ => panic!("{}: parallel encoder produced a corrupt stream", name),
+            }
+
+            single.src += data.len();
+            single.dst += a.len();
+            parallel.src += data.len();
+            parallel.dst += b.len();
+        }
+        single.print(name, "1");
+        parallel.print(name, &threads_str);
+    }
+}
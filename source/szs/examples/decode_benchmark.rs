@@ -0,0 +1,120 @@
+// Measures SZS (YAZ0) decoding throughput over a corpus of real files.
+//
+// Usage: cargo run --release --example decode_benchmark -- [--iterations N] [--min-mbps X] <files or folders...>
+//
+// Folders are searched recursively for SZS files. With `--min-mbps`, the process exits with an error
+// if `decode` falls below the given throughput, so it can guard against regressions in CI.
+use std::path::Path;
+use std::time::Instant;
+
+fn collect(path: &Path, out: &mut Vec<Vec<u8>>) {
+    if path.is_dir() {
+        let Ok(entries) = std::fs::read_dir(path) else {
+            return;
+        };
+        for entry in entries.flatten() {
+            collect(&entry.path(), out);
+        }
+        return;
+    }
+    if let Ok(data) = std::fs::read(path) {
+        if szs::is_compressed(&data) {
+            out.push(data);
+        }
+    }
+}
+
+fn report(name: &str, bytes: usize, seconds: f64) -> f64 {
+    let mbps = bytes as f64 / (1024.0 * 1024.0) / seconds.max(1e-9);
+    println!("{:<16} {:>9.3}s {:>10.2} MB/s", name, seconds, mbps);
+    mbps
+}
+
+fn main() {
+    let mut iterations: u32 = 10;
+    let mut min_mbps: Option<f64> = None;
+    let mut corpus: Vec<Vec<u8>> = Vec::new();
+    let mut args = std::env::args().skip(1);
+    while let Some(arg) = args.next() {
+        if arg == "--iterations" {
+            iterations = args.next().and_then(|x| x.parse().ok()).unwrap_or(10);
+        } else if arg == "--min-mbps" {
+            min_mbps = args.next().and_then(|x| x.parse().ok());
+        } else {
+            collect(Path::new(&arg), &mut corpus);
+        }
+    }
+    if corpus.is_empty() {
+        eprintln!("Usage: decode_benchmark [--iterations N] [--min-mbps X] <files or folders...>");
+        std::process::exit(1);
+    }
+
+    let expanded: usize = corpus.iter().map(|x| szs::decoded_size(x) as usize).sum();
+    let compressed: usize = corpus.iter().map(|x| x.len()).sum();
+    println!(
+        "{} files, {} bytes compressed, {} bytes decompressed, {} iterations",
+        corpus.len(),
+        compressed,
+        expanded,
+        iterations
+    );
+
+    // Whole-buffer decoding
+    let mut buffers: Vec<Vec<u8>> = corpus
+        .iter()
+        .map(|x| vec![0u8; szs::decoded_size(x) as usize])
+        .collect();
+    let start = Instant::now();
+    for _ in 0..iterations {
+        for (src, dst) in corpus.iter().zip(buffers.iter_mut()) {
+            if szs::decode_into(dst, src).is_err() {
+                eprintln!("Failed to decode a file");
+                std::process::exit(1);
+            }
+        }
+    }
+    let mbps = report(
+        "decode",
+        expanded * iterations as usize,
+        start.elapsed().as_secs_f64(),
+    );
+
+    // Incremental decoding through a 64 KiB output chunk
+    let mut chunk = vec![0u8; 64 * 1024];
+    let start = Instant::now();
+    for _ in 0..iterations {
+        for (src, expected) in corpus.iter().zip(buffers.iter()) {
+            let mut decoder = szs::StreamDecoder::new();
+            let mut pos = 0;
+            let mut written = 0;
+            while !decoder.is_done() {
+                let Ok((src_used, dst_used)) = decoder.decode(&src[pos..], &mut chunk) else {
+                    eprintln!("Failed to stream-decode a file");
+                    std::process::exit(1);
+                };
+                if src_used == 0 && dst_used == 0 {
+                    eprintln!("Truncated file");
+                    std::process::exit(1);
+                }
+                pos += src_used as usize;
+                written += dst_used as usize;
+            }
+            assert_eq!(written, expected.len());
+        }
+    }
+    report(
+        "StreamDecoder",
+        expanded * iterations as usize,
+        start.elapsed().as_secs_f64(),
+    );
+
+    if let Some(min) = min_mbps {
+        if mbps < min {
+            eprintln!(
+                "decode throughput {:.2} MB/s is below {:.2} MB/s",
+                mbps, min
+            );
+            std::process::exit(1);
+        }
+    }
+}
@@ -16,6 +16,20 @@ const char* riiszs_decode(void* buf, uint32_t len, const void* src,
 // YAY0 (.szp)
 const char* riiszs_decode_yay0_into(void* buf, uint32_t len, const void* src,
                                     uint32_t src_len);
+
+// Incremental YAZ0 (.szs) decoder retaining only the 4 KiB window.
+typedef struct riiszs_decoder riiszs_decoder;
+riiszs_decoder* riiszs_decoder_create(void);
+void riiszs_decoder_destroy(riiszs_decoder* decoder);
+// Consumes up to |src_len| bytes and writes up to |dst_len| bytes.
+// Unconsumed input must be passed again on the next call.
+const char* riiszs_decoder_feed(riiszs_decoder* decoder, const void* src,
+                                uint32_t src_len, uint32_t* src_used,
+                                void* dst, uint32_t dst_len,
+                                uint32_t* dst_used);
+uint32_t riiszs_decoder_is_done(const riiszs_decoder* decoder);
+uint32_t riiszs_decoder_expanded_size(const riiszs_decoder* decoder);
+
 uint32_t riiszs_encoded_upper_bound(uint32_t len);
 
 enum {
@@ -27,11 +41,18 @@ enum {
   RII_SZS_ENCODE_ALGO_CTLIB,
   RII_SZS_ENCODE_ALGO_LIBYAZ0,
   RII_SZS_ENCODE_ALGO_MK8,
+  RII_SZS_ENCODE_ALGO_BEST_RATIO,
 };
 
 const char* riiszs_encode_algo_fast(void* dst, uint32_t dst_len,
                                     const void* src, uint32_t src_len,
                                     uint32_t* used_len, uint32_t algo);
+// Encodes segments of |src| on |num_threads| worker threads (0: one per
+// hardware thread). Produces a single valid YAZ0 stream.
+const char* riiszs_encode_algo_parallel(void* dst, uint32_t dst_len,
+                                        const void* src, uint32_t src_len,
+                                        uint32_t* used_len, uint32_t algo,
+                                        uint32_t num_threads);
 void riiszs_free_error_message(const char* msg);
 
 int32_t szs_get_version_unstable_api(char* buf, uint32_t len);
@@ -52,6 +73,7 @@ const char* riiszs_deinterlace_into(void* dst, uint32_t dst_len,
 #include <assert.h>
 #include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace szs {
@@ -65,6 +87,7 @@ enum class Algo {
   CTLib = RII_SZS_ENCODE_ALGO_CTLIB,
   LibYaz0 = RII_SZS_ENCODE_ALGO_LIBYAZ0,
   MK8 = RII_SZS_ENCODE_ALGO_MK8,
+  BestRatio = RII_SZS_ENCODE_ALGO_BEST_RATIO,
 };
 
 static inline std::string get_version() {
@@ -112,6 +135,37 @@ encode(std::span<const uint8_t> buf, Algo algo) {
   return tmp;
 }
 
+static inline std::expected<uint32_t, std::string>
+encode_parallel_into(std::span<uint8_t> dst, std::span<const uint8_t> src,
+                     Algo algo, uint32_t num_threads = 0) {
+  uint32_t used_len = 0;
+  const uint32_t algo_u = static_cast<uint32_t>(algo);
+  const char* err = ::riiszs_encode_algo_parallel(
+      dst.data(), dst.size(), src.data(), src.size(), &used_len, algo_u,
+      num_threads);
+  if (err == nullptr) {
+    return used_len;
+  }
+  std::string emsg(err);
+  ::riiszs_free_error_message(err);
+  return std::unexpected(emsg);
+}
+
+static inline std::expected<std::vector<uint8_t>, std::string>
+encode_parallel(std::span<const uint8_t> buf, Algo algo,
+                uint32_t num_threads = 0) {
+  uint32_t worst =
+      ::riiszs_encoded_upper_bound(static_cast<uint32_t>(buf.size()));
+  std::vector<uint8_t> tmp(worst);
+  auto ok = encode_parallel_into(tmp, buf, algo, num_threads);
+  if (!ok) {
+    return std::unexpected(ok.error());
+  }
+  assert(tmp.size() >= *ok);
+  tmp.resize(*ok);
+  return tmp;
+}
+
 static inline std::expected<void, std::string>
 decode_into(std::span<uint8_t> dst, std::span<const uint8_t> src) {
   const char* err =
@@ -134,6 +188,42 @@ decode(std::span<const uint8_t> src) {
   return result;
 }
 
+class StreamDecoder {
+public:
+  struct Progress {
+    uint32_t src_used = 0;
+    uint32_t dst_used = 0;
+  };
+
+  StreamDecoder() : m_decoder(::riiszs_decoder_create()) {}
+  StreamDecoder(StreamDecoder&& rhs) noexcept
+      : m_decoder(std::exchange(rhs.m_decoder, nullptr)) {}
+  StreamDecoder(const StreamDecoder&) = delete;
+  StreamDecoder& operator=(const StreamDecoder&) = delete;
+  ~StreamDecoder() { ::riiszs_decoder_destroy(m_decoder); }
+
+  std::expected<Progress, std::string> decode(std::span<const uint8_t> src,
+                                              std::span<uint8_t> dst) {
+    Progress result;
+    const char* err = ::riiszs_decoder_feed(m_decoder, src.data(), src.size(),
+                                            &result.src_used, dst.data(),
+                                            dst.size(), &result.dst_used);
+    if (err == nullptr) {
+      return result;
+    }
+    std::string emsg(err);
+    ::riiszs_free_error_message(err);
+    return std::unexpected(emsg);
+  }
+  bool is_done() const { return ::riiszs_decoder_is_done(m_decoder); }
+  uint32_t expanded_size() const {
+    return ::riiszs_decoder_expanded_size(m_decoder);
+  }
+
+private:
+  ::riiszs_decoder* m_decoder;
+};
+
 static inline std::expected<void, std::string>
 decode_yay0_into(std::span<uint8_t> dst, std::span<const uint8_t> src) {
   const char* err =
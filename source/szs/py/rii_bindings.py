@@ -36,6 +36,7 @@ class EncodingAlgorithm(Enum):
     CTLIB = 5
     LIBYAZ0 = 6
     MK8 = 7
+    BEST_RATIO = 8
 
 class RIISZSError(Exception):
     pass
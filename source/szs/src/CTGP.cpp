@@ -84,7 +84,7 @@ Result<std::vector<u8>> encodeCTGP(std::span<const u8> buf) {
 }
 } // namespace librii::szs
 
-static u16 DAT_80ad1160[HASH_MAP_SIZE];
+static thread_local u16 DAT_80ad1160[HASH_MAP_SIZE];
 
 u32 hash1(u32 value) {
   assert(!(value & 0xff000000));
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "SZS.hpp"
+
+namespace rlibrii::szs {
+
+// Appends tokens to a YAZ0 stream, starting a new group header every 8 tokens.
+class GroupWriter {
+public:
+  GroupWriter(std::vector<u8>& out) : mOut(out) {}
+
+  void literal(u8 c) {
+    beginToken(true);
+    mOut.push_back(c);
+  }
+  void backref(u32 dist, u32 len) {
+    beginToken(false);
+    const u32 r = dist - 1;
+    if (len < 18) {
+      mOut.push_back(static_cast<u8>(((len - 2) << 4) | (r >> 8)));
+      mOut.push_back(static_cast<u8>(r & 0xff));
+    } else {
+      mOut.push_back(static_cast<u8>(r >> 8));
+      mOut.push_back(static_cast<u8>(r & 0xff));
+      mOut.push_back(static_cast<u8>(len - 18));
+    }
+  }
+
+private:
+  void beginToken(bool raw) {
+    if (mBit == 0) {
+      mHeaderPos = mOut.size();
+      mOut.push_back(0);
+      mBit = 0x80;
+    }
+    if (raw) {
+      mOut[mHeaderPos] |= mBit;
+    }
+    mBit >>= 1;
+  }
+
+  std::vector<u8>& mOut;
+  size_t mHeaderPos = 0;
+  u8 mBit = 0;
+};
+
+} // namespace rlibrii::szs
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "SZS.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace rlibrii::szs {
+
+// Hash-chain match finder over the YAZ0 window.
+//
+// Every position is linked to the previous position sharing the hash of its
+// first three bytes. Searching walks that chain newest-to-oldest, so only
+// plausible candidates are compared instead of every byte of the window.
+class MatchFinder {
+public:
+  static constexpr u32 MAX_WINDOW = 0x1000;
+  static constexpr u32 MIN_MATCH = 3;
+  static constexpr u32 MAX_MATCH = 0xff + 0x12;
+
+  struct Match {
+    u32 len = 0;
+    u32 dist = 0;
+  };
+
+  // |window|: Furthest distance to search, at most MAX_WINDOW.
+  // |max_depth|: Maximum number of chain links to follow per search.
+  MatchFinder(std::span<const u8> src, u32 window = MAX_WINDOW,
+              u32 max_depth = std::numeric_limits<u32>::max())
+      : mSrc(src), mWindow(std::min(window, MAX_WINDOW)),
+        mMaxDepth(max_depth), mHead(1 << HASH_BITS, NONE),
+        mPrev(MAX_WINDOW, NONE) {}
+
+  // Indexes every position before |pos|. Positions must be visited in order.
+  void insertUpTo(u32 pos) {
+    // The last two positions have no hash
+    const u32 hashable = mSrc.size() < MIN_MATCH ? 0 : mSrc.size() - 2;
+    const u32 end = std::min(pos, hashable);
+    for (; mInserted < end; ++mInserted) {
+      const u32 h = hash(mInserted);
+      mPrev[mInserted & (MAX_WINDOW - 1)] = mHead[h];
+      mHead[h] = mInserted;
+    }
+  }
+
+  // Longest match for |pos| against indexed positions within the window.
+  // Matches shorter than MIN_MATCH are not reported.
+  Match longest(u32 pos) {
+    insertUpTo(pos);
+    Match best;
+    const u32 avail = static_cast<u32>(mSrc.size()) - pos;
+    if (avail < MIN_MATCH) {
+      return best;
+    }
+    const u32 max_len = std::min(avail, MAX_MATCH);
+    const u32 lowest = pos > mWindow ? pos - mWindow : 0;
+    const u8* cur = mSrc.data() + pos;
+
+    u32 depth = mMaxDepth;
+    for (u32 cand = mHead[hash(pos)]; cand != NONE && cand >= lowest && depth;
+         cand = mPrev[cand & (MAX_WINDOW - 1)], --depth) {
+      if (cand >= pos) {
+        continue;
+      }
+      const u8* ref = mSrc.data() + cand;
+      // Cheap reject: a longer match must also agree at |best.len|
+      if (ref[best.len] != cur[best.len] || ref[0] != cur[0]) {
+        continue;
+      }
+      u32 len = 0;
+      while (len < max_len && ref[len] == cur[len]) {
+        ++len;
+      }
+      if (len > best.len) {
+        best = {.len = len, .dist = pos - cand};
+        if (len == max_len) {
+          break;
+        }
+      }
+      // Chain links only ever point backwards
+      if (mPrev[cand & (MAX_WINDOW - 1)] >= cand) {
+        break;
+      }
+    }
+    if (best.len < MIN_MATCH) {
+      return {};
+    }
+    return best;
+  }
+
+private:
+  static constexpr u32 HASH_BITS = 15;
+  static constexpr u32 NONE = std::numeric_limits<u32>::max();
+
+  u32 hash(u32 pos) const {
+    const u8* p = mSrc.data() + pos;
+    const u32 v = (p[0] << 16) | (p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  std::span<const u8> mSrc;
+  u32 mWindow;
+  u32 mMaxDepth;
+  u32 mInserted = 0;
+  std::vector<u32> mHead;
+  std::vector<u32> mPrev;
+};
+
+} // namespace rlibrii::szs
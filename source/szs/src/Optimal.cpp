@@ -0,0 +1,91 @@
+#include "GroupWriter.hpp"
+#include "MatchFinder.hpp"
+#include "SZS.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+namespace rlibrii::szs {
+
+// Positions are parsed in blocks so the per-position tables stay bounded.
+// Matches may still reach back into previous blocks.
+static constexpr u32 BLOCK_SIZE = 0x40000;
+
+// Cost of each token in bits, including its flag in the group header.
+static constexpr u32 LITERAL_COST = 1 + 8;
+static constexpr u32 SHORT_MATCH_COST = 1 + 16;
+static constexpr u32 LONG_MATCH_COST = 1 + 24;
+
+static constexpr u32 matchCost(u32 len) {
+  return len < 18 ? SHORT_MATCH_COST : LONG_MATCH_COST;
+}
+
+// Optimal parsing: rather than greedily taking the longest match, find the
+// sequence of tokens minimizing the total encoded size.
+//
+// Since the cost of a back-reference does not depend on its distance, and
+// every shorter match is a prefix of the longest one, the longest match at
+// each position is sufficient; the parse then only decides how much of it to
+// use. Costs are solved backwards from the end of each block.
+std::vector<u8> encodeBestRatio(std::span<const u8> src) {
+  const u32 size = static_cast<u32>(src.size());
+
+  std::vector<u8> result;
+  result.reserve(getWorstEncodingSize(size));
+  result.resize(0x10);
+  memcpy(result.data(), "Yaz0", 4);
+  result[4] = size >> 24;
+  result[5] = size >> 16;
+  result[6] = size >> 8;
+  result[7] = size;
+
+  GroupWriter writer(result);
+  MatchFinder finder(src);
+
+  const u32 block_cap = std::min(size, BLOCK_SIZE);
+  std::vector<MatchFinder::Match> matches(block_cap);
+  // cost[i]: Bits needed to encode the block from position i onwards
+  std::vector<u32> cost(block_cap + 1);
+  // Length of the token chosen at position i (1: literal)
+  std::vector<u16> choice(block_cap);
+
+  for (u32 begin = 0; begin < size; begin += BLOCK_SIZE) {
+    const u32 count = std::min(size - begin, BLOCK_SIZE);
+    for (u32 i = 0; i < count; ++i) {
+      auto m = finder.longest(begin + i);
+      // Tokens may not cross the block boundary
+      m.len = std::min(m.len, count - i);
+      matches[i] = m.len < MatchFinder::MIN_MATCH ? MatchFinder::Match{} : m;
+    }
+
+    cost[count] = 0;
+    for (u32 i = count; i-- > 0;) {
+      u32 best = LITERAL_COST + cost[i + 1];
+      u16 best_len = 1;
+      // Longer matches first, so ties favour fewer tokens
+      for (u32 len = matches[i].len; len >= MatchFinder::MIN_MATCH; --len) {
+        const u32 c = matchCost(len) + cost[i + len];
+        if (c < best) {
+          best = c;
+          best_len = static_cast<u16>(len);
+        }
+      }
+      cost[i] = best;
+      choice[i] = best_len;
+    }
+
+    for (u32 i = 0; i < count;) {
+      if (choice[i] == 1) {
+        writer.literal(src[begin + i]);
+        ++i;
+        continue;
+      }
+      writer.backref(matches[i].dist, choice[i]);
+      i += choice[i];
+    }
+  }
+
+  return result;
+}
+
+} // namespace rlibrii::szs
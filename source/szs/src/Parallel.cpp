@@ -0,0 +1,171 @@
+#include "GroupWriter.hpp"
+#include "SZS.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string.h>
+#include <thread>
+
+namespace rlibrii::szs {
+
+// Each segment is encoded with up to one window (0x1000 bytes) of the
+// preceding data prepended, so back-references across segment boundaries are
+// still found. The prefix is dropped again when the streams are stitched.
+static constexpr u32 WINDOW_SIZE = 0x1000;
+// Below this, thread overhead and boundary losses outweigh any gains.
+static constexpr u32 MIN_SEGMENT_SIZE = 0x20000;
+
+namespace {
+
+struct Segment {
+  u32 begin = 0;
+  u32 end = 0;
+  u32 prefix = 0;
+  std::vector<u8> encoded;
+};
+
+// Re-emits the tokens of |seg| that cover [prefix, prefix + size). A
+// back-reference straddling the start of the segment is trimmed to the part
+// after it; as the distance is unchanged it still decodes identically.
+Result<void> stitchSegment(GroupWriter& writer, const Segment& seg,
+                           std::span<const u8> src) {
+  const std::span<const u8> stream = seg.encoded;
+  const u32 size = seg.prefix + (seg.end - seg.begin);
+  const u8* local = src.data() + seg.begin - seg.prefix;
+
+  size_t in = 0x10;
+  u32 pos = 0;
+  while (pos < size) {
+    if (in >= stream.size()) {
+      return tl::unexpected("encodeAlgoParallel: Truncated segment stream");
+    }
+    const u8 header = stream[in++];
+    for (int i = 0; i < 8 && pos < size; ++i) {
+      if (header & (0x80 >> i)) {
+        if (in >= stream.size()) {
+          return tl::unexpected("encodeAlgoParallel: Truncated segment stream");
+        }
+        if (pos >= seg.prefix) {
+          writer.literal(stream[in]);
+        }
+        ++in;
+        ++pos;
+        continue;
+      }
+      if (in + 2 > stream.size()) {
+        return tl::unexpected("encodeAlgoParallel: Truncated segment stream");
+      }
+      const u32 group = (stream[in] << 8) | stream[in + 1];
+      in += 2;
+      const u32 dist = (group & 0xfff) + 1;
+      u32 len = group >> 12;
+      if (len == 0) {
+        if (in >= stream.size()) {
+          return tl::unexpected("encodeAlgoParallel: Truncated segment stream");
+        }
+        len = stream[in++] + 18;
+      } else {
+        len += 2;
+      }
+      if (dist > pos || pos + len > size) {
+        return tl::unexpected("encodeAlgoParallel: Corrupt segment stream");
+      }
+      u32 start = pos;
+      pos += len;
+      if (pos <= seg.prefix) {
+        continue;
+      }
+      if (start < seg.prefix) {
+        start = seg.prefix;
+      }
+      if (pos - start >= 3) {
+        writer.backref(dist, pos - start);
+        continue;
+      }
+      for (u32 j = start; j < pos; ++j) {
+        writer.literal(local[j]);
+      }
+    }
+  }
+  return {};
+}
+
+} // namespace
+
+Result<std::vector<u8>> encodeAlgoParallel(std::span<const u8> buf, Algo algo,
+                                           u32 num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  const u32 size = static_cast<u32>(buf.size());
+  // Aim for a few segments per worker so uneven data still load-balances.
+  const u32 segment_size =
+      std::max(MIN_SEGMENT_SIZE, roundUp(size / (num_threads * 4) + 1, 0x1000));
+  if (num_threads == 1 || size <= segment_size) {
+    return encodeAlgo(buf, algo);
+  }
+
+  std::vector<Segment> segments;
+  for (u32 pos = 0; pos < size; pos += segment_size) {
+    segments.push_back(Segment{
+        .begin = pos,
+        .end = std::min(pos + segment_size, size),
+        .prefix = std::min(pos, WINDOW_SIZE),
+        .encoded = {},
+    });
+  }
+
+  std::atomic<size_t> next = 0;
+  std::mutex err_lock;
+  std::string err;
+  const auto worker = [&]() {
+    for (size_t i = next++; i < segments.size(); i = next++) {
+      Segment& seg = segments[i];
+      auto res = encodeAlgo(
+          buf.subspan(seg.begin - seg.prefix, seg.end - seg.begin + seg.prefix),
+          algo);
+      if (!res) {
+        std::unique_lock g(err_lock);
+        err = res.error();
+        return;
+      }
+      seg.encoded = std::move(*res);
+    }
+  };
+  {
+    const u32 count =
+        std::min(num_threads, static_cast<u32>(segments.size()));
+    std::vector<std::thread> workers;
+    for (u32 i = 1; i < count; ++i) {
+      workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : workers) {
+      t.join();
+    }
+  }
+  if (!err.empty()) {
+    return tl::unexpected(err);
+  }
+
+  std::vector<u8> result;
+  result.reserve(getWorstEncodingSize(size));
+  result.resize(0x10);
+  memcpy(result.data(), "Yaz0", 4);
+  result[4] = size >> 24;
+  result[5] = size >> 16;
+  result[6] = size >> 8;
+  result[7] = size;
+
+  GroupWriter writer(result);
+  for (const auto& seg : segments) {
+    auto ok = stitchSegment(writer, seg, buf);
+    if (!ok) {
+      return tl::unexpected(ok.error());
+    }
+  }
+  return result;
+}
+
+} // namespace rlibrii::szs
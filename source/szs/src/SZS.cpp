@@ -2,8 +2,10 @@
 
 #include "CTLib.hpp"
 #include "HaroohieYaz0.hpp"
+#include "MatchFinder.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <string.h>
 
 namespace rlibrii::szs {
@@ -54,6 +56,9 @@ Result<std::vector<u8>> encodeAlgo(std::span<const u8> buf, Algo algo) {
     tmp.resize(sz);
     return tmp;
   }
+  if (algo == Algo::BestRatio) {
+    return encodeBestRatio(buf);
+  }
 
   return tl::unexpected("Invalid algorithm: id=" + std::to_string((int)algo));
 }
@@ -75,6 +80,32 @@ Result<u32> getExpandedSize(std::span<const u8> src) {
   return (src[4] << 24) | (src[5] << 16) | (src[6] << 8) | src[7];
 }
 
+// Copies a back-reference of |len| bytes starting |dist| bytes behind |out|.
+// |slack| is how many bytes past |out + len| may be clobbered.
+static inline void copyBackref(u8* out, u32 dist, u32 len, size_t slack) {
+  const u8* from = out - dist;
+  if (dist >= 16 && slack >= 16) {
+    // Each 16-byte chunk only reads bytes finalized by previous chunks, so it
+    // is safe to over-copy in whole chunks.
+    for (u32 i = 0; i < len; i += 16) {
+      memcpy(out + i, from + i, 16);
+    }
+  } else if (dist >= len) {
+    memcpy(out, from, len);
+  } else if (dist == 1) {
+    memset(out, *from, len);
+  } else {
+    // Overlapping: replicate the |dist|-byte pattern, doubling each pass.
+    memcpy(out, from, dist);
+    u32 done = dist;
+    while (done < len) {
+      const u32 chunk = std::min(done, len - done);
+      memcpy(out + done, out, chunk);
+      done += chunk;
+    }
+  }
+}
+
 Result<void> decode(std::span<u8> dst, std::span<const u8> src) {
   auto exp = getExpandedSize(src);
   if (!exp) {
@@ -84,64 +115,64 @@ Result<void> decode(std::span<u8> dst, std::span<const u8> src) {
     return tl::unexpected("Result buffer is too small!");
   }
 
-  int in_position = 0x10;
-  int out_position = 0;
-
-  const auto take8 = [&]() {
-    const u8 result = src[in_position];
-    ++in_position;
-    return result;
-  };
-  const auto take16 = [&]() {
-    const u32 high = src[in_position];
-    ++in_position;
-    const u32 low = src[in_position];
-    ++in_position;
-    return (high << 8) | low;
-  };
-  const auto give8 = [&](u8 val) {
-    dst[out_position] = val;
-    ++out_position;
-  };
-
-  const auto read_group = [&](bool raw) {
-    if (raw) {
-      give8(take8());
-      return;
-    }
-
-    const u16 group = take16();
-    const int reverse = (group & 0xfff) + 1;
-    const int g_size = group >> 12;
-
-    int size = g_size ? g_size + 2 : take8() + 18;
-
-    // Invalid data could buffer overflow
-
-    for (int i = 0; i < size; ++i) {
-      give8(dst[out_position - reverse]);
-    }
-  };
+  const u8* in = src.data() + 0x10;
+  const u8* const in_end = src.data() + src.size();
+  u8* out = dst.data();
+  u8* const out_end = dst.data() + *exp;
+
+  while (in < in_end && out < out_end) {
+    u8 header = *in++;
+    int bits = 8;
+    while (bits > 0 && out < out_end) {
+      // Copy runs of raw bytes at once
+      if (int run = std::min(std::countl_one(header), bits); run > 0) {
+        const size_t n = std::min<size_t>(
+            {static_cast<size_t>(run), static_cast<size_t>(in_end - in),
+             static_cast<size_t>(out_end - out)});
+        memcpy(out, in, n);
+        in += n;
+        out += n;
+        if (n != static_cast<size_t>(run)) {
+          break;
+        }
+        header = static_cast<u8>(header << run);
+        bits -= run;
+        continue;
+      }
 
-  const auto read_chunk = [&]() {
-    const u8 header = take8();
+      if (in_end - in < 2) {
+        in = in_end;
+        break;
+      }
+      const u32 group = (in[0] << 8) | in[1];
+      in += 2;
+      const u32 dist = (group & 0xfff) + 1;
+      u32 len = group >> 12;
+      if (len != 0) {
+        len += 2;
+      } else if (in < in_end) {
+        len = *in++ + 18;
+      } else {
+        break;
+      }
+      if (dist > static_cast<size_t>(out - dst.data())) {
+        return tl::unexpected("Invalid back-reference before start of data");
+      }
+      len = std::min<u32>(len, out_end - out);
+      copyBackref(out, dist, len, out_end - out - len);
+      out += len;
 
-    for (int i = 0; i < 8; ++i) {
-      if (in_position >= src.size() || out_position >= dst.size())
-        return;
-      read_group(header & (1 << (7 - i)));
+      header = static_cast<u8>(header << 1);
+      --bits;
     }
-  };
-
-  while (in_position < src.size() && out_position < dst.size())
-    read_chunk();
+  }
 
-  // if (out_position < dst.size())
+  // if (out < out_end)
   //   return llvm::createStringError(
   //       std::errc::executable_format_error,
   //       "Truncated source file: the file could not be decompressed fully");
 
-  // if (in_position != src.size())
+  // if (in != in_end)
   //   return llvm::createStringError(
   //       std::errc::no_buffer_space,
   //       "Invalid YAZ0 header: file is larger than reported");
@@ -149,7 +180,82 @@ Result<void> decode(std::span<u8> dst, std::span<const u8> src) {
   return {};
 }
 
-u32 getWorstEncodingSize(u32 src) { return 16 + roundUp(src, 8) / 8 * 9 - 1; }
+Result<StreamDecoder::Progress> StreamDecoder::decode(std::span<const u8> src,
+                                                      std::span<u8> dst) {
+  u32 in = 0;
+  u32 out = 0;
+
+  while (!headerRead() && in < src.size()) {
+    mHeader[mHeaderLen++] = src[in++];
+    if (headerRead()) {
+      if (mHeader[0] != 'Y' || mHeader[1] != 'a' || mHeader[2] != 'z' ||
+          (mHeader[3] != '0' && mHeader[3] != '1')) {
+        return tl::unexpected("Data is not a YAZ0 file");
+      }
+      mExpanded = (mHeader[4] << 24) | (mHeader[5] << 16) |
+                  (mHeader[6] << 8) | mHeader[7];
+    }
+  }
+  if (!headerRead()) {
+    return Progress{.src_used = in, .dst_used = out};
+  }
+
+  while (true) {
+    if (mCopyLen) {
+      while (mCopyLen && out < dst.size()) {
+        put(dst.data(), out,
+            mWindow[(mWritten - mCopyDist) & (sizeof(mWindow) - 1)]);
+        --mCopyLen;
+      }
+      if (mCopyLen) {
+        break;
+      }
+    }
+    if (mWritten == mExpanded) {
+      break;
+    }
+    if (mGroupBits == 0) {
+      if (in == src.size()) {
+        break;
+      }
+      mGroup = src[in++];
+      mGroupBits = 8;
+    }
+    if (mGroup & 0x80) {
+      if (in == src.size() || out == dst.size()) {
+        break;
+      }
+      put(dst.data(), out, src[in++]);
+    } else {
+      while (mTokenLen < 2 && in < src.size()) {
+        mToken[mTokenLen++] = src[in++];
+      }
+      if (mTokenLen < 2) {
+        break;
+      }
+      const bool long_run = (mToken[0] >> 4) == 0;
+      if (long_run && mTokenLen < 3) {
+        if (in == src.size()) {
+          break;
+        }
+        mToken[mTokenLen++] = src[in++];
+      }
+      mCopyDist = (((mToken[0] & 0xf) << 8) | mToken[1]) + 1;
+      mCopyLen = long_run ? mToken[2] + 18 : (mToken[0] >> 4) + 2;
+      mTokenLen = 0;
+      if (mCopyDist > mWritten) {
+        return tl::unexpected("Invalid back-reference before start of data");
+      }
+      mCopyLen = std::min(mCopyLen, mExpanded - mWritten);
+    }
+    mGroup <<= 1;
+    --mGroupBits;
+  }
+
+  return Progress{.src_used = in, .dst_used = out};
+}
+
+u32 getWorstEncodingSize(u32 src) { return 16 + roundUp(src, 8) / 8 * 9; }
 u32 getWorstEncodingSize(std::span<const u8> src) {
   return getWorstEncodingSize(static_cast<u32>(src.size()));
 }
@@ -208,7 +314,8 @@ std::vector<u8> encodeFast(std::span<const u8> src) {
   return result;
 }
 
-static u16 sSkipTable[256];
+// Per-thread, as segments may be encoded concurrently (encodeAlgoParallel)
+static thread_local u16 sSkipTable[256];
 
 static void findMatch(const u8* src, int srcPos, int maxSize, int* matchOffset,
                       int* matchSize);
@@ -402,6 +509,7 @@ u32 encodeSP(const u8* src, u8* dst, u32 srcSize, u32 dstSize) {
   writeU32(dst, 0x8, 0x0);
   writeU32(dst, 0xc, 0x0);
 
+  MatchFinder finder({src, srcSize});
   u32 srcOffset = 0x0, dstOffset = 0x10;
   u32 groupHeaderOffset;
   for (u32 i = 0; srcOffset < srcSize && dstOffset < dstSize; i = (i + 1) % 8) {
@@ -412,37 +520,16 @@ u32 encodeSP(const u8* src, u8* dst, u32 srcSize, u32 dstSize) {
         return 0;
       }
     }
-    u32 firstRefOffset = srcOffset < 0x1000 ? 0x0 : srcOffset - 0x1000;
-    u32 bestRefSize = 0x1, bestRefOffset;
-    for (u32 refOffset = firstRefOffset; refOffset < srcOffset; refOffset++) {
-      u32 refSize;
-      u32 maxRefSize = 0x111;
-      if (srcSize - srcOffset < maxRefSize) {
-        maxRefSize = srcSize - srcOffset;
-      }
-      if (dstSize - dstOffset < maxRefSize) {
-        maxRefSize = dstSize - dstOffset;
-      }
-      if (bestRefSize < maxRefSize) {
-        if (src[srcOffset + bestRefSize] != src[refOffset + bestRefSize]) {
-          continue;
-        }
-        for (refSize = 0; refSize < maxRefSize; refSize++) {
-          if (src[srcOffset + refSize] != src[refOffset + refSize]) {
-            break;
-          }
-        }
-        if (refSize > bestRefSize) {
-          bestRefSize = refSize;
-          bestRefOffset = refOffset;
-          if (bestRefSize == 0x111) {
-            break;
-          }
-        }
-      } else {
-        break;
-      }
+    u32 maxRefSize = 0x111;
+    if (srcSize - srcOffset < maxRefSize) {
+      maxRefSize = srcSize - srcOffset;
+    }
+    if (dstSize - dstOffset < maxRefSize) {
+      maxRefSize = dstSize - dstOffset;
     }
+    const auto match = finder.longest(srcOffset);
+    const u32 bestRefSize = std::min(match.len, maxRefSize);
+    const u32 bestRefOffset = srcOffset - match.dist;
     if (bestRefSize < 0x3) {
       dst[groupHeaderOffset] |= 1 << (7 - i);
       dst[dstOffset++] = src[srcOffset++];
@@ -471,59 +558,6 @@ u32 encodeSP(const u8* src, u8* dst, u32 srcSize, u32 dstSize) {
 
   return srcOffset == srcSize ? dstOffset : 0;
 }
-static void compressionSearch(const u8* src_pos, const u8* src, int max_len,
-                              u32 search_range, const u8* src_end,
-                              const u8** out_found, u32* out_found_len) {
-  u32& found_len = *out_found_len;
-  const u8*& found = *out_found;
-
-  found_len = 0;
-  found = nullptr;
-
-  const u8* search;
-  const u8* cmp_end;
-  u8 c1;
-  const u8* cmp1;
-  const u8* cmp2;
-  int len_;
-
-  if (src_pos + 2 < src_end) {
-    search = src_pos - search_range;
-    if (search < src)
-      search = src;
-
-    cmp_end = src_pos + max_len;
-    if (cmp_end > src_end)
-      cmp_end = src_end;
-
-    c1 = *src_pos;
-    while (search < src_pos) {
-      search = (u8*)memchr(search, c1, src_pos - search);
-      if (search == nullptr)
-        break;
-
-      cmp1 = search + 1;
-      cmp2 = src_pos + 1;
-
-      while (cmp2 < cmp_end && *cmp1 == *cmp2) {
-        cmp1++;
-        cmp2++;
-      }
-
-      len_ = cmp2 - src_pos;
-
-      if (found_len < len_) {
-        found_len = len_;
-        found = search;
-        if (found_len == max_len)
-          break;
-      }
-
-      search++;
-    }
-  }
-}
-
 void CompressYaz(const u8* src, u32 src_len, u8 level, u8* dst, u32 dst_len,
                  u32* out_len) {
   writeU32(dst, 0x0, YAZ0_MAGIC);
@@ -546,11 +580,17 @@ void CompressYaz(const u8* src, u32 src_len, u8 level, u8* dst, u32 dst_len,
   const u8* src_pos = src;
   const u8* src_end = src + src_len;
 
+  MatchFinder finder({src, src_len}, search_range);
+  const auto compressionSearch = [&](const u8* pos, const u8** out_found,
+                                     u32* out_found_len) {
+    const auto match = finder.longest(pos - src);
+    *out_found_len = match.len;
+    *out_found = pos - match.dist;
+  };
+
   u8* dst_pos = dst + 16;
   u8* code_byte = dst_pos;
 
-  int max_len = 18 + 255;
-
   int i;
 
   u32 found_len, delta;
@@ -574,8 +614,7 @@ void CompressYaz(const u8* src, u32 src_len, u8 level, u8* dst, u32 dst_len,
       src_pos += delta;
     }
   } else if (src_pos < src_end) {
-    compressionSearch(src_pos, src, max_len, search_range, src_end, &found,
-                      &found_len);
+    compressionSearch(src_pos, &found, &found_len);
 
     next_found = nullptr;
     next_found_len = 0;
@@ -589,8 +628,7 @@ void CompressYaz(const u8* src, u32 src_len, u8 level, u8* dst, u32 dst_len,
           break;
 
         if (src_pos + 1 < src_end)
-          compressionSearch(src_pos + 1, src, max_len, search_range, src_end,
-                            &next_found, &next_found_len);
+          compressionSearch(src_pos + 1, &next_found, &next_found_len);
 
         if (found_len > 2 && next_found_len <= found_len) {
           delta = src_pos - found - 1;
@@ -606,8 +644,7 @@ void CompressYaz(const u8* src, u32 src_len, u8 level, u8* dst, u32 dst_len,
 
           src_pos += found_len;
 
-          compressionSearch(src_pos, src, max_len, search_range, src_end,
-                            &found, &found_len);
+          compressionSearch(src_pos, &found, &found_len);
         } else {
           *code_byte |= 1 << i;
           *dst_pos++ = *src_pos++;
@@ -30,6 +30,45 @@ bool isDataYaz0Compressed(std::span<const u8> src);
 Result<u32> getExpandedSize(std::span<const u8> src);
 Result<void> decode(std::span<u8> dst, std::span<const u8> src);
 
+// Incremental YAZ0 decoder. Input and output may be supplied in chunks of any
+// size; only the 4 KiB back-reference window is retained between calls.
+class StreamDecoder {
+public:
+  struct Progress {
+    u32 src_used = 0;
+    u32 dst_used = 0;
+  };
+
+  // Consumes as much of |src| as possible, writing up to |dst.size()| bytes.
+  Result<Progress> decode(std::span<const u8> src, std::span<u8> dst);
+
+  bool headerRead() const { return mHeaderLen == sizeof(mHeader); }
+  bool done() const { return headerRead() && mWritten == mExpanded; }
+  u32 expandedSize() const { return mExpanded; }
+  u32 written() const { return mWritten; }
+
+private:
+  void put(u8* dst, u32& pos, u8 c) {
+    dst[pos++] = c;
+    mWindow[mWritten++ & (sizeof(mWindow) - 1)] = c;
+  }
+
+  u8 mHeader[16];
+  u32 mHeaderLen = 0;
+  u32 mExpanded = 0;
+  u32 mWritten = 0;
+  // Current group header
+  u8 mGroup = 0;
+  u32 mGroupBits = 0;
+  // Back-reference token split across calls
+  u8 mToken[3];
+  u32 mTokenLen = 0;
+  // Back-reference copy split across calls
+  u32 mCopyLen = 0;
+  u32 mCopyDist = 0;
+  u8 mWindow[0x1000];
+};
+
 u32 getWorstEncodingSize(u32 src);
 u32 getWorstEncodingSize(std::span<const u8> src);
 std::vector<u8> encodeFast(std::span<const u8> src);
@@ -38,6 +77,8 @@ int encodeBoyerMooreHorspool(const u8* src, u8* dst, int srcSize);
 
 u32 encodeSP(const u8* src, u8* dst, u32 srcSize, u32 dstSize);
 Result<std::vector<u8>> encodeCTGP(std::span<const u8> buf);
+// Optimal parse over the full window; slowest, but the smallest output.
+std::vector<u8> encodeBestRatio(std::span<const u8> src);
 
 enum class Algo {
   WorstCaseEncoding,
@@ -48,9 +89,15 @@ enum class Algo {
   CTLib,
   LibYaz0,
   MK8,
+  BestRatio,
 };
 
 Result<std::vector<u8>> encodeAlgo(std::span<const u8> buf, Algo algo);
+// Splits |buf| into segments encoded concurrently with |algo| on
+// |num_threads| workers (0: one per hardware thread), then stitches them into
+// a single YAZ0 stream.
+Result<std::vector<u8>> encodeAlgoParallel(std::span<const u8> buf, Algo algo,
+                                           u32 num_threads);
 
 void CompressYaz(const u8* src_, u32 src_len, u8 opt_compr, u8* dest,
                  u32 dest_len, u32* out_len);
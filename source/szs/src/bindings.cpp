@@ -38,6 +38,37 @@ const char* impl_riiszs_decode(void* buf, uint32_t len, const void* src,
   }
   return nullptr;
 }
+void* impl_rii_decoder_create(void) {
+  return new librii::szs::StreamDecoder;
+}
+void impl_rii_decoder_destroy(void* decoder) {
+  delete reinterpret_cast<librii::szs::StreamDecoder*>(decoder);
+}
+const char* impl_rii_decoder_feed(void* decoder, const void* src,
+                                  uint32_t src_len, uint32_t* src_used,
+                                  void* dst, uint32_t dst_len,
+                                  uint32_t* dst_used) {
+  if (!decoder || !src_used || !dst_used) {
+    return my_strdup("Invalid argument: NULL pointer");
+  }
+  auto* d = reinterpret_cast<librii::szs::StreamDecoder*>(decoder);
+  std::span<const u8> src_span{(const u8*)src, src_len};
+  std::span<u8> dst_span{(u8*)dst, dst_len};
+  auto ok = d->decode(src_span, dst_span);
+  if (!ok) {
+    return my_strdup(ok.error().c_str());
+  }
+  *src_used = ok->src_used;
+  *dst_used = ok->dst_used;
+  return nullptr;
+}
+uint32_t impl_rii_decoder_is_done(const void* decoder) {
+  return reinterpret_cast<const librii::szs::StreamDecoder*>(decoder)->done();
+}
+uint32_t impl_rii_decoder_expanded_size(const void* decoder) {
+  return reinterpret_cast<const librii::szs::StreamDecoder*>(decoder)
+      ->expandedSize();
+}
 uint32_t impl_rii_worst_encoding_size(uint32_t len) {
   return librii::szs::getWorstEncodingSize(len);
 }
@@ -46,7 +77,7 @@ const char* impl_rii_encodeAlgo(void* dst, uint32_t dst_len, const void* src,
                                 uint32_t src_len, uint32_t* used_len,
                                 uint32_t algo) {
   std::span<const u8> src_span{(const u8*)src, src_len};
-  if (algo > 7) {
+  if (algo > 8) {
     return my_strdup("Invalid algorithm");
   }
   auto algo_e = static_cast<librii::szs::Algo>(algo);
@@ -65,6 +96,30 @@ const char* impl_rii_encodeAlgo(void* dst, uint32_t dst_len, const void* src,
   return nullptr;
 }
 
+const char* impl_rii_encodeAlgoParallel(void* dst, uint32_t dst_len,
+                                        const void* src, uint32_t src_len,
+                                        uint32_t* used_len, uint32_t algo,
+                                        uint32_t num_threads) {
+  std::span<const u8> src_span{(const u8*)src, src_len};
+  if (algo > 8) {
+    return my_strdup("Invalid algorithm");
+  }
+  auto algo_e = static_cast<librii::szs::Algo>(algo);
+  auto res = librii::szs::encodeAlgoParallel(src_span, algo_e, num_threads);
+  if (!res) {
+    return my_strdup(res.error().c_str());
+  }
+  if (res->size() > dst_len) {
+    return my_strdup("Destination buffer is too small");
+  }
+  memcpy(dst, res->data(), RMIN(res->size(), static_cast<size_t>(dst_len)));
+  if (!used_len) {
+    return my_strdup("used_len was NULL");
+  }
+  *used_len = RMIN(res->size(), static_cast<size_t>(dst_len));
+  return nullptr;
+}
+
 const char* impl_rii_deinterlace(void* dst, uint32_t dst_len, const void* src,
                                  uint32_t src_len, uint32_t* used_len) {
   if (!used_len) {
@@ -4,9 +4,21 @@ uint32_t impl_rii_is_szs_compressed(const void* src, uint32_t len);
 uint32_t impl_rii_get_szs_expand_size(const void* src, uint32_t len);
 const char* impl_riiszs_decode(void* buf, uint32_t len, const void* src,
                                uint32_t src_len);
+void* impl_rii_decoder_create(void);
+void impl_rii_decoder_destroy(void* decoder);
+const char* impl_rii_decoder_feed(void* decoder, const void* src,
+                                  uint32_t src_len, uint32_t* src_used,
+                                  void* dst, uint32_t dst_len,
+                                  uint32_t* dst_used);
+uint32_t impl_rii_decoder_is_done(const void* decoder);
+uint32_t impl_rii_decoder_expanded_size(const void* decoder);
 uint32_t impl_rii_worst_encoding_size(uint32_t len);
 const char* impl_rii_encodeAlgo(void* dst, uint32_t dst_len, const void* src,
                                 uint32_t src_len, uint32_t* used_len,
                                 uint32_t algo);
+const char* impl_rii_encodeAlgoParallel(void* dst, uint32_t dst_len,
+                                        const void* src, uint32_t src_len,
+                                        uint32_t* used_len, uint32_t algo,
+                                        uint32_t num_threads);
 const char* impl_rii_deinterlace(void* dst, uint32_t dst_len, const void* src,
                                  uint32_t src_len, uint32_t* used_len);
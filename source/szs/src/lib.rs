@@ -157,6 +157,15 @@ pub enum EncodeAlgo {
     /// Speed: A+
     /// Compression Rate: B+
     MK8,
+
+    /// Uses the `BestRatio` algorithm.
+    ///
+    /// Use Case: Smallest possible files, when encoding time does not matter.
+    /// Description: Hash-chain match finding with optimal (shortest path) parsing over the full window.
+    ///
+    /// Speed: D
+    /// Compression Rate: A+
+    BestRatio,
 }
 impl EncodeAlgo {
     /// Alias for the `MKW` algorithm.
@@ -283,6 +292,102 @@ pub fn encode(src: &[u8], algo: EncodeAlgo) -> Result<Vec<u8>, Error> {
     }
 }
 
+/// Performs in-place encoding of the source slice using the specified encoding algorithm, spread across multiple threads.
+///
+/// The source is split into segments that are searched independently on a pool of worker threads.
+/// Each segment may still reference the 4 KiB window preceding it, and the resulting streams are
+/// stitched into a single valid SZS (YAZ0) stream. Compression rate is within a fraction of a percent
+/// of `encode_into` with the same algorithm; inputs too small to split are encoded on the calling thread.
+///
+/// # Arguments
+///
+/// * `dst`: A mutable byte slice where the encoded data will be written.
+///          This slice should be pre-allocated with sufficient capacity.
+///
+/// * `src`: A byte slice that contains the data to be encoded.
+///
+/// * `algo`: The encoding algorithm to be used for each segment.
+///
+/// * `num_threads`: The number of worker threads to use. `0` uses one per hardware thread.
+///
+/// # Returns
+///
+/// * `Ok(u32)`: The length of the encoded data written to `dst`.
+///
+/// * `Err(Error)`: An error encountered during the encoding process.
+///
+/// # Examples
+///
+/// ```
+/// let src = b"some data to encode";
+///
+/// let max_encoded_size = szs::encoded_upper_bound(src.len() as u32) as usize;
+/// let mut dst: Vec<u8> = vec![0; max_encoded_size];
+///
+/// match szs::encode_parallel_into(&mut dst, src, szs::EncodeAlgo::LibYaz0, 0) {
+///     Ok(encoded_len) => dst.truncate(encoded_len as usize),
+///     Err(szs::Error::Error(err)) => println!("Error: {}", err),
+/// }
+/// ```
+pub fn encode_parallel_into(
+    dst: &mut [u8],
+    src: &[u8],
+    algo: EncodeAlgo,
+    num_threads: u32,
+) -> Result<u32, Error> {
+    let mut used_len: u32 = 0;
+
+    let result = unsafe {
+        bindings::impl_rii_encodeAlgoParallel(
+            dst.as_mut_ptr() as *mut _,
+            dst.len() as u32,
+            src.as_ptr() as *const _,
+            src.len() as u32,
+            &mut used_len,
+            algo as u32,
+            num_threads,
+        )
+    };
+
+    if result.is_null() {
+        Ok(used_len)
+    } else {
+        let error_msg = unsafe {
+            std::ffi::CStr::from_ptr(result)
+                .to_string_lossy()
+                .into_owned()
+        };
+        Err(Error::Error(error_msg))
+    }
+}
+
+/// Encodes the source slice using the specified encoding algorithm across multiple threads and returns the encoded data.
+///
+/// See `encode_parallel_into`.
+///
+/// # Examples
+///
+/// ```
+/// let src = b"some data to encode";
+///
+/// match szs::encode_parallel(src, szs::EncodeAlgo::LibYaz0, 0) {
+///     Ok(encoded_data) => println!("Encoded data length: {}", encoded_data.len()),
+///     Err(szs::Error::Error(err)) => println!("Error: {}", err),
+/// }
+/// ```
+pub fn encode_parallel(src: &[u8], algo: EncodeAlgo, num_threads: u32) -> Result<Vec<u8>, Error> {
+    let max_len = encoded_upper_bound(src.len() as u32);
+    let mut dst: Vec<u8> = vec![0; max_len as usize];
+
+    match encode_parallel_into(&mut dst, src, algo, num_threads) {
+        Ok(encoded_len) => {
+            dst.truncate(encoded_len as usize);
+            Ok(dst)
+        }
+        Err(err) => Err(err),
+    }
+}
+
 /// Decodes the source slice in-place as a SZS (YAZ0) compressed stream, writing the decoded data to the destination slice.
 ///
 /// The function calls into a potentially unsafe C binding to perform the decoding,
@@ -382,6 +487,106 @@ pub fn decode(src: &[u8]) -> Result<Vec<u8>, Error> {
     }
 }
 
+/// Incremental SZS (YAZ0) decoder.
+///
+/// Unlike `decode`, neither the whole compressed stream nor the whole decompressed buffer need to be in
+/// memory: input and output may be supplied in chunks of any size, and only the 4 KiB back-reference
+/// window is retained between calls.
+///
+/// # Examples
+///
+/// ```
+/// let src = szs::encode(b"some data to encode", szs::EncodeAlgo::MK8).ok().unwrap();
+///
+/// let mut decoder = szs::StreamDecoder::new();
+/// let mut decoded: Vec<u8> = Vec::new();
+/// let mut chunk = [0u8; 4];
+/// let mut pos = 0;
+/// while !decoder.is_done() {
+///     match decoder.decode(&src[pos..], &mut chunk) {
+///         Ok((src_used, dst_used)) => {
+///             pos += src_used as usize;
+///             decoded.extend_from_slice(&chunk[..dst_used as usize]);
+///         }
+///         Err(szs::Error::Error(err)) => panic!("Decoding error: {}", err),
+///     }
+/// }
+/// assert_eq!(decoded, b"some data to encode");
+/// ```
+pub struct StreamDecoder {
+    handle: *mut std::ffi::c_void,
+}
+
+// The decoder state is only ever accessed through `&mut self`.
+unsafe impl Send for StreamDecoder {}
+
+impl StreamDecoder {
+    /// Creates a decoder expecting the start of a SZS (YAZ0) stream.
+    pub fn new() -> StreamDecoder {
+        StreamDecoder {
+            handle: unsafe { bindings::impl_rii_decoder_create() },
+        }
+    }
+
+    /// Decodes as much of `src` as possible into `dst`.
+    ///
+    /// # Returns
+    ///
+    /// * `Ok((u32, u32))`: The number of bytes consumed from `src` and written to `dst`.
+    ///   Unconsumed input must be passed again on the next call.
+    ///
+    /// * `Err(Error)`: The stream is not valid SZS (YAZ0) data.
+    pub fn decode(&mut self, src: &[u8], dst: &mut [u8]) -> Result<(u32, u32), Error> {
+        let mut src_used: u32 = 0;
+        let mut dst_used: u32 = 0;
+
+        let result = unsafe {
+            bindings::impl_rii_decoder_feed(
+                self.handle,
+                src.as_ptr() as *const _,
+                src.len() as u32,
+                &mut src_used,
+                dst.as_mut_ptr() as *mut _,
+                dst.len() as u32,
+                &mut dst_used,
+            )
+        };
+
+        if result.is_null() {
+            Ok((src_used, dst_used))
+        } else {
+            let error_msg = unsafe {
+                std::ffi::CStr::from_ptr(result)
+                    .to_string_lossy()
+                    .into_owned()
+            };
+            Err(Error::Error(error_msg))
+        }
+    }
+
+    /// Whether the entire stream has been decoded.
+    pub fn is_done(&self) -> bool {
+        unsafe { bindings::impl_rii_decoder_is_done(self.handle) != 0 }
+    }
+
+    /// The decoded size from the stream header, or 0 if the header has not been read yet.
+    pub fn expanded_size(&self) -> u32 {
+        unsafe { bindings::impl_rii_decoder_expanded_size(self.handle) }
+    }
+}
+
+impl Default for StreamDecoder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Drop for StreamDecoder {
+    fn drop(&mut self) {
+        unsafe { bindings::impl_rii_decoder_destroy(self.handle) }
+    }
+}
+
 /// Decompresses the Yay0 (SZP) compressed `src` byte slice into the `dst` byte slice.
 ///
 /// # Arguments
@@ -700,6 +905,34 @@ pub mod c_api {
         }
     }
 
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_encode_algo_parallel(
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        result: *mut u32,
+        algo: EncodeAlgo, // u32
+        num_threads: u32,
+    ) -> *const c_char {
+        let dst_slice = unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) };
+        let src_slice = unsafe { std::slice::from_raw_parts(src, src_len as usize) };
+
+        match encode_parallel_into(dst_slice, src_slice, algo, num_threads) {
+            Ok(used_len) => {
+                unsafe {
+                    *result = used_len;
+                }
+                std::ptr::null()
+            }
+            Err(Error::Error(msg)) => {
+                let c_string = std::ffi::CString::new(msg).unwrap();
+                // Leak the CString into a raw pointer, so we don't deallocate it
+                c_string.into_raw()
+            }
+        }
+    }
+
     #[no_mangle]
     pub unsafe extern "C" fn riiszs_decode(
         dst: *mut u8,
@@ -720,6 +953,58 @@ pub mod c_api {
         }
     }
 
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decoder_create() -> *mut StreamDecoder {
+        Box::into_raw(Box::new(StreamDecoder::new()))
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decoder_destroy(decoder: *mut StreamDecoder) {
+        if !decoder.is_null() {
+            let _ = unsafe { Box::from_raw(decoder) };
+        }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decoder_feed(
+        decoder: *mut StreamDecoder,
+        src: *const u8,
+        src_len: u32,
+        src_used: *mut u32,
+        dst: *mut u8,
+        dst_len: u32,
+        dst_used: *mut u32,
+    ) -> *const c_char {
+        let decoder = unsafe { &mut *decoder };
+        let src_slice = unsafe { std::slice::from_raw_parts(src, src_len as usize) };
+        let dst_slice = unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) };
+
+        match decoder.decode(src_slice, dst_slice) {
+            Ok((s, d)) => {
+                unsafe {
+                    *src_used = s;
+                    *dst_used = d;
+                }
+                std::ptr::null()
+            }
+            Err(Error::Error(msg)) => {
+                let c_string = std::ffi::CString::new(msg).unwrap();
+                // Leak the CString into a raw pointer, so we don't deallocate it
+                c_string.into_raw()
+            }
+        }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decoder_is_done(decoder: *const StreamDecoder) -> u32 {
+        unsafe { &*decoder }.is_done() as u32
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decoder_expanded_size(decoder: *const StreamDecoder) -> u32 {
+        unsafe { &*decoder }.expanded_size()
+    }
+
     #[no_mangle]
     pub unsafe extern "C" fn riiszs_decode_yay0_into(
         dst: *mut u8,
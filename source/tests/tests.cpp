@@ -1,16 +1,34 @@
+#include <LibBadUIFramework/History.hpp>
 #include <core/util/oishii.hpp>
 #include <librii/egg/BDOF.hpp>
 #include <librii/egg/Blight.hpp>
 #include <librii/egg/LTEX.hpp>
 #include <librii/egg/PBLM.hpp>
+#include <librii/g3d/anim/AnimSampler.hpp>
+#include <librii/g3d/data/Archive.hpp>
+#include <librii/g3d/io/ArchiveIO.hpp>
+#include <librii/g3d/io/JSON.hpp>
+#include <librii/gpu/DLMesh.hpp>
+#include <librii/kcol/Query.hpp>
+#include <librii/kmp/CourseMap.hpp>
 #include <librii/kmp/io/KMP.hpp>
+#include <librii/math/util.hpp>
 #include <librii/rarc/RARC.hpp>
 #include <librii/szs/SZS.hpp>
 #include <librii/u8/U8.hpp>
 #include <plugins/g3d/G3dIo.hpp>
 #include <plugins/j3d/J3dIo.hpp>
+#include <rsl/DenseMap.hpp>
 #include <rsl/InitLLVM.hpp>
 #include <rsl/Ranges.hpp>
+#include <rsl/Stb.hpp>
+
+#include <random>
+#include <sstream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 IMPORT_STD;
 
@@ -209,6 +227,895 @@ void rebuild(std::string from, const std::string_view to, bool check,
   return;
 }
 
+// Serialize a model |iterations| times, reporting the writer's throughput.
+void bench_write(std::string from, int iterations) {
+  auto file = OishiiReadFile2(from);
+  if (!file.has_value()) {
+    fprintf(stderr, "Cannot read %s\n", from.c_str());
+    return;
+  }
+  oishii::BinaryReader reader(*file, from, std::endian::big);
+  kpi::LightIOTransaction trans;
+  trans.callback = [&](kpi::IOMessageClass message_class,
+                       const std::string_view domain,
+                       const std::string_view message_body) {
+    auto msg = std::format("[{}] {} {}", magic_enum::enum_name(message_class),
+                           domain, message_body);
+    rsl::error(msg);
+  };
+
+  std::function<Result<void>(oishii::Writer&)> write;
+  riistudio::g3d::Collection brres;
+  riistudio::j3d::Collection bmd;
+  if (from.ends_with("brres")) {
+    if (auto ok = riistudio::g3d::ReadBRRES(brres, reader, trans); !ok) {
+      fprintf(stderr, "Failed to read BRRES: %s\n", ok.error().c_str());
+      return;
+    }
+    write = [&](oishii::Writer& w) {
+      return riistudio::g3d::WriteBRRES(brres, w);
+    };
+  } else if (from.ends_with("bmd") || from.ends_with("bdl")) {
+    if (auto ok = riistudio::j3d::ReadBMD(bmd, reader, trans); !ok) {
+      fprintf(stderr, "Failed to read BMD/BDL: %s\n", ok.error().c_str());
+      return;
+    }
+    write = [&](oishii::Writer& w) { return riistudio::j3d::WriteBMD(bmd, w); };
+  } else {
+    fprintf(stderr, "Unrecognized format; Failed to benchmark\n");
+    return;
+  }
+
+  size_t bytes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    oishii::Writer writer(std::endian::big);
+    if (auto ok = write(writer); !ok) {
+      fprintf(stderr, "Failed to write: %s\n", ok.error().c_str());
+      return;
+    }
+    bytes += writer.getBufSize();
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  printf("Wrote %d x %zu bytes: %.3f ms per iteration, %.1f MB/s\n",
+         iterations, bytes / iterations, elapsed.count() * 1000.0 / iterations,
+         bytes / elapsed.count() / (1024.0 * 1024.0));
+}
+
+// Serialize synthetic models with |count| distinct materials, bones and names,
+// stressing the writers' string/material/shader pools.
+void bench_pools(int count, int iterations) {
+  librii::g3d::Archive brres;
+  auto& mdl = brres.models.emplace_back();
+  mdl.name = "synthetic";
+  librii::j3d::J3dModel bmd;
+  for (int i = 0; i < count; ++i) {
+    // Only 64 distinct colors, so the color pools see many repeats
+    const s16 c = static_cast<s16>(i % 64);
+
+    auto& mat = mdl.materials.emplace_back();
+    mat.name = std::format("material_{}", i);
+    mat.id = i;
+    mat.tevColors[0] = {c, c, c, 0xff};
+
+    auto& bone = mdl.bones.emplace_back();
+    bone.mName = std::format("bone_{}", i);
+    bone.mParent = i == 0 ? -1 : 0;
+    if (i != 0) {
+      mdl.bones[0].mChildren.push_back(i);
+    }
+
+    auto& jmat = bmd.materials.emplace_back();
+    jmat.name = std::format("material_{}", i);
+    jmat.tevColors[0] = {c, c, c, 0xff};
+
+    auto& joint = bmd.joints.emplace_back();
+    joint.name = std::format("joint_{}", i);
+    joint.parentId = i == 0 ? -1 : 0;
+    if (i != 0) {
+      bmd.joints[0].children.push_back(i);
+    }
+  }
+
+  auto bench = [&](const char* title, auto&& write) {
+    size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      oishii::Writer writer(std::endian::big);
+      if (auto ok = write(writer); !ok) {
+        fprintf(stderr, "Failed to write %s: %s\n", title, ok.error().c_str());
+        return;
+      }
+      bytes += writer.getBufSize();
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%s: Wrote %d x %zu bytes: %.3f ms per iteration\n", title,
+           iterations, bytes / iterations,
+           elapsed.count() * 1000.0 / iterations);
+  };
+  bench("BRRES", [&](oishii::Writer& w) { return brres.write(w); });
+  bench("BMD", [&](oishii::Writer& w) { return bmd.write(w, false); });
+}
+
+// Checkerboards of two saturated colors, which RGB565 holds exactly, must
+// survive every quality level. Their principal axis is orthogonal to gray.
+bool check_cmpr_two_color() {
+  const std::array<std::array<u8, 3>, 2> pairs[] = {
+      {{{255, 0, 0}, {0, 255, 0}}},
+      {{{255, 0, 0}, {0, 0, 255}}},
+      {{{0, 255, 0}, {0, 0, 255}}},
+      {{{255, 0, 255}, {0, 255, 0}}},
+  };
+  bool ok = true;
+  for (auto& pair : pairs) {
+    std::vector<u8> image(8 * 8 * 4);
+    for (int i = 0; i < 64; ++i) {
+      const auto& c = pair[(i % 8 + i / 8) % 2];
+      std::copy(c.begin(), c.end(), image.begin() + i * 4);
+      image[i * 4 + 3] = 0xff;
+    }
+    for (auto quality :
+         magic_enum::enum_values<librii::image::EncodeQuality>()) {
+      std::vector<u8> encoded(
+          librii::image::getEncodedSize(8, 8, librii::gx::TextureFormat::CMPR));
+      if (auto res = librii::image::encode(
+              encoded, image, 8, 8, librii::gx::TextureFormat::CMPR, {},
+              librii::gx::PaletteFormat::IA8, quality);
+          !res) {
+        fprintf(stderr, "Failed to encode: %s\n", res.error().c_str());
+        return false;
+      }
+      std::vector<u8> decoded(32 * 32 * 4);
+      librii::image::decode(decoded, encoded, 8, 8,
+                            librii::gx::TextureFormat::CMPR);
+      if (!std::equal(image.begin(), image.end(), decoded.begin())) {
+        fprintf(stderr, "%s: two-color block (%d,%d,%d)/(%d,%d,%d) lost\n",
+                std::string(magic_enum::enum_name(quality)).c_str(),
+                pair[0][0], pair[0][1], pair[0][2], pair[1][0], pair[1][1],
+                pair[1][2]);
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+// Encode every image under |folder| as CMPR at each quality level, reporting
+// throughput and PSNR (over the color of opaque pixels). Fails if a
+// two-color regression block does not round-trip.
+bool bench_cmpr(std::string folder, int iterations) {
+  if (!check_cmpr_two_color()) {
+    return false;
+  }
+  std::vector<rsl::stb::ImageResult> images;
+  for (auto& entry : std::filesystem::recursive_directory_iterator(folder)) {
+    auto ext = entry.path().extension().string();
+    if (ext != ".png" && ext != ".jpg" && ext != ".tga" && ext != ".bmp") {
+      continue;
+    }
+    auto image = rsl::stb::load(entry.path().string());
+    if (!image) {
+      fprintf(stderr, "Cannot read %s\n", entry.path().string().c_str());
+      continue;
+    }
+    images.push_back(std::move(*image));
+  }
+  if (images.empty()) {
+    fprintf(stderr, "No images found in %s\n", folder.c_str());
+    return false;
+  }
+
+  for (auto quality : magic_enum::enum_values<librii::image::EncodeQuality>()) {
+    size_t pixels = 0;
+    double elapsed = 0.0;
+    double squared_error = 0.0;
+    size_t samples = 0;
+    for (auto& image : images) {
+      const int w = image.width, h = image.height;
+      std::vector<u8> encoded(librii::image::getEncodedSize(
+          w, h, librii::gx::TextureFormat::CMPR));
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i) {
+        if (auto ok = librii::image::encode(
+                encoded, image.data, w, h, librii::gx::TextureFormat::CMPR, {},
+                librii::gx::PaletteFormat::IA8, quality);
+            !ok) {
+          fprintf(stderr, "Failed to encode: %s\n", ok.error().c_str());
+          return false;
+        }
+      }
+      elapsed += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+      pixels += static_cast<size_t>(w) * h * iterations;
+
+      std::vector<u8> decoded(roundUp(w, 32) * roundUp(h, 32) * 4);
+      librii::image::decode(decoded, encoded, w, h,
+                            librii::gx::TextureFormat::CMPR);
+      for (size_t i = 0; i < static_cast<size_t>(w) * h; ++i) {
+        if (image.data[i * 4 + 3] < 0x80) {
+          continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+          const double d = double(decoded[i * 4 + c]) - image.data[i * 4 + c];
+          squared_error += d * d;
+        }
+        samples += 3;
+      }
+    }
+    const double mse = squared_error / std::max<size_t>(samples, 1);
+    printf("%-8s %zu images: %.2f MPixel/s, PSNR %.2f dB\n",
+           std::string(magic_enum::enum_name(quality)).c_str(), images.size(),
+           pixels / elapsed / 1e6,
+           mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse));
+  }
+  return true;
+}
+
+// Insert |keys|, then look each up and look up |misses|, in every map type.
+template <typename K>
+void bench_maps(const char* key_name, const std::vector<K>& keys,
+                const std::vector<K>& misses, int iterations) {
+  auto bench = [&]<typename Map>(const char* map_name, Map*) {
+    double insert = 0.0, hit = 0.0, miss = 0.0;
+    size_t found = 0;
+    for (int it = 0; it < iterations; ++it) {
+      Map map;
+      auto t0 = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < keys.size(); ++i) {
+        map.try_emplace(keys[i], static_cast<u32>(i));
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      for (auto& k : keys) {
+        found += map.find(k) != map.end();
+      }
+      auto t2 = std::chrono::steady_clock::now();
+      for (auto& k : misses) {
+        found += map.find(k) != map.end();
+      }
+      auto t3 = std::chrono::steady_clock::now();
+      insert += std::chrono::duration<double>(t1 - t0).count();
+      hit += std::chrono::duration<double>(t2 - t1).count();
+      miss += std::chrono::duration<double>(t3 - t2).count();
+    }
+    const double n = static_cast<double>(keys.size()) * iterations;
+    printf("%-12s %-20s insert %6.1f ns  hit %6.1f ns  miss %6.1f ns (%zu)\n",
+           key_name, map_name, insert * 1e9 / n, hit * 1e9 / n,
+           miss * 1e9 / n, found);
+  };
+  bench("std::map", static_cast<std::map<K, u32>*>(nullptr));
+  bench("std::unordered_map", static_cast<std::unordered_map<K, u32>*>(nullptr));
+  bench("rsl::dense_map", static_cast<rsl::dense_map<K, u32>*>(nullptr));
+}
+
+// Compare rsl::dense_map against the standard maps with |count| keys of the
+// types librii keys maps by: generation IDs, offsets and names.
+void bench_dense_map(int count, int iterations) {
+  std::mt19937_64 rng(0);
+  std::vector<s64> ids, id_misses;
+  std::vector<u32> offsets, offset_misses;
+  std::vector<std::string> names, name_misses;
+  for (int i = 0; i < count; ++i) {
+    // Generation IDs: a counter in the high 32 bits
+    ids.push_back(static_cast<s64>(i) << 32);
+    id_misses.push_back((static_cast<s64>(i) << 32) | 1);
+    offsets.push_back(static_cast<u32>(rng()) & ~3u);
+    offset_misses.push_back(static_cast<u32>(rng()) | 1u);
+    names.push_back(std::format("material_{}", rng() % 1'000'000'000));
+    name_misses.push_back(std::format("bone_{}", i));
+  }
+  std::shuffle(ids.begin(), ids.end(), rng);
+  bench_maps("GenerationID", ids, id_misses, iterations);
+  bench_maps("u32 offset", offsets, offset_misses, iterations);
+  bench_maps("std::string", names, name_misses, iterations);
+}
+
+// Resident set size in bytes, or 0 where unsupported
+static size_t CurrentRSS() {
+#ifdef __linux__
+  long pages = 0, resident = 0;
+  if (FILE* f = fopen("/proc/self/statm", "r")) {
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(f);
+  }
+  return static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+// Commit |edits| single-material edits to an undo history of a BRRES,
+// with and without dirty tracking, reporting commit time and memory.
+void bench_history(std::string from, int edits) {
+  auto file = OishiiReadFile2(from);
+  if (!file.has_value()) {
+    fprintf(stderr, "Cannot read %s\n", from.c_str());
+    return;
+  }
+  for (bool dirty_tracking : {false, true}) {
+    oishii::BinaryReader reader(*file, from, std::endian::big);
+    kpi::LightIOTransaction trans;
+    trans.callback = [&](kpi::IOMessageClass, const std::string_view,
+                         const std::string_view) {};
+    riistudio::g3d::Collection brres;
+    if (auto ok = riistudio::g3d::ReadBRRES(brres, reader, trans); !ok) {
+      fprintf(stderr, "Failed to read BRRES: %s\n", ok.error().c_str());
+      return;
+    }
+    if (brres.getModels().empty() ||
+        brres.getModels()[0].getMaterials().empty()) {
+      fprintf(stderr, "%s has no materials to edit\n", from.c_str());
+      return;
+    }
+    kpi::History history;
+    history.setDirtyTracking(dirty_tracking);
+    history.commit(brres);
+    const size_t rss_before = CurrentRSS();
+
+    auto materials = brres.getModels()[0].getMaterials();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < edits; ++i) {
+      auto& mat = materials[i % materials.size()];
+      mat.tevColors[0].r = static_cast<s16>(i & 0xff);
+      mat.markDirty();
+      history.commit(brres);
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const size_t rss_after = CurrentRSS();
+    printf("%s: %d commits: %.3f ms per commit, history ~%zu KiB, RSS +%zu "
+           "KiB\n",
+           dirty_tracking ? "Dirty tracking" : "Full compare", edits,
+           elapsed.count() * 1000.0 / edits, history.memoryUsage() / 1024,
+           (rss_after - std::min(rss_after, rss_before)) / 1024);
+  }
+}
+
+// Nearest hit over every prism, ignoring the octree
+static std::optional<float>
+BruteForceRayCast(const librii::kcol::KclQuery::Triangles& tris,
+                  const librii::kcol::KclRay& ray) {
+  std::optional<float> best;
+  for (size_t p = 0; p < tris.v0[0].size(); ++p) {
+    const glm::vec3 v0(tris.v0[0][p], tris.v0[1][p], tris.v0[2][p]);
+    const glm::vec3 e1(tris.e1[0][p], tris.e1[1][p], tris.e1[2][p]);
+    const glm::vec3 e2(tris.e2[0][p], tris.e2[1][p], tris.e2[2][p]);
+    const glm::vec3 pv = glm::cross(ray.dir, e2);
+    const float det = glm::dot(e1, pv);
+    if (!(std::abs(det) > 1e-8f)) {
+      continue;
+    }
+    const glm::vec3 tv = ray.origin - v0;
+    const glm::vec3 qv = glm::cross(tv, e1);
+    const float u = glm::dot(tv, pv) / det;
+    const float v = glm::dot(ray.dir, qv) / det;
+    const float t = glm::dot(e2, qv) / det;
+    if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f &&
+        t < ray.max_t && (!best || t < *best)) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+// Cast |count| random rays through a course KCL: one at a time, batched, and
+// (for a sample) by brute force over every prism.
+void bench_kcl(std::string from, int count) {
+  auto file = OishiiReadFile2(from);
+  if (!file.has_value()) {
+    fprintf(stderr, "Cannot read %s\n", from.c_str());
+    return;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  auto kcl = librii::kcol::ReadKCollisionData(*file, file->size());
+  if (!kcl) {
+    fprintf(stderr, "Failed to read KCL: %s\n", kcl.error().c_str());
+    return;
+  }
+  librii::kcol::KclQuery query(*kcl);
+  const std::chrono::duration<double> load =
+      std::chrono::steady_clock::now() - t0;
+  printf("%zu prisms, %zu octree cells: loaded in %.2f ms\n",
+         kcl->prism_data.size(), kcl->octree.cells.size(),
+         load.count() * 1000.0);
+
+  // Half are straight down, like the game's ground probes
+  const auto grid = librii::kcol::GetRootGridSize(*kcl);
+  const glm::vec3 lo = kcl->area_min_pos;
+  const glm::vec3 hi =
+      lo + glm::vec3(grid[0], grid[1], grid[2]) *
+               std::ldexp(1.0f, kcl->block_width_shift);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> ux(lo.x, hi.x), uy(lo.y, hi.y),
+      uz(lo.z, hi.z), unit(-1.0f, 1.0f);
+  std::vector<librii::kcol::KclRay> rays(count);
+  for (int i = 0; i < count; ++i) {
+    rays[i].origin = {ux(rng), uy(rng), uz(rng)};
+    rays[i].dir = i % 2 ? glm::vec3(0.0f, -1.0f, 0.0f)
+                        : glm::vec3(unit(rng), unit(rng), unit(rng));
+  }
+
+  std::vector<std::optional<librii::kcol::KclHit>> serial(count);
+  std::vector<std::optional<librii::kcol::KclHit>> batched(count);
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    serial[i] = query.rayCast(rays[i]);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  query.rayCast(rays, batched);
+  auto t2 = std::chrono::steady_clock::now();
+  const size_t hits = std::ranges::count_if(
+      serial, [](auto& h) { return h.has_value(); });
+  const double serial_s = std::chrono::duration<double>(t1 - t0).count();
+  const double batched_s = std::chrono::duration<double>(t2 - t1).count();
+  printf("Octree:      %d rays (%zu hits) in %.1f ms: %.2f Mrays/s\n", count,
+         hits, serial_s * 1000.0, count / serial_s / 1e6);
+  printf("  batched:   %.1f ms: %.2f Mrays/s\n", batched_s * 1000.0,
+         count / batched_s / 1e6);
+
+  const int sample = std::min(count, 10'000);
+  int mismatches = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < sample; ++i) {
+    const auto t = BruteForceRayCast(query.triangles(), rays[i]);
+    if (t.has_value() != serial[i].has_value() ||
+        (t && std::abs(*t - serial[i]->t) > 1e-3f * std::max(1.0f, *t))) {
+      ++mismatches;
+    }
+  }
+  t1 = std::chrono::steady_clock::now();
+  const double brute_s = std::chrono::duration<double>(t1 - t0).count();
+  printf("Brute force: %d rays in %.1f ms: %.2f Mrays/s (%d mismatches)\n",
+         sample, brute_s * 1000.0, sample / brute_s / 1e6, mismatches);
+}
+
+// Re-decode the draw commands of every mesh in a BRRES |iterations| times:
+// with the decoder picked for each layout, with the generic decoder, and one
+// index at a time through the reader.
+void bench_vertex_decode(std::string from, int iterations) {
+  auto brres = librii::g3d::Archive::fromFile(from);
+  if (!brres) {
+    fprintf(stderr, "Failed to read BRRES: %s\n", brres.error().c_str());
+    return;
+  }
+
+  struct Draw {
+    size_t layout;
+    const librii::gx::IndexedPrimitive* prim;
+    u32 offset;
+    u16 num_verts;
+  };
+  // Re-encoded vertex data of every primitive, back to back
+  std::vector<u8> stream;
+  std::vector<librii::gpu::VertexLayout> layouts;
+  std::vector<Draw> draws;
+  size_t num_verts = 0, num_specialized = 0;
+  size_t max_verts = 0;
+  for (auto& mdl : brres->models) {
+    for (auto& mesh : mdl.meshes) {
+      auto layout = librii::gpu::MakeVertexLayout(mesh.mVertexDescriptor);
+      if (!layout) {
+        fprintf(stderr, "Skipping %s: %s\n", mesh.mName.c_str(),
+                layout.error().c_str());
+        continue;
+      }
+      layouts.push_back(*layout);
+      for (auto& mp : mesh.mMatrixPrimitives) {
+        for (auto& prim : mp.mPrimitives) {
+          draws.push_back({layouts.size() - 1, &prim,
+                           static_cast<u32>(stream.size()),
+                           static_cast<u16>(prim.mVertices.size())});
+          for (auto& v : prim.mVertices) {
+            for (auto& f : layout->getFields()) {
+              const u16 i = v[f.attr];
+              if (f.width == 2) {
+                stream.push_back(static_cast<u8>(i >> 8));
+              }
+              stream.push_back(static_cast<u8>(i));
+            }
+          }
+          num_verts += prim.mVertices.size();
+          max_verts = std::max(max_verts, prim.mVertices.size());
+          if (layout->decoder != &librii::gpu::DecodeVerticesGeneric) {
+            num_specialized += prim.mVertices.size();
+          }
+        }
+      }
+    }
+  }
+  printf("%zu vertices in %zu primitives, %zu in specialized layouts\n",
+         num_verts, draws.size(), num_specialized);
+
+  oishii::BinaryReader reader(std::span<const u8>(stream), from,
+                              std::endian::big);
+  std::vector<librii::gx::IndexedVertex> verts(max_verts);
+  const u32 end = static_cast<u32>(stream.size());
+  size_t mismatches = 0;
+  for (auto& draw : draws) {
+    const auto& layout = layouts[draw.layout];
+    reader.seekSet(draw.offset);
+    auto out = std::span(verts).first(draw.num_verts);
+    if (auto ok = librii::gpu::DecodeVertices(reader, layout, end, out); !ok) {
+      fprintf(stderr, "%s\n", ok.error().c_str());
+      return;
+    }
+    for (size_t i = 0; i < out.size(); ++i) {
+      for (auto& f : layout.getFields()) {
+        mismatches += out[i][f.attr] != draw.prim->mVertices[i][f.attr];
+      }
+    }
+  }
+  printf("%zu mismatched indices\n", mismatches);
+
+  auto bench = [&](const char* title, auto&& decode) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (auto& draw : draws) {
+        reader.seekSet(draw.offset);
+        auto out = std::span(verts).first(draw.num_verts);
+        if (auto ok = decode(layouts[draw.layout], out); !ok) {
+          fprintf(stderr, "%s: %s\n", title, ok.error().c_str());
+          return;
+        }
+      }
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%-12s %.2f ms per iteration, %.1f Mverts/s\n", title,
+           elapsed.count() * 1000.0 / iterations,
+           num_verts * iterations / elapsed.count() / 1e6);
+  };
+  bench("Specialized:", [&](const librii::gpu::VertexLayout& layout,
+                            std::span<librii::gx::IndexedVertex> out) {
+    return librii::gpu::DecodeVertices(reader, layout, end, out);
+  });
+  bench("Generic:", [&](librii::gpu::VertexLayout layout,
+                        std::span<librii::gx::IndexedVertex> out) {
+    layout.decoder = &librii::gpu::DecodeVerticesGeneric;
+    return librii::gpu::DecodeVertices(reader, layout, end, out);
+  });
+  bench("Per index:", [&](const librii::gpu::VertexLayout& layout,
+                          std::span<librii::gx::IndexedVertex> out)
+                          -> Result<void> {
+    for (auto& v : out) {
+      for (auto& f : layout.getFields()) {
+        v[f.attr] =
+            f.width == 1
+                ? TRY(reader.tryRead<u8, oishii::EndianSelect::Big, true>())
+                : TRY(reader.tryRead<u16, oishii::EndianSelect::Big, true>());
+      }
+    }
+    return {};
+  });
+}
+
+// Re-parse the display lists of every MDL0 material in a BRRES |iterations|
+// times.
+void bench_mat_dl(std::string from, int iterations) {
+  auto reader = oishii::BinaryReader::FromFilePath(from, std::endian::big);
+  if (!reader) {
+    fprintf(stderr, "Cannot read %s\n", from.c_str());
+    return;
+  }
+  kpi::LightIOTransaction trans;
+  trans.callback = [&](kpi::IOMessageClass, const std::string_view,
+                       const std::string_view) {};
+  librii::g3d::BinaryArchive brres;
+  if (auto ok = brres.read(*reader, trans); !ok) {
+    fprintf(stderr, "Failed to read BRRES: %s\n", ok.error().c_str());
+    return;
+  }
+
+  // Written back out, each material's lists are 0x180 bytes
+  std::vector<const librii::g3d::BinaryMaterial*> mats;
+  oishii::Writer writer(std::endian::big);
+  for (auto& mdl : brres.models) {
+    for (auto& mat : mdl.materials) {
+      if (auto ok = mat.dl.write(writer); !ok) {
+        fprintf(stderr, "Failed to write %s: %s\n", mat.name.c_str(),
+                ok.error().c_str());
+        return;
+      }
+      mats.push_back(&mat);
+    }
+  }
+  const auto buf = writer.takeBuf();
+  oishii::BinaryReader dl_reader(std::span<const u8>(buf), from,
+                                 std::endian::big);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    dl_reader.seekSet(0);
+    for (auto* mat : mats) {
+      const u32 next = dl_reader.tell() + 0x180;
+      librii::g3d::BinaryMatDL dl;
+      auto ok = dl.parse(dl_reader, std::min<u32>(mat->genMode.numIndStages, 4),
+                         std::min<u32>(mat->genMode.numTexGens, 8));
+      if (!ok) {
+        fprintf(stderr, "Failed to parse %s: %s\n", mat->name.c_str(),
+                ok.error().c_str());
+        return;
+      }
+      dl_reader.seekSet(next);
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  printf("Parsed %d x %zu materials: %.3f ms per iteration, %.0f ns per "
+         "material\n",
+         iterations, mats.size(), elapsed.count() * 1000.0 / iterations,
+         elapsed.count() * 1e9 / (iterations * mats.size()));
+}
+
+// Sample |frames| frames of a synthetic |bones|-bone CHR0, keyed every few
+// frames, then build each frame's matrices. Samples are checked against
+// librii::math::hermite, failing past a small tolerance.
+bool bench_anim(int bones, int frames) {
+  // CHR0Frame48 stores frame * 32 in an s16
+  if (bones < 1 || frames < 1 || frames > 1023) {
+    fprintf(stderr, "bench-anim: need 1+ bones and 1 to 1023 frames\n");
+    return false;
+  }
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<f32> unit(-1.0f, 1.0f);
+
+  librii::g3d::BinaryChr chr;
+  chr.frameDuration = static_cast<u16>(frames);
+  chr.wrapMode = librii::g3d::AnimationWrapMode::Repeat;
+  std::vector<librii::g3d::BoneData> model(bones);
+  // Per animated channel, the decoded keys, for the reference
+  std::vector<std::vector<librii::g3d::SRT0KeyFrame>> reference;
+  for (int b = 0; b < bones; ++b) {
+    auto& bone = model[b];
+    bone.mName = std::format("bone_{}", b);
+    bone.mParent = b == 0 ? -1 : (b - 1) / 2;
+    bone.mTranslation = {0.0f, 10.0f, 0.0f};
+
+    librii::g3d::CHR0Node node{
+        .name = bone.mName,
+        .flags = librii::g3d::CHR0Flags::ENABLED |
+                 librii::g3d::CHR0Flags::SCL_ONE,
+    };
+    // Rotation, then translation: 6 keyed tracks
+    for (int a = 0; a < 6; ++a) {
+      const f32 range = a < 3 ? 180.0f : 20.0f;
+      librii::g3d::CHR0Track48 track{.scale = 2.0f * range / 65535.0f,
+                                     .offset = -range};
+      std::vector<librii::g3d::SRT0KeyFrame> keys;
+      for (int f = 0; f <= frames; f += 4 + rng() % 8) {
+        const librii::g3d::CHR0Frame48 key{
+            .frame = static_cast<s16>(f * 32),
+            .value = static_cast<u16>(rng()),
+            .slope = static_cast<s16>(unit(rng) * 2048.0f),
+        };
+        track.frames.push_back(key);
+        keys.push_back({.frame = key.frame / 32.0f,
+                        .value = key.value * track.scale + track.offset,
+                        .tangent = key.slope / 256.0f});
+      }
+      node.tracks.push_back(static_cast<u32>(chr.tracks.size()));
+      chr.tracks.push_back(
+          {librii::g3d::CHR0Track{.step = 0.0f, .data = track}});
+      reference.push_back(std::move(keys));
+    }
+    chr.nodes.push_back(std::move(node));
+  }
+
+  auto sampler = librii::g3d::ChrSampler::compile(chr, model);
+  if (!sampler) {
+    fprintf(stderr, "Failed to compile CHR0: %s\n", sampler.error().c_str());
+    return false;
+  }
+  std::vector<f32> times(frames);
+  for (int f = 0; f < frames; ++f) {
+    times[f] = static_cast<f32>(f);
+  }
+  std::vector<librii::math::SRT3> srts(static_cast<size_t>(frames) * bones);
+  std::vector<glm::mat4> mtxs(bones);
+
+  auto t0 = std::chrono::steady_clock::now();
+  sampler->sampleSrtRange(times, srts);
+  auto t1 = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; ++f) {
+    sampler->computeMatrices(std::span(srts).subspan(f * bones, bones),
+                             librii::g3d::ScalingRule::Maya, mtxs);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  const double sample_s = std::chrono::duration<double>(t1 - t0).count();
+  const double mtx_s = std::chrono::duration<double>(t2 - t1).count();
+  printf("Sampled %d frames x %d bones in %.2f ms: %.1f ns per bone\n",
+         frames, bones, sample_s * 1000.0, sample_s * 1e9 / (frames * bones));
+  printf("Matrices: %.2f ms: %.1f ns per bone\n", mtx_s * 1000.0,
+         mtx_s * 1e9 / (frames * bones));
+
+  // One frame at a time, for comparison
+  t0 = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; ++f) {
+    sampler->sampleSrt(times[f], std::span(srts).subspan(f * bones, bones));
+  }
+  t1 = std::chrono::steady_clock::now();
+  const double single_s = std::chrono::duration<double>(t1 - t0).count();
+  printf("Per frame: %.2f ms: %.1f ns per bone\n", single_s * 1000.0,
+         single_s * 1e9 / (frames * bones));
+
+  f32 max_error = 0.0f;
+  t0 = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; ++f) {
+    for (int b = 0; b < bones; ++b) {
+      const f32* got = &srts[f * bones + b].rotation.x;
+      for (int a = 0; a < 6; ++a) {
+        const auto& keys = reference[b * 6 + a];
+        size_t k = 0;
+        while (k + 2 < keys.size() && keys[k + 1].frame <= times[f]) {
+          ++k;
+        }
+        f32 want = keys.back().value;
+        if (times[f] < keys.back().frame) {
+          want = librii::math::hermite(
+              times[f], keys[k].frame, keys[k].value, keys[k].tangent,
+              keys[k + 1].frame, keys[k + 1].value, keys[k + 1].tangent);
+        }
+        max_error = std::max(max_error, std::abs(want - got[a]));
+      }
+    }
+  }
+  t1 = std::chrono::steady_clock::now();
+  const double naive_s = std::chrono::duration<double>(t1 - t0).count();
+  printf("Naive hermite: %.2f ms: %.1f ns per bone (max error %g)\n",
+         naive_s * 1000.0, naive_s * 1e9 / (frames * bones), max_error);
+  // Observed: ~1.5e-4 on values up to 180
+  if (max_error > 1e-3f) {
+    fprintf(stderr, "Sampler disagrees with hermite by %g\n", max_error);
+    return false;
+  }
+  return true;
+}
+
+// Write |x| through the streaming JSON writer and the DOM writer, then read
+// both through the streaming reader. Each must give back the DOM's document.
+template <typename T>
+bool check_json_round_trip(const char* what, const T& x, auto dom_write,
+                           auto stream_write, auto stream_read) {
+  const std::string dom = dom_write(x);
+  std::stringstream streamed;
+  stream_write(streamed, x);
+  std::istringstream from_dom(dom);
+  bool ok = true;
+  auto check = [&](std::istream& in, const char* source) {
+    auto back = stream_read(in);
+    if (!back) {
+      fprintf(stderr, "%s: cannot read the %s's output: %s\n", what, source,
+              back.error().c_str());
+      ok = false;
+    } else if (dom_write(*back) != dom) {
+      fprintf(stderr, "%s: the %s's output reads back differently\n", what,
+              source);
+      ok = false;
+    }
+  };
+  check(streamed, "stream writer");
+  check(from_dom, "DOM writer");
+  printf("%s: JSON round trip %s\n", what, ok ? "OK" : "FAILED");
+  return ok;
+}
+
+// Whether two octrees hold the same tree, however their cells are numbered
+bool SameOctree(const librii::kcol::KCollisionOctree& a,
+                const librii::kcol::KCollisionOctree& b) {
+  using Cell = librii::kcol::KCollisionOctree::Cell;
+  std::function<bool(const Cell&, const Cell&)> same = [&](const Cell& x,
+                                                           const Cell& y) {
+    if (x.leaf != y.leaf) {
+      return false;
+    }
+    if (x.leaf) {
+      return std::ranges::equal(
+          std::span(a.prisms).subspan(x.first, x.count),
+          std::span(b.prisms).subspan(y.first, y.count));
+    }
+    for (u32 i = 0; i < 8; ++i) {
+      if (!same(a.cells[x.first + i], b.cells[y.first + i])) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (a.root_count != b.root_count) {
+    return false;
+  }
+  for (u32 i = 0; i < a.root_count; ++i) {
+    if (!same(a.cells[i], b.cells[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Check the streaming JSON reader and writer of a .kcl, .kmp or .brres
+// against the DOM path. KCL also round-trips through its binary writer.
+bool check_json(std::string from) {
+  auto file = OishiiReadFile2(from);
+  if (!file.has_value()) {
+    fprintf(stderr, "Cannot read %s\n", from.c_str());
+    return false;
+  }
+  if (from.ends_with(".kcl")) {
+    auto kcl = librii::kcol::ReadKCollisionData(*file, file->size());
+    if (!kcl) {
+      fprintf(stderr, "Failed to read KCL: %s\n", kcl.error().c_str());
+      return false;
+    }
+    bool ok = check_json_round_trip(
+        "KCL", *kcl,
+        [](const librii::kcol::KCollisionData& k) {
+          return librii::kcol::DumpJSON(k);
+        },
+        [](std::ostream& out, const librii::kcol::KCollisionData& k) {
+          librii::kcol::WriteJSON(out, k);
+        },
+        [](std::istream& in) { return librii::kcol::ReadJSON(in); });
+    auto bin = librii::kcol::WriteKCollisionData(*kcl);
+    if (!bin) {
+      fprintf(stderr, "KCL: cannot write: %s\n", bin.error().c_str());
+      return false;
+    }
+    auto back = librii::kcol::ReadKCollisionData(*bin, bin->size());
+    if (!back) {
+      fprintf(stderr, "KCL: cannot read back: %s\n", back.error().c_str());
+      return false;
+    }
+    // Not stored in the file
+    back->version = kcl->version;
+    // Cells may be numbered differently: the octree is compared by shape
+    const bool same_octree = SameOctree(back->octree, kcl->octree);
+    back->octree = kcl->octree;
+    if (!same_octree ||
+        librii::kcol::DumpJSON(*back) != librii::kcol::DumpJSON(*kcl)) {
+      fprintf(stderr, "KCL: binary round trip FAILED\n");
+      ok = false;
+    }
+    return ok;
+  }
+  if (from.ends_with(".kmp")) {
+    auto map = librii::kmp::readKMP(*file);
+    if (!map) {
+      fprintf(stderr, "Failed to read KMP: %s\n", map.error().c_str());
+      return false;
+    }
+    return check_json_round_trip(
+        "KMP", *map,
+        [](const librii::kmp::CourseMap& m) {
+          return librii::kmp::DumpJSON(m);
+        },
+        [](std::ostream& out, const librii::kmp::CourseMap& m) {
+          librii::kmp::WriteJSON(out, m);
+        },
+        [](std::istream& in) { return librii::kmp::ReadJSON(in); });
+  }
+  auto brres = librii::g3d::Archive::fromMemory(*file, from);
+  if (!brres) {
+    fprintf(stderr, "Failed to read BRRES: %s\n", brres.error().c_str());
+    return false;
+  }
+  bool ok = true;
+  for (auto& mdl : brres->models) {
+    ok &= check_json_round_trip(
+        mdl.name.c_str(), mdl,
+        [](const librii::g3d::Model& m) {
+          return librii::g3d::ModelToJSON(m);
+        },
+        [](std::ostream& out, const librii::g3d::Model& m) {
+          librii::g3d::WriteModelJSON(out, m);
+        },
+        [](std::istream& in) { return librii::g3d::ReadModelJSON(in); });
+  }
+  return ok;
+}
+
 extern bool gTestMode;
 
 #define ANNOUNCE(TITLE) printf("------\n" TITLE "\n\n")
@@ -220,9 +1127,48 @@ int main(int argc, const char** argv) {
   rsl::InitLLVM init_llvm(argc, argv);
 
   ANNOUNCE("Performing tasks");
-  if (argc < 3) {
+  if (argc >= 3 && !strcmp(argv[1], "bench")) {
+    bench_write(argv[2], argc > 3 ? std::stoi(argv[3]) : 100);
+  } else if (argc >= 3 && !strcmp(argv[1], "check-json")) {
+    if (!check_json(argv[2])) {
+      return 1;
+    }
+  } else if (argc >= 3 && !strcmp(argv[1], "bench-cmpr")) {
+    if (!bench_cmpr(argv[2], argc > 3 ? std::stoi(argv[3]) : 1)) {
+      return 1;
+    }
+  } else if (argc >= 3 && !strcmp(argv[1], "bench-history")) {
+    bench_history(argv[2], argc > 3 ? std::stoi(argv[3]) : 1'000);
+  } else if (argc >= 3 && !strcmp(argv[1], "bench-kcl")) {
+    bench_kcl(argv[2], argc > 3 ? std::stoi(argv[3]) : 1'000'000);
+  } else if (argc >= 3 && !strcmp(argv[1], "bench-vertex-decode")) {
+    bench_vertex_decode(argv[2], argc > 3 ? std::stoi(argv[3]) : 100);
+  } else if (argc >= 3 && !strcmp(argv[1], "bench-mat-dl")) {
+    bench_mat_dl(argv[2], argc > 3 ? std::stoi(argv[3]) : 1'000);
+  } else if (argc >= 2 && !strcmp(argv[1], "bench-anim")) {
+    if (!bench_anim(argc > 2 ? std::stoi(argv[2]) : 100,
+                    argc > 3 ? std::stoi(argv[3]) : 1'000)) {
+      return 1;
+    }
+  } else if (argc >= 2 && !strcmp(argv[1], "bench-dense-map")) {
+    bench_dense_map(argc > 2 ? std::stoi(argv[2]) : 100'000,
+                    argc > 3 ? std::stoi(argv[3]) : 10);
+  } else if (argc >= 2 && !strcmp(argv[1], "bench-pools")) {
+    bench_pools(argc > 2 ? std::stoi(argv[2]) : 10'000,
+                argc > 3 ? std::stoi(argv[3]) : 10);
+  } else if (argc < 3) {
     fprintf(stderr,
-            "Error: Too few arguments:\ntests.exe <from> <to> [check?]\n");
+            "Error: Too few arguments:\ntests.exe <from> <to> [check?]\n"
+            "tests.exe bench <model> [iterations]\n"
+            "tests.exe bench-pools [count] [iterations]\n"
+            "tests.exe check-json <kcl|kmp|brres>\n"
+            "tests.exe bench-cmpr <folder> [iterations]\n"
+            "tests.exe bench-history <brres> [edits]\n"
+            "tests.exe bench-dense-map [count] [iterations]\n"
+            "tests.exe bench-kcl <kcl> [rays]\n"
+            "tests.exe bench-vertex-decode <brres> [iterations]\n"
+            "tests.exe bench-mat-dl <brres> [iterations]\n"
+            "tests.exe bench-anim [bones] [frames]\n");
   } else {
     std::vector<s32> bps;
     for (int i = 4; i < argc; ++i) {